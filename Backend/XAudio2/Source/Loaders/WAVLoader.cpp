@@ -171,6 +171,16 @@ namespace EnSound
 			(*pwfx).mBitsPerSample = wf->wBitsPerSample;
 			(*pwfx).mCBSize = wf->cbSize;
 
+			// The size of the extensible fields was validated with the format tag above.
+			if (wf->wFormatTag == WAVE_FORMAT_EXTENSIBLE)
+			{
+				auto wfex = reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(wf);
+
+				(*pwfx).mValidBitsPerSample = wfex->Samples.wValidBitsPerSample;
+				(*pwfx).mChannelMask = wfex->dwChannelMask;
+				memcpy((*pwfx).mSubFormat, &wfex->SubFormat, sizeof((*pwfx).mSubFormat));
+			}
+
 			*pdata = ptr;
 			*dataSize = dataChunk->mSize;
 			return S_OK;
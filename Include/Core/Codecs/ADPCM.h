@@ -0,0 +1,193 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Codecs/Decoder.h"
+
+namespace EnSound
+{
+	/**
+	 * ADPCM Type enum.
+	 */
+	enum class ADPCMType : uint8 {
+		ADPCM_TYPE_UNKNOWN,
+		ADPCM_TYPE_MICROSOFT,
+		ADPCM_TYPE_IMA,
+	};
+
+	/**
+	 * Get the ADPCM type of a WAV format.
+	 *
+	 * @param format: The WAV format.
+	 * @return The ADPCM type. ADPCM_TYPE_UNKNOWN if the format is not ADPCM.
+	 */
+	ADPCMType GetADPCMType(const WAVFormat& format);
+
+	/**
+	 * Get the number of samples (per channel) stored in a single ADPCM block.
+	 *
+	 * @param type: The ADPCM type.
+	 * @param channels: The number of channels.
+	 * @param blockAlignment: The byte size of a single block.
+	 * @return The number of samples per block. 0 if the parameters are invalid.
+	 */
+	uint32 GetADPCMSamplesPerBlock(ADPCMType type, uint16 channels, uint16 blockAlignment);
+
+	/**
+	 * Create the WAV format of an ADPCM stream.
+	 *
+	 * @param type: The ADPCM type.
+	 * @param channels: The number of channels.
+	 * @param sampleRate: The sample rate of the audio.
+	 * @param blockAlignment: The byte size of a single block. Default is 512 bytes per channel.
+	 * @return The WAV format.
+	 */
+	WAVFormat CreateADPCMFormat(ADPCMType type, uint16 channels, uint64 sampleRate, uint16 blockAlignment = 0);
+
+	/**
+	 * Decode a single Microsoft ADPCM block.
+	 * The standard coefficient set is used, which is the only one XAudio2 accepts as well.
+	 *
+	 * @param pBlock: The compressed block.
+	 * @param channels: The number of channels.
+	 * @param samplesPerBlock: The number of samples per channel in the block.
+	 * @param pOutput: The interleaved output samples. Must hold samplesPerBlock * channels samples.
+	 * @return Boolean stating if the block was valid.
+	 */
+	bool DecodeMSADPCMBlock(const uint8* pBlock, uint16 channels, uint32 samplesPerBlock, int16* pOutput);
+
+	/**
+	 * Decode a single IMA (DVI) ADPCM block.
+	 *
+	 * @param pBlock: The compressed block.
+	 * @param channels: The number of channels.
+	 * @param samplesPerBlock: The number of samples per channel in the block.
+	 * @param pOutput: The interleaved output samples. Must hold samplesPerBlock * channels samples.
+	 * @return Boolean stating if the block was valid.
+	 */
+	bool DecodeIMAADPCMBlock(const uint8* pBlock, uint16 channels, uint32 samplesPerBlock, int16* pOutput);
+
+	/**
+	 * Encode interleaved 16 bit PCM samples to ADPCM.
+	 * This is meant to be used when importing assets. The last block is padded with silence.
+	 *
+	 * @param format: The ADPCM format to encode to (see CreateADPCMFormat()).
+	 * @param pSamples: The interleaved PCM samples.
+	 * @param frameCount: The number of frames (samples per channel).
+	 * @param output: The encoded blocks.
+	 * @return Boolean stating if the samples were encoded.
+	 */
+	bool EncodeADPCM(const WAVFormat& format, const int16* pSamples, uint64 frameCount, Vector<uint8>& output);
+
+	/**
+	 * Convert 16 bit PCM samples to normalized floating point samples.
+	 *
+	 * @param pSource: The source samples.
+	 * @param pDestination: The destination samples.
+	 * @param sampleCount: The number of samples to convert.
+	 */
+	void ConvertPCM16ToFloat(const int16* pSource, float* pDestination, uint64 sampleCount);
+
+	/**
+	 * ADPCM Decoder object.
+	 * This decodes ADPCM data directly from compressed memory, a single block at a time, so that the asset can stay
+	 * resident at a 4:1 ratio and only the block that is being played is expanded.
+	 */
+	class ADPCMDecoder final : public Decoder {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		ADPCMDecoder() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~ADPCMDecoder() {}
+
+		/**
+		 * Get the type of the decoder.
+		 *
+		 * @return DECODER_TYPE_ADPCM.
+		 */
+		virtual DecoderType GetType() const override { return DecoderType::DECODER_TYPE_ADPCM; }
+
+		/**
+		 * Initialize the decoder.
+		 * The decoder does not copy the audio data, so it must outlive the decoder.
+		 *
+		 * @param data: The WAV data.
+		 * @return Boolean stating if the data could be decoded.
+		 */
+		virtual bool Initialize(const WAVData& data) override;
+
+		/**
+		 * Terminate the decoder.
+		 */
+		virtual void Terminate() override;
+
+		/**
+		 * Decode frames to interleaved floating point samples.
+		 *
+		 * @param pOutput: The output samples. Must hold frameCount * channels samples.
+		 * @param frameCount: The number of frames to decode.
+		 * @return The number of frames decoded. Less than frameCount if the end of the data is reached.
+		 */
+		virtual uint64 Decode(float* pOutput, uint64 frameCount) override;
+
+		/**
+		 * Seek to a frame.
+		 * ADPCM blocks are independent, so this only selects the block containing the frame.
+		 *
+		 * @param frame: The frame to seek to.
+		 */
+		virtual void Seek(uint64 frame) override;
+
+		/**
+		 * Get the current frame position.
+		 *
+		 * @return The frame index.
+		 */
+		uint64 GetPosition() const { return mPosition; }
+
+		/**
+		 * Get the total number of frames.
+		 *
+		 * @return The frame count.
+		 */
+		uint64 GetFrameCount() const { return mFrameCount; }
+
+		/**
+		 * Get the number of channels.
+		 *
+		 * @return The channel count.
+		 */
+		uint16 GetChannels() const { return mChannels; }
+
+	private:
+		/**
+		 * Decode a block to the block cache.
+		 *
+		 * @param block: The block index.
+		 * @return Boolean stating if the block was decoded.
+		 */
+		bool DecodeBlock(uint64 block);
+
+	private:
+		Vector<int16> mBlockCache;	// Decoded samples of the current block.
+
+		const uint8* pData = nullptr;	// The compressed audio data.
+		uint64 mBlockCount = 0;	// The number of blocks, including a trailing partial block.
+		uint64 mFrameCount = 0;	// The total number of frames.
+		uint64 mPosition = 0;	// The current frame position.
+		uint64 mCachedBlock = ~0ULL;	// The block stored in the cache.
+
+		uint32 mSamplesPerBlock = 0;	// Samples per channel in a block.
+		uint32 mLastBlockSamples = 0;	// Samples per channel in the last block.
+		uint16 mChannels = 0;	// The number of channels.
+		uint16 mBlockAlignment = 0;	// The byte size of a block.
+
+		ADPCMType mType = ADPCMType::ADPCM_TYPE_UNKNOWN;	// The ADPCM type.
+	};
+}
\ No newline at end of file
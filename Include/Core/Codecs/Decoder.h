@@ -0,0 +1,89 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Formats/SeekTable.h"
+#include "Core/Formats/WAV/Format.h"
+
+namespace EnSound
+{
+	/**
+	 * Decoder Type enum.
+	 */
+	enum class DecoderType : uint8 {
+		DECODER_TYPE_UNKNOWN,
+		DECODER_TYPE_ADPCM,
+		DECODER_TYPE_MP3,
+		DECODER_TYPE_OGG,
+		DECODER_TYPE_FLAC,
+		DECODER_TYPE_XWMA,
+
+		DECODER_TYPE_MAX
+	};
+
+	/**
+	 * Decoder object.
+	 * This is the base class of all the decoders. Decoders are created once (which is where the expensive codec state
+	 * is allocated) and are then bound to an asset using Initialize() and unbound using Terminate(), any number of times.
+	 */
+	class Decoder {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		Decoder() {}
+
+		/**
+		 * Default destructor.
+		 */
+		virtual ~Decoder() {}
+
+		/**
+		 * Get the type of the decoder.
+		 *
+		 * @return The decoder type.
+		 */
+		virtual DecoderType GetType() const = 0;
+
+		/**
+		 * Bind the decoder to an asset.
+		 * The decoder does not copy the audio data, so it must outlive the binding.
+		 *
+		 * @param data: The WAV data of the asset, including its seek table.
+		 * @return Boolean stating if the data could be decoded.
+		 */
+		virtual bool Initialize(const WAVData& data) = 0;
+
+		/**
+		 * Unbind the decoder from its asset.
+		 */
+		virtual void Terminate() = 0;
+
+		/**
+		 * Decode frames to interleaved floating point samples.
+		 *
+		 * @param pOutput: The output samples. Must hold frameCount * channels samples.
+		 * @param frameCount: The number of frames to decode.
+		 * @return The number of frames decoded. Less than frameCount if the end of the data is reached.
+		 */
+		virtual uint64 Decode(float* pOutput, uint64 frameCount) = 0;
+
+		/**
+		 * Seek to a frame.
+		 *
+		 * @param frame: The frame to seek to.
+		 */
+		virtual void Seek(uint64 frame) = 0;
+
+		/**
+		 * Seek to a frame through a seek point of the asset's seek table, see WAVData::pFrameSeekTable.
+		 * Decoders of packetized formats resume decoding at the byte offset of the point and discard the frames up to
+		 * the one asked for. Decoders which can seek directly, such as ADPCM, ignore the point.
+		 *
+		 * @param point: The seek point at or before the frame.
+		 * @param frame: The frame to seek to.
+		 */
+		virtual void SeekFrom(const SeekPoint& point, uint64 frame);
+	};
+}
\ No newline at end of file
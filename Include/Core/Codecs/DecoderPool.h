@@ -0,0 +1,101 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Codecs/Decoder.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace EnSound
+{
+	/**
+	 * Decoder Pool Stats structure.
+	 * This contains the occupancy of a single codec's pool.
+	 */
+	struct DecoderPoolStats {
+		uint32 mCapacity = 0;	// The number of pre-created decoders.
+		uint32 mBorrowed = 0;	// The number of decoders currently in use.
+		uint32 mPeakBorrowed = 0;	// The highest number of decoders in use at once.
+		uint64 mFailedBorrows = 0;	// The number of borrows which failed because the pool was exhausted.
+	};
+
+	/**
+	 * Decoder Pool object.
+	 * This holds a bounded number of pre-created decoders per codec so that starting a compressed sound only binds an
+	 * existing decoder to the asset and seeks it, instead of creating the codec state from scratch.
+	 */
+	class DecoderPool {
+	public:
+		using Factory = std::function<std::unique_ptr<Decoder>()>;
+
+	public:
+		/**
+		 * Default constructor.
+		 */
+		DecoderPool() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~DecoderPool() {}
+
+		/**
+		 * Create the decoders of a codec.
+		 * Calling this again for the same type replaces the pool, so no decoder of that type may be borrowed.
+		 *
+		 * @param type: The decoder type.
+		 * @param capacity: The maximum number of decoders of this type.
+		 * @param factory: The function used to create a single decoder.
+		 */
+		void Initialize(DecoderType type, uint32 capacity, const Factory& factory);
+
+		/**
+		 * Destroy all the decoders. No decoder may be borrowed.
+		 */
+		void Terminate();
+
+		/**
+		 * Borrow a decoder and bind it to an asset.
+		 *
+		 * @param type: The decoder type.
+		 * @param data: The WAV data of the asset.
+		 * @param startFrame: The frame to seek to, through the seek table of the asset if it has one. Default is 0.
+		 * @return The decoder pointer. nullptr if the pool is exhausted or the asset could not be bound.
+		 */
+		Decoder* Borrow(DecoderType type, const WAVData& data, uint64 startFrame = 0);
+
+		/**
+		 * Return a borrowed decoder back to the pool.
+		 * Decoders which are not borrowed from this pool, such as one returned twice, are rejected.
+		 *
+		 * @param pDecoder: The decoder pointer.
+		 */
+		void Return(Decoder* pDecoder);
+
+		/**
+		 * Get the occupancy of a codec's pool.
+		 *
+		 * @param type: The decoder type.
+		 * @return The pool stats.
+		 */
+		DecoderPoolStats GetStats(DecoderType type) const;
+
+	private:
+		/**
+		 * Pool structure.
+		 * This holds the decoders of a single codec.
+		 */
+		struct Pool {
+			Vector<std::unique_ptr<Decoder>> mDecoders;	// All the decoders.
+			Vector<bool> mIsBorrowed;	// Whether each decoder of mDecoders is borrowed.
+			Vector<Decoder*> mFreeDecoders;	// The decoders which are not borrowed.
+			DecoderPoolStats mStats = {};	// The occupancy of the pool.
+		};
+
+		Pool mPools[static_cast<uint8>(DecoderType::DECODER_TYPE_MAX)] = {};	// The pools, indexed by the decoder type.
+		mutable std::mutex mMutex;	// Guards the pools.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,113 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DSP/FFT.h"
+
+namespace EnSound
+{
+	/**
+	 * Convolution Kernel structure.
+	 * This is an impulse response cut into partitions of one block each, stored as the spectra of the zero padded
+	 * partitions. Kernels are created by a UniformConvolver and can be shared by every convolver of the same block size.
+	 */
+	struct ConvolutionKernel {
+		Vector<float> mReal;	// The real parts of the partition spectra, back to back.
+		Vector<float> mImaginary;	// The imaginary parts of the partition spectra, back to back.
+		uint32 mBlockSize = 0;	// The block size of the partitions.
+		uint32 mPartitionCount = 0;	// The number of partitions.
+	};
+
+	/**
+	 * Uniform Convolver object.
+	 * This convolves a signal with impulse responses using uniformly partitioned overlap save convolution. Every block,
+	 * the input is transformed once and stored in a frequency domain delay line, and an output block costs one complex
+	 * multiply and add per partition and a single inverse FFT. The latency is zero beyond the block itself.
+	 *
+	 * As the delay line only depends on the input, the same input can be convolved with several kernels, which is how
+	 * filters are swapped with a crossfade and how one input is rendered to several outputs.
+	 */
+	class UniformConvolver {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		UniformConvolver() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~UniformConvolver() {}
+
+		/**
+		 * Initialize the convolver.
+		 *
+		 * @param blockSize: The number of samples per block. This must be a power of two.
+		 * @param partitionCount: The maximum number of partitions of the kernels.
+		 */
+		void Initialize(uint32 blockSize, uint32 partitionCount);
+
+		/**
+		 * Terminate the convolver.
+		 */
+		void Terminate();
+
+		/**
+		 * Create a kernel from an impulse response.
+		 *
+		 * @param pImpulse: The impulse response samples.
+		 * @param length: The number of samples. The samples past the partition count of the convolver are dropped.
+		 * @param kernel: The created kernel.
+		 */
+		void CreateKernel(const float* pImpulse, uint64 length, ConvolutionKernel& kernel);
+
+		/**
+		 * Push the next block of input.
+		 *
+		 * @param pInput: The block size input samples.
+		 */
+		void PushInput(const float* pInput);
+
+		/**
+		 * Convolve the pushed input with a kernel.
+		 *
+		 * @param kernel: The kernel, created with the same block size.
+		 * @param pOutput: The block size output samples.
+		 */
+		void Convolve(const ConvolutionKernel& kernel, float* pOutput);
+
+		/**
+		 * Clear the input history.
+		 */
+		void Reset();
+
+		/**
+		 * Get the block size.
+		 *
+		 * @return The number of samples per block.
+		 */
+		uint32 GetBlockSize() const { return mBlockSize; }
+
+		/**
+		 * Get the maximum number of partitions.
+		 *
+		 * @return The partition count.
+		 */
+		uint32 GetPartitionCount() const { return mPartitionCount; }
+
+	private:
+		FFT mFFT = {};	// The transform of twice the block size.
+
+		Vector<float> mInput;	// The last two blocks of input.
+		Vector<float> mHistoryReal;	// The frequency domain delay line, one spectrum per partition.
+		Vector<float> mHistoryImaginary;	// The frequency domain delay line, one spectrum per partition.
+		Vector<float> mSumReal;	// The output spectrum.
+		Vector<float> mSumImaginary;	// The output spectrum.
+		Vector<float> mTime;	// The time domain scratch memory.
+
+		uint32 mBlockSize = 0;	// The number of samples per block.
+		uint32 mPartitionCount = 0;	// The length of the delay line.
+		uint32 mHistoryHead = 0;	// The delay line entry of the newest input block.
+	};
+}
\ No newline at end of file
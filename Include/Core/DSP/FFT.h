@@ -0,0 +1,105 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * FFT object.
+	 * This is a real to complex FFT of a power of two size, computed as a complex FFT of half the size. Spectra are
+	 * stored as split real and imaginary arrays of size / 2 + 1 bins, which is the layout the SIMD complex multiply
+	 * works on. The object holds scratch memory, so every thread needs its own.
+	 */
+	class FFT {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		FFT() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~FFT() {}
+
+		/**
+		 * Initialize the FFT.
+		 *
+		 * @param size: The number of real samples. This must be a power of two, at least 4.
+		 */
+		void Initialize(uint32 size);
+
+		/**
+		 * Terminate the FFT.
+		 */
+		void Terminate();
+
+		/**
+		 * Compute the spectrum of a real signal.
+		 *
+		 * @param pInput: The size samples.
+		 * @param pReal: The size / 2 + 1 real parts.
+		 * @param pImaginary: The size / 2 + 1 imaginary parts.
+		 */
+		void Forward(const float* pInput, float* pReal, float* pImaginary);
+
+		/**
+		 * Compute a real signal from its spectrum. The output is scaled so that Inverse(Forward(x)) is x.
+		 *
+		 * @param pReal: The size / 2 + 1 real parts.
+		 * @param pImaginary: The size / 2 + 1 imaginary parts.
+		 * @param pOutput: The size samples.
+		 */
+		void Inverse(const float* pReal, const float* pImaginary, float* pOutput);
+
+		/**
+		 * Get the number of real samples.
+		 *
+		 * @return The size.
+		 */
+		uint32 GetSize() const { return mSize; }
+
+		/**
+		 * Get the number of bins of a spectrum.
+		 *
+		 * @return The bin count.
+		 */
+		uint32 GetBinCount() const { return mSize / 2 + 1; }
+
+	private:
+		/**
+		 * Compute the complex FFT of half the size in place.
+		 *
+		 * @param pReal: The real parts.
+		 * @param pImaginary: The imaginary parts.
+		 */
+		void Transform(float* pReal, float* pImaginary) const;
+
+	private:
+		Vector<uint32> mBitReversal;	// The bit reversed index of every complex sample.
+		Vector<float> mStageReal;	// The twiddles of every stage, back to back.
+		Vector<float> mStageImaginary;	// The twiddles of every stage, back to back.
+		Vector<float> mSplitReal;	// The twiddles which split the half size transform into the real spectrum.
+		Vector<float> mSplitImaginary;	// The twiddles which split the half size transform into the real spectrum.
+		Vector<float> mScratchReal;	// The complex scratch memory.
+		Vector<float> mScratchImaginary;	// The complex scratch memory.
+
+		uint32 mSize = 0;	// The number of real samples.
+	};
+
+	/**
+	 * Multiply two spectra and add the result to a third one.
+	 *
+	 * @param pReal: The real parts to add to.
+	 * @param pImaginary: The imaginary parts to add to.
+	 * @param pLeftReal: The real parts of the first spectrum.
+	 * @param pLeftImaginary: The imaginary parts of the first spectrum.
+	 * @param pRightReal: The real parts of the second spectrum.
+	 * @param pRightImaginary: The imaginary parts of the second spectrum.
+	 * @param binCount: The number of bins.
+	 */
+	void MultiplyAccumulateSpectrum(float* pReal, float* pImaginary, const float* pLeftReal, const float* pLeftImaginary, const float* pRightReal, const float* pRightImaginary, uint32 binCount);
+}
\ No newline at end of file
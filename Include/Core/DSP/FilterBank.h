@@ -0,0 +1,129 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * Filter Type enum.
+	 */
+	enum class FilterType : uint8 {
+		FILTER_TYPE_NONE,
+		FILTER_TYPE_LOW_PASS,
+		FILTER_TYPE_HIGH_PASS,
+		FILTER_TYPE_BAND_PASS,
+	};
+
+	/**
+	 * Filter Parameters structure.
+	 */
+	struct FilterParameters {
+		FilterType mType = FilterType::FILTER_TYPE_NONE;	// The filter type. A filter of no type passes its input through.
+		float mCutoff = 1000.0f;	// The cutoff, or center, frequency in Hz.
+		float mResonance = 0.7071f;	// The quality factor. 0.7071 is the flattest response without a peak.
+	};
+
+	/**
+	 * Filter Bank object.
+	 * This holds many mono state variable filters and processes them four at a time, one filter per SIMD lane, so the
+	 * per voice filters used for occlusion and distance cost about a quarter of filtering every voice on its own. The
+	 * filters are the trapezoidal integrated state variable filter, which stays stable when its coefficients move
+	 * every frame.
+	 *
+	 * Parameter changes do not step: every filter interpolates its coefficients from the ones it ended the last ramp
+	 * with to the ones of its new parameters, across the ramp length given to Process(). States which decay below the
+	 * denormal range are flushed to zero after every call.
+	 */
+	class FilterBank {
+	public:
+		static const uint32 LaneCount = 4;	// The number of filters processed together.
+		static const uint32 InvalidFilter = ~0U;	// The index of an unused lane.
+
+	public:
+		/**
+		 * Default constructor.
+		 */
+		FilterBank() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~FilterBank() {}
+
+		/**
+		 * Initialize the bank. All the filters pass their input through.
+		 *
+		 * @param capacity: The number of filters.
+		 * @param sampleRate: The sample rate of the filtered signals.
+		 */
+		void Initialize(uint32 capacity, uint32 sampleRate);
+
+		/**
+		 * Terminate the bank.
+		 */
+		void Terminate();
+
+		/**
+		 * Set the parameters of a filter. The coefficients move to the new ones across the next ramp.
+		 *
+		 * @param filter: The filter index.
+		 * @param parameters: The filter parameters.
+		 */
+		void SetFilter(uint32 filter, const FilterParameters& parameters);
+
+		/**
+		 * Get the parameters of a filter.
+		 *
+		 * @param filter: The filter index.
+		 * @return The filter parameters.
+		 */
+		const FilterParameters& GetFilter(uint32 filter) const { return mParameters[filter]; }
+
+		/**
+		 * Clear the state of a filter and jump to its current coefficients, as for a new voice.
+		 *
+		 * @param filter: The filter index.
+		 */
+		void Reset(uint32 filter);
+
+		/**
+		 * Move a filter, its state included, to another index.
+		 *
+		 * @param source: The index of the filter to move.
+		 * @param destination: The index to move it to.
+		 */
+		void Move(uint32 source, uint32 destination);
+
+		/**
+		 * Process a part of a ramp for four filters.
+		 * The filters which reach the end of the ramp keep their new coefficients as the start of the next one.
+		 *
+		 * @param pFilters: The four filter indexes. InvalidFilter for the unused lanes.
+		 * @param pSamples: The samples of the four filters, the four lanes of a frame together. They are filtered in place.
+		 * @param offset: The index in the ramp of the first frame.
+		 * @param frameCount: The number of frames.
+		 * @param rampLength: The number of frames the coefficients are interpolated across, usually the block frames.
+		 */
+		void Process(const uint32* pFilters, float* pSamples, uint32 offset, uint32 frameCount, uint32 rampLength);
+
+		/**
+		 * Get the number of filters.
+		 *
+		 * @return The capacity.
+		 */
+		uint32 GetCapacity() const { return static_cast<uint32>(mParameters.size()); }
+
+	private:
+		static const uint32 CoefficientCount = 6;	// The integrator coefficients a1, a2, a3 and the output mix m0, m1, m2.
+
+		Vector<FilterParameters> mParameters;	// The parameters of every filter.
+		Vector<float> mCoefficients;	// The coefficients of the parameters of every filter.
+		Vector<float> mPreviousCoefficients;	// The coefficients every filter ended its last ramp with.
+		Vector<float> mStates;	// The two integrator states of every filter.
+
+		uint32 mSampleRate = 48000;	// The sample rate of the filtered signals.
+	};
+}
\ No newline at end of file
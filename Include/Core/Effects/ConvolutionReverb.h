@@ -0,0 +1,197 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DSP/Convolver.h"
+#include "Core/Formats/WAV/Format.h"
+#include "Core/Mixing/BusGraph.h"
+
+namespace EnSound
+{
+	/**
+	 * Convolution Reverb Description structure.
+	 */
+	struct ConvolutionReverbDescription {
+		JobSystem* pJobSystem = nullptr;	// The job system the tail is computed on. nullptr to compute it on the mixer thread.
+		uint32 mChannelCount = 2;	// The number of channels of the bus.
+		uint32 mBlockFrames = 256;	// The number of frames in a block, which is the head partition size. This must be a power of two.
+		uint32 mMaxPartitionFrames = 16384;	// The largest tail partition size. This must be a power of two.
+		float mWetGain = 1.0f;	// The gain of the reverberated signal.
+		float mDryGain = 1.0f;	// The gain of the original signal.
+	};
+
+	/**
+	 * Convolution Reverb object.
+	 * This is a bus effect which convolves the bus with an impulse response using non uniformly partitioned
+	 * convolution. The impulse response is cut into segments of growing partition sizes (four times larger each time,
+	 * up to the maximum): the head segment uses block sized partitions and is convolved on the mixer thread with no
+	 * added latency, and every tail segment of partition size N starts 2N frames into the response. A tail segment
+	 * collects N frames of input and then convolves them on a worker while the next N frames play, so each tail job
+	 * has a whole partition worth of time to complete and the mixer only waits if a worker falls that far behind.
+	 *
+	 * The spectra of the partitions can be cached on disk, keyed by the impulse response and the partition layout, so
+	 * long responses load without running their FFTs again.
+	 *
+	 * The impulse response must not be changed while the bus is being rendered.
+	 */
+	class ConvolutionReverb final : public BusEffect {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		ConvolutionReverb() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~ConvolutionReverb() {}
+
+		/**
+		 * Initialize the reverb.
+		 *
+		 * @param description: The reverb description.
+		 * @return Boolean stating if the description was valid.
+		 */
+		bool Initialize(const ConvolutionReverbDescription& description);
+
+		/**
+		 * Terminate the reverb, waiting for the tail jobs.
+		 */
+		void Terminate();
+
+		/**
+		 * Load the impulse response from WAV data, as returned by the WAV loader.
+		 * 16, 24 and 32 bit PCM, 32 bit float and ADPCM data are supported.
+		 *
+		 * @param data: The WAV data.
+		 * @param pCacheFileName: The file the partition spectra are cached in. nullptr to skip the cache.
+		 * @return Boolean stating if the impulse response was loaded.
+		 */
+		bool LoadImpulse(const WAVData& data, const wchar* pCacheFileName = nullptr);
+
+		/**
+		 * Set the impulse response.
+		 * Every channel of the bus is convolved with the channel of the response of the same index, wrapping around,
+		 * so a mono response applies to every channel.
+		 *
+		 * @param pSamples: The interleaved samples.
+		 * @param frameCount: The number of frames.
+		 * @param channelCount: The number of channels.
+		 * @param pCacheFileName: The file the partition spectra are cached in. nullptr to skip the cache.
+		 * @return Boolean stating if the impulse response was set.
+		 */
+		bool SetImpulse(const float* pSamples, uint64 frameCount, uint32 channelCount, const wchar* pCacheFileName = nullptr);
+
+		/**
+		 * Set the gains. Changes ramp across the next block.
+		 *
+		 * @param wetGain: The gain of the reverberated signal.
+		 * @param dryGain: The gain of the original signal.
+		 */
+		void SetGains(float wetGain, float dryGain) { mWetGain = wetGain; mDryGain = dryGain; }
+
+		/**
+		 * Get the number of segments the impulse response is cut into, the head included.
+		 *
+		 * @return The segment count.
+		 */
+		uint32 GetSegmentCount() const { return static_cast<uint32>(mSegments.size()); }
+
+		/**
+		 * Process a block.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block. This must be the block frames of the description.
+		 * @param channelCount: The number of channels of the bus. This must be the channel count of the description.
+		 */
+		void Process(float* pBuffer, uint32 frameCount, uint32 channelCount) override;
+
+		/**
+		 * Check if the tail has decayed, once the input has been silent for the length of the impulse response.
+		 *
+		 * @return Boolean value.
+		 */
+		bool IsTailSilent() const override { return mSegments.empty() || mSilentFrames >= GetTailFrames(); }
+
+	private:
+		/**
+		 * Segment structure.
+		 * This is the part of the impulse response convolved with a single partition size.
+		 */
+		struct Segment {
+			Vector<UniformConvolver> mConvolvers;	// The convolver of every bus channel.
+			Vector<ConvolutionKernel> mKernels;	// The kernel of every impulse response channel.
+			Vector<float> mInputs;	// Two slots of partition frames of input per bus channel.
+			Vector<float> mOutputs;	// Two slots of partition frames of output per bus channel.
+			JobCounter mJobs = {};	// The tail jobs in flight.
+
+			uint64 mStart = 0;	// The first frame of the impulse response in the segment.
+			uint64 mLength = 0;	// The number of frames of the impulse response in the segment.
+			uint32 mPartitionFrames = 0;	// The partition size.
+			uint32 mJobSlot = 0;	// The slot the tail jobs read and write.
+		};
+
+		/**
+		 * Get the number of frames of silent input after which the output is silent.
+		 *
+		 * @return The frame count.
+		 */
+		uint64 GetTailFrames() const { return mImpulseFrames + static_cast<uint64>(mDescription.mMaxPartitionFrames) * 2; }
+
+		/**
+		 * Cut an impulse response into segments.
+		 *
+		 * @param frameCount: The number of frames of the impulse response.
+		 * @param impulseChannels: The number of channels of the impulse response.
+		 */
+		void CreateSegments(uint64 frameCount, uint32 impulseChannels);
+
+		/**
+		 * Wait for the tail jobs and release the segments.
+		 */
+		void ClearSegments();
+
+		/**
+		 * Load the partition spectra from a cache file.
+		 *
+		 * @param pFileName: The cache file.
+		 * @param hash: The hash of the impulse response.
+		 * @return Boolean stating if the cache matched the impulse response.
+		 */
+		bool LoadCache(const wchar* pFileName, uint64 hash);
+
+		/**
+		 * Save the partition spectra to a cache file.
+		 *
+		 * @param pFileName: The cache file.
+		 * @param hash: The hash of the impulse response.
+		 */
+		void SaveCache(const wchar* pFileName, uint64 hash) const;
+
+		/**
+		 * Convolve the last collected input of a tail segment for one channel.
+		 *
+		 * @param pData: The segment.
+		 * @param channel: The bus channel.
+		 */
+		static void TailJob(void* pData, uint64 channel);
+
+	private:
+		Vector<std::unique_ptr<Segment>> mSegments;	// The segments, the head first.
+		Vector<float> mChannels;	// The deinterleaved block of every channel.
+		Vector<float> mWet;	// The reverberated block of every channel.
+		Vector<float> mRamps;	// The wet and dry gain ramps.
+
+		ConvolutionReverbDescription mDescription = {};	// The reverb description.
+		uint64 mFramePosition = 0;	// The number of frames processed.
+		uint64 mSilentFrames = 0;	// The number of frames of silent input since the last sound.
+		uint64 mImpulseFrames = 0;	// The number of frames of the impulse response.
+		uint32 mImpulseChannels = 0;	// The number of channels of the impulse response.
+
+		float mWetGain = 1.0f;	// The wet gain.
+		float mDryGain = 1.0f;	// The dry gain.
+		float mPreviousWetGain = 1.0f;	// The wet gain at the end of the last block.
+		float mPreviousDryGain = 1.0f;	// The dry gain at the end of the last block.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,192 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Mixing/BusGraph.h"
+
+namespace EnSound
+{
+	/**
+	 * Dynamics Mode enum.
+	 */
+	enum class DynamicsMode : uint8 {
+		DYNAMICS_MODE_COMPRESSOR,	// Reduces the level above the threshold by the ratio, with a soft knee.
+		DYNAMICS_MODE_LIMITER,	// Never lets a peak above the threshold through. The ratio, knee, attack and detector are ignored.
+	};
+
+	/**
+	 * Dynamics Detector enum.
+	 */
+	enum class DynamicsDetector : uint8 {
+		DYNAMICS_DETECTOR_PEAK,	// The largest absolute sample of the channels.
+		DYNAMICS_DETECTOR_RMS,	// The mean square of the channels, averaged across the RMS time.
+	};
+
+	/**
+	 * Dynamics Parameters structure.
+	 */
+	struct DynamicsParameters {
+		DynamicsMode mMode = DynamicsMode::DYNAMICS_MODE_COMPRESSOR;	// The processing mode.
+		DynamicsDetector mDetector = DynamicsDetector::DYNAMICS_DETECTOR_PEAK;	// The level detector of the compressor.
+		float mThreshold = -12.0f;	// The level in dB above which the gain is reduced.
+		float mRatio = 4.0f;	// The input to output ratio of the level above the threshold.
+		float mKnee = 6.0f;	// The width in dB of the soft knee around the threshold.
+		float mAttackTime = 0.005f;	// The time in seconds the gain reduction takes to increase.
+		float mReleaseTime = 0.1f;	// The time in seconds the gain reduction takes to decrease.
+		float mRmsTime = 0.01f;	// The averaging time in seconds of the RMS detector.
+		float mRange = 60.0f;	// The largest gain reduction in dB. Ducking usually limits it to 10 to 20 dB.
+		float mMakeupGain = 0.0f;	// The gain in dB applied after the compressor, or before the limiter so the threshold still holds.
+	};
+
+	/**
+	 * Dynamics Processor Description structure.
+	 */
+	struct DynamicsProcessorDescription {
+		DynamicsParameters mParameters = {};	// The initial parameters.
+		uint32 mChannelCount = 2;	// The number of channels of the bus.
+		uint32 mSampleRate = 48000;	// The sample rate of the bus.
+		uint32 mBlockFrames = 256;	// The largest number of frames in a block.
+		float mLookaheadTime = 0.005f;	// The time in seconds the output is delayed by, so the gain moves before the peaks arrive.
+	};
+
+	/**
+	 * Dynamics Processor object.
+	 * This is a bus effect which reduces the gain of loud passages. As a limiter on the master bus it keeps the sum of
+	 * many voices from clipping, so the voices need no headroom of their own. As a compressor it evens out a submix,
+	 * and keyed by the sidechain of its bus, such as dialogue, it ducks the bus under the key signal.
+	 *
+	 * The output is delayed by the lookahead time and the gain is computed from the undelayed input, so the gain is
+	 * already reduced when a transient comes out. The limiter holds the smallest gain needed within the lookahead and
+	 * averages it across the lookahead, which reaches the needed gain exactly when the peak comes out and never lets it
+	 * through. The compressor follows a soft knee gain curve with attack and release smoothing in the log domain.
+	 *
+	 * The level detection runs on all the channels of several frames at once with SIMD, and the logarithms and
+	 * exponentials use fast approximations, so the per frame cost is a few tens of operations. Only the smoothing runs
+	 * frame by frame.
+	 */
+	class DynamicsProcessor final : public BusEffect {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		DynamicsProcessor() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~DynamicsProcessor() {}
+
+		/**
+		 * Initialize the processor.
+		 *
+		 * @param description: The processor description.
+		 */
+		void Initialize(const DynamicsProcessorDescription& description);
+
+		/**
+		 * Terminate the processor.
+		 */
+		void Terminate();
+
+		/**
+		 * Set the parameters. Changes apply from the next block.
+		 *
+		 * @param parameters: The parameters.
+		 */
+		void SetParameters(const DynamicsParameters& parameters) { mParameters = parameters; }
+
+		/**
+		 * Get the parameters.
+		 *
+		 * @return The parameters.
+		 */
+		const DynamicsParameters& GetParameters() const { return mParameters; }
+
+		/**
+		 * Get the largest gain reduction of the last block, for metering. This can be called from any thread.
+		 *
+		 * @return The gain reduction in dB, 0 or more.
+		 */
+		float GetGainReduction() const { return mGainReduction.load(std::memory_order_relaxed); }
+
+		/**
+		 * Clear the lookahead delay and the gain reduction.
+		 */
+		void Reset();
+
+		/**
+		 * Process a block, keyed by the block itself.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block. This must not be more than the block frames of the description.
+		 * @param channelCount: The number of channels of the bus. This must be the channel count of the description.
+		 */
+		void Process(float* pBuffer, uint32 frameCount, uint32 channelCount) override;
+
+		/**
+		 * Process a block, keyed by the sidechain.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param pSidechain: The interleaved key block. nullptr if the key is silent.
+		 * @param frameCount: The number of frames in the block. This must not be more than the block frames of the description.
+		 * @param channelCount: The number of channels of the bus. This must be the channel count of the description.
+		 */
+		void ProcessWithSidechain(float* pBuffer, const float* pSidechain, uint32 frameCount, uint32 channelCount) override;
+
+		/**
+		 * Check if the lookahead delay only holds silence and the gain reduction has fully released.
+		 *
+		 * @return Boolean value.
+		 */
+		bool IsTailSilent() const override;
+
+	private:
+		/**
+		 * Compute the compressor gains of a block.
+		 *
+		 * @param pKey: The interleaved key block. nullptr for silence.
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void ComputeCompressorGains(const float* pKey, uint32 frameCount);
+
+		/**
+		 * Compute the limiter gains of a block.
+		 *
+		 * @param pKey: The interleaved key block. nullptr for silence.
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void ComputeLimiterGains(const float* pKey, uint32 frameCount);
+
+		/**
+		 * Delay a block by the lookahead and apply the gains to it.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void ApplyGains(float* pBuffer, uint32 frameCount);
+
+	private:
+		Vector<float> mDelay;	// The lookahead frames followed by the current block, interleaved.
+		Vector<float> mLevels;	// The detected level of every frame of a block.
+		Vector<float> mGains;	// The linear gain of every frame of a block.
+		Vector<float> mHeldGains;	// The ring buffer of the limiter's held gains across the lookahead window.
+		Vector<float> mMinimumGains;	// The limiter's ascending queue of the smallest needed gains in the window.
+		Vector<uint64> mMinimumFrames;	// The frame every gain of the queue was needed at.
+
+		DynamicsProcessorDescription mDescription = {};	// The processor description.
+		DynamicsParameters mParameters = {};	// The current parameters.
+		std::atomic<float> mGainReduction = 0.0f;	// The largest gain reduction of the last block in dB.
+
+		double mHeldSum = 0.0;	// The sum of the held gains in the window.
+		uint64 mFramePosition = 0;	// The number of frames processed.
+		uint64 mSilentFrames = 0;	// The number of frames of silent input since the last sound.
+		uint32 mLookaheadFrames = 0;	// The lookahead delay in frames.
+		uint32 mMinimumBegin = 0;	// The ring index of the first entry of the queue.
+		uint32 mMinimumCount = 0;	// The number of entries in the queue.
+
+		float mMeanSquare = 0.0f;	// The state of the RMS detector.
+		float mReduction = 0.0f;	// The smoothed gain reduction of the compressor, in log2 units, 0 or less.
+		float mLimiterGain = 1.0f;	// The released gain of the limiter.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,209 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Mixing/BusGraph.h"
+
+namespace EnSound
+{
+	/**
+	 * FDN Matrix enum.
+	 * The feedback matrix mixes the output of every delay line into the input of every other one.
+	 */
+	enum class FDNMatrix : uint8 {
+		FDN_MATRIX_HOUSEHOLDER,	// I - 2/N, every line feeds every other line equally. The cheapest one.
+		FDN_MATRIX_HADAMARD,	// The scaled Hadamard matrix, which spreads energy between the lines faster.
+	};
+
+	/**
+	 * FDN Reverb Parameters structure.
+	 */
+	struct FDNReverbParameters {
+		float mSize = 0.5f;	// The room size from 0 to 1, which scales the delay lines from a quarter to twice their base lengths.
+		float mDecayTime = 1.5f;	// The time in seconds it takes the low frequencies to decay by 60 dB.
+		float mDamping = 0.3f;	// How much faster the high frequencies decay, from 0 to 1.
+		float mDiffusion = 1.0f;	// How much the lines are mixed together, from 0 (independent combs) to 1 (the full matrix).
+	};
+
+	/**
+	 * FDN Reverb Description structure.
+	 */
+	struct FDNReverbDescription {
+		FDNReverbParameters mParameters = {};	// The initial parameters.
+		uint32 mChannelCount = 2;	// The number of channels of the bus.
+		uint32 mSampleRate = 48000;	// The sample rate of the bus.
+		uint32 mBlockFrames = 256;	// The largest number of frames in a block.
+		uint32 mLineCount = 8;	// The number of delay lines, 8 or 16.
+		FDNMatrix mMatrix = FDNMatrix::FDN_MATRIX_HADAMARD;	// The feedback matrix.
+		float mWetGain = 0.3f;	// The gain of the reverberated signal.
+		float mDryGain = 1.0f;	// The gain of the original signal.
+	};
+
+	/**
+	 * FDN Reverb object.
+	 * This is a bus effect which runs the bus through a feedback delay network: the channels are summed into 8 or 16
+	 * delay lines whose outputs go through a one pole damping lowpass and a decay gain, and are then mixed back into
+	 * their inputs through an orthogonal feedback matrix. The lines are processed four at a time with SIMD, so an
+	 * instance costs a few hundred operations per frame and many of them can run side by side, one per reverb zone.
+	 *
+	 * Every line only reads frames written at least its length ago, so a whole chunk of frames is read from the lines,
+	 * run through the filters and the matrix frame by frame, and written back line by line.
+	 *
+	 * A 16 line network can drop to its first 8 lines, usually when the mix is over its CPU budget, and back. The
+	 * feedback and the outputs of the two networks crossfade across a block, so the switch does not click.
+	 *
+	 * The parameters can be changed every block. The decay, damping and diffusion ramp across the next block and a
+	 * size change glides the delay lengths across it, which bends the pitch of the tail slightly instead of clicking.
+	 */
+	class FDNReverb final : public BusEffect {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		FDNReverb() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~FDNReverb() {}
+
+		/**
+		 * Initialize the reverb.
+		 *
+		 * @param description: The reverb description.
+		 */
+		void Initialize(const FDNReverbDescription& description);
+
+		/**
+		 * Terminate the reverb.
+		 */
+		void Terminate();
+
+		/**
+		 * Set the parameters. Changes apply across the next block.
+		 *
+		 * @param parameters: The parameters.
+		 */
+		void SetParameters(const FDNReverbParameters& parameters) { mParameters = parameters; }
+
+		/**
+		 * Get the parameters.
+		 *
+		 * @return The parameters.
+		 */
+		const FDNReverbParameters& GetParameters() const { return mParameters; }
+
+		/**
+		 * Set the gains. Changes ramp across the next block.
+		 *
+		 * @param wetGain: The gain of the reverberated signal.
+		 * @param dryGain: The gain of the original signal.
+		 */
+		void SetGains(float wetGain, float dryGain) { mWetGain = wetGain; mDryGain = dryGain; }
+
+		/**
+		 * Set the number of delay lines the network runs with. Fewer lines halve the cost of the reverb for a sparser
+		 * tail. The change crossfades across the next block.
+		 *
+		 * @param count: The line count, 8 or the line count of the description.
+		 */
+		void SetLineCount(uint32 count);
+
+		/**
+		 * Get the number of delay lines the network runs with.
+		 *
+		 * @return The line count.
+		 */
+		uint32 GetLineCount() const { return mLineCount; }
+
+		/**
+		 * Clear the delay lines, cutting the tail.
+		 */
+		void Reset();
+
+		/**
+		 * Process a block.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block. This must not be more than the block frames of the description.
+		 * @param channelCount: The number of channels of the bus. This must be the channel count of the description.
+		 */
+		void Process(float* pBuffer, uint32 frameCount, uint32 channelCount) override;
+
+		/**
+		 * Check if the tail has decayed by 120 dB, which takes twice the decay time after the input turns silent.
+		 *
+		 * @return Boolean value.
+		 */
+		bool IsTailSilent() const override;
+
+	private:
+		static const uint32 MaxLineCount = 16;	// The largest supported number of delay lines.
+		static const uint32 ChunkFrames = 64;	// The largest number of frames processed between reading and writing the lines.
+
+		/**
+		 * Line State structure.
+		 * These are the per line values the block ramps go from, laid out for SIMD loads.
+		 */
+		struct LineState {
+			float mDelays[MaxLineCount] = {};	// The delay lengths in frames.
+			float mGains[MaxLineCount] = {};	// The decay gains.
+			float mDamping = 0.0f;	// The damping lowpass coefficient.
+			float mDiffusion = 0.0f;	// The mix between no feedback mixing and the full matrix.
+		};
+
+		/**
+		 * Get the number of frames of silent input after which the tail has decayed.
+		 *
+		 * @return The frame count.
+		 */
+		uint64 GetTailFrames() const;
+
+		/**
+		 * Compute the line state of a set of parameters.
+		 *
+		 * @param parameters: The parameters.
+		 * @param state: The line state.
+		 */
+		void ComputeLineState(const FDNReverbParameters& parameters, LineState& state) const;
+
+		/**
+		 * Run a chunk of frames through the network.
+		 *
+		 * @param pInput: The mono input of the chunk.
+		 * @param pOutput: The left and right wet output of the chunk, ChunkFrames apart.
+		 * @param blockOffset: The index in the block of the first frame of the chunk.
+		 * @param frameCount: The number of frames in the chunk.
+		 * @param blockFrames: The number of frames in the block.
+		 */
+		void ProcessChunk(const float* pInput, float* pOutput, uint32 blockOffset, uint32 frameCount, uint32 blockFrames);
+
+	private:
+		Vector<float> mLines;	// The ring buffer of every delay line, back to back.
+		Vector<float> mTaps;	// The outputs of the lines of a chunk, all lines of a frame together.
+		Vector<float> mFeeds;	// The inputs of the lines of a chunk, all lines of a frame together.
+		Vector<float> mInput;	// The mono input of a block.
+		Vector<float> mWet;	// The left and right output of a chunk.
+		Vector<float> mRamps;	// The wet and dry gain ramps.
+
+		float mBaseDelays[MaxLineCount] = {};	// The delay lengths in frames at a size scale of 1.
+		float mFilterStates[MaxLineCount] = {};	// The damping lowpass state of every line.
+
+		LineState mPrevious = {};	// The line state at the end of the last block.
+		LineState mTarget = {};	// The line state at the end of the current block.
+
+		FDNReverbDescription mDescription = {};	// The reverb description.
+		FDNReverbParameters mParameters = {};	// The current parameters.
+		uint64 mWritePosition = 0;	// The number of frames written to the lines.
+		uint64 mSilentFrames = 0;	// The number of frames of silent input since the last sound.
+		uint32 mLineMask = 0;	// The ring buffer size of a line minus one.
+		uint32 mLineCount = 8;	// The number of lines the network runs with.
+		uint32 mPreviousLineCount = 8;	// The number of lines the network ran with in the last block.
+
+		float mWetGain = 0.3f;	// The wet gain.
+		float mDryGain = 1.0f;	// The dry gain.
+		float mPreviousWetGain = 0.3f;	// The wet gain at the end of the last block.
+		float mPreviousDryGain = 1.0f;	// The dry gain at the end of the last block.
+	};
+}
\ No newline at end of file
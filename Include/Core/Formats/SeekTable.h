@@ -0,0 +1,129 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Objects/AudioObjectHandle.h"
+
+namespace EnSound
+{
+	/**
+	 * Seek Point structure.
+	 * This is the start of a packet (MP3 frame, OGG page or FLAC frame) and the first frame decoded from it.
+	 */
+	struct SeekPoint {
+		uint64 mFrame = 0;	// The first audio frame decoded from the packet.
+		uint64 mByteOffset = 0;	// The byte offset of the packet from the start of the file.
+	};
+
+	/**
+	 * Seek Table object.
+	 * This indexes a compressed file on a fixed frame interval, so that seeking to any frame is a single table lookup
+	 * followed by decoding (and discarding) less than one interval plus one packet of audio. The table is generated
+	 * by scanning the packet headers of the file and can be persisted next to the asset so that it is only built once.
+	 *
+	 * OGG Vorbis packets overlap, so decoders must discard the first packet decoded after seeking to an OGG seek point.
+	 */
+	class SeekTable {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		SeekTable() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~SeekTable() {}
+
+		/**
+		 * Build the seek table by scanning a file.
+		 *
+		 * @param type: The type of the audio file. Must be MP3, OGG or FLAC.
+		 * @param pData: The file data.
+		 * @param dataSize: The byte size of the file data.
+		 * @param frameInterval: The number of frames between two table entries. Default is 4096.
+		 * @return Boolean stating if the table was built.
+		 */
+		bool Build(AudioFileType type, const uint8* pData, uint64 dataSize, uint32 frameInterval = 4096);
+
+		/**
+		 * Clear the seek table.
+		 */
+		void Clear();
+
+		/**
+		 * Find the seek point to start decoding from in order to reach a frame.
+		 *
+		 * @param frame: The frame to seek to.
+		 * @return The seek point. The number of frames to discard is frame - mFrame, which is never negative.
+		 */
+		SeekPoint Find(uint64 frame) const;
+
+		/**
+		 * Serialize the seek table.
+		 *
+		 * @param output: The serialized bytes.
+		 */
+		void Serialize(Vector<uint8>& output) const;
+
+		/**
+		 * Deserialize the seek table.
+		 *
+		 * @param pData: The serialized bytes.
+		 * @param dataSize: The number of serialized bytes.
+		 * @return Boolean stating if the data was a valid seek table.
+		 */
+		bool Deserialize(const uint8* pData, uint64 dataSize);
+
+		/**
+		 * Save the seek table to a file.
+		 *
+		 * @param pFileName: The file path.
+		 * @return Boolean stating if the file was written.
+		 */
+		bool SaveToFile(const wchar* pFileName) const;
+
+		/**
+		 * Load the seek table from a file.
+		 *
+		 * @param pFileName: The file path.
+		 * @return Boolean stating if the file contained a valid seek table.
+		 */
+		bool LoadFromFile(const wchar* pFileName);
+
+		/**
+		 * Check if the table is empty.
+		 *
+		 * @return Boolean value.
+		 */
+		bool IsEmpty() const { return mSeekPoints.empty(); }
+
+		/**
+		 * Get the total number of frames in the file.
+		 *
+		 * @return The frame count.
+		 */
+		uint64 GetFrameCount() const { return mFrameCount; }
+
+		/**
+		 * Get the number of frames between two table entries.
+		 *
+		 * @return The frame interval.
+		 */
+		uint32 GetFrameInterval() const { return mFrameInterval; }
+
+		/**
+		 * Get the type of the file the table was built for.
+		 *
+		 * @return The audio file type.
+		 */
+		AudioFileType GetType() const { return mFileType; }
+
+	private:
+		Vector<SeekPoint> mSeekPoints;	// Table entries, one every mFrameInterval frames.
+		uint64 mFrameCount = 0;	// The total number of frames.
+		uint32 mFrameInterval = 0;	// The number of frames between two entries.
+		AudioFileType mFileType = AudioFileType::AUDIO_FILE_TYPE_UNKNOWN;	// The type of the audio file.
+	};
+}
\ No newline at end of file
@@ -33,6 +33,19 @@ namespace EnSound
 		WAV_FILE_TAG_XMA_SEEK = MAKE_TAG('s', 'e', 'e', 'k'),
 	};
 
+	/**
+	 * WAV Format Tag enum.
+	 * These are the values stored in WAVFormat::mFormatTag which are understood by the Core.
+	 */
+	enum class WAVFormatTag : const uint16 {
+		WAV_FORMAT_TAG_UNKNOWN = 0x0000,
+		WAV_FORMAT_TAG_PCM = 0x0001,
+		WAV_FORMAT_TAG_MS_ADPCM = 0x0002,
+		WAV_FORMAT_TAG_IEEE_FLOAT = 0x0003,
+		WAV_FORMAT_TAG_IMA_ADPCM = 0x0011,
+		WAV_FORMAT_TAG_EXTENSIBLE = 0xFFFE,
+	};
+
 	/**
 	 * WAV file format.
 	 * This structure contains information about a single WAV file.
@@ -45,8 +58,13 @@ namespace EnSound
 		uint16 mBlockAlignment = 0;		// Alignment of the memory block.
 		uint16 mBitsPerSample = 0;		// Number of bits per sample.
 		uint16 mCBSize = 0;				// Size of the additional information.
+		uint16 mValidBitsPerSample = 0;	// Number of bits of a sample which hold audio, for WAV_FORMAT_TAG_EXTENSIBLE.
+		uint32 mChannelMask = 0;		// Speaker positions of the channels, for WAV_FORMAT_TAG_EXTENSIBLE.
+		uint8 mSubFormat[16] = {};		// Sub format GUID in file byte order, for WAV_FORMAT_TAG_EXTENSIBLE.
 	};
 
+	class SeekTable;
+
 	/**
 	 * WAV Data structure.
 	 * This structure contains information about a single WAV file.
@@ -59,6 +77,7 @@ namespace EnSound
 		uint32 mLoopStart = 0;	// Loop start index.
 		uint32 mLoopLength = 0;	// The length of the loop.
 		uint32 mSeekCount = 0;	// The seek count.
+		const SeekTable* pFrameSeekTable = nullptr;	// Frame seek table of MP3, OGG and FLAC audio.
 	};
 
 #pragma pack(push, 1)
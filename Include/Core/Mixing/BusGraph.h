@@ -0,0 +1,452 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Threading/JobSystem.h"
+
+namespace EnSound
+{
+	/**
+	 * Bus Input object.
+	 * A bus input is anything which renders into a bus, such as a voice.
+	 */
+	class BusInput {
+	public:
+		static const uint32 MaxSendCount = 4;	// The number of send slots an input can feed besides its bus.
+
+	public:
+		/**
+		 * Default constructor.
+		 */
+		BusInput() {}
+
+		/**
+		 * Default destructor.
+		 */
+		virtual ~BusInput() {}
+
+		/**
+		 * Mix a block into the bus.
+		 *
+		 * @param pBuffer: The interleaved bus buffer. The input adds its output to what is already in it.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 * @return Boolean stating if anything was added. An input which returns false must leave the buffer untouched.
+		 */
+		virtual bool Mix(float* pBuffer, uint32 frameCount, uint32 channelCount) = 0;
+
+		/**
+		 * Mix a block into the bus and into the send buses of the bus.
+		 * This is called instead of Mix() when the bus has sends. Inputs without send levels only mix into the bus.
+		 *
+		 * @param pBuffer: The interleaved bus buffer. The input adds its output to what is already in it.
+		 * @param ppSends: The interleaved buffers of the send slots, which the input also adds to. nullptr for the slots which are not routed.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 * @return The mask of the buffers which were added to: bit 0 for the bus buffer and bit 1 + slot for every send slot.
+		 */
+		virtual uint32 MixWithSends(float* pBuffer, float* const* /*ppSends*/, uint32 /*sendCount*/, uint32 frameCount, uint32 channelCount) { return Mix(pBuffer, frameCount, channelCount) ? 1 : 0; }
+	};
+
+	/**
+	 * Bus Effect object.
+	 * A bus effect processes the mixed block of a bus in place, such as a reverb or an EQ.
+	 */
+	class BusEffect {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		BusEffect() {}
+
+		/**
+		 * Default destructor.
+		 */
+		virtual ~BusEffect() {}
+
+		/**
+		 * Process a block.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		virtual void Process(float* pBuffer, uint32 frameCount, uint32 channelCount) = 0;
+
+		/**
+		 * Process a block with the block of the sidechain bus of the bus as a key signal, such as dialogue for ducking.
+		 * This is called instead of Process() when the bus has a sidechain. Effects without a key input ignore it.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param pSidechain: The interleaved block of the sidechain bus, before its gain. nullptr if it is silent.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		virtual void ProcessWithSidechain(float* pBuffer, const float* /*pSidechain*/, uint32 frameCount, uint32 channelCount) { Process(pBuffer, frameCount, channelCount); }
+
+		/**
+		 * Check if the effect would only output silence for a silent input, because its tail has decayed.
+		 * While this is true and its bus is silent the effect is not processed at all. It is processed again, with a
+		 * cleared buffer if need be, as soon as either changes.
+		 *
+		 * @return Boolean value. The default is false, which processes the effect every block.
+		 */
+		virtual bool IsTailSilent() const { return false; }
+	};
+
+	/**
+	 * Bus Graph Description structure.
+	 */
+	struct BusGraphDescription {
+		JobSystem* pJobSystem = nullptr;	// The job system the buses are rendered on. nullptr to render on the caller's thread.
+		uint32 mChannelCount = 2;	// The number of channels of every bus.
+		uint32 mBlockFrames = 256;	// The number of frames in a block.
+		uint32 mMaxBusCount = 256;	// The maximum number of buses, the master bus included.
+		RampCurve mGainCurve = RampCurve::RAMP_CURVE_LINEAR;	// The curve bus gain changes ramp with across a block.
+	};
+
+	/**
+	 * Bus Graph object.
+	 * This is the mixing tree: inputs (voices) mix into submix buses, and every bus mixes into its output bus up to the
+	 * master bus. Compile() flattens the graph into a render schedule, which Render() walks without blocking on edits.
+	 */
+	class BusGraph {
+	public:
+		static const uint32 MasterBus = 0;	// The index of the master bus.
+		static const uint32 InvalidBus = ~0U;	// The index returned when a bus could not be created.
+		static const uint32 MaxRateDivisor = 4;	// The largest factor a bus rate can be below the block rate.
+
+	public:
+		/**
+		 * Default constructor.
+		 */
+		BusGraph() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~BusGraph() {}
+
+		/**
+		 * Initialize the graph with only the master bus.
+		 *
+		 * @param description: The graph description.
+		 * @return Boolean stating if the graph was initialized.
+		 */
+		bool Initialize(const BusGraphDescription& description = {});
+
+		/**
+		 * Destroy all the buses.
+		 */
+		void Terminate();
+
+		/**
+		 * Create a submix bus.
+		 *
+		 * @param outputBus: The bus it mixes into. Default is the master bus. The new bus runs at its rate.
+		 * @return The bus index. InvalidBus if the output bus does not exist.
+		 */
+		uint32 CreateBus(uint32 outputBus = MasterBus);
+
+		/**
+		 * Destroy a submix bus.
+		 * Its child buses are moved to its output bus and its inputs and effects are dropped.
+		 *
+		 * @param bus: The bus index.
+		 */
+		void DestroyBus(uint32 bus);
+
+		/**
+		 * Change the bus a submix bus mixes into.
+		 *
+		 * @param bus: The bus index.
+		 * @param outputBus: The new output bus.
+		 * @return Boolean stating if the output was changed. It is not changed if it would create a cycle.
+		 */
+		bool SetBusOutput(uint32 bus, uint32 outputBus);
+
+		/**
+		 * Route a send slot of the inputs of a bus to a send bus.
+		 * The inputs decide how much of every voice goes to the slot, see BusInput::MixWithSends().
+		 *
+		 * @param bus: The bus index.
+		 * @param slot: The send slot, less than BusInput::MaxSendCount.
+		 * @param sendBus: The bus the slot mixes into. InvalidBus to remove the send.
+		 * @return Boolean stating if the send was set. It is not set if it would create a cycle.
+		 */
+		bool SetSend(uint32 bus, uint32 slot, uint32 sendBus);
+
+		/**
+		 * Set the bus whose block the effects of a bus get as a key signal, see BusEffect::ProcessWithSidechain().
+		 *
+		 * @param bus: The bus index.
+		 * @param sidechainBus: The key bus. InvalidBus to remove the sidechain.
+		 * @return Boolean stating if the sidechain was set. It is not set if it would create a cycle.
+		 */
+		bool SetSidechain(uint32 bus, uint32 sidechainBus);
+
+		/**
+		 * Set the factor a bus runs below the block rate at.
+		 * The inputs and effects of the bus get blocks of block frames / divisor frames, and must be set up for that
+		 * sample rate, such as voice tables initialized with the same divisor.
+		 *
+		 * @param bus: The bus index.
+		 * @param divisor: 1 for the block rate, 2 for half of it or MaxRateDivisor for a quarter of it.
+		 * @return Boolean stating if the divisor was set. It is not set if a child, send or sidechain would run faster
+		 * than the bus it feeds, or if the block is too short to be divided.
+		 */
+		bool SetBusRateDivisor(uint32 bus, uint32 divisor);
+
+		/**
+		 * Get the factor a bus runs below the block rate at.
+		 *
+		 * @param bus: The bus index.
+		 * @return The rate divisor. 1 if the bus does not exist.
+		 */
+		uint32 GetBusRateDivisor(uint32 bus) const { return IsValidBus(bus) ? mBuses[bus].mRateDivisor : 1; }
+
+		/**
+		 * Set the gain a bus is mixed into its output with.
+		 * This takes effect from the next block without compiling, and can be called while a block is being rendered.
+		 *
+		 * @param bus: The bus index.
+		 * @param gain: The linear gain.
+		 */
+		void SetBusGain(uint32 bus, float gain);
+
+		/**
+		 * Add an input to a bus.
+		 *
+		 * @param bus: The bus index.
+		 * @param pInput: The input pointer. It must stay alive until it is removed.
+		 */
+		void AddInput(uint32 bus, BusInput* pInput);
+
+		/**
+		 * Remove an input from a bus.
+		 *
+		 * @param bus: The bus index.
+		 * @param pInput: The input pointer.
+		 */
+		void RemoveInput(uint32 bus, BusInput* pInput);
+
+		/**
+		 * Add an effect to the end of a bus's effect chain.
+		 *
+		 * @param bus: The bus index.
+		 * @param pEffect: The effect pointer. It must stay alive until it is removed.
+		 */
+		void AddEffect(uint32 bus, BusEffect* pEffect);
+
+		/**
+		 * Remove an effect from a bus.
+		 *
+		 * @param bus: The bus index.
+		 * @param pEffect: The effect pointer.
+		 */
+		void RemoveEffect(uint32 bus, BusEffect* pEffect);
+
+		/**
+		 * Compile the graph into a render schedule and publish it.
+		 * The changes made to the graph are not heard until this is called. This must not be called concurrently with
+		 * the other graph functions, but can be called while a block is being rendered. Inputs and effects removed from
+		 * the graph must stay alive until GetRenderedVersion() reaches the returned version.
+		 *
+		 * @return The version of the published schedule.
+		 */
+		uint64 Compile();
+
+		/**
+		 * Render a block with the latest published schedule.
+		 * With a job system, independent submixes render in parallel and the output does not depend on the worker count.
+		 *
+		 * @param pOutput: The interleaved output buffer of block frames * channels samples.
+		 */
+		void Render(float* pOutput);
+
+		/**
+		 * Get the version of the schedule the last block was rendered with.
+		 *
+		 * @return The schedule version. 0 if no block was rendered.
+		 */
+		uint64 GetRenderedVersion() const { return mRenderedVersion.load(std::memory_order_acquire); }
+
+		/**
+		 * Get the number of buses which were silent in the last block, and were therefore skipped.
+		 *
+		 * @return The silent bus count.
+		 */
+		uint32 GetSilentBusCount() const { return mSilentBusCount.load(std::memory_order_relaxed); }
+
+		/**
+		 * Get the number of channels of every bus.
+		 *
+		 * @return The channel count.
+		 */
+		uint32 GetChannelCount() const { return mDescription.mChannelCount; }
+
+		/**
+		 * Get the number of frames in a block.
+		 *
+		 * @return The frame count.
+		 */
+		uint32 GetBlockFrames() const { return mDescription.mBlockFrames; }
+
+	private:
+		/**
+		 * Bus structure.
+		 */
+		struct Bus {
+			Vector<BusInput*> mInputs;	// The inputs, mixed in order.
+			Vector<BusEffect*> mEffects;	// The effect chain.
+			Vector<uint32> mChildren;	// The child buses, summed in order.
+			uint32 mSends[BusInput::MaxSendCount] = {};	// The send bus of every send slot. InvalidBus for the slots which are not routed.
+
+			uint64 mCreatedVersion = 0;	// The version of the first schedule the bus is part of.
+			uint32 mOutputBus = MasterBus;	// The bus this one mixes into.
+			uint32 mSidechain = InvalidBus;	// The key bus of the effects.
+			uint32 mRateDivisor = 1;	// The factor the bus runs below the block rate at.
+			bool mIsActive = false;	// Whether the bus exists.
+		};
+
+		/**
+		 * Render Op structure.
+		 * This is a single bus in the render schedule. The ranges index the flat arrays of the schedule.
+		 */
+		struct RenderOp {
+			uint64 mCreatedVersion = 0;	// The version of the first schedule the bus is part of.
+			uint32 mBus = 0;	// The bus index.
+			uint32 mBuffer = 0;	// The scratch buffer index.
+			uint32 mOutputOp = 0;	// The op this one mixes into. Ignored for the master bus.
+			uint32 mChildBegin = 0;	// The first child op index in the child op array.
+			uint32 mChildEnd = 0;	// One past the last child op index in the child op array.
+			uint32 mInputBegin = 0;	// The first input in the input array.
+			uint32 mInputEnd = 0;	// One past the last input in the input array.
+			uint32 mEffectBegin = 0;	// The first effect in the effect array.
+			uint32 mEffectEnd = 0;	// One past the last effect in the effect array.
+			uint32 mReturnBegin = 0;	// The first send buffer summed by this op in the return array.
+			uint32 mReturnEnd = 0;	// One past the last send buffer summed by this op in the return array.
+			uint32 mDependentBegin = 0;	// The first op waiting on this one besides its output op, in the dependent op array.
+			uint32 mDependentEnd = 0;	// One past the last op waiting on this one besides its output op, in the dependent op array.
+			uint32 mDependencyCount = 0;	// The number of child, sending and sidechain ops which must be rendered before this one.
+			uint32 mSendBuffers[BusInput::MaxSendCount] = {};	// The scratch buffer of every send slot. InvalidBus for the slots which are not routed.
+			uint32 mKeyBuffer = InvalidBus;	// The scratch buffer the block is copied to for the buses keyed by it. InvalidBus if there are none.
+			uint32 mSidechainBuffer = InvalidBus;	// The key buffer of the sidechain bus. InvalidBus if there is no sidechain.
+			uint32 mRateDivisor = 1;	// The factor the bus runs below the block rate at.
+			uint32 mOutputFactor = 1;	// The rate of the output bus over the rate of the bus.
+			uint32 mSendFactors[BusInput::MaxSendCount] = {};	// The rate of the send bus of every send slot over the rate of the bus.
+			uint32 mStagingBuffer = InvalidBus;	// The scratch buffer the upsampler works in. InvalidBus if nothing is upsampled.
+			bool mHasSends = false;	// Whether any send slot is routed.
+		};
+
+		/**
+		 * Render Schedule structure.
+		 */
+		struct RenderSchedule {
+			Vector<RenderOp> mOps;	// The ops in topological order. The master bus is the last.
+			Vector<uint32> mChildOps;	// The child op indexes of all the ops.
+			Vector<uint32> mLeafOps;	// The ops without dependencies, which start every block.
+			Vector<uint32> mReturns;	// The send buffers summed by the ops.
+			Vector<uint32> mDependentOps;	// The ops the ops send to, one per routed send slot, and the ops keyed by them.
+			Vector<BusInput*> mInputs;	// The inputs of all the ops.
+			Vector<BusEffect*> mEffects;	// The effects of all the ops.
+			Vector<float> mScratch;	// The scratch buffers, one block each.
+			Vector<uint8> mSilentBuffers;	// Whether every scratch buffer is silent this block. The samples of a silent buffer are undefined.
+			std::unique_ptr<std::atomic<uint32>[]> pPendingChildren;	// The number of dependencies of every op not yet rendered this block.
+			uint64 mPendingCapacity = 0;	// The number of pending child counters.
+			uint64 mVersion = 0;	// The version of the schedule.
+		};
+
+		/**
+		 * Check if a bus exists.
+		 *
+		 * @param bus: The bus index.
+		 * @return Boolean value.
+		 */
+		bool IsValidBus(uint32 bus) const { return bus < mBuses.size() && mBuses[bus].mIsActive; }
+
+		/**
+		 * Check if a bus has to be rendered after another one, because the other one is one of its descendants, sends to
+		 * it, is its sidechain, or is a dependency of any of those.
+		 *
+		 * @param bus: The bus index.
+		 * @param dependency: The other bus index.
+		 * @return Boolean value.
+		 */
+		bool DependsOn(uint32 bus, uint32 dependency) const;
+
+		/**
+		 * Append a bus and all of its dependencies to a schedule, dependencies first.
+		 *
+		 * @param schedule: The schedule being compiled.
+		 * @param bus: The bus index.
+		 * @param busOps: The op index of every bus compiled so far, InvalidBus for the others.
+		 * @param bufferCount: The number of scratch buffers assigned so far.
+		 * @return The op index of the bus.
+		 */
+		uint32 CompileBus(RenderSchedule& schedule, uint32 bus, Vector<uint32>& busOps, uint32& bufferCount) const;
+
+		/**
+		 * Upsample a buffer of an op in place to the rate of the bus it feeds.
+		 *
+		 * @param pBuffer: The interleaved buffer, one block long.
+		 * @param pStaging: The staging buffer, one block long.
+		 * @param bus: The bus index.
+		 * @param stream: The buffer of the bus: 0 for the bus buffer and 1 + slot for every send slot.
+		 * @param frameCount: The number of frames in the buffer.
+		 * @param factor: The factor to raise the rate by, 2 or 4.
+		 */
+		void UpsampleBuffer(float* pBuffer, float* pStaging, uint32 bus, uint32 stream, uint32 frameCount, uint32 factor);
+
+		/**
+		 * Render an op now or submit it as a job, depending on whether a job system is used.
+		 *
+		 * @param op: The op index.
+		 */
+		void Dispatch(uint32 op);
+
+		/**
+		 * Render a single op of the schedule being rendered.
+		 *
+		 * @param op: The op index.
+		 */
+		void ProcessOp(uint32 op);
+
+		/**
+		 * Mix job function. It renders an op and submits its output and dependent ops if this was their last pending dependency.
+		 *
+		 * @param pData: The graph pointer.
+		 * @param argument: The op index.
+		 */
+		static void RenderJob(void* pData, uint64 argument);
+
+	private:
+		static const uint32 NewScheduleBit = 0x80000000;	// Marks a published schedule the mixer has not picked up.
+		static const uint32 StreamCount = 1 + BusInput::MaxSendCount;	// The number of buffers of a bus which can be upsampled.
+		static const uint32 UpsamplerStageCount = 2;	// The number of times a buffer can be doubled in rate, up to MaxRateDivisor.
+
+		Vector<Bus> mBuses;	// All the buses. The master bus is always the first.
+		Vector<uint32> mFreeBuses;	// The indexes of the destroyed buses.
+
+		std::unique_ptr<std::atomic<float>[]> pBusGains;	// The gain of every bus, set by SetBusGain().
+		Vector<float> mGainRampStarts;	// The gain of every bus at the start of the current block.
+		Vector<float> mGainRampEnds;	// The gain of every bus at the end of the current block.
+		Vector<float> mUpsamplerHistory;	// The last input frames of every upsampler stage of every stream of every bus.
+		Vector<uint32> mUpsamplerFactors;	// The factor every stream of every bus was last upsampled by.
+
+		RenderSchedule mSchedules[3] = {};	// The render schedule slots.
+		uint32 mCompileSchedule = 0;	// The slot owned by Compile().
+		uint32 mRenderSchedule = 1;	// The slot owned by Render().
+		std::atomic<uint32> mPublishedSchedule = 2;	// The latest published slot, with the new schedule bit.
+
+		BusGraphDescription mDescription = {};	// The graph description.
+		JobCounter mBlockJobs = {};	// The op jobs of the current block which have not completed.
+		uint64 mCompiledVersion = 0;	// The version of the last compiled schedule.
+		std::atomic<uint64> mRenderedVersion = 0;	// The version of the schedule the last block was rendered with.
+		std::atomic<uint32> mSilentOps = 0;	// The number of silent ops of the current block.
+		std::atomic<uint32> mSilentBusCount = 0;	// The number of silent ops of the last block.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,169 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * Speaker enum.
+	 */
+	enum class Speaker : uint8 {
+		SPEAKER_FRONT_LEFT,
+		SPEAKER_FRONT_RIGHT,
+		SPEAKER_FRONT_CENTER,
+		SPEAKER_LOW_FREQUENCY,
+		SPEAKER_BACK_LEFT,
+		SPEAKER_BACK_RIGHT,
+		SPEAKER_SIDE_LEFT,
+		SPEAKER_SIDE_RIGHT,
+		SPEAKER_TOP_FRONT_LEFT,
+		SPEAKER_TOP_FRONT_RIGHT,
+		SPEAKER_TOP_BACK_LEFT,
+		SPEAKER_TOP_BACK_RIGHT,
+
+		SPEAKER_MAX
+	};
+
+	/**
+	 * Channel Layout enum.
+	 * The channels of every layout are in the WAVE channel mask order.
+	 */
+	enum class ChannelLayout : uint8 {
+		CHANNEL_LAYOUT_UNKNOWN,
+		CHANNEL_LAYOUT_MONO,	// C.
+		CHANNEL_LAYOUT_STEREO,	// L, R.
+		CHANNEL_LAYOUT_QUAD,	// L, R, Lb, Rb.
+		CHANNEL_LAYOUT_5_1,	// L, R, C, LFE, Ls, Rs.
+		CHANNEL_LAYOUT_7_1,	// L, R, C, LFE, Lb, Rb, Ls, Rs.
+		CHANNEL_LAYOUT_7_1_4,	// L, R, C, LFE, Lb, Rb, Ls, Rs, Ltf, Rtf, Ltb, Rtb.
+
+		CHANNEL_LAYOUT_MAX
+	};
+
+	const uint32 MaxLayoutChannels = 12;	// The largest number of channels of a standard layout.
+
+	/**
+	 * Channel Layout Description structure.
+	 * The azimuths are in the form the Spatializer and the ambisonic bus take speaker layouts, so a layout can be
+	 * spatialized to directly.
+	 */
+	struct ChannelLayoutDescription {
+		const Speaker* pSpeakers = nullptr;	// The speaker of every channel.
+		const float* pAzimuths = nullptr;	// The azimuth of every channel in degrees, clockwise from the front. The LFE is at 0.
+		const float* pElevations = nullptr;	// The elevation of every channel in degrees, up from the horizontal plane.
+		uint32 mChannelCount = 0;	// The number of channels.
+	};
+
+	/**
+	 * Get the description of a layout.
+	 *
+	 * @param layout: The layout.
+	 * @return The description. It has no channels for an unknown layout.
+	 */
+	const ChannelLayoutDescription& GetChannelLayoutDescription(ChannelLayout layout);
+
+	/**
+	 * Get the layout usually meant by a channel count, such as the one of WAVFormat::mChannels.
+	 *
+	 * @param channelCount: The number of channels.
+	 * @return The layout. Unknown for counts without a standard layout, such as 3.
+	 */
+	ChannelLayout GetDefaultChannelLayout(uint32 channelCount);
+
+	/**
+	 * Get the precomputed mixing matrix from a layout to another.
+	 * Downmixes fold every missing speaker into its neighbours at -3 dB (ITU-R BS.775), surrounds fold into backs and
+	 * backs into surrounds, and heights fold into the speakers below them. The LFE is dropped by layouts without one.
+	 * Upmixes only copy the shared speakers, except that a mono center is spread to the front left and right at -3 dB.
+	 *
+	 * @param input: The input layout.
+	 * @param output: The output layout.
+	 * @return The matrix, the weights of every input channel for the first output channel, then the second one and so
+	 * on. nullptr if either layout is unknown.
+	 */
+	const float* GetChannelMatrix(ChannelLayout input, ChannelLayout output);
+
+	/**
+	 * Channel Mixer object.
+	 * This mixes interleaved blocks of one channel layout into another with a matrix, such as surround stems and
+	 * multichannel ambiences folded down to a stereo output. The matrix is stored in the padded form MixMatrix()
+	 * takes, so every frame costs one SIMD multiply and add per input channel and group of 4 output channels.
+	 */
+	class ChannelMixer {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		ChannelMixer() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~ChannelMixer() {}
+
+		/**
+		 * Initialize the mixer with the standard matrix between two layouts, see GetChannelMatrix().
+		 *
+		 * @param input: The input layout.
+		 * @param output: The output layout.
+		 * @return Boolean stating if both layouts were known.
+		 */
+		bool Initialize(ChannelLayout input, ChannelLayout output);
+
+		/**
+		 * Initialize the mixer with a custom matrix.
+		 *
+		 * @param pMatrix: The weights of every input channel for the first output channel, then the second one and so on.
+		 * @param inputChannelCount: The number of input channels.
+		 * @param outputChannelCount: The number of output channels, up to MaxMatrixOutputs.
+		 * @return Boolean stating if the matrix was valid.
+		 */
+		bool Initialize(const float* pMatrix, uint32 inputChannelCount, uint32 outputChannelCount);
+
+		/**
+		 * Terminate the mixer.
+		 */
+		void Terminate();
+
+		/**
+		 * Mix a block into another.
+		 *
+		 * @param pOutput: The interleaved block to mix into.
+		 * @param pInput: The interleaved block to mix. It must not overlap the output.
+		 * @param frameCount: The number of frames.
+		 */
+		void Mix(float* pOutput, const float* pInput, uint32 frameCount) const;
+
+		/**
+		 * Get the weight of an input channel in an output channel.
+		 *
+		 * @param output: The output channel.
+		 * @param input: The input channel.
+		 * @return The weight.
+		 */
+		float GetWeight(uint32 output, uint32 input) const { return mColumns[static_cast<uint64>(input) * mStride + output]; }
+
+		/**
+		 * Get the number of input channels.
+		 *
+		 * @return The channel count.
+		 */
+		uint32 GetInputChannelCount() const { return mInputChannelCount; }
+
+		/**
+		 * Get the number of output channels.
+		 *
+		 * @return The channel count.
+		 */
+		uint32 GetOutputChannelCount() const { return mOutputChannelCount; }
+
+	private:
+		Vector<float> mColumns;	// The weights of every input channel for all the outputs, padded to the stride.
+		uint32 mStride = 0;	// The number of weights per input channel.
+		uint32 mInputChannelCount = 0;	// The number of input channels.
+		uint32 mOutputChannelCount = 0;	// The number of output channels.
+	};
+}
\ No newline at end of file
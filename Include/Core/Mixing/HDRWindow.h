@@ -0,0 +1,89 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+#include <atomic>
+
+namespace EnSound
+{
+	/**
+	 * HDR Window Description structure.
+	 */
+	struct HDRWindowDescription {
+		float mRange = 60.0f;	// The height of the window in dB. Voices further below its top are virtualized.
+		float mReleaseRate = 20.0f;	// The rate in dB per second the top falls at once the loudest voices are gone.
+		float mMinimumTop = 0.0f;	// The lowest loudness the top falls to, so quiet scenes are not brought up.
+		float mHysteresis = 3.0f;	// How far in dB a virtual voice must rise above the floor before it is heard again.
+		uint32 mSampleRate = 48000;	// The mix sample rate.
+	};
+
+	/**
+	 * HDR Window object.
+	 * This is the loudness window of a high dynamic range mix. Every voice has an authored loudness in dB on the scale
+	 * of the game's sounds, such as 130 for an explosion and 50 for a footstep, and is heard at its loudness relative
+	 * to the top of the window: the loudest voice plays at its own gain and the others are turned down by how much
+	 * quieter they are. Voices which fall below the floor of the window, the top minus the range, are masked. They are
+	 * virtualized instead of turned down, so they cost nothing to mix until the window falls back or they get louder.
+	 *
+	 * The top jumps up to the loudest voice at once and falls at the release rate, so the mix recovers smoothly after
+	 * an explosion. Every voice table using the window submits its loudest voice while it is mixed, from any thread,
+	 * and Update() moves the window once per block. A voice table also uses its own loudest voice right away, so a loud
+	 * voice never plays a block before the window makes room for it.
+	 */
+	class HDRWindow {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		HDRWindow() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~HDRWindow() {}
+
+		/**
+		 * Initialize the window.
+		 *
+		 * @param description: The window description.
+		 */
+		void Initialize(const HDRWindowDescription& description = {});
+
+		/**
+		 * Submit the loudness of a voice heard this block. This can be called from any thread.
+		 *
+		 * @param loudness: The loudness in dB, the authored loudness plus the gain of the voice.
+		 */
+		void Submit(float loudness);
+
+		/**
+		 * Move the window to the loudest voice submitted since the last update. This must be called once per block,
+		 * after all the voice tables are mixed.
+		 *
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void Update(uint32 frameCount);
+
+		/**
+		 * Get the top of the window.
+		 *
+		 * @return The loudness in dB.
+		 */
+		float GetTop() const { return mTop; }
+
+		/**
+		 * Get the window description.
+		 *
+		 * @return The description.
+		 */
+		const HDRWindowDescription& GetDescription() const { return mDescription; }
+
+	private:
+		HDRWindowDescription mDescription = {};	// The window description.
+		std::atomic<float> mLoudest = -1e30f;	// The loudest voice submitted since the last update.
+		float mTop = 0.0f;	// The top of the window.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,132 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * Ramp Curve enum.
+	 */
+	enum class RampCurve : uint8 {
+		RAMP_CURVE_LINEAR,
+		RAMP_CURVE_EXPONENTIAL,
+	};
+
+	const float SilenceThreshold = 1e-6f;	// The peak below which a signal counts as silent, -120 dB.
+	const uint32 UpsamplerHistoryFrames = 15;	// The number of input frames before a block which Upsample() reads.
+	const uint32 UpsamplerLatency = 8;	// The delay of Upsample() in input frames.
+	const uint32 MaxMatrixOutputs = 16;	// The largest number of output channels MixMatrix() takes.
+
+	/**
+	 * Add a scaled buffer to another.
+	 * The result of every sample only depends on its own inputs, so the SIMD and scalar paths match bit for bit.
+	 *
+	 * @param pDestination: The buffer to mix into.
+	 * @param pSource: The buffer to mix.
+	 * @param gain: The gain applied to the source.
+	 * @param sampleCount: The number of samples.
+	 */
+	void MixBuffer(float* pDestination, const float* pSource, float gain, uint64 sampleCount);
+
+	/**
+	 * Scale a buffer in place.
+	 *
+	 * @param pBuffer: The buffer.
+	 * @param gain: The gain.
+	 * @param sampleCount: The number of samples.
+	 */
+	void ScaleBuffer(float* pBuffer, float gain, uint64 sampleCount);
+
+	/**
+	 * Compute a part of a ramp.
+	 * The ramp goes from start to end across rampLength samples, so the sample at index i has the value of the ramp
+	 * after i + 1 steps and the last one is exactly the end value. Exponential ramps fall back to linear when either
+	 * end is not positive.
+	 *
+	 * @param pOutput: The output values.
+	 * @param start: The value before the ramp.
+	 * @param end: The value at the end of the ramp.
+	 * @param offset: The index of the first sample to compute.
+	 * @param count: The number of samples to compute.
+	 * @param rampLength: The length of the whole ramp.
+	 * @param curve: The ramp curve.
+	 */
+	void ComputeRamp(float* pOutput, float start, float end, uint32 offset, uint32 count, uint32 rampLength, RampCurve curve);
+
+	/**
+	 * Add a buffer to another with a gain ramping across the block.
+	 * If the gain does not change this is the same as MixBuffer().
+	 *
+	 * @param pDestination: The interleaved buffer to mix into.
+	 * @param pSource: The interleaved buffer to mix.
+	 * @param startGain: The gain before the block.
+	 * @param endGain: The gain at the end of the block.
+	 * @param frameCount: The number of frames.
+	 * @param channelCount: The number of channels.
+	 * @param curve: The ramp curve.
+	 */
+	void MixBufferRamped(float* pDestination, const float* pSource, float startGain, float endGain, uint32 frameCount, uint32 channelCount, RampCurve curve);
+
+	/**
+	 * Scale a buffer in place with a gain ramping across the block.
+	 * If the gain does not change this is the same as ScaleBuffer().
+	 *
+	 * @param pBuffer: The interleaved buffer.
+	 * @param startGain: The gain before the block.
+	 * @param endGain: The gain at the end of the block.
+	 * @param frameCount: The number of frames.
+	 * @param channelCount: The number of channels.
+	 * @param curve: The ramp curve.
+	 */
+	void ScaleBufferRamped(float* pBuffer, float startGain, float endGain, uint32 frameCount, uint32 channelCount, RampCurve curve);
+
+	/**
+	 * Double the sample rate of a block with a halfband interpolator.
+	 * The interpolator passes up to 80% of the input Nyquist frequency and rejects its images by 52 dB, and delays the
+	 * block by UpsamplerLatency input frames. The result of every sample only depends on its own inputs, so the SIMD and
+	 * scalar paths match bit for bit.
+	 *
+	 * @param pOutput: The interleaved output of frameCount * 2 frames. It must not overlap the input.
+	 * @param pInput: The interleaved input of frameCount frames, preceded by the last UpsamplerHistoryFrames frames of the previous block.
+	 * @param frameCount: The number of input frames.
+	 * @param channelCount: The number of channels.
+	 */
+	void Upsample(float* pOutput, const float* pInput, uint32 frameCount, uint32 channelCount);
+
+	/**
+	 * Halve the sample rate of a block with the halfband filter of Upsample(), without any delay, so output frame i
+	 * lines up with input frame 2i. This runs when samples are prepared rather than every block, so it has no SIMD path.
+	 *
+	 * @param pOutput: The interleaved output of frameCount frames.
+	 * @param pInput: The interleaved input of frameCount * 2 frames, with UpsamplerHistoryFrames readable frames before and after it.
+	 * @param frameCount: The number of output frames.
+	 * @param channelCount: The number of channels.
+	 */
+	void Downsample(float* pOutput, const float* pInput, uint32 frameCount, uint32 channelCount);
+
+	/**
+	 * Mix an interleaved block into another of a different channel count through a matrix.
+	 * Every frame adds each input sample times its weights to all the outputs at once, four outputs per SIMD lane group.
+	 * The result of every sample only depends on its own inputs, so the SIMD and scalar paths match bit for bit.
+	 *
+	 * @param pOutput: The interleaved block to mix into.
+	 * @param pInput: The interleaved block to mix. It must not overlap the output.
+	 * @param pColumns: The weights of every input channel for all the output channels, each padded with zeros to a multiple of 4 outputs.
+	 * @param frameCount: The number of frames.
+	 * @param inputChannels: The number of input channels.
+	 * @param outputChannels: The number of output channels, up to MaxMatrixOutputs.
+	 */
+	void MixMatrix(float* pOutput, const float* pInput, const float* pColumns, uint32 frameCount, uint32 inputChannels, uint32 outputChannels);
+
+	/**
+	 * Compute the largest absolute sample of a buffer.
+	 *
+	 * @param pBuffer: The buffer.
+	 * @param sampleCount: The number of samples.
+	 * @return The peak.
+	 */
+	float ComputePeak(const float* pBuffer, uint64 sampleCount);
+}
\ No newline at end of file
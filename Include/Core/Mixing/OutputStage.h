@@ -0,0 +1,119 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Formats/WAV/Format.h"
+
+namespace EnSound
+{
+	/**
+	 * Output Format enum.
+	 */
+	enum class OutputFormat : uint8 {
+		OUTPUT_FORMAT_INT16,	// Signed 16 bit samples.
+		OUTPUT_FORMAT_INT24,	// Signed 24 bit samples packed into 3 little endian bytes, as in WAV files.
+	};
+
+	/**
+	 * Dither Mode enum.
+	 */
+	enum class DitherMode : uint8 {
+		DITHER_MODE_NONE,	// Samples are only rounded, so quiet signals distort into their harmonics.
+		DITHER_MODE_TPDF,	// Triangular dither of 1 LSB peak, which turns the quantization error into flat noise.
+		DITHER_MODE_SHAPED,	// Triangular dither with the noise pushed out of the band the ear is most sensitive to.
+	};
+
+	/**
+	 * Output Stage Description structure.
+	 */
+	struct OutputStageDescription {
+		OutputFormat mFormat = OutputFormat::OUTPUT_FORMAT_INT16;	// The sample format of the destination.
+		DitherMode mDither = DitherMode::DITHER_MODE_TPDF;	// The dither applied before quantizing.
+		uint32 mChannelCount = 2;	// The number of interleaved channels.
+		uint32 mSeed = 1;	// The seed of the dither noise.
+	};
+
+	/**
+	 * Output Stage object.
+	 * This is the last step of the mix, which quantizes the float master to the integer samples of a device or a WAV
+	 * file. The samples are scaled, dithered, clamped to full scale and written packed straight into the destination,
+	 * such as the buffer of a device callback or a mapped region of a file, with no intermediate copy.
+	 *
+	 * Without noise shaping every sample is independent, so 8 samples are converted per SIMD step. The dither noise
+	 * comes from 4 xorshift generators, one per SIMD lane, and the scalar path draws from them in the same order, so
+	 * both paths write the same samples. The noise shaper feeds the quantization error of every channel back through a
+	 * 3 tap filter (Wannamaker's F-weighted curve), which lowers the noise by about 15 dB at low frequencies and raises
+	 * it close to Nyquist. Its recursion runs through the frames of a channel, so it is done a channel at a time in
+	 * scalar code.
+	 */
+	class OutputStage {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		OutputStage() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~OutputStage() {}
+
+		/**
+		 * Initialize the stage.
+		 *
+		 * @param description: The stage description.
+		 */
+		void Initialize(const OutputStageDescription& description = {});
+
+		/**
+		 * Terminate the stage.
+		 */
+		void Terminate();
+
+		/**
+		 * Quantize an interleaved block into the destination.
+		 *
+		 * @param pDestination: The destination of frame count * GetFrameBytes() bytes.
+		 * @param pInput: The interleaved float samples, full scale at 1.
+		 * @param frameCount: The number of frames.
+		 */
+		void Convert(void* pDestination, const float* pInput, uint32 frameCount);
+
+		/**
+		 * Clear the noise shaper, such as after the device was restarted.
+		 */
+		void Reset();
+
+		/**
+		 * Get the WAV format of the output.
+		 *
+		 * @param sampleRate: The sample rate of the output.
+		 * @return The PCM format.
+		 */
+		WAVFormat GetWAVFormat(uint64 sampleRate) const;
+
+		/**
+		 * Get the number of bytes of a frame of the output.
+		 *
+		 * @return The frame size.
+		 */
+		uint32 GetFrameBytes() const { return mDescription.mChannelCount * mSampleBytes; }
+
+		/**
+		 * Get the number of samples clamped to full scale since the stage was initialized.
+		 *
+		 * @return The clipped sample count.
+		 */
+		uint64 GetClippedSampleCount() const { return mClippedSampleCount; }
+
+	private:
+		Vector<float> mErrors;	// The last 3 errors of the noise shaper per channel, newest first.
+		uint32 mRandom[4] = {};	// The dither generator of every SIMD lane.
+
+		OutputStageDescription mDescription = {};	// The stage description.
+		float mScale = 0.0f;	// The value of full scale in the output format.
+		uint32 mSampleBytes = 0;	// The size of a sample of the output.
+		uint64 mClippedSampleCount = 0;	// The number of samples clamped to full scale.
+	};
+}
\ No newline at end of file
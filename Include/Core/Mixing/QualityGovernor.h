@@ -0,0 +1,231 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Effects/FDNReverb.h"
+#include "Core/Mixing/VoiceTable.h"
+#include "Core/Spatial/BinauralRenderer.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace EnSound
+{
+	/**
+	 * Quality Level enum.
+	 * Every level keeps the reductions of the levels before it.
+	 */
+	enum class QualityLevel : uint8 {
+		QUALITY_LEVEL_FULL,	// Everything runs at the quality of the description.
+		QUALITY_LEVEL_LINEAR_RESAMPLING,	// Resampled voices use linear interpolation.
+		QUALITY_LEVEL_REDUCED_HRTF,	// Fewer sources are rendered with full HRTF, the others are panned.
+		QUALITY_LEVEL_REDUCED_REVERB,	// The reverbs run with 8 delay lines.
+		QUALITY_LEVEL_REDUCED_VOICES,	// Only the loudest voices up to the reduced real voice cap are mixed.
+	};
+
+	/**
+	 * Quality Governor Description structure.
+	 */
+	struct QualityGovernorDescription {
+		uint32 mSampleRate = 48000;	// The mix sample rate, which the block deadlines are computed from.
+		float mBudget = 0.5f;	// The fraction of a block's deadline the mix may take, leaving the rest of the core to the game.
+		float mRecoveryRatio = 0.6f;	// The fraction of the budget the load must stay under before quality is restored.
+		float mStepDownTime = 0.02f;	// The time in seconds the load must stay over the budget before quality is reduced.
+		float mStepUpTime = 2.0f;	// The time in seconds the load must stay under the recovery budget before quality is restored.
+
+		ResamplerQuality mResamplerQuality = ResamplerQuality::RESAMPLER_QUALITY_CUBIC;	// The resampler at full quality.
+		uint32 mMaxHRTFVoices = ~0U;	// The HRTF voice cap at full quality, clamped to the voices of every renderer.
+		uint32 mReducedHRTFVoices = 4;	// The HRTF voice cap from the reduced HRTF level.
+		uint32 mMaxRealVoices = ~0U;	// The real voice cap of every voice table at full quality. ~0U for no cap.
+		uint32 mReducedRealVoices = 32;	// The real voice cap of every voice table at the reduced voices level.
+	};
+
+	/**
+	 * Quality Governor Stats structure.
+	 */
+	struct QualityGovernorStats {
+		QualityLevel mLevel = QualityLevel::QUALITY_LEVEL_FULL;	// The current quality level.
+		ResamplerQuality mResamplerQuality = ResamplerQuality::RESAMPLER_QUALITY_CUBIC;	// The current resampler.
+		uint32 mMaxHRTFVoices = 0;	// The HRTF voice cap asked of the renderers.
+		uint32 mReverbLineCount = 0;	// The delay line count asked of the reverbs.
+		uint32 mMaxRealVoices = 0;	// The current real voice cap.
+		uint32 mVirtualVoiceCount = 0;	// The number of virtual or culled voices of all the voice tables in the last block.
+
+		float mLoad = 0.0f;	// The mix time of the last block over its deadline.
+		float mAverageLoad = 0.0f;	// The load averaged over about a second.
+		float mPeakLoad = 0.0f;	// The highest load of a block.
+
+		uint64 mBlockCount = 0;	// The number of blocks measured.
+		uint64 mOverrunCount = 0;	// The number of blocks which took longer than their deadline.
+		uint64 mStepDownCount = 0;	// The number of times quality was reduced.
+		uint64 mStepUpCount = 0;	// The number of times quality was restored.
+	};
+
+	/**
+	 * Quality Governor object.
+	 * This measures the time the mix takes every block against the block's deadline, and trades quality for time when
+	 * the mix goes over its budget, so the mix does not glitch when the machine is busy with the rest of the game. The
+	 * quality knobs are stepped down in order of how little they are heard: the resampler tier, the HRTF voice cap,
+	 * the reverb density and the real voice cap of the voice tables.
+	 *
+	 * Quality is reduced by a level once the load has been over the budget for the step down time, or right away when
+	 * a block misses its deadline. It is restored by a level once the load has been under the recovery budget for the
+	 * step up time. A level which is lost again shortly after it was restored doubles the time the next step up
+	 * waits, so the governor does not keep flipping between two levels at the edge of the budget.
+	 *
+	 * Every level change and the load of every block are published in the stats, which can be read from any thread.
+	 * The rest of the governor lives on the mixer thread: BeginBlock() and EndBlock() bracket the mix of every block,
+	 * and the knobs are set on the registered objects at the end of the block.
+	 */
+	class QualityGovernor {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		QualityGovernor() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~QualityGovernor() {}
+
+		/**
+		 * Initialize the governor at full quality.
+		 *
+		 * @param description: The governor description.
+		 */
+		void Initialize(const QualityGovernorDescription& description = {});
+
+		/**
+		 * Terminate the governor and forget the registered objects.
+		 */
+		void Terminate();
+
+		/**
+		 * Register a voice table, whose resampler and real voice cap follow the quality level.
+		 *
+		 * @param pTable: The voice table pointer. It must outlive its registration.
+		 */
+		void AddVoiceTable(VoiceTable* pTable);
+
+		/**
+		 * Unregister a voice table.
+		 *
+		 * @param pTable: The voice table pointer.
+		 */
+		void RemoveVoiceTable(VoiceTable* pTable);
+
+		/**
+		 * Register a binaural renderer, whose HRTF voice cap follows the quality level.
+		 *
+		 * @param pRenderer: The renderer pointer. It must outlive its registration.
+		 */
+		void AddBinauralRenderer(BinauralRenderer* pRenderer);
+
+		/**
+		 * Unregister a binaural renderer.
+		 *
+		 * @param pRenderer: The renderer pointer.
+		 */
+		void RemoveBinauralRenderer(BinauralRenderer* pRenderer);
+
+		/**
+		 * Register a reverb, whose delay line count follows the quality level.
+		 *
+		 * @param pReverb: The reverb pointer. It must outlive its registration.
+		 */
+		void AddReverb(FDNReverb* pReverb);
+
+		/**
+		 * Unregister a reverb.
+		 *
+		 * @param pReverb: The reverb pointer.
+		 */
+		void RemoveReverb(FDNReverb* pReverb);
+
+		/**
+		 * Start timing the mix of a block.
+		 */
+		void BeginBlock() { mBlockStart = std::chrono::steady_clock::now(); }
+
+		/**
+		 * Stop timing the mix of a block and update the quality level.
+		 *
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void EndBlock(uint32 frameCount);
+
+		/**
+		 * Update the quality level with the time a block took, measured by the caller.
+		 *
+		 * @param seconds: The time the mix of the block took in seconds.
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void ReportBlock(double seconds, uint32 frameCount);
+
+		/**
+		 * Get the current quality level.
+		 *
+		 * @return The quality level.
+		 */
+		QualityLevel GetLevel() const { return mLevel; }
+
+		/**
+		 * Get the governor stats. This can be called from any thread.
+		 *
+		 * @return The stats structure.
+		 */
+		QualityGovernorStats GetStats() const;
+
+	private:
+		static const uint32 MaxBackoff = 8;	// The largest multiple of the step up time a step up waits.
+
+		/**
+		 * Change the quality level and set the knobs of all the registered objects.
+		 *
+		 * @param level: The quality level.
+		 */
+		void SetLevel(QualityLevel level);
+
+		/**
+		 * Set the knobs of a voice table for the current quality level.
+		 *
+		 * @param pTable: The voice table pointer.
+		 */
+		void ApplyLevel(VoiceTable* pTable) const;
+
+		/**
+		 * Set the knobs of a binaural renderer for the current quality level.
+		 *
+		 * @param pRenderer: The renderer pointer.
+		 */
+		void ApplyLevel(BinauralRenderer* pRenderer) const;
+
+		/**
+		 * Set the knobs of a reverb for the current quality level.
+		 *
+		 * @param pReverb: The reverb pointer.
+		 */
+		void ApplyLevel(FDNReverb* pReverb) const;
+
+	private:
+		Vector<VoiceTable*> mVoiceTables;	// The registered voice tables.
+		Vector<BinauralRenderer*> mBinauralRenderers;	// The registered binaural renderers.
+		Vector<FDNReverb*> mReverbs;	// The registered reverbs.
+
+		QualityGovernorDescription mDescription = {};	// The governor description.
+		QualityGovernorStats mStats = {};	// The governor stats.
+		mutable std::mutex mMutex;	// Guards the stats.
+
+		std::chrono::steady_clock::time_point mBlockStart = {};	// The time the mix of the current block started.
+		QualityLevel mLevel = QualityLevel::QUALITY_LEVEL_FULL;	// The current quality level.
+
+		uint32 mStepDownBlocks = 1;	// The step down time in blocks, computed from the size of the last block.
+		uint32 mStepUpBlocks = 1;	// The step up time in blocks, computed from the size of the last block.
+		uint32 mOverBudgetBlocks = 0;	// The number of blocks in a row over the budget.
+		uint32 mUnderBudgetBlocks = 0;	// The number of blocks in a row under the recovery budget.
+		uint32 mBlocksSinceStepUp = ~0U;	// The number of blocks since quality was last restored.
+		uint32 mBackoff = 1;	// The multiple of the step up time the next step up waits.
+	};
+}
\ No newline at end of file
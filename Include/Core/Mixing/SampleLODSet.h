@@ -0,0 +1,180 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+#include <atomic>
+
+namespace EnSound
+{
+	/**
+	 * Sample LOD Set Description structure.
+	 */
+	struct SampleLODSetDescription {
+		const float* pSamples = nullptr;	// The interleaved float samples at full rate. They must outlive the set.
+		uint64 mFrameCount = 0;	// The number of frames.
+		uint32 mChannelCount = 1;	// The number of channels of the samples, 1 or 2.
+
+		uint32 mLODCount = 3;	// The number of LODs, the full rate one included. Up to SampleLODSet::MaxLODCount.
+		bool mIsLooping = false;	// Whether the sound loops, so the filter wraps around its ends instead of fading them.
+		bool mIsMonoFolded = false;	// Whether the reduced LODs of stereo samples are folded to mono.
+		bool mIsLazy = false;	// Whether the reduced LODs are only generated once a voice asks for them, see GenerateRequested().
+	};
+
+	/**
+	 * Sample LOD Set object.
+	 * This holds decimated copies of a sound, its levels of detail: LOD 0 is the sound itself, LOD 1 is at half of its
+	 * rate and LOD 2 at a quarter. The many distant copies of common sounds, such as footsteps and gunfire, have lost
+	 * their highs to distance anyway, so voices playing them can read a reduced LOD which spans half or a quarter of
+	 * the memory, and keeps more of the sounds in cache, see VoiceTable::SetLODGain(). The reduced LODs can also be
+	 * folded to mono, which halves them again.
+	 *
+	 * Every LOD is decimated from the one before it with the halfband filter of the bus graph's upsampler, which keeps
+	 * 80% of the band of the reduced rate and adds no delay, so the frames of all the LODs line up and a voice can
+	 * crossfade between them.
+	 *
+	 * The reduced LODs are generated when the set is initialized, or in a lazy set only once a voice asks for them, by
+	 * GenerateRequested() on any thread but the mixer's. Under memory pressure they can be evicted again. Voices stop
+	 * choosing an evicted LOD right away, but its samples are only freed once no voice reads them, so eviction must be
+	 * retried until it succeeds. Eviction, like updating a voice table, must happen between blocks.
+	 */
+	class SampleLODSet {
+	public:
+		static const uint32 MaxLODCount = 3;	// The maximum number of LODs, down to a quarter of the rate.
+
+	public:
+		/**
+		 * Default constructor.
+		 */
+		SampleLODSet() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~SampleLODSet() {}
+
+		/**
+		 * Initialize the set, and generate the reduced LODs unless it is lazy.
+		 *
+		 * @param description: The set description.
+		 * @return Boolean stating if the set was initialized.
+		 */
+		bool Initialize(const SampleLODSetDescription& description);
+
+		/**
+		 * Terminate the set and free the reduced LODs. No voice may play it anymore.
+		 */
+		void Terminate();
+
+		/**
+		 * Generate a reduced LOD, from the closest finer one which is resident.
+		 * This must not be called on the mixer thread, nor concurrently with any other call generating or evicting.
+		 *
+		 * @param lod: The LOD index.
+		 * @return Boolean stating if the LOD is resident.
+		 */
+		bool Generate(uint32 lod);
+
+		/**
+		 * Generate the reduced LODs voices asked for since they were last generated or evicted.
+		 * This must not be called on the mixer thread, nor concurrently with any other call generating or evicting.
+		 */
+		void GenerateRequested();
+
+		/**
+		 * Evict a reduced LOD. Voices playing it crossfade to a finer LOD over their next block.
+		 * This must be called between blocks.
+		 *
+		 * @param lod: The LOD index.
+		 * @return Boolean stating if the samples were freed. They are not while a voice still reads them.
+		 */
+		bool Evict(uint32 lod);
+
+		/**
+		 * Check if a LOD can be played.
+		 *
+		 * @param lod: The LOD index.
+		 * @return Boolean value. LOD 0 is always resident.
+		 */
+		bool IsResident(uint32 lod) const { return lod < mDescription.mLODCount && mIsResident[lod].load(std::memory_order_acquire); }
+
+		/**
+		 * Ask for a LOD to be generated in a lazy set, see GenerateRequested(). This can be called from any thread.
+		 *
+		 * @param lod: The LOD index.
+		 */
+		void Request(uint32 lod) { if (lod < mDescription.mLODCount) mIsRequested[lod].store(true, std::memory_order_relaxed); }
+
+		/**
+		 * Mark a LOD as read by a voice, so it is not freed. Voice tables call this when a voice switches to it.
+		 *
+		 * @param lod: The LOD index.
+		 */
+		void Acquire(uint32 lod) { mReaderCounts[lod].fetch_add(1, std::memory_order_relaxed); }
+
+		/**
+		 * Mark a LOD as no longer read by a voice.
+		 *
+		 * @param lod: The LOD index.
+		 */
+		void Release(uint32 lod) { mReaderCounts[lod].fetch_sub(1, std::memory_order_relaxed); }
+
+		/**
+		 * Get the number of voices reading a LOD.
+		 *
+		 * @param lod: The LOD index.
+		 * @return The reader count.
+		 */
+		uint32 GetReaderCount(uint32 lod) const { return mReaderCounts[lod].load(std::memory_order_relaxed); }
+
+		/**
+		 * Get the samples of a LOD.
+		 * An evicted LOD stays readable until its samples are freed, so the voices still reading it can finish.
+		 *
+		 * @param lod: The LOD index.
+		 * @return The interleaved samples. nullptr if the LOD was never generated or was freed.
+		 */
+		const float* GetSamples(uint32 lod) const { return lod ? (lod < MaxLODCount && !mLODs[lod].empty() ? mLODs[lod].data() : nullptr) : mDescription.pSamples; }
+
+		/**
+		 * Get the number of frames of a LOD.
+		 *
+		 * @param lod: The LOD index.
+		 * @return The frame count.
+		 */
+		uint64 GetFrameCount(uint32 lod) const { return lod < MaxLODCount ? mFrameCounts[lod] : 0; }
+
+		/**
+		 * Get the number of channels of a LOD.
+		 *
+		 * @param lod: The LOD index.
+		 * @return The channel count.
+		 */
+		uint32 GetChannelCount(uint32 lod) const { return lod && mDescription.mIsMonoFolded ? 1 : mDescription.mChannelCount; }
+
+		/**
+		 * Get the number of LODs.
+		 *
+		 * @return The LOD count.
+		 */
+		uint32 GetLODCount() const { return mDescription.mLODCount; }
+
+		/**
+		 * Get the memory the reduced LODs take.
+		 *
+		 * @return The size in bytes.
+		 */
+		uint64 GetMemorySize() const;
+
+	private:
+		SampleLODSetDescription mDescription = {};	// The set description.
+		Vector<float> mLODs[MaxLODCount];	// The samples of the reduced LODs. The first one is unused, LOD 0 is the description's.
+		uint64 mFrameCounts[MaxLODCount] = {};	// The number of frames of every LOD.
+
+		std::atomic<bool> mIsResident[MaxLODCount] = {};	// Whether every LOD can be played.
+		std::atomic<bool> mIsRequested[MaxLODCount] = {};	// Whether a voice asked for every LOD while it was not resident.
+		std::atomic<uint32> mReaderCounts[MaxLODCount] = {};	// The number of voices reading every LOD.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,637 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DSP/FilterBank.h"
+#include "Core/Mixing/BusGraph.h"
+#include "Core/Mixing/HDRWindow.h"
+#include "Core/Mixing/SampleLODSet.h"
+#include "Core/Spatial/Spatializer.h"
+
+namespace EnSound
+{
+	/**
+	 * Voice Flags.
+	 */
+	struct VoiceFlags {
+		static const uint8 Playing = 0x01;
+		static const uint8 Looping = 0x02;
+		static const uint8 Paused = 0x04;
+		static const uint8 Spatial = 0x08;
+		static const uint8 Starting = 0x10;
+		static const uint8 Filtered = 0x20;
+		static const uint8 Virtual = 0x40;
+		static const uint8 Culled = 0x80;
+	};
+
+	/**
+	 * Resampler Quality enum.
+	 * The interpolation voices are read with when they do not play at the mix rate, from the best to the cheapest.
+	 */
+	enum class ResamplerQuality : uint8 {
+		RESAMPLER_QUALITY_CUBIC,	// 4 point Hermite interpolation, which keeps more of the highs of pitched voices.
+		RESAMPLER_QUALITY_LINEAR,	// Linear interpolation between the two closest frames.
+	};
+
+	/**
+	 * Voice Description structure.
+	 */
+	struct VoiceDescription {
+		const float* pSamples = nullptr;	// The interleaved float samples. They must outlive the voice.
+		uint64 mFrameCount = 0;	// The number of frames.
+		uint32 mChannelCount = 1;	// The number of channels of the samples, 1 or 2.
+
+		const wchar* pName = nullptr;	// The name of the sound, usually its file name.
+
+		float mGain = 1.0f;	// The linear gain.
+		float mPan = 0.0f;	// The pan, from -1 (left) to 1 (right).
+		float mPitchRatio = 1.0f;	// The playback rate relative to the mix rate.
+		bool mIsLooping = false;	// Whether the voice loops.
+
+		bool mIsSpatial = false;	// Whether the voice is positioned in 3D. Its pan is then ignored.
+		uint32 mSpatialSettings = 0;	// The emitter settings index of a spatial voice.
+
+		float mSendLevels[BusInput::MaxSendCount] = {};	// The level of every send slot of the bus, such as the reverb of a zone.
+		FilterParameters mFilter = {};	// The filter of the voice, such as a low pass for occlusion.
+		float mLoudness = 0.0f;	// The authored loudness in dB, used when the table has an HDR window.
+
+		SampleLODSet* pLODSet = nullptr;	// The LOD set of the sound, whose LOD 0 replaces the samples above. It must outlive the voice.
+		uint32 mMinimumLOD = 0;	// The finest LOD the voice plays, such as 1 or 2 for low priority voices.
+	};
+
+	/**
+	 * Voice Table object.
+	 * This holds the state of the active voices of a bus as structure of arrays: gains, pans, pitch ratios, positions,
+	 * read cursors and flags each live in their own contiguous array, indexed by the voice's dense index. Stopping a
+	 * voice swaps the last voice into its place, so the active voices are always packed at the front and the per block
+	 * passes only touch the arrays they need. Data which is not touched while mixing, such as the name, is kept in a
+	 * separate array indexed by the voice's slot.
+	 *
+	 * Voice handles hold the slot and a generation, so a handle of a stopped voice never refers to a newer one.
+	 *
+	 * Gain, pan and pitch changes ramp across the next block instead of stepping at its start. Voices whose parameters
+	 * did not change take a direct path without any per frame ramp.
+	 *
+	 * Every voice also has a level for each send slot of the bus, so it can feed shared effect buses such as zone
+	 * reverbs after its gain and pan. Send level changes ramp like gains, so moving a voice from one zone to another is
+	 * a crossfade of its send levels.
+	 *
+	 * Voices can have a filter, which runs before their gains. The filters of the voices are processed by a filter bank
+	 * in groups of four mono channels, so four mono voices or two stereo ones share every SIMD filter pass, and filter
+	 * changes interpolate across the next block like the gains.
+	 *
+	 * Voices which are silent for a whole block, because their gains and send levels are zero such as voices culled by
+	 * distance, only move their read cursors. A table whose voices are all silent adds nothing to its bus, which lets
+	 * the bus stay silent.
+	 *
+	 * With an HDR window, every voice is turned down by how far its authored loudness is below the top of the window,
+	 * and voices whose loudness with their gains falls below the floor of the window are virtualized: their gains are
+	 * zero, so after fading out across one block they take the silent path above until they are loud enough again.
+	 *
+	 * With a real voice cap, only the loudest voices up to the cap are mixed and the others are culled like virtual
+	 * voices. Voices which are already real are favored, so that voices of similar gains do not swap every block.
+	 *
+	 * Voices playing a sample LOD set switch between its LODs by their gains, so distant and quiet voices read the
+	 * cheaper half or quarter rate copies, and low priority voices can be kept on a coarse LOD. A voice crossfades
+	 * from its previous LOD to the new one across a block, and only switches back once its gain is 3 dB above the
+	 * threshold, so voices at the edge of a threshold do not switch every block.
+	 *
+	 * Spatial voices take their left and right gains and a Doppler pitch ratio from a Spatializer, which processes the
+	 * position, velocity and cone arrays of the table in one pass.
+	 *
+	 * The table is mixed into a bus as a bus input. It is not thread safe, so the voices must be updated between blocks
+	 * (or from the mixer thread).
+	 */
+	class VoiceTable final : public BusInput {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		VoiceTable() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~VoiceTable() {}
+
+		/**
+		 * Initialize the table.
+		 * All the arrays are allocated up front, so playing a voice never allocates.
+		 *
+		 * @param capacity: The maximum number of voices.
+		 * @param sampleRate: The mix sample rate, which the filter frequencies are relative to.
+		 * @param rateDivisor: The rate divisor of the bus the table mixes into, see BusGraph::SetBusRateDivisor(). The
+		 * voices keep their pitch and filter frequencies but are mixed at the divided rate, where their frequencies
+		 * above its Nyquist frequency fold back, so a divided table suits voices which have little of those left.
+		 */
+		void Initialize(uint32 capacity, uint32 sampleRate = 48000, uint32 rateDivisor = 1);
+
+		/**
+		 * Terminate the table and stop all the voices.
+		 */
+		void Terminate();
+
+		/**
+		 * Start a voice.
+		 *
+		 * @param description: The voice description.
+		 * @return The voice handle. 0 if the table is full or the description is invalid.
+		 */
+		uint64 Play(const VoiceDescription& description);
+
+		/**
+		 * Stop a voice.
+		 *
+		 * @param handle: The voice handle.
+		 */
+		void Stop(uint64 handle);
+
+		/**
+		 * Check if a voice is still playing.
+		 *
+		 * @param handle: The voice handle.
+		 * @return Boolean value.
+		 */
+		bool IsPlaying(uint64 handle) const { return GetDenseIndex(handle) != InvalidIndex; }
+
+		/**
+		 * Pause or resume a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param isPaused: Whether the voice is paused.
+		 */
+		void SetPaused(uint64 handle, bool isPaused);
+
+		/**
+		 * Set the gain of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param gain: The linear gain.
+		 */
+		void SetGain(uint64 handle, float gain);
+
+		/**
+		 * Set the gains of many voices at once.
+		 *
+		 * @param pHandles: The voice handles.
+		 * @param pGains: The linear gains.
+		 * @param count: The number of voices.
+		 */
+		void SetGains(const uint64* pHandles, const float* pGains, uint32 count);
+
+		/**
+		 * Set the level a voice is sent to a send slot with.
+		 *
+		 * @param handle: The voice handle.
+		 * @param slot: The send slot.
+		 * @param level: The linear send level.
+		 */
+		void SetSendLevel(uint64 handle, uint32 slot, float level);
+
+		/**
+		 * Set the send levels of many voices at once, usually when the listener changes zones.
+		 *
+		 * @param pHandles: The voice handles.
+		 * @param slot: The send slot.
+		 * @param pLevels: The linear send levels.
+		 * @param count: The number of voices.
+		 */
+		void SetSendLevels(const uint64* pHandles, uint32 slot, const float* pLevels, uint32 count);
+
+		/**
+		 * Set the filter of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param parameters: The filter parameters. A filter of no type removes the filter.
+		 */
+		void SetFilter(uint64 handle, const FilterParameters& parameters);
+
+		/**
+		 * Set the authored loudness of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param loudness: The loudness in dB.
+		 */
+		void SetLoudness(uint64 handle, float loudness);
+
+		/**
+		 * Set the HDR window the voices are mixed with.
+		 *
+		 * @param pWindow: The window pointer. It must outlive its use by the table. nullptr to mix without one.
+		 */
+		void SetHDRWindow(HDRWindow* pWindow) { pHDRWindow = pWindow; }
+
+		/**
+		 * Set the interpolation of the voices which do not play at the mix rate.
+		 *
+		 * @param quality: The resampler quality.
+		 */
+		void SetResamplerQuality(ResamplerQuality quality) { mResamplerQuality = quality; }
+
+		/**
+		 * Get the interpolation of the voices which do not play at the mix rate.
+		 *
+		 * @return The resampler quality.
+		 */
+		ResamplerQuality GetResamplerQuality() const { return mResamplerQuality; }
+
+		/**
+		 * Set the largest number of voices which are mixed. The quietest voices above it are culled until they are
+		 * loud enough again.
+		 *
+		 * @param count: The real voice cap. ~0U for no cap.
+		 */
+		void SetMaxRealVoices(uint32 count) { mMaxRealVoices = count; }
+
+		/**
+		 * Get the largest number of voices which are mixed.
+		 *
+		 * @return The real voice cap. ~0U for no cap.
+		 */
+		uint32 GetMaxRealVoices() const { return mMaxRealVoices; }
+
+		/**
+		 * Set the gain below which voices play a LOD of their LOD sets.
+		 * Voices whose louder channel gain, after spatialization and the HDR window, is below the gain of a LOD play
+		 * it or a coarser one.
+		 *
+		 * @param lod: The LOD index, 1 or 2.
+		 * @param gain: The linear gain. 0 to never choose the LOD by gain.
+		 */
+		void SetLODGain(uint32 lod, float gain) { if (lod && lod < SampleLODSet::MaxLODCount) mLODGains[lod] = gain; }
+
+		/**
+		 * Set the finest LOD a voice plays, such as a coarse one for low priority voices.
+		 *
+		 * @param handle: The voice handle.
+		 * @param lod: The LOD index.
+		 */
+		void SetMinimumLOD(uint64 handle, uint32 lod);
+
+		/**
+		 * Get the LOD a voice plays.
+		 *
+		 * @param handle: The voice handle.
+		 * @return The LOD index. 0 for voices without a LOD set.
+		 */
+		uint32 GetLOD(uint64 handle) const;
+
+		/**
+		 * Check if a voice is virtual, because it is masked by louder voices in the HDR window or culled by the real
+		 * voice cap.
+		 *
+		 * @param handle: The voice handle.
+		 * @return Boolean value.
+		 */
+		bool IsVirtual(uint64 handle) const;
+
+		/**
+		 * Set the pan of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param pan: The pan, from -1 (left) to 1 (right).
+		 */
+		void SetPan(uint64 handle, float pan);
+
+		/**
+		 * Set the pitch ratio of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param pitchRatio: The playback rate relative to the mix rate.
+		 */
+		void SetPitchRatio(uint64 handle, float pitchRatio);
+
+		/**
+		 * Set the position of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @param x: The X coordinate.
+		 * @param y: The Y coordinate.
+		 * @param z: The Z coordinate.
+		 */
+		void SetPosition(uint64 handle, float x, float y, float z);
+
+		/**
+		 * Upload the emitter data of many voices at once, usually all the spatial voices once per frame.
+		 * The optional arrays which are nullptr leave the matching voice data untouched.
+		 *
+		 * @param pHandles: The voice handles.
+		 * @param emitters: The emitter arrays, indexed like the handles.
+		 * @param count: The number of voices.
+		 */
+		void SetEmitters(const uint64* pHandles, const EmitterArrays& emitters, uint32 count);
+
+		/**
+		 * Compute the gains and Doppler ratios of all the spatial voices in a single pass.
+		 * The first two speakers of the spatializer's layout feed the left and right channels. This should be called
+		 * once per block, before the table is mixed.
+		 *
+		 * @param spatializer: The spatializer.
+		 * @param listener: The listener.
+		 */
+		void Spatialize(Spatializer& spatializer, const Listener& listener);
+
+		/**
+		 * Set the curve gain and pan changes ramp with.
+		 *
+		 * @param curve: The ramp curve. Pitch changes always ramp linearly.
+		 */
+		void SetRampCurve(RampCurve curve) { mRampCurve = curve; }
+
+		/**
+		 * Get the name of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @return The name. nullptr if the voice is not playing.
+		 */
+		const wchar* GetName(uint64 handle) const;
+
+		/**
+		 * Get the number of active voices.
+		 *
+		 * @return The voice count.
+		 */
+		uint32 GetVoiceCount() const { return mVoiceCount; }
+
+		/**
+		 * Get the number of voices which were virtual or culled in the last block.
+		 *
+		 * @return The virtual voice count.
+		 */
+		uint32 GetVirtualVoiceCount() const { return mVirtualCount; }
+
+		/**
+		 * Get the maximum number of voices.
+		 *
+		 * @return The capacity.
+		 */
+		uint32 GetCapacity() const { return static_cast<uint32>(mGains.size()); }
+
+		/**
+		 * Get the factor the table mixes below the mix rate at.
+		 *
+		 * @return The rate divisor.
+		 */
+		uint32 GetRateDivisor() const { return mRateDivisor; }
+
+		/**
+		 * Mix all the active voices into a bus.
+		 * Voices which reach their end are stopped.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 * @return Boolean stating if any voice was mixed.
+		 */
+		bool Mix(float* pBuffer, uint32 frameCount, uint32 channelCount) override;
+
+		/**
+		 * Mix all the active voices into a bus and its sends.
+		 * Voices which reach their end are stopped.
+		 *
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots. nullptr for the slots which are not routed.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 * @return The mask of the buffers which any voice was mixed into: bit 0 for the bus and bit 1 + slot for the sends.
+		 */
+		uint32 MixWithSends(float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount) override;
+
+	private:
+		static const uint32 InvalidIndex = ~0U;	// The index of a voice which is not playing.
+		static const uint32 ChunkFrames = 64;	// The number of frames resampled at once on the stack.
+
+		/**
+		 * Get the dense index of a voice.
+		 *
+		 * @param handle: The voice handle.
+		 * @return The dense index. InvalidIndex if the voice is not playing.
+		 */
+		uint32 GetDenseIndex(uint64 handle) const;
+
+		/**
+		 * Remove a voice by swapping the last voice into its place.
+		 *
+		 * @param index: The dense index of the voice.
+		 */
+		void RemoveVoice(uint32 index);
+
+		/**
+		 * Compute the left and right gains of all the voices from their gains and pans.
+		 */
+		void UpdateChannelGains();
+
+		/**
+		 * Scale the channel gains of all the voices by the HDR window and virtualize the masked ones.
+		 */
+		void ApplyHDRWindow();
+
+		/**
+		 * Cull the quietest voices above the real voice cap.
+		 */
+		void ApplyVoiceCap();
+
+		/**
+		 * Choose the LOD of every voice with a LOD set from its gains.
+		 */
+		void UpdateLODs();
+
+		/**
+		 * Switch a voice to another LOD of its LOD set, crossfading from the current one unless the voice is starting.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param lod: The new LOD index. It must be resident.
+		 */
+		void SwitchLOD(uint32 index, uint32 lod);
+
+		/**
+		 * Get the number of filter lanes a voice takes this block, the most channels of its current and previous LODs.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @return The lane count, 1 or 2.
+		 */
+		uint32 GetLaneCount(uint32 index) const;
+
+		/**
+		 * Start mixing a voice for a block.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @return The pitch ratio at the end of the block, including Doppler and the rate divisor.
+		 */
+		float BeginVoice(uint32 index);
+
+		/**
+		 * Finish mixing a voice for a block, keeping its values as the start of the next ramps.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pitchRatio: The pitch ratio at the end of the block, including Doppler.
+		 */
+		void EndVoice(uint32 index, float pitchRatio);
+
+		/**
+		 * Get the buffers a voice is heard in this block, from its gains and send levels.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @return The mask of the buffers, as returned by MixWithSends(). 0 if the voice is silent.
+		 */
+		uint32 GetOutputMask(uint32 index, float* const* ppSends, uint32 sendCount) const;
+
+		/**
+		 * Move a silent voice through a block without reading its samples.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param frameCount: The number of frames in the block.
+		 */
+		void SkipVoice(uint32 index, uint32 frameCount);
+
+		/**
+		 * Mix a single unfiltered voice.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		void MixVoice(uint32 index, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount);
+
+		/**
+		 * Mix a group of filtered voices, whose channels fit in the lanes of the filter bank.
+		 *
+		 * @param pIndices: The dense indexes of the voices.
+		 * @param voiceCount: The number of voices.
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		void MixFilteredVoices(const uint32* pIndices, uint32 voiceCount, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount);
+
+		/**
+		 * Mix a single voice which plays at the mix rate with steady gains, straight from its samples.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		void MixDirect(uint32 index, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount);
+
+		/**
+		 * Mix a single voice with interpolation and per frame gains and pitch ratios.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pitchRatio: The pitch ratio at the end of the block, including Doppler.
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		void MixResampled(uint32 index, float pitchRatio, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount);
+
+		/**
+		 * Read a chunk of a voice at per frame pitch ratios, interpolating between source frames.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pitchRatio: The pitch ratio at the end of the block, including Doppler.
+		 * @param chunk: The index in the block of the first frame of the chunk.
+		 * @param chunkFrames: The number of frames in the chunk.
+		 * @param frameCount: The number of frames in the block.
+		 * @param pFrames: The stereo frames. Mono voices get the same sample on both sides.
+		 * @return The number of frames read, less than the chunk frames if the voice ended.
+		 */
+		uint32 ReadFrames(uint32 index, float pitchRatio, uint32 chunk, uint32 chunkFrames, uint32 frameCount, float* pFrames);
+
+		/**
+		 * Mix a chunk of stereo frames of a voice into the bus and its sends with the per frame gains of the voice.
+		 *
+		 * @param index: The dense index of the voice.
+		 * @param pFrames: The stereo frames.
+		 * @param produced: The number of frames.
+		 * @param chunk: The index in the block of the first frame of the chunk.
+		 * @param pBuffer: The interleaved bus buffer.
+		 * @param ppSends: The interleaved buffers of the send slots.
+		 * @param sendCount: The number of send slots.
+		 * @param frameCount: The number of frames in the block.
+		 * @param channelCount: The number of channels of the bus.
+		 */
+		void MixChunk(uint32 index, const float* pFrames, uint32 produced, uint32 chunk, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount);
+
+	private:
+		/**
+		 * Voice Cold Data structure.
+		 * This holds the voice data which the mixer never reads.
+		 */
+		struct VoiceColdData {
+			const wchar* pName = nullptr;	// The name of the sound.
+			uint32 mGeneration = 0;	// The generation of the slot, incremented every time it is freed.
+			uint32 mDenseIndex = InvalidIndex;	// The dense index of the voice in the slot.
+		};
+
+		// Hot data, indexed by the dense index.
+		Vector<float> mGains;	// The linear gains.
+		Vector<float> mPans;	// The pans.
+		Vector<float> mLeftGains;	// The left channel gains, computed every block.
+		Vector<float> mRightGains;	// The right channel gains, computed every block.
+		Vector<float> mPreviousLeftGains;	// The left channel gains at the end of the last block.
+		Vector<float> mPreviousRightGains;	// The right channel gains at the end of the last block.
+		Vector<float> mPitchRatios;	// The pitch ratios.
+		Vector<float> mPreviousPitchRatios;	// The pitch ratios, including Doppler and the rate divisor, at the end of the last block.
+		Vector<float> mPositionsX;	// The X coordinates.
+		Vector<float> mPositionsY;	// The Y coordinates.
+		Vector<float> mPositionsZ;	// The Z coordinates.
+		Vector<float> mVelocitiesX;	// The X velocities.
+		Vector<float> mVelocitiesY;	// The Y velocities.
+		Vector<float> mVelocitiesZ;	// The Z velocities.
+		Vector<float> mForwardsX;	// The X of the cone directions.
+		Vector<float> mForwardsY;	// The Y of the cone directions.
+		Vector<float> mForwardsZ;	// The Z of the cone directions.
+		Vector<uint32> mSpatialSettings;	// The emitter settings indexes.
+		Vector<float> mSpatialLeftGains;	// The left spatial gains, computed by Spatialize().
+		Vector<float> mSpatialRightGains;	// The right spatial gains, computed by Spatialize().
+		Vector<float> mDopplerRatios;	// The Doppler pitch ratios, computed by Spatialize().
+		Vector<float> mSendLevels[BusInput::MaxSendCount];	// The send levels of every send slot.
+		Vector<float> mPreviousSendLevels[BusInput::MaxSendCount];	// The send levels at the end of the last block.
+		Vector<float> mLoudness;	// The authored loudness.
+		Vector<float> mPerceivedLoudness;	// The loudness with the gains of the current block.
+		Vector<double> mReadCursors;	// The read positions in frames.
+		Vector<const float*> mSamples;	// The sample pointers.
+		Vector<uint64> mFrameCounts;	// The frame counts.
+		Vector<uint32> mChannelCounts;	// The channel counts of the samples.
+		Vector<SampleLODSet*> mLODSets;	// The LOD sets. nullptr for voices playing plain samples.
+		Vector<uint8> mLODs;	// The LODs the samples belong to.
+		Vector<uint8> mPreviousLODs;	// The LODs crossfaded from this block, the same as the current ones otherwise.
+		Vector<uint8> mMinimumLODs;	// The finest LODs the voices play.
+		Vector<uint32> mSlots;	// The slot of each voice.
+		Vector<uint8> mFlags;	// The voice flags.
+
+		// Scratch memory.
+		Vector<uint32> mOrder;	// The audible voices ordered by priority.
+		Vector<float> mPriorities;	// The priority of every voice for the real voice cap.
+
+		FilterBank mFilters;	// The left and right filters of every voice, indexed by twice the dense index.
+
+		// Cold data, indexed by the slot.
+		Vector<VoiceColdData> mColdData;	// The cold data of every slot.
+		Vector<uint32> mFreeSlots;	// The slots which are not in use.
+
+		HDRWindow* pHDRWindow = nullptr;	// The HDR window. nullptr to mix without one.
+		uint32 mVoiceCount = 0;	// The number of active voices.
+		uint32 mVirtualCount = 0;	// The number of virtual voices in the last block.
+		uint32 mCulledCount = 0;	// The number of voices culled by the real voice cap in the last block.
+		uint32 mMaxRealVoices = ~0U;	// The real voice cap.
+		uint32 mRateDivisor = 1;	// The factor the table mixes below the mix rate at.
+		float mLODGains[SampleLODSet::MaxLODCount] = {};	// The gain below which voices play every LOD.
+		ResamplerQuality mResamplerQuality = ResamplerQuality::RESAMPLER_QUALITY_LINEAR;	// The interpolation of resampled voices.
+		RampCurve mRampCurve = RampCurve::RAMP_CURVE_LINEAR;	// The curve gain and pan changes ramp with.
+	};
+}
\ No newline at end of file
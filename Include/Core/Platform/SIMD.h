@@ -0,0 +1,15 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+/**
+ * SIMD support detection.
+ * SSE2 is part of the x64 baseline, so every x64 build gets ENSD_SIMD_SSE2 without any additional compiler flags.
+ * Every SIMD code path in the Core must have a scalar fallback for the other targets.
+ */
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENSD_SIMD_SSE2
+#include <emmintrin.h>
+
+#endif // SSE2
\ No newline at end of file
@@ -0,0 +1,524 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Codecs/ADPCM.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+/**
+ * The block layouts follow the Microsoft ADPCM and IMA ADPCM (DVI) specifications from the Multimedia Registration
+ * Kit (https://docs.microsoft.com/en-us/windows/win32/xaudio2/adpcm-overview).
+ */
+
+namespace EnSound
+{
+	namespace
+	{
+		const int32 MSAdaptationTable[16] = { 230, 230, 230, 230, 307, 409, 512, 614, 768, 614, 512, 409, 307, 230, 230, 230 };
+		const int32 MSCoefficient1[7] = { 256, 512, 0, 192, 240, 460, 392 };
+		const int32 MSCoefficient2[7] = { 0, -256, 0, 64, 0, -208, -232 };
+
+		const int32 IMAIndexTable[16] = { -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8 };
+		const int32 IMAStepTable[89] = {
+			7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45, 50, 55, 60, 66, 73, 80, 88, 97,
+			107, 118, 130, 143, 157, 173, 190, 209, 230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+			876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428,
+			4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350,
+			22385, 24623, 27086, 29794, 32767
+		};
+
+		const uint32 MSHeaderBytes = 7;		// Per channel: predictor (1), delta (2), sample 1 (2), sample 2 (2).
+		const uint32 IMAHeaderBytes = 4;	// Per channel: predictor (2), step index (1), reserved (1).
+
+		inline int32 Clamp16(int32 value) { return std::min(std::max(value, -32768), 32767); }
+
+		inline int16 ReadInt16(const uint8* ptr) { return static_cast<int16>(ptr[0] | (ptr[1] << 8)); }
+
+		inline void WriteInt16(uint8* ptr, int32 value)
+		{
+			ptr[0] = static_cast<uint8>(value & 0xFF);
+			ptr[1] = static_cast<uint8>((value >> 8) & 0xFF);
+		}
+
+		/**
+		 * Microsoft ADPCM channel state.
+		 */
+		struct MSChannelState {
+			int32 mCoefficient1 = 0;
+			int32 mCoefficient2 = 0;
+			int32 mDelta = 0;
+			int32 mSample1 = 0;
+			int32 mSample2 = 0;
+
+			int32 Expand(uint8 nibble)
+			{
+				const int32 signedNibble = (nibble & 0x08) ? static_cast<int32>(nibble) - 16 : static_cast<int32>(nibble);
+				const int32 predicted = Clamp16(((mSample1 * mCoefficient1 + mSample2 * mCoefficient2) >> 8) + signedNibble * mDelta);
+
+				mSample2 = mSample1;
+				mSample1 = predicted;
+				mDelta = std::min(std::max((MSAdaptationTable[nibble] * mDelta) >> 8, 16), 32767);
+
+				return predicted;
+			}
+
+			uint8 Compress(int32 sample)
+			{
+				const int32 predicted = (mSample1 * mCoefficient1 + mSample2 * mCoefficient2) >> 8;
+				int32 error = sample - predicted;
+				error += (error >= 0) ? mDelta / 2 : -mDelta / 2;
+
+				const uint8 nibble = static_cast<uint8>(std::min(std::max(error / mDelta, -8), 7) & 0x0F);
+				Expand(nibble);
+				return nibble;
+			}
+		};
+
+		/**
+		 * IMA ADPCM channel state.
+		 */
+		struct IMAChannelState {
+			int32 mPredictor = 0;
+			int32 mStepIndex = 0;
+
+			int32 Expand(uint8 nibble)
+			{
+				const int32 step = IMAStepTable[mStepIndex];
+
+				int32 difference = step >> 3;
+				if (nibble & 0x01) difference += step >> 2;
+				if (nibble & 0x02) difference += step >> 1;
+				if (nibble & 0x04) difference += step;
+
+				mPredictor = Clamp16((nibble & 0x08) ? mPredictor - difference : mPredictor + difference);
+				mStepIndex = std::min(std::max(mStepIndex + IMAIndexTable[nibble], 0), 88);
+
+				return mPredictor;
+			}
+
+			uint8 Compress(int32 sample)
+			{
+				int32 difference = sample - mPredictor;
+				uint8 nibble = 0;
+				if (difference < 0)
+				{
+					nibble = 0x08;
+					difference = -difference;
+				}
+
+				int32 step = IMAStepTable[mStepIndex];
+				for (uint8 mask = 0x04; mask; mask >>= 1, step >>= 1)
+				{
+					if (difference >= step)
+					{
+						nibble |= mask;
+						difference -= step;
+					}
+				}
+
+				Expand(nibble);
+				return nibble;
+			}
+		};
+
+		/**
+		 * Encode a single channel of a Microsoft ADPCM block with a given predictor.
+		 *
+		 * @return The sum of squared errors.
+		 */
+		uint64 EncodeMSChannel(const int16* pSamples, uint16 channels, uint32 samplesPerBlock, uint8 predictor, MSChannelState& header, Vector<uint8>& nibbles)
+		{
+			MSChannelState state = {};
+			state.mCoefficient1 = MSCoefficient1[predictor];
+			state.mCoefficient2 = MSCoefficient2[predictor];
+			state.mSample2 = pSamples[0];
+			state.mSample1 = pSamples[channels];
+
+			// Initial delta from the average prediction error of the start of the block.
+			int64 errorSum = 0;
+			const uint32 window = std::min(samplesPerBlock, 18U);
+			for (uint32 i = 2; i < window; i++)
+			{
+				const int32 predicted = (pSamples[(i - 1) * channels] * state.mCoefficient1 + pSamples[(i - 2) * channels] * state.mCoefficient2) >> 8;
+				errorSum += std::abs(pSamples[i * channels] - predicted);
+			}
+			state.mDelta = std::max(static_cast<int32>(errorSum / std::max(window - 2, 1U) / 4), 16);
+			header = state;
+
+			uint64 squaredError = 0;
+			nibbles.resize(samplesPerBlock - 2);
+			for (uint32 i = 2; i < samplesPerBlock; i++)
+			{
+				const int32 sample = pSamples[i * channels];
+				nibbles[i - 2] = state.Compress(sample);
+
+				const int64 error = sample - state.mSample1;
+				squaredError += static_cast<uint64>(error * error);
+			}
+
+			return squaredError;
+		}
+
+		void EncodeMSBlock(const int16* pSamples, uint16 channels, uint32 samplesPerBlock, uint8* pBlock)
+		{
+			Vector<uint8> bestNibbles, nibbles;
+			Vector<uint8> interleaved((samplesPerBlock - 2) * channels);
+
+			for (uint16 channel = 0; channel < channels; channel++)
+			{
+				MSChannelState bestHeader = {}, header = {};
+				uint64 bestError = ~0ULL;
+				uint8 bestPredictor = 0;
+
+				for (uint8 predictor = 0; predictor < 7; predictor++)
+				{
+					const uint64 error = EncodeMSChannel(pSamples + channel, channels, samplesPerBlock, predictor, header, nibbles);
+					if (error < bestError)
+					{
+						bestError = error;
+						bestPredictor = predictor;
+						bestHeader = header;
+						bestNibbles.swap(nibbles);
+					}
+				}
+
+				pBlock[channel] = bestPredictor;
+				WriteInt16(pBlock + channels + channel * 2, bestHeader.mDelta);
+				WriteInt16(pBlock + channels * 3 + channel * 2, bestHeader.mSample1);
+				WriteInt16(pBlock + channels * 5 + channel * 2, bestHeader.mSample2);
+
+				for (uint32 i = 0; i < samplesPerBlock - 2; i++)
+					interleaved[i * channels + channel] = bestNibbles[i];
+			}
+
+			// Two nibbles per byte, the first one in the high nibble. An odd count leaves the last low nibble empty.
+			uint8* pNibbles = pBlock + MSHeaderBytes * channels;
+			for (uint64 i = 0; i < interleaved.size(); i += 2)
+			{
+				const uint8 low = i + 1 < interleaved.size() ? interleaved[i + 1] : 0;
+				pNibbles[i / 2] = static_cast<uint8>((interleaved[i] << 4) | low);
+			}
+		}
+
+		void EncodeIMABlock(const int16* pSamples, uint16 channels, uint32 samplesPerBlock, IMAChannelState* pStates, uint8* pBlock)
+		{
+			for (uint16 channel = 0; channel < channels; channel++)
+			{
+				IMAChannelState& state = pStates[channel];
+				state.mPredictor = pSamples[channel];
+
+				uint8* pHeader = pBlock + channel * IMAHeaderBytes;
+				WriteInt16(pHeader, state.mPredictor);
+				pHeader[2] = static_cast<uint8>(state.mStepIndex);
+				pHeader[3] = 0;
+			}
+
+			// Groups of 8 samples are stored as 4 bytes per channel, low nibble first.
+			uint8* ptr = pBlock + IMAHeaderBytes * channels;
+			for (uint32 group = 1; group < samplesPerBlock; group += 8)
+			{
+				for (uint16 channel = 0; channel < channels; channel++)
+				{
+					for (uint32 i = 0; i < 8; i += 2)
+					{
+						const uint8 low = pStates[channel].Compress(pSamples[(group + i) * channels + channel]);
+						const uint8 high = pStates[channel].Compress(pSamples[(group + i + 1) * channels + channel]);
+						*ptr++ = static_cast<uint8>(low | (high << 4));
+					}
+				}
+			}
+		}
+	}
+
+	ADPCMType GetADPCMType(const WAVFormat& format)
+	{
+		switch (static_cast<WAVFormatTag>(format.mFormatTag))
+		{
+		case WAVFormatTag::WAV_FORMAT_TAG_MS_ADPCM:
+			return ADPCMType::ADPCM_TYPE_MICROSOFT;
+
+		case WAVFormatTag::WAV_FORMAT_TAG_IMA_ADPCM:
+			return ADPCMType::ADPCM_TYPE_IMA;
+
+		default:
+			return ADPCMType::ADPCM_TYPE_UNKNOWN;
+		}
+	}
+
+	uint32 GetADPCMSamplesPerBlock(ADPCMType type, uint16 channels, uint16 blockAlignment)
+	{
+		if (!channels)
+			return 0;
+
+		switch (type)
+		{
+		case ADPCMType::ADPCM_TYPE_MICROSOFT:
+			if (blockAlignment < (MSHeaderBytes + 1) * channels)
+				return 0;
+			return (blockAlignment - MSHeaderBytes * channels) * 2 / channels + 2;
+
+		case ADPCMType::ADPCM_TYPE_IMA:
+			if (blockAlignment < (IMAHeaderBytes * 2) * channels || blockAlignment % (4 * channels))
+				return 0;
+			return (blockAlignment - IMAHeaderBytes * channels) * 2 / channels + 1;
+
+		default:
+			return 0;
+		}
+	}
+
+	WAVFormat CreateADPCMFormat(ADPCMType type, uint16 channels, uint64 sampleRate, uint16 blockAlignment)
+	{
+		if (!blockAlignment)
+			blockAlignment = static_cast<uint16>(512 * channels);
+
+		const uint32 samplesPerBlock = GetADPCMSamplesPerBlock(type, channels, blockAlignment);
+
+		WAVFormat format = {};
+		if (!samplesPerBlock)
+			return format;
+
+		format.mFormatTag = static_cast<uint16>(type == ADPCMType::ADPCM_TYPE_MICROSOFT ? WAVFormatTag::WAV_FORMAT_TAG_MS_ADPCM : WAVFormatTag::WAV_FORMAT_TAG_IMA_ADPCM);
+		format.mChannels = channels;
+		format.mSampleRate = sampleRate;
+		format.mAvgByteRate = sampleRate * blockAlignment / samplesPerBlock;
+		format.mBlockAlignment = blockAlignment;
+		format.mBitsPerSample = 4;
+		format.mCBSize = type == ADPCMType::ADPCM_TYPE_MICROSOFT ? 32 : 2;
+
+		return format;
+	}
+
+	bool DecodeMSADPCMBlock(const uint8* pBlock, uint16 channels, uint32 samplesPerBlock, int16* pOutput)
+	{
+		if (!pBlock || !pOutput || !channels || channels > 8 || samplesPerBlock < 2)
+			return false;
+
+		MSChannelState states[8] = {};
+		for (uint16 channel = 0; channel < channels; channel++)
+		{
+			const uint8 predictor = pBlock[channel];
+			if (predictor > 6)
+				return false;
+
+			MSChannelState& state = states[channel];
+			state.mCoefficient1 = MSCoefficient1[predictor];
+			state.mCoefficient2 = MSCoefficient2[predictor];
+			state.mDelta = ReadInt16(pBlock + channels + channel * 2);
+			state.mSample1 = ReadInt16(pBlock + channels * 3 + channel * 2);
+			state.mSample2 = ReadInt16(pBlock + channels * 5 + channel * 2);
+
+			// The block starts with the older sample.
+			pOutput[channel] = static_cast<int16>(state.mSample2);
+			pOutput[channels + channel] = static_cast<int16>(state.mSample1);
+		}
+
+		const uint8* pNibbles = pBlock + MSHeaderBytes * channels;
+		const uint64 nibbleCount = static_cast<uint64>(samplesPerBlock - 2) * channels;
+		int16* pDestination = pOutput + 2 * channels;
+
+		uint16 channel = 0;
+		for (uint64 i = 0; i < nibbleCount; i++)
+		{
+			const uint8 byte = pNibbles[i / 2];
+			const uint8 nibble = (i & 1) ? (byte & 0x0F) : (byte >> 4);
+
+			pDestination[i] = static_cast<int16>(states[channel].Expand(nibble));
+			if (++channel == channels)
+				channel = 0;
+		}
+
+		return true;
+	}
+
+	bool DecodeIMAADPCMBlock(const uint8* pBlock, uint16 channels, uint32 samplesPerBlock, int16* pOutput)
+	{
+		if (!pBlock || !pOutput || !channels || channels > 8 || !samplesPerBlock || (samplesPerBlock - 1) % 8)
+			return false;
+
+		IMAChannelState states[8] = {};
+		for (uint16 channel = 0; channel < channels; channel++)
+		{
+			const uint8* pHeader = pBlock + channel * IMAHeaderBytes;
+			if (pHeader[2] > 88)
+				return false;
+
+			states[channel].mPredictor = ReadInt16(pHeader);
+			states[channel].mStepIndex = pHeader[2];
+			pOutput[channel] = static_cast<int16>(states[channel].mPredictor);
+		}
+
+		const uint8* ptr = pBlock + IMAHeaderBytes * channels;
+		for (uint32 group = 1; group < samplesPerBlock; group += 8)
+		{
+			for (uint16 channel = 0; channel < channels; channel++)
+			{
+				int16* pDestination = pOutput + group * channels + channel;
+				for (uint32 i = 0; i < 8; i += 2)
+				{
+					const uint8 byte = *ptr++;
+					pDestination[i * channels] = static_cast<int16>(states[channel].Expand(byte & 0x0F));
+					pDestination[(i + 1) * channels] = static_cast<int16>(states[channel].Expand(byte >> 4));
+				}
+			}
+		}
+
+		return true;
+	}
+
+	bool EncodeADPCM(const WAVFormat& format, const int16* pSamples, uint64 frameCount, Vector<uint8>& output)
+	{
+		const ADPCMType type = GetADPCMType(format);
+		const uint32 samplesPerBlock = GetADPCMSamplesPerBlock(type, format.mChannels, format.mBlockAlignment);
+		if (!samplesPerBlock || !pSamples || format.mChannels > 8)
+			return false;
+
+		const uint16 channels = format.mChannels;
+		const uint64 blockCount = (frameCount + samplesPerBlock - 1) / samplesPerBlock;
+
+		output.assign(blockCount * format.mBlockAlignment, 0);
+
+		IMAChannelState imaStates[8] = {};
+		Vector<int16> padded(static_cast<uint64>(samplesPerBlock) * channels);
+
+		for (uint64 block = 0; block < blockCount; block++)
+		{
+			const uint64 firstFrame = block * samplesPerBlock;
+			const int16* pBlockSamples = pSamples + firstFrame * channels;
+
+			// Pad the last block with silence.
+			if (firstFrame + samplesPerBlock > frameCount)
+			{
+				std::fill(padded.begin(), padded.end(), static_cast<int16>(0));
+				std::memcpy(padded.data(), pBlockSamples, (frameCount - firstFrame) * channels * sizeof(int16));
+				pBlockSamples = padded.data();
+			}
+
+			uint8* pBlock = output.data() + block * format.mBlockAlignment;
+			if (type == ADPCMType::ADPCM_TYPE_MICROSOFT)
+				EncodeMSBlock(pBlockSamples, channels, samplesPerBlock, pBlock);
+			else
+				EncodeIMABlock(pBlockSamples, channels, samplesPerBlock, imaStates, pBlock);
+		}
+
+		return true;
+	}
+
+	void ConvertPCM16ToFloat(const int16* pSource, float* pDestination, uint64 sampleCount)
+	{
+		const float scale = 1.0f / 32768.0f;
+		uint64 index = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		const __m128 scaleVector = _mm_set1_ps(scale);
+		for (; index + 8 <= sampleCount; index += 8)
+		{
+			const __m128i samples = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pSource + index));
+
+			// Sign extend by placing the samples in the upper halves and shifting them back.
+			const __m128i low = _mm_srai_epi32(_mm_unpacklo_epi16(samples, samples), 16);
+			const __m128i high = _mm_srai_epi32(_mm_unpackhi_epi16(samples, samples), 16);
+
+			_mm_storeu_ps(pDestination + index, _mm_mul_ps(_mm_cvtepi32_ps(low), scaleVector));
+			_mm_storeu_ps(pDestination + index + 4, _mm_mul_ps(_mm_cvtepi32_ps(high), scaleVector));
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+			pDestination[index] = pSource[index] * scale;
+	}
+
+	bool ADPCMDecoder::Initialize(const WAVData& data)
+	{
+		Terminate();
+
+		mType = GetADPCMType(data.mWAVFormat);
+		mChannels = data.mWAVFormat.mChannels;
+		mBlockAlignment = data.mWAVFormat.mBlockAlignment;
+		mSamplesPerBlock = GetADPCMSamplesPerBlock(mType, mChannels, mBlockAlignment);
+
+		if (!mSamplesPerBlock || !data.pStartAudio || mChannels > 8)
+		{
+			Terminate();
+			return false;
+		}
+
+		pData = data.pStartAudio;
+		mBlockCount = data.mAudioBytes / mBlockAlignment;
+		mLastBlockSamples = mSamplesPerBlock;
+
+		// A trailing partial block still holds a header and some samples.
+		const uint32 remainder = data.mAudioBytes % mBlockAlignment;
+		uint32 partialSamples = 0;
+		if (mType == ADPCMType::ADPCM_TYPE_MICROSOFT && remainder >= MSHeaderBytes * mChannels)
+			partialSamples = (remainder - MSHeaderBytes * mChannels) * 2 / mChannels + 2;
+		else if (mType == ADPCMType::ADPCM_TYPE_IMA && remainder >= IMAHeaderBytes * mChannels)
+			partialSamples = (remainder - IMAHeaderBytes * mChannels) / (4 * mChannels) * 8 + 1;
+
+		if (partialSamples)
+		{
+			mBlockCount++;
+			mLastBlockSamples = partialSamples;
+		}
+
+		mFrameCount = mBlockCount ? (mBlockCount - 1) * mSamplesPerBlock + mLastBlockSamples : 0;
+		mBlockCache.resize(static_cast<uint64>(mSamplesPerBlock) * mChannels);
+		return true;
+	}
+
+	void ADPCMDecoder::Terminate()
+	{
+		pData = nullptr;
+		mBlockCount = mFrameCount = mPosition = 0;
+		mCachedBlock = ~0ULL;
+		mSamplesPerBlock = mLastBlockSamples = 0;
+		mChannels = mBlockAlignment = 0;
+		mType = ADPCMType::ADPCM_TYPE_UNKNOWN;
+	}
+
+	uint64 ADPCMDecoder::Decode(float* pOutput, uint64 frameCount)
+	{
+		uint64 decoded = 0;
+		while (decoded < frameCount && mPosition < mFrameCount)
+		{
+			const uint64 block = mPosition / mSamplesPerBlock;
+			if (!DecodeBlock(block))
+				break;
+
+			const uint64 offset = mPosition - block * mSamplesPerBlock;
+			const uint64 blockSamples = (block + 1 == mBlockCount) ? mLastBlockSamples : mSamplesPerBlock;
+			const uint64 frames = std::min(frameCount - decoded, blockSamples - offset);
+
+			ConvertPCM16ToFloat(mBlockCache.data() + offset * mChannels, pOutput + decoded * mChannels, frames * mChannels);
+
+			decoded += frames;
+			mPosition += frames;
+		}
+
+		return decoded;
+	}
+
+	void ADPCMDecoder::Seek(uint64 frame)
+	{
+		mPosition = std::min(frame, mFrameCount);
+	}
+
+	bool ADPCMDecoder::DecodeBlock(uint64 block)
+	{
+		if (block == mCachedBlock)
+			return true;
+
+		const uint8* pBlock = pData + block * mBlockAlignment;
+		const uint32 samples = (block + 1 == mBlockCount) ? mLastBlockSamples : mSamplesPerBlock;
+
+		const bool result = (mType == ADPCMType::ADPCM_TYPE_MICROSOFT) ?
+			DecodeMSADPCMBlock(pBlock, mChannels, samples, mBlockCache.data()) :
+			DecodeIMAADPCMBlock(pBlock, mChannels, samples, mBlockCache.data());
+
+		mCachedBlock = result ? block : ~0ULL;
+		return result;
+	}
+}
\ No newline at end of file
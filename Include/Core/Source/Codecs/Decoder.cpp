@@ -0,0 +1,13 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Codecs/Decoder.h"
+
+namespace EnSound
+{
+	void Decoder::SeekFrom(const SeekPoint& point, uint64 frame)
+	{
+		(void)point;
+		Seek(frame);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,163 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Codecs/DecoderPool.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	namespace
+	{
+		/**
+		 * Check if a decoder type indexes a pool.
+		 */
+		inline bool IsValidType(DecoderType type)
+		{
+			return type < DecoderType::DECODER_TYPE_MAX;
+		}
+	}
+
+	void DecoderPool::Initialize(DecoderType type, uint32 capacity, const Factory& factory)
+	{
+		if (!IsValidType(type))
+		{
+			Logger::LogError(STRING("Invalid decoder type!"));
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		Pool& pool = mPools[static_cast<uint8>(type)];
+		if (pool.mStats.mBorrowed)
+		{
+			Logger::LogError(STRING("Cannot replace a decoder pool while its decoders are borrowed!"));
+			return;
+		}
+
+		pool = {};
+		pool.mDecoders.reserve(capacity);
+		pool.mFreeDecoders.reserve(capacity);
+
+		for (uint32 i = 0; i < capacity; i++)
+		{
+			auto pDecoder = factory();
+			if (!pDecoder || pDecoder->GetType() != type)
+			{
+				Logger::LogError(STRING("The decoder factory returned an invalid decoder!"));
+				break;
+			}
+
+			pool.mFreeDecoders.insert(pool.mFreeDecoders.end(), pDecoder.get());
+			pool.mDecoders.insert(pool.mDecoders.end(), std::move(pDecoder));
+		}
+
+		pool.mIsBorrowed.assign(pool.mDecoders.size(), false);
+		pool.mStats.mCapacity = static_cast<uint32>(pool.mDecoders.size());
+	}
+
+	void DecoderPool::Terminate()
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// Borrowed decoders are still used by their voices, which return them later.
+		for (const auto& pool : mPools)
+		{
+			if (pool.mStats.mBorrowed)
+			{
+				Logger::LogError(STRING("Cannot terminate the decoder pool while its decoders are borrowed!"));
+				return;
+			}
+		}
+
+		for (auto& pool : mPools)
+			pool = {};
+	}
+
+	Decoder* DecoderPool::Borrow(DecoderType type, const WAVData& data, uint64 startFrame)
+	{
+		if (!IsValidType(type))
+		{
+			Logger::LogError(STRING("Invalid decoder type!"));
+			return nullptr;
+		}
+
+		Decoder* pDecoder = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+
+			Pool& pool = mPools[static_cast<uint8>(type)];
+			if (pool.mFreeDecoders.empty())
+			{
+				pool.mStats.mFailedBorrows++;
+				return nullptr;
+			}
+
+			pDecoder = pool.mFreeDecoders.back();
+			pool.mFreeDecoders.pop_back();
+
+			const auto itr = std::find_if(pool.mDecoders.begin(), pool.mDecoders.end(), [pDecoder](const std::unique_ptr<Decoder>& pOther) { return pOther.get() == pDecoder; });
+			pool.mIsBorrowed[itr - pool.mDecoders.begin()] = true;
+
+			pool.mStats.mBorrowed++;
+			pool.mStats.mPeakBorrowed = std::max(pool.mStats.mPeakBorrowed, pool.mStats.mBorrowed);
+		}
+
+		// Binding and seeking is done outside the lock since it touches the asset data.
+		if (!pDecoder->Initialize(data))
+		{
+			Logger::LogError(STRING("Failed to bind the borrowed decoder to the asset!"));
+			Return(pDecoder);
+			return nullptr;
+		}
+
+		// Packetized assets seek through their table, so the decoder starts at the closest packet instead of scanning.
+		if (startFrame && data.pFrameSeekTable)
+			pDecoder->SeekFrom(data.pFrameSeekTable->Find(startFrame), startFrame);
+		else if (startFrame)
+			pDecoder->Seek(startFrame);
+
+		return pDecoder;
+	}
+
+	void DecoderPool::Return(Decoder* pDecoder)
+	{
+		if (!pDecoder)
+			return;
+
+		const DecoderType type = pDecoder->GetType();
+		if (!IsValidType(type))
+		{
+			Logger::LogError(STRING("Invalid decoder type!"));
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock(mMutex);
+
+		// The decoder is only terminated once it is known to be borrowed, since a second return could otherwise
+		// terminate it while it is bound again.
+		Pool& pool = mPools[static_cast<uint8>(type)];
+		const auto itr = std::find_if(pool.mDecoders.begin(), pool.mDecoders.end(), [pDecoder](const std::unique_ptr<Decoder>& pOther) { return pOther.get() == pDecoder; });
+		if (itr == pool.mDecoders.end() || !pool.mIsBorrowed[itr - pool.mDecoders.begin()])
+		{
+			Logger::LogError(STRING("Cannot return a decoder which is not borrowed from the pool!"));
+			return;
+		}
+
+		pDecoder->Terminate();
+
+		pool.mIsBorrowed[itr - pool.mDecoders.begin()] = false;
+		pool.mFreeDecoders.insert(pool.mFreeDecoders.end(), pDecoder);
+		pool.mStats.mBorrowed--;
+	}
+
+	DecoderPoolStats DecoderPool::GetStats(DecoderType type) const
+	{
+		if (!IsValidType(type))
+			return {};
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mPools[static_cast<uint8>(type)].mStats;
+	}
+}
\ No newline at end of file
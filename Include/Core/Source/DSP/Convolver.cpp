@@ -0,0 +1,115 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/DSP/Convolver.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	void UniformConvolver::Initialize(uint32 blockSize, uint32 partitionCount)
+	{
+		Terminate();
+
+		mFFT.Initialize(blockSize * 2);
+		if (!mFFT.GetSize() || !partitionCount)
+			return;
+
+		mBlockSize = blockSize;
+		mPartitionCount = partitionCount;
+
+		const uint32 binCount = mFFT.GetBinCount();
+		mInput.resize(static_cast<uint64>(blockSize) * 2);
+		mHistoryReal.resize(static_cast<uint64>(binCount) * partitionCount);
+		mHistoryImaginary.resize(static_cast<uint64>(binCount) * partitionCount);
+		mSumReal.resize(binCount);
+		mSumImaginary.resize(binCount);
+		mTime.resize(static_cast<uint64>(blockSize) * 2);
+	}
+
+	void UniformConvolver::Terminate()
+	{
+		mFFT.Terminate();
+		mInput.clear();
+		mHistoryReal.clear();
+		mHistoryImaginary.clear();
+		mSumReal.clear();
+		mSumImaginary.clear();
+		mTime.clear();
+
+		mBlockSize = 0;
+		mPartitionCount = 0;
+		mHistoryHead = 0;
+	}
+
+	void UniformConvolver::CreateKernel(const float* pImpulse, uint64 length, ConvolutionKernel& kernel)
+	{
+		const uint32 binCount = mFFT.GetBinCount();
+		const uint64 partitionCount = std::min<uint64>((length + mBlockSize - 1) / mBlockSize, mPartitionCount);
+
+		kernel.mBlockSize = mBlockSize;
+		kernel.mPartitionCount = static_cast<uint32>(partitionCount);
+		kernel.mReal.resize(binCount * partitionCount);
+		kernel.mImaginary.resize(binCount * partitionCount);
+
+		// Every partition is zero padded to twice the block size, as overlap save keeps the second half of the output.
+		for (uint64 partition = 0; partition < partitionCount; partition++)
+		{
+			const uint64 offset = partition * mBlockSize;
+			const uint64 count = std::min<uint64>(length - offset, mBlockSize);
+
+			std::fill(mTime.begin(), mTime.end(), 0.0f);
+			std::copy(pImpulse + offset, pImpulse + offset + count, mTime.begin());
+			mFFT.Forward(mTime.data(), kernel.mReal.data() + partition * binCount, kernel.mImaginary.data() + partition * binCount);
+		}
+	}
+
+	void UniformConvolver::PushInput(const float* pInput)
+	{
+		if (!mPartitionCount)
+			return;
+
+		// Slide the input by a block and transform the last two blocks.
+		std::copy(mInput.begin() + mBlockSize, mInput.end(), mInput.begin());
+		std::copy(pInput, pInput + mBlockSize, mInput.begin() + mBlockSize);
+
+		const uint32 binCount = mFFT.GetBinCount();
+		mHistoryHead = mHistoryHead ? mHistoryHead - 1 : mPartitionCount - 1;
+		mFFT.Forward(mInput.data(), mHistoryReal.data() + static_cast<uint64>(mHistoryHead) * binCount, mHistoryImaginary.data() + static_cast<uint64>(mHistoryHead) * binCount);
+	}
+
+	void UniformConvolver::Convolve(const ConvolutionKernel& kernel, float* pOutput)
+	{
+		if (!mPartitionCount || kernel.mBlockSize != mBlockSize || !kernel.mPartitionCount)
+		{
+			std::fill(pOutput, pOutput + mBlockSize, 0.0f);
+			return;
+		}
+
+		const uint32 binCount = mFFT.GetBinCount();
+		std::fill(mSumReal.begin(), mSumReal.end(), 0.0f);
+		std::fill(mSumImaginary.begin(), mSumImaginary.end(), 0.0f);
+
+		// Partition p of the kernel meets the input from p blocks ago.
+		const uint32 partitionCount = std::min(kernel.mPartitionCount, mPartitionCount);
+		for (uint32 partition = 0; partition < partitionCount; partition++)
+		{
+			const uint64 history = static_cast<uint64>((mHistoryHead + partition) % mPartitionCount) * binCount;
+			const uint64 offset = static_cast<uint64>(partition) * binCount;
+
+			MultiplyAccumulateSpectrum(mSumReal.data(), mSumImaginary.data(), mHistoryReal.data() + history, mHistoryImaginary.data() + history,
+				kernel.mReal.data() + offset, kernel.mImaginary.data() + offset, binCount);
+		}
+
+		mFFT.Inverse(mSumReal.data(), mSumImaginary.data(), mTime.data());
+		std::copy(mTime.begin() + mBlockSize, mTime.end(), pOutput);
+	}
+
+	void UniformConvolver::Reset()
+	{
+		std::fill(mInput.begin(), mInput.end(), 0.0f);
+		std::fill(mHistoryReal.begin(), mHistoryReal.end(), 0.0f);
+		std::fill(mHistoryImaginary.begin(), mHistoryImaginary.end(), 0.0f);
+		mHistoryHead = 0;
+	}
+}
\ No newline at end of file
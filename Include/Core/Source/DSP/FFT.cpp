@@ -0,0 +1,214 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/DSP/FFT.h"
+#include "Core/Platform/SIMD.h"
+
+#include <cmath>
+#include <utility>
+
+namespace EnSound
+{
+	namespace
+	{
+		const double Pi = 3.14159265358979323846;
+	}
+
+	void FFT::Initialize(uint32 size)
+	{
+		Terminate();
+
+		if (size < 4 || (size & (size - 1)))
+			return;
+
+		mSize = size;
+		const uint32 complexSize = size / 2;
+
+		uint32 bits = 0;
+		while ((1U << bits) < complexSize)
+			bits++;
+
+		mBitReversal.resize(complexSize);
+		for (uint32 i = 0; i < complexSize; i++)
+		{
+			uint32 reversed = 0;
+			for (uint32 bit = 0; bit < bits; bit++)
+				reversed |= ((i >> bit) & 1) << (bits - bit - 1);
+
+			mBitReversal[i] = reversed;
+		}
+
+		// The stage with half length h keeps its h twiddles at offset h - 1.
+		mStageReal.resize(complexSize);
+		mStageImaginary.resize(complexSize);
+		for (uint32 half = 1; half < complexSize; half *= 2)
+		{
+			for (uint32 k = 0; k < half; k++)
+			{
+				mStageReal[half - 1 + k] = static_cast<float>(std::cos(-Pi * k / half));
+				mStageImaginary[half - 1 + k] = static_cast<float>(std::sin(-Pi * k / half));
+			}
+		}
+
+		mSplitReal.resize(complexSize + 1);
+		mSplitImaginary.resize(complexSize + 1);
+		for (uint32 k = 0; k <= complexSize; k++)
+		{
+			mSplitReal[k] = static_cast<float>(std::cos(-2.0 * Pi * k / size));
+			mSplitImaginary[k] = static_cast<float>(std::sin(-2.0 * Pi * k / size));
+		}
+
+		mScratchReal.resize(complexSize);
+		mScratchImaginary.resize(complexSize);
+	}
+
+	void FFT::Terminate()
+	{
+		mBitReversal.clear();
+		mStageReal.clear();
+		mStageImaginary.clear();
+		mSplitReal.clear();
+		mSplitImaginary.clear();
+		mScratchReal.clear();
+		mScratchImaginary.clear();
+		mSize = 0;
+	}
+
+	void FFT::Forward(const float* pInput, float* pReal, float* pImaginary)
+	{
+		const uint32 complexSize = mSize / 2;
+
+		// Even samples go in the real parts and odd samples in the imaginary parts.
+		for (uint32 i = 0; i < complexSize; i++)
+		{
+			mScratchReal[mBitReversal[i]] = pInput[i * 2];
+			mScratchImaginary[mBitReversal[i]] = pInput[i * 2 + 1];
+		}
+
+		Transform(mScratchReal.data(), mScratchImaginary.data());
+
+		// X[k] = E[k] + W^k O[k], where E and O are the spectra of the even and odd samples.
+		for (uint32 k = 0; k <= complexSize; k++)
+		{
+			const uint32 index = k % complexSize;
+			const uint32 mirror = (complexSize - k) % complexSize;
+
+			const float evenReal = (mScratchReal[index] + mScratchReal[mirror]) * 0.5f;
+			const float evenImaginary = (mScratchImaginary[index] - mScratchImaginary[mirror]) * 0.5f;
+			const float oddReal = (mScratchImaginary[index] + mScratchImaginary[mirror]) * 0.5f;
+			const float oddImaginary = (mScratchReal[mirror] - mScratchReal[index]) * 0.5f;
+
+			pReal[k] = evenReal + mSplitReal[k] * oddReal - mSplitImaginary[k] * oddImaginary;
+			pImaginary[k] = evenImaginary + mSplitReal[k] * oddImaginary + mSplitImaginary[k] * oddReal;
+		}
+	}
+
+	void FFT::Inverse(const float* pReal, const float* pImaginary, float* pOutput)
+	{
+		const uint32 complexSize = mSize / 2;
+
+		// Rebuild E[k] + i O[k], swapping the real and imaginary parts so the forward transform computes the inverse.
+		for (uint32 k = 0; k < complexSize; k++)
+		{
+			const uint32 mirror = complexSize - k;
+
+			const float evenReal = (pReal[k] + pReal[mirror]) * 0.5f;
+			const float evenImaginary = (pImaginary[k] - pImaginary[mirror]) * 0.5f;
+			const float differenceReal = (pReal[k] - pReal[mirror]) * 0.5f;
+			const float differenceImaginary = (pImaginary[k] + pImaginary[mirror]) * 0.5f;
+
+			const float oddReal = differenceReal * mSplitReal[k] + differenceImaginary * mSplitImaginary[k];
+			const float oddImaginary = differenceImaginary * mSplitReal[k] - differenceReal * mSplitImaginary[k];
+
+			mScratchImaginary[mBitReversal[k]] = evenReal - oddImaginary;
+			mScratchReal[mBitReversal[k]] = evenImaginary + oddReal;
+		}
+
+		Transform(mScratchReal.data(), mScratchImaginary.data());
+
+		const float scale = 1.0f / complexSize;
+		for (uint32 i = 0; i < complexSize; i++)
+		{
+			pOutput[i * 2] = mScratchImaginary[i] * scale;
+			pOutput[i * 2 + 1] = mScratchReal[i] * scale;
+		}
+	}
+
+	void FFT::Transform(float* pReal, float* pImaginary) const
+	{
+		const uint32 complexSize = mSize / 2;
+
+		for (uint32 half = 1; half < complexSize; half *= 2)
+		{
+			const float* pTwiddleReal = mStageReal.data() + half - 1;
+			const float* pTwiddleImaginary = mStageImaginary.data() + half - 1;
+
+			for (uint32 start = 0; start < complexSize; start += half * 2)
+			{
+				float* pTopReal = pReal + start;
+				float* pTopImaginary = pImaginary + start;
+				float* pBottomReal = pTopReal + half;
+				float* pBottomImaginary = pTopImaginary + half;
+				uint32 k = 0;
+
+#ifdef ENSD_SIMD_SSE2
+				for (; k + 4 <= half; k += 4)
+				{
+					const __m128 twiddleReal = _mm_loadu_ps(pTwiddleReal + k);
+					const __m128 twiddleImaginary = _mm_loadu_ps(pTwiddleImaginary + k);
+					const __m128 bottomReal = _mm_loadu_ps(pBottomReal + k);
+					const __m128 bottomImaginary = _mm_loadu_ps(pBottomImaginary + k);
+					const __m128 topReal = _mm_loadu_ps(pTopReal + k);
+					const __m128 topImaginary = _mm_loadu_ps(pTopImaginary + k);
+
+					const __m128 productReal = _mm_sub_ps(_mm_mul_ps(bottomReal, twiddleReal), _mm_mul_ps(bottomImaginary, twiddleImaginary));
+					const __m128 productImaginary = _mm_add_ps(_mm_mul_ps(bottomReal, twiddleImaginary), _mm_mul_ps(bottomImaginary, twiddleReal));
+
+					_mm_storeu_ps(pTopReal + k, _mm_add_ps(topReal, productReal));
+					_mm_storeu_ps(pTopImaginary + k, _mm_add_ps(topImaginary, productImaginary));
+					_mm_storeu_ps(pBottomReal + k, _mm_sub_ps(topReal, productReal));
+					_mm_storeu_ps(pBottomImaginary + k, _mm_sub_ps(topImaginary, productImaginary));
+				}
+#endif // ENSD_SIMD_SSE2
+
+				for (; k < half; k++)
+				{
+					const float productReal = pBottomReal[k] * pTwiddleReal[k] - pBottomImaginary[k] * pTwiddleImaginary[k];
+					const float productImaginary = pBottomReal[k] * pTwiddleImaginary[k] + pBottomImaginary[k] * pTwiddleReal[k];
+
+					pBottomReal[k] = pTopReal[k] - productReal;
+					pBottomImaginary[k] = pTopImaginary[k] - productImaginary;
+					pTopReal[k] += productReal;
+					pTopImaginary[k] += productImaginary;
+				}
+			}
+		}
+	}
+
+	void MultiplyAccumulateSpectrum(float* pReal, float* pImaginary, const float* pLeftReal, const float* pLeftImaginary, const float* pRightReal, const float* pRightImaginary, uint32 binCount)
+	{
+		uint32 i = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		for (; i + 4 <= binCount; i += 4)
+		{
+			const __m128 leftReal = _mm_loadu_ps(pLeftReal + i);
+			const __m128 leftImaginary = _mm_loadu_ps(pLeftImaginary + i);
+			const __m128 rightReal = _mm_loadu_ps(pRightReal + i);
+			const __m128 rightImaginary = _mm_loadu_ps(pRightImaginary + i);
+
+			const __m128 real = _mm_sub_ps(_mm_mul_ps(leftReal, rightReal), _mm_mul_ps(leftImaginary, rightImaginary));
+			const __m128 imaginary = _mm_add_ps(_mm_mul_ps(leftReal, rightImaginary), _mm_mul_ps(leftImaginary, rightReal));
+
+			_mm_storeu_ps(pReal + i, _mm_add_ps(_mm_loadu_ps(pReal + i), real));
+			_mm_storeu_ps(pImaginary + i, _mm_add_ps(_mm_loadu_ps(pImaginary + i), imaginary));
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; i < binCount; i++)
+		{
+			pReal[i] += pLeftReal[i] * pRightReal[i] - pLeftImaginary[i] * pRightImaginary[i];
+			pImaginary[i] += pLeftReal[i] * pRightImaginary[i] + pLeftImaginary[i] * pRightReal[i];
+		}
+	}
+}
\ No newline at end of file
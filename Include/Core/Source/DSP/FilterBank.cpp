@@ -0,0 +1,224 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/DSP/FilterBank.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float Pi = 3.14159265358979f;
+		const float FlushThreshold = 1e-15f;	// States below this are flushed to zero, long before they turn denormal.
+		const float PassCoefficients[6] = { 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f };	// The coefficients of a filter of no type.
+
+		/**
+		 * Four filters worth of values.
+		 */
+#ifdef ENSD_SIMD_SSE2
+		struct Lanes { __m128 v; };
+
+		inline Lanes Set(float value) { return { _mm_set1_ps(value) }; }
+		inline Lanes Load(const float* pValues) { return { _mm_loadu_ps(pValues) }; }
+		inline void Store(float* pValues, Lanes lanes) { _mm_storeu_ps(pValues, lanes.v); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { _mm_add_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { _mm_sub_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { _mm_mul_ps(lhs.v, rhs.v) }; }
+
+		/**
+		 * Zero the lanes whose magnitude is below a threshold.
+		 */
+		inline Lanes Flush(Lanes lanes, Lanes threshold) { return { _mm_and_ps(lanes.v, _mm_cmpge_ps(_mm_andnot_ps(_mm_set1_ps(-0.0f), lanes.v), threshold.v)) }; }
+
+#else
+		struct Lanes { float v[4]; };
+
+		inline Lanes Set(float value) { return { { value, value, value, value } }; }
+		inline Lanes Load(const float* pValues) { return { { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+		inline void Store(float* pValues, Lanes lanes) { std::copy(lanes.v, lanes.v + 4, pValues); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { { lhs.v[0] + rhs.v[0], lhs.v[1] + rhs.v[1], lhs.v[2] + rhs.v[2], lhs.v[3] + rhs.v[3] } }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { { lhs.v[0] - rhs.v[0], lhs.v[1] - rhs.v[1], lhs.v[2] - rhs.v[2], lhs.v[3] - rhs.v[3] } }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { { lhs.v[0] * rhs.v[0], lhs.v[1] * rhs.v[1], lhs.v[2] * rhs.v[2], lhs.v[3] * rhs.v[3] } }; }
+
+		inline Lanes Flush(Lanes lanes, Lanes threshold)
+		{
+			for (uint32 i = 0; i < 4; i++)
+				lanes.v[i] = std::fabs(lanes.v[i]) >= threshold.v[i] ? lanes.v[i] : 0.0f;
+
+			return lanes;
+		}
+
+#endif // ENSD_SIMD_SSE2
+
+		/**
+		 * Compute the coefficients of a set of parameters.
+		 */
+		void ComputeCoefficients(const FilterParameters& parameters, uint32 sampleRate, float* pCoefficients)
+		{
+			if (parameters.mType == FilterType::FILTER_TYPE_NONE)
+			{
+				std::copy(PassCoefficients, PassCoefficients + 6, pCoefficients);
+				return;
+			}
+
+			const float cutoff = std::min(std::max(parameters.mCutoff, 10.0f), sampleRate * 0.49f);
+			const float g = std::tan(Pi * cutoff / sampleRate);
+			const float k = 1.0f / std::max(parameters.mResonance, 0.1f);
+
+			pCoefficients[0] = 1.0f / (1.0f + g * (g + k));
+			pCoefficients[1] = g * pCoefficients[0];
+			pCoefficients[2] = g * pCoefficients[1];
+
+			// The output is m0 * input + m1 * band pass + m2 * low pass.
+			switch (parameters.mType)
+			{
+			case FilterType::FILTER_TYPE_LOW_PASS:
+				pCoefficients[3] = 0.0f;
+				pCoefficients[4] = 0.0f;
+				pCoefficients[5] = 1.0f;
+				break;
+
+			case FilterType::FILTER_TYPE_HIGH_PASS:
+				pCoefficients[3] = 1.0f;
+				pCoefficients[4] = -k;
+				pCoefficients[5] = -1.0f;
+				break;
+
+			default:
+				// Scaled by k so the peak is at unity gain whatever the resonance.
+				pCoefficients[3] = 0.0f;
+				pCoefficients[4] = k;
+				pCoefficients[5] = 0.0f;
+				break;
+			}
+		}
+	}
+
+	void FilterBank::Initialize(uint32 capacity, uint32 sampleRate)
+	{
+		Terminate();
+
+		mSampleRate = sampleRate;
+		mParameters.resize(capacity);
+		mStates.resize(static_cast<uint64>(capacity) * 2);
+		mCoefficients.resize(static_cast<uint64>(capacity) * CoefficientCount);
+		for (uint32 i = 0; i < capacity; i++)
+			std::copy(PassCoefficients, PassCoefficients + CoefficientCount, mCoefficients.begin() + static_cast<uint64>(i) * CoefficientCount);
+
+		mPreviousCoefficients = mCoefficients;
+	}
+
+	void FilterBank::Terminate()
+	{
+		mParameters.clear();
+		mCoefficients.clear();
+		mPreviousCoefficients.clear();
+		mStates.clear();
+	}
+
+	void FilterBank::SetFilter(uint32 filter, const FilterParameters& parameters)
+	{
+		mParameters[filter] = parameters;
+		ComputeCoefficients(parameters, mSampleRate, mCoefficients.data() + static_cast<uint64>(filter) * CoefficientCount);
+	}
+
+	void FilterBank::Reset(uint32 filter)
+	{
+		const uint64 offset = static_cast<uint64>(filter) * CoefficientCount;
+		std::copy(mCoefficients.begin() + offset, mCoefficients.begin() + offset + CoefficientCount, mPreviousCoefficients.begin() + offset);
+
+		mStates[static_cast<uint64>(filter) * 2] = 0.0f;
+		mStates[static_cast<uint64>(filter) * 2 + 1] = 0.0f;
+	}
+
+	void FilterBank::Move(uint32 source, uint32 destination)
+	{
+		const uint64 sourceOffset = static_cast<uint64>(source) * CoefficientCount;
+		const uint64 destinationOffset = static_cast<uint64>(destination) * CoefficientCount;
+
+		mParameters[destination] = mParameters[source];
+		std::copy(mCoefficients.begin() + sourceOffset, mCoefficients.begin() + sourceOffset + CoefficientCount, mCoefficients.begin() + destinationOffset);
+		std::copy(mPreviousCoefficients.begin() + sourceOffset, mPreviousCoefficients.begin() + sourceOffset + CoefficientCount, mPreviousCoefficients.begin() + destinationOffset);
+		mStates[static_cast<uint64>(destination) * 2] = mStates[static_cast<uint64>(source) * 2];
+		mStates[static_cast<uint64>(destination) * 2 + 1] = mStates[static_cast<uint64>(source) * 2 + 1];
+	}
+
+	void FilterBank::Process(const uint32* pFilters, float* pSamples, uint32 offset, uint32 frameCount, uint32 rampLength)
+	{
+		// Gather the coefficients and states into lanes. Unused lanes pass their input through.
+		float starts[CoefficientCount][LaneCount] = {};
+		float steps[CoefficientCount][LaneCount] = {};
+		float states[2][LaneCount] = {};
+		for (uint32 lane = 0; lane < LaneCount; lane++)
+		{
+			const uint32 filter = pFilters[lane];
+			const float* pPrevious = filter != InvalidFilter ? mPreviousCoefficients.data() + static_cast<uint64>(filter) * CoefficientCount : PassCoefficients;
+			const float* pTarget = filter != InvalidFilter ? mCoefficients.data() + static_cast<uint64>(filter) * CoefficientCount : PassCoefficients;
+
+			for (uint32 i = 0; i < CoefficientCount; i++)
+			{
+				steps[i][lane] = (pTarget[i] - pPrevious[i]) / rampLength;
+				starts[i][lane] = pPrevious[i] + steps[i][lane] * offset;
+			}
+
+			if (filter != InvalidFilter)
+			{
+				states[0][lane] = mStates[static_cast<uint64>(filter) * 2];
+				states[1][lane] = mStates[static_cast<uint64>(filter) * 2 + 1];
+			}
+		}
+
+		Lanes a1 = Load(starts[0]), a2 = Load(starts[1]), a3 = Load(starts[2]);
+		Lanes m0 = Load(starts[3]), m1 = Load(starts[4]), m2 = Load(starts[5]);
+		const Lanes a1Step = Load(steps[0]), a2Step = Load(steps[1]), a3Step = Load(steps[2]);
+		const Lanes m0Step = Load(steps[3]), m1Step = Load(steps[4]), m2Step = Load(steps[5]);
+		Lanes state1 = Load(states[0]);
+		Lanes state2 = Load(states[1]);
+		const Lanes two = Set(2.0f);
+
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			a1 = a1 + a1Step;
+			a2 = a2 + a2Step;
+			a3 = a3 + a3Step;
+			m0 = m0 + m0Step;
+			m1 = m1 + m1Step;
+			m2 = m2 + m2Step;
+
+			const Lanes v0 = Load(pSamples + frame * LaneCount);
+			const Lanes v3 = v0 - state2;
+			const Lanes v1 = a1 * state1 + a2 * v3;
+			const Lanes v2 = state2 + a2 * state1 + a3 * v3;
+			state1 = two * v1 - state1;
+			state2 = two * v2 - state2;
+
+			Store(pSamples + frame * LaneCount, m0 * v0 + m1 * v1 + m2 * v2);
+		}
+
+		const Lanes threshold = Set(FlushThreshold);
+		Store(states[0], Flush(state1, threshold));
+		Store(states[1], Flush(state2, threshold));
+
+		const bool isRampDone = offset + frameCount >= rampLength;
+		for (uint32 lane = 0; lane < LaneCount; lane++)
+		{
+			const uint32 filter = pFilters[lane];
+			if (filter == InvalidFilter)
+				continue;
+
+			mStates[static_cast<uint64>(filter) * 2] = states[0][lane];
+			mStates[static_cast<uint64>(filter) * 2 + 1] = states[1][lane];
+
+			if (isRampDone)
+			{
+				const uint64 coefficientOffset = static_cast<uint64>(filter) * CoefficientCount;
+				std::copy(mCoefficients.begin() + coefficientOffset, mCoefficients.begin() + coefficientOffset + CoefficientCount, mPreviousCoefficients.begin() + coefficientOffset);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,430 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Effects/ConvolutionReverb.h"
+#include "Core/Codecs/ADPCM.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace EnSound
+{
+	namespace
+	{
+		const uint32 ReverbCacheTag = MAKE_TAG('E', 'C', 'V', 'R');
+		const uint32 ReverbCacheVersion = 1;
+		const uint32 PartitionGrowth = 4;	// The ratio between the partition sizes of two consecutive segments.
+
+#pragma pack(push, 1)
+		/**
+		 * Reverb Cache Header structure.
+		 * This is the header of a cache file, which is followed by the real and imaginary parts of every kernel, segment
+		 * by segment.
+		 */
+		struct ReverbCacheHeader {
+			uint32 mTag = ReverbCacheTag;
+			uint32 mVersion = ReverbCacheVersion;
+			uint32 mBlockFrames = 0;
+			uint32 mMaxPartitionFrames = 0;
+			uint32 mImpulseChannels = 0;
+			uint32 mSegmentCount = 0;
+			uint64 mFrameCount = 0;
+			uint64 mHash = 0;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(ReverbCacheHeader) == 40, "ReverbCacheHeader structure size mismatch!");
+
+		/**
+		 * 64 bit FNV-1a hash.
+		 */
+		uint64 HashBytes(const void* pData, uint64 size, uint64 hash = 0xCBF29CE484222325ULL)
+		{
+			const uint8* pBytes = static_cast<const uint8*>(pData);
+			for (uint64 i = 0; i < size; i++)
+				hash = (hash ^ pBytes[i]) * 0x100000001B3ULL;
+
+			return hash;
+		}
+
+		/**
+		 * Get the format tag of the samples. WAV_FORMAT_TAG_EXTENSIBLE stores it in the first 2 bytes of its sub format
+		 * GUID, which otherwise matches the base GUID 0000xxxx-0000-0010-8000-00AA00389B71.
+		 */
+		WAVFormatTag GetSampleFormatTag(const WAVFormat& format)
+		{
+			if (static_cast<WAVFormatTag>(format.mFormatTag) != WAVFormatTag::WAV_FORMAT_TAG_EXTENSIBLE)
+				return static_cast<WAVFormatTag>(format.mFormatTag);
+
+			const uint8 baseGUID[14] = { 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+			if (std::memcmp(format.mSubFormat + 2, baseGUID, sizeof(baseGUID)))
+				return WAVFormatTag::WAV_FORMAT_TAG_UNKNOWN;
+
+			return static_cast<WAVFormatTag>(format.mSubFormat[0] | (format.mSubFormat[1] << 8));
+		}
+
+		/**
+		 * Decode WAV data to interleaved float samples.
+		 */
+		bool DecodeSamples(const WAVData& data, Vector<float>& samples)
+		{
+			const WAVFormat& format = data.mWAVFormat;
+			if (!data.pStartAudio || !format.mChannels || !format.mBlockAlignment)
+				return false;
+
+			const WAVFormatTag tag = GetSampleFormatTag(format);
+			if (tag == WAVFormatTag::WAV_FORMAT_TAG_MS_ADPCM || tag == WAVFormatTag::WAV_FORMAT_TAG_IMA_ADPCM)
+			{
+				ADPCMDecoder decoder;
+				if (!decoder.Initialize(data))
+					return false;
+
+				Vector<float> block(static_cast<uint64>(format.mChannels) * 4096);
+				uint64 frames = 0;
+				while ((frames = decoder.Decode(block.data(), 4096)) > 0)
+					samples.insert(samples.end(), block.begin(), block.begin() + frames * format.mChannels);
+
+				decoder.Terminate();
+				return !samples.empty();
+			}
+
+			const uint64 sampleCount = data.mAudioBytes / (format.mBitsPerSample / 8 ? format.mBitsPerSample / 8 : 1);
+			samples.resize(sampleCount - sampleCount % format.mChannels);
+
+			const uint8* pBytes = data.pStartAudio;
+			const bool isFloat = tag == WAVFormatTag::WAV_FORMAT_TAG_IEEE_FLOAT;
+			if ((tag != WAVFormatTag::WAV_FORMAT_TAG_PCM && !isFloat) || (isFloat && format.mBitsPerSample != 32))
+				return false;
+
+			switch (format.mBitsPerSample)
+			{
+			case 16:
+				ConvertPCM16ToFloat(reinterpret_cast<const int16*>(pBytes), samples.data(), samples.size());
+				return true;
+
+			case 24:
+				for (uint64 i = 0; i < samples.size(); i++)
+				{
+					const int32 value = static_cast<int32>((static_cast<uint32>(pBytes[i * 3]) << 8) | (static_cast<uint32>(pBytes[i * 3 + 1]) << 16) | (static_cast<uint32>(pBytes[i * 3 + 2]) << 24));
+					samples[i] = static_cast<float>(value >> 8) / 8388608.0f;
+				}
+				return true;
+
+			case 32:
+				if (isFloat)
+					std::memcpy(samples.data(), pBytes, samples.size() * sizeof(float));
+				else
+				{
+					for (uint64 i = 0; i < samples.size(); i++)
+					{
+						int32 value = 0;
+						std::memcpy(&value, pBytes + i * 4, sizeof(int32));
+						samples[i] = static_cast<float>(value / 2147483648.0);
+					}
+				}
+				return true;
+
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool ConvolutionReverb::Initialize(const ConvolutionReverbDescription& description)
+	{
+		Terminate();
+
+		// The FFT size doubles from one segment to the next, so the partition boundaries only line up for powers of two.
+		const uint32 blockFrames = description.mBlockFrames;
+		const uint32 maxPartitionFrames = description.mMaxPartitionFrames;
+		if (!description.mChannelCount || !blockFrames || (blockFrames & (blockFrames - 1)) || !maxPartitionFrames || (maxPartitionFrames & (maxPartitionFrames - 1)))
+		{
+			Logger::LogError(STRING("Invalid convolution reverb description!"));
+			return false;
+		}
+
+		mDescription = description;
+		mDescription.mMaxPartitionFrames = std::max(description.mMaxPartitionFrames, description.mBlockFrames);
+
+		mChannels.resize(static_cast<uint64>(description.mChannelCount) * description.mBlockFrames);
+		mWet.resize(static_cast<uint64>(description.mChannelCount) * description.mBlockFrames);
+		mRamps.resize(static_cast<uint64>(description.mBlockFrames) * 2);
+
+		mWetGain = mPreviousWetGain = description.mWetGain;
+		mDryGain = mPreviousDryGain = description.mDryGain;
+		return true;
+	}
+
+	void ConvolutionReverb::Terminate()
+	{
+		ClearSegments();
+
+		mChannels.clear();
+		mWet.clear();
+		mRamps.clear();
+		mDescription = {};
+	}
+
+	bool ConvolutionReverb::LoadImpulse(const WAVData& data, const wchar* pCacheFileName)
+	{
+		Vector<float> samples;
+		if (!DecodeSamples(data, samples))
+		{
+			Logger::LogError(STRING("Unsupported impulse response format!"));
+			return false;
+		}
+
+		const uint32 channelCount = data.mWAVFormat.mChannels;
+		return SetImpulse(samples.data(), samples.size() / channelCount, channelCount, pCacheFileName);
+	}
+
+	bool ConvolutionReverb::SetImpulse(const float* pSamples, uint64 frameCount, uint32 channelCount, const wchar* pCacheFileName)
+	{
+		ClearSegments();
+
+		// The reverb must have been initialized for its block buffers to exist.
+		if (!pSamples || !frameCount || !channelCount || mChannels.empty())
+			return false;
+
+		// The hash covers the samples and everything the partition layout depends on.
+		uint64 hash = HashBytes(pSamples, frameCount * channelCount * sizeof(float));
+		hash = HashBytes(&frameCount, sizeof(frameCount), hash);
+		hash = HashBytes(&channelCount, sizeof(channelCount), hash);
+
+		CreateSegments(frameCount, channelCount);
+		if (pCacheFileName && LoadCache(pCacheFileName, hash))
+			return true;
+
+		Vector<float> channel;
+		for (auto& pSegment : mSegments)
+		{
+			channel.resize(pSegment->mLength);
+			for (uint32 c = 0; c < channelCount; c++)
+			{
+				for (uint64 i = 0; i < pSegment->mLength; i++)
+					channel[i] = pSamples[(pSegment->mStart + i) * channelCount + c];
+
+				pSegment->mConvolvers.front().CreateKernel(channel.data(), pSegment->mLength, pSegment->mKernels[c]);
+			}
+		}
+
+		if (pCacheFileName)
+			SaveCache(pCacheFileName, hash);
+
+		return true;
+	}
+
+	void ConvolutionReverb::Process(float* pBuffer, uint32 frameCount, uint32 channelCount)
+	{
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		if (frameCount != blockFrames || channelCount != mDescription.mChannelCount || mSegments.empty())
+			return;
+
+		if (ComputePeak(pBuffer, static_cast<uint64>(blockFrames) * channelCount) > SilenceThreshold)
+			mSilentFrames = 0;
+		else
+			mSilentFrames += blockFrames;
+
+		for (uint32 c = 0; c < channelCount; c++)
+			for (uint32 frame = 0; frame < blockFrames; frame++)
+				mChannels[static_cast<uint64>(c) * blockFrames + frame] = pBuffer[static_cast<uint64>(frame) * channelCount + c];
+
+		// The head is convolved right away.
+		Segment& head = *mSegments.front();
+		for (uint32 c = 0; c < channelCount; c++)
+		{
+			float* pChannel = mChannels.data() + static_cast<uint64>(c) * blockFrames;
+			head.mConvolvers[c].PushInput(pChannel);
+			head.mConvolvers[c].Convolve(head.mKernels[c % mImpulseChannels], mWet.data() + static_cast<uint64>(c) * blockFrames);
+		}
+
+		// Tail segments play the output of the partition before last and collect the input of the next one.
+		for (uint64 s = 1; s < mSegments.size(); s++)
+		{
+			Segment& segment = *mSegments[s];
+			const uint32 partitionFrames = segment.mPartitionFrames;
+			const uint32 offset = static_cast<uint32>(mFramePosition % partitionFrames);
+			const uint32 slot = static_cast<uint32>(mFramePosition / partitionFrames % 2);
+
+			for (uint32 c = 0; c < channelCount; c++)
+			{
+				const uint64 slotOffset = (static_cast<uint64>(slot) * channelCount + c) * partitionFrames + offset;
+				const float* pChannel = mChannels.data() + static_cast<uint64>(c) * blockFrames;
+				float* pWet = mWet.data() + static_cast<uint64>(c) * blockFrames;
+
+				MixBuffer(pWet, segment.mOutputs.data() + slotOffset, 1.0f, blockFrames);
+				std::copy(pChannel, pChannel + blockFrames, segment.mInputs.begin() + slotOffset);
+			}
+
+			if (offset + blockFrames < partitionFrames)
+				continue;
+
+			// The partition is complete. The previous job's output plays from the next block on, so it must be done.
+			JobSystem* pJobSystem = mDescription.pJobSystem;
+			if (pJobSystem)
+				pJobSystem->Wait(segment.mJobs, JobPriority::JOB_PRIORITY_REAL_TIME_MIX);
+
+			segment.mJobSlot = slot;
+			for (uint32 c = 0; c < channelCount; c++)
+			{
+				if (pJobSystem)
+				{
+					Job job = {};
+					job.pFunction = TailJob;
+					job.pData = &segment;
+					job.mArgument = c;
+					job.pCounter = &segment.mJobs;
+					pJobSystem->Submit(job, JobPriority::JOB_PRIORITY_REAL_TIME_MIX);
+				}
+				else
+					TailJob(&segment, c);
+			}
+		}
+
+		float* pWetRamp = mRamps.data();
+		float* pDryRamp = pWetRamp + blockFrames;
+		ComputeRamp(pWetRamp, mPreviousWetGain, mWetGain, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+		ComputeRamp(pDryRamp, mPreviousDryGain, mDryGain, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+
+		for (uint32 c = 0; c < channelCount; c++)
+		{
+			const float* pChannel = mChannels.data() + static_cast<uint64>(c) * blockFrames;
+			const float* pWet = mWet.data() + static_cast<uint64>(c) * blockFrames;
+
+			for (uint32 frame = 0; frame < blockFrames; frame++)
+				pBuffer[static_cast<uint64>(frame) * channelCount + c] = pChannel[frame] * pDryRamp[frame] + pWet[frame] * pWetRamp[frame];
+		}
+
+		mPreviousWetGain = mWetGain;
+		mPreviousDryGain = mDryGain;
+		mFramePosition += blockFrames;
+	}
+
+	void ConvolutionReverb::CreateSegments(uint64 frameCount, uint32 impulseChannels)
+	{
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		const uint32 channelCount = mDescription.mChannelCount;
+		mImpulseFrames = frameCount;
+		mImpulseChannels = impulseChannels;
+		mFramePosition = 0;
+		mSilentFrames = GetTailFrames();
+
+		// The head ends where the first tail segment starts, at twice that segment's partition size.
+		uint64 start = 0;
+		uint32 partitionFrames = blockFrames;
+		while (start < frameCount)
+		{
+			const uint32 nextFrames = std::min(partitionFrames * PartitionGrowth, mDescription.mMaxPartitionFrames);
+			const uint64 end = nextFrames > partitionFrames ? std::min<uint64>(static_cast<uint64>(nextFrames) * 2, frameCount) : frameCount;
+
+			auto pSegment = std::make_unique<Segment>();
+			pSegment->mStart = start;
+			pSegment->mLength = end - start;
+			pSegment->mPartitionFrames = partitionFrames;
+
+			const uint32 partitionCount = static_cast<uint32>((pSegment->mLength + partitionFrames - 1) / partitionFrames);
+			pSegment->mConvolvers.resize(channelCount);
+			for (UniformConvolver& convolver : pSegment->mConvolvers)
+				convolver.Initialize(partitionFrames, partitionCount);
+
+			pSegment->mKernels.resize(impulseChannels);
+			if (start)
+			{
+				pSegment->mInputs.resize(static_cast<uint64>(partitionFrames) * channelCount * 2);
+				pSegment->mOutputs.resize(static_cast<uint64>(partitionFrames) * channelCount * 2);
+			}
+
+			mSegments.insert(mSegments.end(), std::move(pSegment));
+			start = end;
+			partitionFrames = nextFrames;
+		}
+	}
+
+	void ConvolutionReverb::ClearSegments()
+	{
+		if (mDescription.pJobSystem)
+			for (auto& pSegment : mSegments)
+				mDescription.pJobSystem->Wait(pSegment->mJobs);
+
+		mSegments.clear();
+		mImpulseFrames = 0;
+		mImpulseChannels = 0;
+		mFramePosition = 0;
+		mSilentFrames = 0;
+	}
+
+	bool ConvolutionReverb::LoadCache(const wchar* pFileName, uint64 hash)
+	{
+		std::ifstream file(std::filesystem::path(pFileName), std::ios::binary);
+		if (!file.is_open())
+			return false;
+
+		ReverbCacheHeader header = {};
+		file.read(reinterpret_cast<char*>(&header), sizeof(ReverbCacheHeader));
+		if (!file.good() || header.mTag != ReverbCacheTag || header.mVersion != ReverbCacheVersion || header.mHash != hash ||
+			header.mBlockFrames != mDescription.mBlockFrames || header.mMaxPartitionFrames != mDescription.mMaxPartitionFrames ||
+			header.mImpulseChannels != mImpulseChannels || header.mFrameCount != mImpulseFrames || header.mSegmentCount != mSegments.size())
+			return false;
+
+		for (auto& pSegment : mSegments)
+		{
+			const uint64 binCount = pSegment->mPartitionFrames + 1;
+			const uint32 partitionCount = static_cast<uint32>((pSegment->mLength + pSegment->mPartitionFrames - 1) / pSegment->mPartitionFrames);
+
+			for (ConvolutionKernel& kernel : pSegment->mKernels)
+			{
+				kernel.mBlockSize = pSegment->mPartitionFrames;
+				kernel.mPartitionCount = partitionCount;
+				kernel.mReal.resize(binCount * partitionCount);
+				kernel.mImaginary.resize(binCount * partitionCount);
+
+				file.read(reinterpret_cast<char*>(kernel.mReal.data()), kernel.mReal.size() * sizeof(float));
+				file.read(reinterpret_cast<char*>(kernel.mImaginary.data()), kernel.mImaginary.size() * sizeof(float));
+			}
+		}
+
+		return file.good();
+	}
+
+	void ConvolutionReverb::SaveCache(const wchar* pFileName, uint64 hash) const
+	{
+		std::ofstream file(std::filesystem::path(pFileName), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Logger::LogWarn(STRING("Failed to open the reverb cache file for writing!"));
+			return;
+		}
+
+		ReverbCacheHeader header = {};
+		header.mBlockFrames = mDescription.mBlockFrames;
+		header.mMaxPartitionFrames = mDescription.mMaxPartitionFrames;
+		header.mImpulseChannels = mImpulseChannels;
+		header.mSegmentCount = static_cast<uint32>(mSegments.size());
+		header.mFrameCount = mImpulseFrames;
+		header.mHash = hash;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(ReverbCacheHeader));
+
+		for (const auto& pSegment : mSegments)
+		{
+			for (const ConvolutionKernel& kernel : pSegment->mKernels)
+			{
+				file.write(reinterpret_cast<const char*>(kernel.mReal.data()), kernel.mReal.size() * sizeof(float));
+				file.write(reinterpret_cast<const char*>(kernel.mImaginary.data()), kernel.mImaginary.size() * sizeof(float));
+			}
+		}
+	}
+
+	void ConvolutionReverb::TailJob(void* pData, uint64 channel)
+	{
+		Segment& segment = *static_cast<Segment*>(pData);
+		const uint64 channelCount = segment.mConvolvers.size();
+		const uint64 slotOffset = (segment.mJobSlot * channelCount + channel) * segment.mPartitionFrames;
+
+		UniformConvolver& convolver = segment.mConvolvers[channel];
+		convolver.PushInput(segment.mInputs.data() + slotOffset);
+		convolver.Convolve(segment.mKernels[channel % segment.mKernels.size()], segment.mOutputs.data() + slotOffset);
+	}
+}
\ No newline at end of file
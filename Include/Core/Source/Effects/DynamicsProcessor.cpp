@@ -0,0 +1,459 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Effects/DynamicsProcessor.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float DecibelsToLog2 = 0.166096405f;	// log2(10) / 20, the log2 units in a dB.
+		const float Log2ToDecibels = 6.02059991f;	// 20 / log2(10), the dB in a log2 unit.
+		const float MinimumLevel = 1e-12f;	// The level silence is detected as, -240 dB.
+		const float MinimumKnee = 1e-3f;	// The knee width of a hard knee in log2 units, which avoids dividing by 0.
+
+		// log2(m) is approximated as (m - 1) * p(m) for a mantissa m in [1, 2), within 0.0012 dB.
+		const float Log2Coefficients[4] = { 2.52454373f, -1.57819749f, 0.576485637f, -0.0842850908f };
+
+		// 2^f is approximated as 1 + f * p(f) for f in [0, 1), within a relative error of 5e-6.
+		const float Exp2Coefficients[4] = { 0.693018631f, 0.241404768f, 0.0520739356f, 0.0134934755f };
+
+		/**
+		 * Four frames worth of values.
+		 */
+#ifdef ENSD_SIMD_SSE2
+		struct Lanes { __m128 v; };
+
+		inline Lanes Set(float value) { return { _mm_set1_ps(value) }; }
+		inline Lanes Load(const float* pValues) { return { _mm_loadu_ps(pValues) }; }
+		inline void Store(float* pValues, Lanes lanes) { _mm_storeu_ps(pValues, lanes.v); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { _mm_add_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { _mm_sub_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { _mm_mul_ps(lhs.v, rhs.v) }; }
+		inline Lanes Max(Lanes lhs, Lanes rhs) { return { _mm_max_ps(lhs.v, rhs.v) }; }
+		inline Lanes Min(Lanes lhs, Lanes rhs) { return { _mm_min_ps(lhs.v, rhs.v) }; }
+
+		/**
+		 * Pick the lanes of one value where a value is at most a limit, and of another elsewhere.
+		 */
+		inline Lanes SelectLessEqual(Lanes value, Lanes limit, Lanes ifTrue, Lanes ifFalse)
+		{
+			const __m128 mask = _mm_cmple_ps(value.v, limit.v);
+			return { _mm_or_ps(_mm_and_ps(mask, ifTrue.v), _mm_andnot_ps(mask, ifFalse.v)) };
+		}
+
+		inline Lanes FastLog2(Lanes lanes)
+		{
+			const __m128i bits = _mm_castps_si128(lanes.v);
+			const Lanes exponent = { _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(bits, 23), _mm_set1_epi32(127))) };
+			const Lanes mantissa = { _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(bits, _mm_set1_epi32(0x007FFFFF)), _mm_set1_epi32(0x3F800000))) };
+
+			const Lanes polynomial = Set(Log2Coefficients[0]) + mantissa * (Set(Log2Coefficients[1]) + mantissa * (Set(Log2Coefficients[2]) + mantissa * Set(Log2Coefficients[3])));
+			return exponent + (mantissa - Set(1.0f)) * polynomial;
+		}
+
+		inline Lanes FastExp2(Lanes lanes)
+		{
+			const __m128 clamped = _mm_min_ps(_mm_max_ps(lanes.v, _mm_set1_ps(-126.0f)), _mm_set1_ps(126.0f));
+
+			// Truncation rounds negative values up, so those are stepped down to the floor.
+			__m128i whole = _mm_cvttps_epi32(clamped);
+			Lanes fraction = { _mm_sub_ps(clamped, _mm_cvtepi32_ps(whole)) };
+			const __m128 isNegative = _mm_cmplt_ps(fraction.v, _mm_setzero_ps());
+			whole = _mm_add_epi32(whole, _mm_castps_si128(isNegative));
+			fraction.v = _mm_add_ps(fraction.v, _mm_and_ps(isNegative, _mm_set1_ps(1.0f)));
+
+			const Lanes polynomial = Set(Exp2Coefficients[0]) + fraction * (Set(Exp2Coefficients[1]) + fraction * (Set(Exp2Coefficients[2]) + fraction * Set(Exp2Coefficients[3])));
+			const Lanes scale = { _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(whole, _mm_set1_epi32(127)), 23)) };
+			return scale * (Set(1.0f) + fraction * polynomial);
+		}
+
+#else
+		struct Lanes { float v[4]; };
+
+		inline Lanes Set(float value) { return { { value, value, value, value } }; }
+		inline Lanes Load(const float* pValues) { return { { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+		inline void Store(float* pValues, Lanes lanes) { std::copy(lanes.v, lanes.v + 4, pValues); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { { lhs.v[0] + rhs.v[0], lhs.v[1] + rhs.v[1], lhs.v[2] + rhs.v[2], lhs.v[3] + rhs.v[3] } }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { { lhs.v[0] - rhs.v[0], lhs.v[1] - rhs.v[1], lhs.v[2] - rhs.v[2], lhs.v[3] - rhs.v[3] } }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { { lhs.v[0] * rhs.v[0], lhs.v[1] * rhs.v[1], lhs.v[2] * rhs.v[2], lhs.v[3] * rhs.v[3] } }; }
+		inline Lanes Max(Lanes lhs, Lanes rhs) { return { { std::max(lhs.v[0], rhs.v[0]), std::max(lhs.v[1], rhs.v[1]), std::max(lhs.v[2], rhs.v[2]), std::max(lhs.v[3], rhs.v[3]) } }; }
+		inline Lanes Min(Lanes lhs, Lanes rhs) { return { { std::min(lhs.v[0], rhs.v[0]), std::min(lhs.v[1], rhs.v[1]), std::min(lhs.v[2], rhs.v[2]), std::min(lhs.v[3], rhs.v[3]) } }; }
+
+		inline Lanes SelectLessEqual(Lanes value, Lanes limit, Lanes ifTrue, Lanes ifFalse)
+		{
+			for (uint32 i = 0; i < 4; i++)
+				ifFalse.v[i] = value.v[i] <= limit.v[i] ? ifTrue.v[i] : ifFalse.v[i];
+
+			return ifFalse;
+		}
+
+		inline Lanes FastLog2(Lanes lanes)
+		{
+			for (uint32 i = 0; i < 4; i++)
+			{
+				uint32 bits = 0;
+				std::memcpy(&bits, &lanes.v[i], sizeof(bits));
+
+				const float exponent = static_cast<float>(static_cast<int32>(bits >> 23) - 127);
+				bits = (bits & 0x007FFFFF) | 0x3F800000;
+
+				float mantissa = 0.0f;
+				std::memcpy(&mantissa, &bits, sizeof(mantissa));
+
+				const float polynomial = Log2Coefficients[0] + mantissa * (Log2Coefficients[1] + mantissa * (Log2Coefficients[2] + mantissa * Log2Coefficients[3]));
+				lanes.v[i] = exponent + (mantissa - 1.0f) * polynomial;
+			}
+
+			return lanes;
+		}
+
+		inline Lanes FastExp2(Lanes lanes)
+		{
+			for (uint32 i = 0; i < 4; i++)
+			{
+				const float clamped = std::min(std::max(lanes.v[i], -126.0f), 126.0f);
+				const float whole = std::floor(clamped);
+				const float fraction = clamped - whole;
+
+				const uint32 bits = static_cast<uint32>(static_cast<int32>(whole) + 127) << 23;
+				float scale = 0.0f;
+				std::memcpy(&scale, &bits, sizeof(scale));
+
+				const float polynomial = Exp2Coefficients[0] + fraction * (Exp2Coefficients[1] + fraction * (Exp2Coefficients[2] + fraction * Exp2Coefficients[3]));
+				lanes.v[i] = scale * (1.0f + fraction * polynomial);
+			}
+
+			return lanes;
+		}
+
+#endif // ENSD_SIMD_SSE2
+
+		/**
+		 * Detect the level of every frame across the channels: the largest absolute sample, or the mean square.
+		 */
+		void DetectLevels(const float* pKey, uint32 channelCount, uint32 frameCount, bool isRms, float* pLevels)
+		{
+			uint32 frame = 0;
+
+#ifdef ENSD_SIMD_SSE2
+			const __m128 signMask = _mm_set1_ps(-0.0f);
+			if (channelCount == 1)
+			{
+				for (; frame + 4 <= frameCount; frame += 4)
+				{
+					const __m128 samples = _mm_loadu_ps(pKey + frame);
+					_mm_storeu_ps(pLevels + frame, isRms ? _mm_mul_ps(samples, samples) : _mm_andnot_ps(signMask, samples));
+				}
+			}
+			else if (channelCount == 2)
+			{
+				const __m128 half = _mm_set1_ps(0.5f);
+				for (; frame + 4 <= frameCount; frame += 4)
+				{
+					const __m128 low = _mm_loadu_ps(pKey + frame * 2);
+					const __m128 high = _mm_loadu_ps(pKey + frame * 2 + 4);
+					const __m128 left = _mm_shuffle_ps(low, high, _MM_SHUFFLE(2, 0, 2, 0));
+					const __m128 right = _mm_shuffle_ps(low, high, _MM_SHUFFLE(3, 1, 3, 1));
+
+					if (isRms)
+						_mm_storeu_ps(pLevels + frame, _mm_mul_ps(_mm_add_ps(_mm_mul_ps(left, left), _mm_mul_ps(right, right)), half));
+					else
+						_mm_storeu_ps(pLevels + frame, _mm_max_ps(_mm_andnot_ps(signMask, left), _mm_andnot_ps(signMask, right)));
+				}
+			}
+#endif // ENSD_SIMD_SSE2
+
+			const float channelScale = 1.0f / channelCount;
+			for (; frame < frameCount; frame++)
+			{
+				const float* pFrame = pKey + static_cast<uint64>(frame) * channelCount;
+				float level = 0.0f;
+				for (uint32 c = 0; c < channelCount; c++)
+					level = isRms ? level + pFrame[c] * pFrame[c] : std::max(level, std::fabs(pFrame[c]));
+
+				pLevels[frame] = isRms ? level * channelScale : level;
+			}
+		}
+
+		/**
+		 * Compute a one pole smoothing coefficient from a time constant.
+		 */
+		inline float ComputeCoefficient(float time, uint32 sampleRate)
+		{
+			return time > 0.0f ? std::exp(-1.0f / (time * sampleRate)) : 0.0f;
+		}
+	}
+
+	void DynamicsProcessor::Initialize(const DynamicsProcessorDescription& description)
+	{
+		Terminate();
+
+		mDescription = description;
+		mDescription.mBlockFrames = std::max(description.mBlockFrames, 1U);
+		mParameters = description.mParameters;
+
+		mLookaheadFrames = static_cast<uint32>(std::max(description.mLookaheadTime, 0.0f) * description.mSampleRate + 0.5f);
+		mDelay.resize(static_cast<uint64>(mLookaheadFrames + mDescription.mBlockFrames) * description.mChannelCount);
+
+		// Rounded up to four frames, so the SIMD passes never need a scalar tail.
+		const uint32 paddedFrames = (mDescription.mBlockFrames + 3) & ~3U;
+		mLevels.resize(paddedFrames);
+		mGains.resize(paddedFrames);
+
+		// The limiter window covers the lookahead and the frame which comes out.
+		mHeldGains.resize(static_cast<uint64>(mLookaheadFrames) + 1);
+		mMinimumGains.resize(static_cast<uint64>(mLookaheadFrames) + 1);
+		mMinimumFrames.resize(static_cast<uint64>(mLookaheadFrames) + 1);
+
+		Reset();
+	}
+
+	void DynamicsProcessor::Terminate()
+	{
+		mDelay.clear();
+		mLevels.clear();
+		mGains.clear();
+		mHeldGains.clear();
+		mMinimumGains.clear();
+		mMinimumFrames.clear();
+		mDescription = {};
+	}
+
+	void DynamicsProcessor::Reset()
+	{
+		std::fill(mDelay.begin(), mDelay.end(), 0.0f);
+		std::fill(mHeldGains.begin(), mHeldGains.end(), 1.0f);
+		mHeldSum = static_cast<double>(mHeldGains.size());
+		mMinimumBegin = 0;
+		mMinimumCount = 0;
+
+		mFramePosition = 0;
+		mSilentFrames = static_cast<uint64>(mLookaheadFrames) + 1;
+		mMeanSquare = 0.0f;
+		mReduction = 0.0f;
+		mLimiterGain = 1.0f;
+		mGainReduction.store(0.0f, std::memory_order_relaxed);
+	}
+
+	void DynamicsProcessor::Process(float* pBuffer, uint32 frameCount, uint32 channelCount)
+	{
+		ProcessWithSidechain(pBuffer, pBuffer, frameCount, channelCount);
+	}
+
+	void DynamicsProcessor::ProcessWithSidechain(float* pBuffer, const float* pSidechain, uint32 frameCount, uint32 channelCount)
+	{
+		if (channelCount != mDescription.mChannelCount || frameCount > mDescription.mBlockFrames || !frameCount || mDelay.empty())
+			return;
+
+		if (ComputePeak(pBuffer, static_cast<uint64>(frameCount) * channelCount) > SilenceThreshold)
+			mSilentFrames = 0;
+		else
+			mSilentFrames += frameCount;
+
+		if (mParameters.mMode == DynamicsMode::DYNAMICS_MODE_LIMITER)
+			ComputeLimiterGains(pSidechain, frameCount);
+		else
+			ComputeCompressorGains(pSidechain, frameCount);
+
+		ApplyGains(pBuffer, frameCount);
+		mFramePosition += frameCount;
+	}
+
+	bool DynamicsProcessor::IsTailSilent() const
+	{
+		if (mDelay.empty())
+			return true;
+
+		const bool isReleased = mParameters.mMode == DynamicsMode::DYNAMICS_MODE_LIMITER ? mLimiterGain >= 0.9999f : mReduction >= -1e-4f;
+		return isReleased && mSilentFrames > mLookaheadFrames;
+	}
+
+	void DynamicsProcessor::ComputeCompressorGains(const float* pKey, uint32 frameCount)
+	{
+		const uint32 sampleRate = mDescription.mSampleRate;
+		const uint32 paddedFrames = (frameCount + 3) & ~3U;
+		const bool isRms = mParameters.mDetector == DynamicsDetector::DYNAMICS_DETECTOR_RMS;
+		float* pLevels = mLevels.data();
+		float* pGains = mGains.data();
+
+		std::fill(pLevels + frameCount, pLevels + paddedFrames, 0.0f);
+		if (pKey)
+			DetectLevels(pKey, mDescription.mChannelCount, frameCount, isRms, pLevels);
+		else
+			std::fill(pLevels, pLevels + frameCount, 0.0f);
+
+		if (isRms)
+		{
+			const float rmsCoefficient = ComputeCoefficient(mParameters.mRmsTime, sampleRate);
+			for (uint32 frame = 0; frame < frameCount; frame++)
+			{
+				mMeanSquare = pLevels[frame] + rmsCoefficient * (mMeanSquare - pLevels[frame]);
+				pLevels[frame] = mMeanSquare;
+			}
+		}
+
+		// The soft knee gain curve, in log2 units, four frames at a time.
+		const float slope = 1.0f / std::max(mParameters.mRatio, 1.0f) - 1.0f;
+		const float knee = std::max(mParameters.mKnee * DecibelsToLog2, MinimumKnee);
+		const Lanes threshold = Set(mParameters.mThreshold * DecibelsToLog2);
+		const Lanes halfKnee = Set(knee * 0.5f);
+		const Lanes negativeHalfKnee = Set(-knee * 0.5f);
+		const Lanes slopes = Set(slope);
+		const Lanes kneeScale = Set(slope / (2.0f * knee));
+		const Lanes range = Set(-std::max(mParameters.mRange, 0.0f) * DecibelsToLog2);
+		const Lanes levelScale = Set(isRms ? 0.5f : 1.0f);
+		const Lanes minimumLevel = Set(MinimumLevel);
+		const Lanes zero = Set(0.0f);
+
+		for (uint32 frame = 0; frame < paddedFrames; frame += 4)
+		{
+			const Lanes difference = FastLog2(Max(Load(pLevels + frame), minimumLevel)) * levelScale - threshold;
+			const Lanes kneeOffset = difference + halfKnee;
+			const Lanes kneeReduction = kneeScale * kneeOffset * kneeOffset;
+
+			Lanes reduction = SelectLessEqual(difference, negativeHalfKnee, zero, kneeReduction);
+			reduction = SelectLessEqual(halfKnee, difference, slopes * difference, reduction);
+			Store(pLevels + frame, Max(reduction, range));
+		}
+
+		// Attack when the reduction grows and release when it shrinks.
+		const float attackCoefficient = ComputeCoefficient(mParameters.mAttackTime, sampleRate);
+		const float releaseCoefficient = ComputeCoefficient(mParameters.mReleaseTime, sampleRate);
+		float largestReduction = 0.0f;
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			const float target = pLevels[frame];
+			const float coefficient = target < mReduction ? attackCoefficient : releaseCoefficient;
+			mReduction = target + coefficient * (mReduction - target);
+			largestReduction = std::min(largestReduction, mReduction);
+			pGains[frame] = mReduction;
+		}
+
+		std::fill(pGains + frameCount, pGains + paddedFrames, 0.0f);
+		const Lanes makeup = Set(mParameters.mMakeupGain * DecibelsToLog2);
+		for (uint32 frame = 0; frame < paddedFrames; frame += 4)
+			Store(pGains + frame, FastExp2(Load(pGains + frame) + makeup));
+
+		mGainReduction.store(-largestReduction * Log2ToDecibels, std::memory_order_relaxed);
+	}
+
+	void DynamicsProcessor::ComputeLimiterGains(const float* pKey, uint32 frameCount)
+	{
+		const uint32 paddedFrames = (frameCount + 3) & ~3U;
+		float* pLevels = mLevels.data();
+		float* pGains = mGains.data();
+
+		std::fill(pLevels + frameCount, pLevels + paddedFrames, 0.0f);
+		if (pKey)
+			DetectLevels(pKey, mDescription.mChannelCount, frameCount, false, pLevels);
+		else
+			std::fill(pLevels, pLevels + frameCount, 0.0f);
+
+		// The gain every frame needs to stay under the threshold once the makeup gain is applied.
+		const float makeup = std::pow(10.0f, mParameters.mMakeupGain / 20.0f);
+		const Lanes ceiling = Set(std::pow(10.0f, mParameters.mThreshold / 20.0f) / makeup);
+		const Lanes one = Set(1.0f);
+		const Lanes minimumLevel = Set(MinimumLevel);
+		for (uint32 frame = 0; frame < paddedFrames; frame += 4)
+		{
+			const Lanes levels = Max(Load(pLevels + frame), minimumLevel);
+#ifdef ENSD_SIMD_SSE2
+			const Lanes needed = { _mm_div_ps(ceiling.v, levels.v) };
+#else
+			const Lanes needed = { { ceiling.v[0] / levels.v[0], ceiling.v[1] / levels.v[1], ceiling.v[2] / levels.v[2], ceiling.v[3] / levels.v[3] } };
+#endif // ENSD_SIMD_SSE2
+
+			Store(pLevels + frame, Min(needed, one));
+		}
+
+		// Hold the smallest needed gain of the window, then average the held gains across the window. A peak is inside
+		// the window of every held gain averaged when it comes out, so the average is never above its needed gain.
+		const uint32 windowFrames = static_cast<uint32>(mHeldGains.size());
+		const float windowScale = 1.0f / windowFrames;
+		const float releaseCoefficient = ComputeCoefficient(mParameters.mReleaseTime, mDescription.mSampleRate);
+		float smallestGain = 1.0f;
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			const uint64 position = mFramePosition + frame;
+			const float needed = pLevels[frame];
+
+			while (mMinimumCount && mMinimumGains[(mMinimumBegin + mMinimumCount - 1) % windowFrames] >= needed)
+				mMinimumCount--;
+
+			if (mMinimumCount && mMinimumFrames[mMinimumBegin] + windowFrames <= position)
+			{
+				mMinimumBegin = (mMinimumBegin + 1) % windowFrames;
+				mMinimumCount--;
+			}
+
+			const uint32 back = (mMinimumBegin + mMinimumCount++) % windowFrames;
+			mMinimumGains[back] = needed;
+			mMinimumFrames[back] = position;
+
+			const float held = mMinimumGains[mMinimumBegin];
+			const uint32 slot = static_cast<uint32>(position % windowFrames);
+			mHeldSum += static_cast<double>(held) - mHeldGains[slot];
+			mHeldGains[slot] = held;
+
+			// The running sum is recomputed once per window so rounding never builds up.
+			if (slot == windowFrames - 1)
+			{
+				mHeldSum = 0.0;
+				for (auto gain : mHeldGains)
+					mHeldSum += gain;
+			}
+
+			const float average = static_cast<float>(mHeldSum) * windowScale;
+			mLimiterGain = average < mLimiterGain ? average : average + releaseCoefficient * (mLimiterGain - average);
+			smallestGain = std::min(smallestGain, mLimiterGain);
+			pGains[frame] = mLimiterGain * makeup;
+		}
+
+		mGainReduction.store(-20.0f * std::log10(std::max(smallestGain, MinimumLevel)), std::memory_order_relaxed);
+	}
+
+	void DynamicsProcessor::ApplyGains(float* pBuffer, uint32 frameCount)
+	{
+		const uint32 channelCount = mDescription.mChannelCount;
+		const uint64 lookaheadSamples = static_cast<uint64>(mLookaheadFrames) * channelCount;
+		const uint64 sampleCount = static_cast<uint64>(frameCount) * channelCount;
+		float* pDelay = mDelay.data();
+		const float* pGains = mGains.data();
+
+		std::copy(pBuffer, pBuffer + sampleCount, pDelay + lookaheadSamples);
+
+		uint32 frame = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		if (channelCount == 1)
+		{
+			for (; frame + 4 <= frameCount; frame += 4)
+				_mm_storeu_ps(pBuffer + frame, _mm_mul_ps(_mm_loadu_ps(pDelay + frame), _mm_loadu_ps(pGains + frame)));
+		}
+		else if (channelCount == 2)
+		{
+			for (; frame + 4 <= frameCount; frame += 4)
+			{
+				const __m128 gains = _mm_loadu_ps(pGains + frame);
+				_mm_storeu_ps(pBuffer + frame * 2, _mm_mul_ps(_mm_loadu_ps(pDelay + frame * 2), _mm_unpacklo_ps(gains, gains)));
+				_mm_storeu_ps(pBuffer + frame * 2 + 4, _mm_mul_ps(_mm_loadu_ps(pDelay + frame * 2 + 4), _mm_unpackhi_ps(gains, gains)));
+			}
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; frame < frameCount; frame++)
+			for (uint32 c = 0; c < channelCount; c++)
+				pBuffer[static_cast<uint64>(frame) * channelCount + c] = pDelay[static_cast<uint64>(frame) * channelCount + c] * pGains[frame];
+
+		// The last lookahead frames are the start of the next block.
+		std::copy(pDelay + sampleCount, pDelay + sampleCount + lookaheadSamples, pDelay);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,429 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Effects/FDNReverb.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		// Mutually prime delay lengths between 30 and 60 ms at 48 kHz. 8 line networks use every other one.
+		const float BaseDelays[16] = {
+			1433.0f, 1531.0f, 1601.0f, 1699.0f, 1787.0f, 1867.0f, 1951.0f, 2053.0f,
+			2131.0f, 2251.0f, 2333.0f, 2399.0f, 2473.0f, 2617.0f, 2711.0f, 2801.0f };
+
+		const float MinSizeScale = 0.25f;	// The delay scale at size 0.
+		const float MaxSizeScale = 2.0f;	// The delay scale at size 1.
+		const float MaxDamping = 0.95f;	// The damping coefficient at damping 1.
+		const float DenormalOffset = 1e-18f;	// Keeps the damping filters out of denormals once the input goes silent.
+
+		// Hadamard rows used to spread the input over the lines and to pick the left and right output taps, so the
+		// two outputs are decorrelated.
+		const float InputSigns[4][4] = { { 1.0f, -1.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, 1.0f, -1.0f }, { 1.0f, -1.0f, -1.0f, 1.0f }, { -1.0f, 1.0f, 1.0f, -1.0f } };
+		const float LeftSigns[4] = { 1.0f, -1.0f, 1.0f, -1.0f };
+		const float RightSigns[4] = { 1.0f, 1.0f, -1.0f, -1.0f };
+
+		/**
+		 * Four delay lines worth of values.
+		 */
+#ifdef ENSD_SIMD_SSE2
+		struct Lanes { __m128 v; };
+
+		inline Lanes Set(float value) { return { _mm_set1_ps(value) }; }
+		inline Lanes Load(const float* pValues) { return { _mm_loadu_ps(pValues) }; }
+		inline void Store(float* pValues, Lanes lanes) { _mm_storeu_ps(pValues, lanes.v); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { _mm_add_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { _mm_sub_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { _mm_mul_ps(lhs.v, rhs.v) }; }
+
+		inline Lanes SwapPairs(Lanes lanes) { return { _mm_shuffle_ps(lanes.v, lanes.v, _MM_SHUFFLE(2, 3, 0, 1)) }; }
+		inline Lanes SwapHalves(Lanes lanes) { return { _mm_shuffle_ps(lanes.v, lanes.v, _MM_SHUFFLE(1, 0, 3, 2)) }; }
+		inline float First(Lanes lanes) { return _mm_cvtss_f32(lanes.v); }
+
+#else
+		struct Lanes { float v[4]; };
+
+		inline Lanes Set(float value) { return { { value, value, value, value } }; }
+		inline Lanes Load(const float* pValues) { return { { pValues[0], pValues[1], pValues[2], pValues[3] } }; }
+		inline void Store(float* pValues, Lanes lanes) { std::copy(lanes.v, lanes.v + 4, pValues); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { { lhs.v[0] + rhs.v[0], lhs.v[1] + rhs.v[1], lhs.v[2] + rhs.v[2], lhs.v[3] + rhs.v[3] } }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { { lhs.v[0] - rhs.v[0], lhs.v[1] - rhs.v[1], lhs.v[2] - rhs.v[2], lhs.v[3] - rhs.v[3] } }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { { lhs.v[0] * rhs.v[0], lhs.v[1] * rhs.v[1], lhs.v[2] * rhs.v[2], lhs.v[3] * rhs.v[3] } }; }
+
+		inline Lanes SwapPairs(Lanes lanes) { return { { lanes.v[1], lanes.v[0], lanes.v[3], lanes.v[2] } }; }
+		inline Lanes SwapHalves(Lanes lanes) { return { { lanes.v[2], lanes.v[3], lanes.v[0], lanes.v[1] } }; }
+		inline float First(Lanes lanes) { return lanes.v[0]; }
+
+#endif // ENSD_SIMD_SSE2
+
+		/**
+		 * The sum of the four lanes, in every lane.
+		 */
+		inline Lanes Sum(Lanes lanes)
+		{
+			lanes = lanes + SwapPairs(lanes);
+			return lanes + SwapHalves(lanes);
+		}
+
+		/**
+		 * Multiply the lines by the unscaled Hadamard matrix with a fast Walsh-Hadamard transform. The first two stages
+		 * mix the lanes of every vector and the others mix whole vectors.
+		 */
+		inline void Hadamard(Lanes* pLines, uint32 vectorCount)
+		{
+			const Lanes pairSigns = Load(LeftSigns);
+			const Lanes halfSigns = Load(RightSigns);
+			for (uint32 v = 0; v < vectorCount; v++)
+			{
+				pLines[v] = SwapPairs(pLines[v]) + pLines[v] * pairSigns;
+				pLines[v] = SwapHalves(pLines[v]) + pLines[v] * halfSigns;
+			}
+
+			for (uint32 half = 1; half < vectorCount; half *= 2)
+			{
+				for (uint32 v = 0; v < vectorCount; v += half * 2)
+				{
+					for (uint32 i = v; i < v + half; i++)
+					{
+						const Lanes first = pLines[i];
+						pLines[i] = first + pLines[i + half];
+						pLines[i + half] = first - pLines[i + half];
+					}
+				}
+			}
+		}
+
+		/**
+		 * Compute the inputs of the lines of a network made of the first vectors of lines: the lines mixed through
+		 * the feedback matrix, plus the input. The Hadamard matrix is scaled by 1 / sqrt(N) and the Householder matrix
+		 * by -2 / N, which makes them orthogonal. The lines outside the network keep their outputs.
+		 */
+		inline void ComputeFeeds(const Lanes* pLines, Lanes* pFeeds, uint32 networkVectors, uint32 vectorCount, bool isHadamard, Lanes scale, Lanes diffusion, Lanes input, const Lanes* pInputSigns)
+		{
+			if (isHadamard)
+			{
+				std::copy(pLines, pLines + networkVectors, pFeeds);
+				Hadamard(pFeeds, networkVectors);
+				for (uint32 v = 0; v < networkVectors; v++)
+					pFeeds[v] = pFeeds[v] * scale;
+			}
+			else
+			{
+				Lanes total = pLines[0];
+				for (uint32 v = 1; v < networkVectors; v++)
+					total = total + pLines[v];
+
+				total = Sum(total) * scale;
+				for (uint32 v = 0; v < networkVectors; v++)
+					pFeeds[v] = pLines[v] + total;
+			}
+
+			for (uint32 v = 0; v < networkVectors; v++)
+				pFeeds[v] = pLines[v] + (pFeeds[v] - pLines[v]) * diffusion + input * pInputSigns[v];
+
+			for (uint32 v = networkVectors; v < vectorCount; v++)
+				pFeeds[v] = pLines[v];
+		}
+	}
+
+	void FDNReverb::Initialize(const FDNReverbDescription& description)
+	{
+		Terminate();
+
+		mDescription = description;
+		mDescription.mLineCount = description.mLineCount > 8 ? MaxLineCount : 8;
+		mDescription.mBlockFrames = std::max(description.mBlockFrames, 1U);
+
+		// The lines hold the longest delay at the largest size, rounded up to a power of two for masking.
+		const uint32 lineCount = mDescription.mLineCount;
+		const float rateScale = static_cast<float>(description.mSampleRate) / 48000.0f;
+		const uint32 stride = MaxLineCount / lineCount;
+		float longest = 0.0f;
+		for (uint32 i = 0; i < lineCount; i++)
+		{
+			mBaseDelays[i] = BaseDelays[i * stride] * rateScale;
+			longest = std::max(longest, mBaseDelays[i] * MaxSizeScale);
+		}
+
+		uint32 lineSize = 1;
+		while (lineSize < static_cast<uint32>(longest) + 2)
+			lineSize *= 2;
+
+		mLineMask = lineSize - 1;
+		mLines.resize(static_cast<uint64>(lineSize) * lineCount);
+		mTaps.resize(static_cast<uint64>(ChunkFrames) * lineCount);
+		mFeeds.resize(static_cast<uint64>(ChunkFrames) * lineCount);
+		mInput.resize(mDescription.mBlockFrames);
+		mWet.resize(static_cast<uint64>(ChunkFrames) * 2);
+		mRamps.resize(static_cast<uint64>(mDescription.mBlockFrames) * 2);
+
+		mParameters = description.mParameters;
+		ComputeLineState(mParameters, mPrevious);
+		mTarget = mPrevious;
+
+		mLineCount = mPreviousLineCount = lineCount;
+		mWetGain = mPreviousWetGain = description.mWetGain;
+		mDryGain = mPreviousDryGain = description.mDryGain;
+		Reset();
+	}
+
+	void FDNReverb::Terminate()
+	{
+		mLines.clear();
+		mTaps.clear();
+		mFeeds.clear();
+		mInput.clear();
+		mWet.clear();
+		mRamps.clear();
+		mDescription = {};
+	}
+
+	void FDNReverb::Reset()
+	{
+		std::fill(mLines.begin(), mLines.end(), 0.0f);
+		std::fill(mFilterStates, mFilterStates + MaxLineCount, 0.0f);
+		mWritePosition = 0;
+		mSilentFrames = GetTailFrames();
+		mPreviousLineCount = mLineCount;
+	}
+
+	void FDNReverb::SetLineCount(uint32 count)
+	{
+		mLineCount = count > 8 ? mDescription.mLineCount : 8;
+	}
+
+	void FDNReverb::Process(float* pBuffer, uint32 frameCount, uint32 channelCount)
+	{
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		if (channelCount != mDescription.mChannelCount || frameCount > blockFrames || !frameCount || mLines.empty())
+			return;
+
+		// The network is fed with the average of the channels.
+		const float channelScale = 1.0f / channelCount;
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			float sum = 0.0f;
+			for (uint32 c = 0; c < channelCount; c++)
+				sum += pBuffer[static_cast<uint64>(frame) * channelCount + c];
+
+			mInput[frame] = sum * channelScale;
+		}
+
+		if (ComputePeak(mInput.data(), frameCount) > SilenceThreshold)
+			mSilentFrames = 0;
+		else
+			mSilentFrames += frameCount;
+
+		ComputeLineState(mParameters, mTarget);
+
+		// Lines which join the network start empty, whatever they held when they last left it.
+		if (mLineCount > mPreviousLineCount)
+		{
+			const uint64 lineSize = static_cast<uint64>(mLineMask) + 1;
+			std::fill(mLines.begin() + mPreviousLineCount * lineSize, mLines.begin() + mLineCount * lineSize, 0.0f);
+			std::fill(mFilterStates + mPreviousLineCount, mFilterStates + mLineCount, 0.0f);
+		}
+
+		// A chunk must not read frames it writes, so it is never longer than the shortest delay of the block.
+		float shortest = static_cast<float>(ChunkFrames);
+		for (uint32 i = 0; i < std::max(mLineCount, mPreviousLineCount); i++)
+			shortest = std::min(shortest, std::min(mPrevious.mDelays[i], mTarget.mDelays[i]));
+
+		const uint32 chunkFrames = std::max(static_cast<uint32>(shortest), 1U);
+
+		float* pWetRamp = mRamps.data();
+		float* pDryRamp = pWetRamp + blockFrames;
+		ComputeRamp(pWetRamp, mPreviousWetGain, mWetGain, 0, frameCount, frameCount, RampCurve::RAMP_CURVE_LINEAR);
+		ComputeRamp(pDryRamp, mPreviousDryGain, mDryGain, 0, frameCount, frameCount, RampCurve::RAMP_CURVE_LINEAR);
+
+		for (uint32 offset = 0; offset < frameCount; offset += chunkFrames)
+		{
+			const uint32 count = std::min(chunkFrames, frameCount - offset);
+			ProcessChunk(mInput.data() + offset, mWet.data(), offset, count, frameCount);
+
+			for (uint32 frame = 0; frame < count; frame++)
+			{
+				float* pFrame = pBuffer + static_cast<uint64>(offset + frame) * channelCount;
+				const float wetGain = pWetRamp[offset + frame];
+				const float dryGain = pDryRamp[offset + frame];
+
+				for (uint32 c = 0; c < channelCount; c++)
+					pFrame[c] = pFrame[c] * dryGain + mWet[static_cast<uint64>(c % 2) * ChunkFrames + frame] * wetGain;
+			}
+		}
+
+		mPrevious = mTarget;
+		mPreviousLineCount = mLineCount;
+		mPreviousWetGain = mWetGain;
+		mPreviousDryGain = mDryGain;
+	}
+
+	bool FDNReverb::IsTailSilent() const
+	{
+		return mLines.empty() || mSilentFrames >= GetTailFrames();
+	}
+
+	uint64 FDNReverb::GetTailFrames() const
+	{
+		// The last sound may still be in the longest line before it starts decaying.
+		return static_cast<uint64>(2.0f * std::max(mParameters.mDecayTime, 0.0f) * mDescription.mSampleRate) + mLineMask + 1;
+	}
+
+	void FDNReverb::ComputeLineState(const FDNReverbParameters& parameters, LineState& state) const
+	{
+		const float size = std::clamp(parameters.mSize, 0.0f, 1.0f);
+		const float scale = MinSizeScale * std::pow(MaxSizeScale / MinSizeScale, size);
+		const float decayFrames = std::max(parameters.mDecayTime, 0.01f) * mDescription.mSampleRate;
+
+		for (uint32 i = 0; i < mDescription.mLineCount; i++)
+		{
+			// Every pass through a line of d frames loses d / decayFrames of the 60 dB.
+			state.mDelays[i] = mBaseDelays[i] * scale;
+			state.mGains[i] = std::pow(10.0f, -3.0f * state.mDelays[i] / decayFrames);
+		}
+
+		state.mDamping = std::clamp(parameters.mDamping, 0.0f, 1.0f) * MaxDamping;
+		state.mDiffusion = std::clamp(parameters.mDiffusion, 0.0f, 1.0f);
+	}
+
+	void FDNReverb::ProcessChunk(const float* pInput, float* pOutput, uint32 blockOffset, uint32 frameCount, uint32 blockFrames)
+	{
+		const uint32 lineCount = std::max(mLineCount, mPreviousLineCount);
+		const uint32 vectorCount = lineCount / 4;
+		const uint64 lineSize = static_cast<uint64>(mLineMask) + 1;
+		const float rampStep = 1.0f / blockFrames;
+
+		// Read the outputs of the chunk line by line, gliding the delays across the block.
+		for (uint32 i = 0; i < lineCount; i++)
+		{
+			const float* pLine = mLines.data() + i * lineSize;
+			const float startDelay = mPrevious.mDelays[i];
+			const float delayStep = (mTarget.mDelays[i] - startDelay) * rampStep;
+
+			for (uint32 frame = 0; frame < frameCount; frame++)
+			{
+				const float delay = startDelay + delayStep * (blockOffset + frame + 1);
+				const uint32 whole = static_cast<uint32>(delay);
+				const float fraction = delay - whole;
+				const uint64 index = mWritePosition + frame - whole;
+
+				mTaps[static_cast<uint64>(frame) * lineCount + i] = pLine[index & mLineMask] + (pLine[(index - 1) & mLineMask] - pLine[index & mLineMask]) * fraction;
+			}
+		}
+
+		// Damp, decay and mix the lines frame by frame, four lines at a time.
+		Lanes states[MaxLineCount / 4] = {};
+		Lanes gains[MaxLineCount / 4] = {};
+		Lanes gainSteps[MaxLineCount / 4] = {};
+		Lanes inputSigns[MaxLineCount / 4] = {};
+		for (uint32 v = 0; v < vectorCount; v++)
+		{
+			const Lanes previousGains = Load(mPrevious.mGains + v * 4);
+			gainSteps[v] = (Load(mTarget.mGains + v * 4) - previousGains) * Set(rampStep);
+			gains[v] = previousGains + gainSteps[v] * Set(static_cast<float>(blockOffset));
+			states[v] = Load(mFilterStates + v * 4);
+			inputSigns[v] = Load(InputSigns[v]);
+		}
+
+		const Lanes dampingStep = Set((mTarget.mDamping - mPrevious.mDamping) * rampStep);
+		const Lanes diffusionStep = Set((mTarget.mDiffusion - mPrevious.mDiffusion) * rampStep);
+		Lanes damping = Set(mPrevious.mDamping) + dampingStep * Set(static_cast<float>(blockOffset));
+		Lanes diffusion = Set(mPrevious.mDiffusion) + diffusionStep * Set(static_cast<float>(blockOffset));
+
+		const Lanes leftSigns = Load(LeftSigns);
+		const Lanes rightSigns = Load(RightSigns);
+		const Lanes denormalOffset = Set(DenormalOffset);
+		const bool isHadamard = mDescription.mMatrix == FDNMatrix::FDN_MATRIX_HADAMARD;
+
+		// A line count change crossfades the feeds and the outputs of the old and new networks across the block.
+		const uint32 previousVectors = mPreviousLineCount / 4;
+		const uint32 targetVectors = mLineCount / 4;
+		const uint32 lowerVectors = std::min(previousVectors, targetVectors);
+		const bool isSwitching = previousVectors != targetVectors;
+		const Lanes previousScale = Set(isHadamard ? 1.0f / std::sqrt(static_cast<float>(mPreviousLineCount)) : -2.0f / mPreviousLineCount);
+		const Lanes targetScale = Set(isHadamard ? 1.0f / std::sqrt(static_cast<float>(mLineCount)) : -2.0f / mLineCount);
+		const Lanes previousOutputScale = Set(1.0f / std::sqrt(static_cast<float>(mPreviousLineCount)));
+		const Lanes targetOutputScale = Set(1.0f / std::sqrt(static_cast<float>(mLineCount)));
+		const Lanes fadeStep = Set(rampStep);
+		Lanes fade = Set(rampStep * blockOffset);
+
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			float* pTaps = mTaps.data() + static_cast<uint64>(frame) * lineCount;
+			float* pFeeds = mFeeds.data() + static_cast<uint64>(frame) * lineCount;
+			damping = damping + dampingStep;
+			diffusion = diffusion + diffusionStep;
+			fade = fade + fadeStep;
+
+			// The left and right sums of the lines both networks share, and of the lines only the larger one has.
+			Lanes left = Set(0.0f);
+			Lanes right = Set(0.0f);
+			Lanes upperLeft = Set(0.0f);
+			Lanes upperRight = Set(0.0f);
+			Lanes lines[MaxLineCount / 4] = {};
+			for (uint32 v = 0; v < vectorCount; v++)
+			{
+				const Lanes taps = Load(pTaps + v * 4);
+				if (v < lowerVectors)
+				{
+					left = left + taps * leftSigns;
+					right = right + taps * rightSigns;
+				}
+				else
+				{
+					upperLeft = upperLeft + taps * leftSigns;
+					upperRight = upperRight + taps * rightSigns;
+				}
+
+				gains[v] = gains[v] + gainSteps[v];
+				states[v] = taps + (states[v] - taps) * damping + denormalOffset;
+				lines[v] = states[v] * gains[v];
+			}
+
+			const Lanes input = Set(pInput[frame]);
+			Lanes feeds[MaxLineCount / 4] = {};
+			ComputeFeeds(lines, feeds, targetVectors, vectorCount, isHadamard, targetScale, diffusion, input, inputSigns);
+
+			Lanes outputLeft = (targetVectors > lowerVectors ? left + upperLeft : left) * targetOutputScale;
+			Lanes outputRight = (targetVectors > lowerVectors ? right + upperRight : right) * targetOutputScale;
+			if (isSwitching)
+			{
+				Lanes previousFeeds[MaxLineCount / 4] = {};
+				ComputeFeeds(lines, previousFeeds, previousVectors, vectorCount, isHadamard, previousScale, diffusion, input, inputSigns);
+				for (uint32 v = 0; v < vectorCount; v++)
+					feeds[v] = previousFeeds[v] + (feeds[v] - previousFeeds[v]) * fade;
+
+				const Lanes previousLeft = (previousVectors > lowerVectors ? left + upperLeft : left) * previousOutputScale;
+				const Lanes previousRight = (previousVectors > lowerVectors ? right + upperRight : right) * previousOutputScale;
+				outputLeft = previousLeft + (outputLeft - previousLeft) * fade;
+				outputRight = previousRight + (outputRight - previousRight) * fade;
+			}
+
+			for (uint32 v = 0; v < vectorCount; v++)
+				Store(pFeeds + v * 4, feeds[v]);
+
+			pOutput[frame] = First(Sum(outputLeft));
+			pOutput[ChunkFrames + frame] = First(Sum(outputRight));
+		}
+
+		for (uint32 v = 0; v < vectorCount; v++)
+			Store(mFilterStates + v * 4, states[v]);
+
+		// Write the inputs of the chunk line by line.
+		for (uint32 i = 0; i < lineCount; i++)
+		{
+			float* pLine = mLines.data() + i * lineSize;
+			for (uint32 frame = 0; frame < frameCount; frame++)
+				pLine[(mWritePosition + frame) & mLineMask] = mFeeds[static_cast<uint64>(frame) * lineCount + i];
+		}
+
+		mWritePosition += frameCount;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,554 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Formats/SeekTable.h"
+#include "Core/Formats/WAV/Format.h"
+#include "Core/Error/Logger.h"
+
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace EnSound
+{
+	namespace
+	{
+		const uint32 SeekTableTag = MAKE_TAG('E', 'S', 'K', 'T');
+		const uint32 SeekTableVersion = 1;
+
+#pragma pack(push, 1)
+		/**
+		 * Seek Table Header structure.
+		 * This is the header of a serialized seek table, which is followed by the seek points.
+		 */
+		struct SeekTableHeader {
+			uint32 mTag = SeekTableTag;
+			uint32 mVersion = SeekTableVersion;
+			uint32 mFileType = 0;
+			uint32 mFrameInterval = 0;
+			uint64 mFrameCount = 0;
+			uint64 mPointCount = 0;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(SeekTableHeader) == 32, "SeekTableHeader structure size mismatch!");
+
+		/**
+		 * MPEG Audio Frame structure.
+		 */
+		struct MPEGFrame {
+			uint32 mFrameBytes = 0;
+			uint32 mSamples = 0;
+			uint32 mSideInfoOffset = 0;
+		};
+
+		const uint16 MPEGBitRates[5][15] = {
+			{ 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },	// MPEG 1, Layer I
+			{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },		// MPEG 1, Layer II
+			{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },		// MPEG 1, Layer III
+			{ 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },		// MPEG 2/2.5, Layer I
+			{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },			// MPEG 2/2.5, Layer II and III
+		};
+
+		const uint32 MPEGSampleRates[3] = { 44100, 48000, 32000 };
+
+		/**
+		 * Parse an MPEG audio frame header.
+		 *
+		 * @return Boolean stating if the header is valid.
+		 */
+		bool ParseMPEGFrame(const uint8* ptr, MPEGFrame& frame)
+		{
+			if (ptr[0] != 0xFF || (ptr[1] & 0xE0) != 0xE0)
+				return false;
+
+			const uint8 version = (ptr[1] >> 3) & 0x03;	// 0 = MPEG 2.5, 2 = MPEG 2, 3 = MPEG 1.
+			const uint8 layer = 4 - ((ptr[1] >> 1) & 0x03);	// 1, 2 or 3. 4 is reserved.
+			const uint8 bitRateIndex = ptr[2] >> 4;
+			const uint8 sampleRateIndex = (ptr[2] >> 2) & 0x03;
+			const uint32 padding = (ptr[2] >> 1) & 0x01;
+			const bool isMono = (ptr[3] >> 6) == 0x03;
+			const bool hasCRC = !(ptr[1] & 0x01);
+
+			// Free format bit rates are not indexed.
+			if (version == 1 || layer == 4 || bitRateIndex == 0 || bitRateIndex == 15 || sampleRateIndex == 3)
+				return false;
+
+			const bool isMPEG1 = version == 3;
+			const uint32 bitRate = MPEGBitRates[isMPEG1 ? layer - 1 : (layer == 1 ? 3 : 4)][bitRateIndex] * 1000;
+			const uint32 sampleRate = MPEGSampleRates[sampleRateIndex] >> (isMPEG1 ? 0 : (version == 2 ? 1 : 2));
+
+			if (layer == 1)
+			{
+				frame.mFrameBytes = (12 * bitRate / sampleRate + padding) * 4;
+				frame.mSamples = 384;
+			}
+			else
+			{
+				const uint32 samples = (layer == 3 && !isMPEG1) ? 576 : 1152;
+				frame.mFrameBytes = samples / 8 * bitRate / sampleRate + padding;
+				frame.mSamples = samples;
+			}
+
+			const uint32 sideInfo = isMPEG1 ? (isMono ? 17 : 32) : (isMono ? 9 : 17);
+			frame.mSideInfoOffset = 4 + (hasCRC ? 2 : 0) + sideInfo;
+			return true;
+		}
+
+		/**
+		 * Scan the frames of an MP3 file.
+		 */
+		bool ScanMP3(const uint8* pData, uint64 dataSize, Vector<SeekPoint>& points, uint64& frameCount)
+		{
+			uint64 offset = 0;
+
+			// Skip the ID3v2 tag.
+			if (dataSize >= 10 && std::memcmp(pData, "ID3", 3) == 0)
+			{
+				offset = 10 + ((static_cast<uint64>(pData[6] & 0x7F) << 21) | ((pData[7] & 0x7F) << 14) | ((pData[8] & 0x7F) << 7) | (pData[9] & 0x7F));
+				if (pData[5] & 0x10)
+					offset += 10;
+			}
+
+			bool isFirstFrame = true;
+			MPEGFrame frame = {}, nextFrame = {};
+			while (offset + 4 <= dataSize)
+			{
+				if (!ParseMPEGFrame(pData + offset, frame) || offset + frame.mFrameBytes > dataSize)
+				{
+					offset++;
+					continue;
+				}
+
+				// Require the next frame to be valid as well, to reject false syncs inside the audio data.
+				const uint64 next = offset + frame.mFrameBytes;
+				if (next + 4 <= dataSize && !ParseMPEGFrame(pData + next, nextFrame))
+				{
+					offset++;
+					continue;
+				}
+
+				// The Xing/ Info/ VBRI frame only holds encoder information and decodes to nothing.
+				const bool isInfoFrame = isFirstFrame && frame.mFrameBytes >= frame.mSideInfoOffset + 4 &&
+					(std::memcmp(pData + offset + frame.mSideInfoOffset, "Xing", 4) == 0 ||
+						std::memcmp(pData + offset + frame.mSideInfoOffset, "Info", 4) == 0 ||
+						(frame.mFrameBytes >= 40 && std::memcmp(pData + offset + 36, "VBRI", 4) == 0));
+
+				if (!isInfoFrame)
+				{
+					points.insert(points.end(), { frameCount, offset });
+					frameCount += frame.mSamples;
+				}
+
+				isFirstFrame = false;
+				offset = next;
+			}
+
+			return !points.empty();
+		}
+
+		/**
+		 * Scan the pages of an OGG file.
+		 * Only the first logical stream is indexed.
+		 */
+		bool ScanOGG(const uint8* pData, uint64 dataSize, Vector<SeekPoint>& points, uint64& frameCount)
+		{
+			const uint64 noGranule = ~0ULL;
+
+			uint64 offset = 0;
+			uint32 streamSerial = 0;
+			bool hasSerial = false;
+
+			while (offset + 27 <= dataSize)
+			{
+				const uint8* pPage = pData + offset;
+				if (std::memcmp(pPage, "OggS", 4) != 0 || pPage[4] != 0)
+				{
+					offset++;
+					continue;
+				}
+
+				const uint8 segmentCount = pPage[26];
+				if (offset + 27 + segmentCount > dataSize)
+					break;
+
+				uint64 pageBytes = 27 + static_cast<uint64>(segmentCount);
+				for (uint8 i = 0; i < segmentCount; i++)
+					pageBytes += pPage[27 + i];
+
+				uint64 granule = 0;
+				uint32 serial = 0;
+				std::memcpy(&granule, pPage + 6, sizeof(uint64));
+				std::memcpy(&serial, pPage + 14, sizeof(uint32));
+
+				if (!hasSerial)
+				{
+					streamSerial = serial;
+					hasSerial = true;
+				}
+
+				// The granule position is the number of frames completed at the end of the page. Pages without any
+				// completed packet carry -1, and the header pages complete no audio.
+				if (serial == streamSerial && granule != noGranule && granule > frameCount)
+				{
+					points.insert(points.end(), { frameCount, offset });
+					frameCount = granule;
+				}
+
+				offset += pageBytes;
+			}
+
+			return !points.empty();
+		}
+
+		/**
+		 * Calculate the CRC-8 of a FLAC frame header (polynomial x^8 + x^2 + x^1 + 1).
+		 */
+		uint8 CalculateCRC8(const uint8* pData, uint64 dataSize)
+		{
+			uint8 crc = 0;
+			for (uint64 i = 0; i < dataSize; i++)
+			{
+				crc ^= pData[i];
+				for (uint8 bit = 0; bit < 8; bit++)
+					crc = static_cast<uint8>((crc & 0x80) ? (crc << 1) ^ 0x07 : crc << 1);
+			}
+
+			return crc;
+		}
+
+		/**
+		 * Update the CRC-16 of a FLAC frame with a byte (polynomial x^16 + x^15 + x^2 + 1).
+		 * The CRC of a whole frame, its stored CRC included, is 0.
+		 */
+		inline uint16 UpdateCRC16(uint16 crc, uint8 byte)
+		{
+			static const Vector<uint16> table = []() {
+				Vector<uint16> result(256);
+				for (uint32 i = 0; i < 256; i++)
+				{
+					uint16 entry = static_cast<uint16>(i << 8);
+					for (uint8 bit = 0; bit < 8; bit++)
+						entry = static_cast<uint16>((entry & 0x8000) ? (entry << 1) ^ 0x8005 : entry << 1);
+
+					result[i] = entry;
+				}
+
+				return result;
+			}();
+
+			return static_cast<uint16>((crc << 8) ^ table[(crc >> 8) ^ byte]);
+		}
+
+		/**
+		 * Parse a FLAC frame header.
+		 *
+		 * @return The number of header bytes. 0 if the header is invalid.
+		 */
+		uint32 ParseFLACFrameHeader(const uint8* ptr, uint64 available, uint64& number, bool& isVariable)
+		{
+			if (available < 6 || ptr[0] != 0xFF || (ptr[1] & 0xFE) != 0xF8)
+				return 0;
+
+			const uint8 blockSizeCode = ptr[2] >> 4;
+			const uint8 sampleRateCode = ptr[2] & 0x0F;
+			const uint8 channelCode = ptr[3] >> 4;
+			const uint8 sampleSizeCode = (ptr[3] >> 1) & 0x07;
+
+			if (blockSizeCode == 0 || sampleRateCode == 15 || channelCode > 10 || sampleSizeCode == 3 || sampleSizeCode == 7 || (ptr[3] & 0x01))
+				return 0;
+
+			// Frame/ sample number, stored as an extended UTF-8 sequence.
+			uint32 length = 0;
+			uint8 lead = ptr[4];
+			if (!(lead & 0x80)) { number = lead; length = 1; }
+			else if ((lead & 0xE0) == 0xC0) { number = lead & 0x1F; length = 2; }
+			else if ((lead & 0xF0) == 0xE0) { number = lead & 0x0F; length = 3; }
+			else if ((lead & 0xF8) == 0xF0) { number = lead & 0x07; length = 4; }
+			else if ((lead & 0xFC) == 0xF8) { number = lead & 0x03; length = 5; }
+			else if ((lead & 0xFE) == 0xFC) { number = lead & 0x01; length = 6; }
+			else if (lead == 0xFE) { number = 0; length = 7; }
+			else return 0;
+
+			uint64 size = 4 + length;
+			if (size + 1 > available)
+				return 0;
+
+			for (uint32 i = 1; i < length; i++)
+			{
+				if ((ptr[4 + i] & 0xC0) != 0x80)
+					return 0;
+
+				number = (number << 6) | (ptr[4 + i] & 0x3F);
+			}
+
+			if (blockSizeCode == 6) size += 1;
+			else if (blockSizeCode == 7) size += 2;
+
+			if (sampleRateCode == 12) size += 1;
+			else if (sampleRateCode == 13 || sampleRateCode == 14) size += 2;
+
+			if (size + 1 > available || CalculateCRC8(ptr, size) != ptr[size])
+				return 0;
+
+			isVariable = ptr[1] & 0x01;
+			return static_cast<uint32>(size + 1);
+		}
+
+		/**
+		 * Find the end of a FLAC frame, where its CRC-16 checks out and the next frame header or the end of the data
+		 * follows. Frame headers are only protected by a CRC-8, so this is what tells a real frame from a false sync.
+		 *
+		 * @return The offset of the end of the frame. 0 if the frame is not valid.
+		 */
+		uint64 FindFLACFrameEnd(const uint8* pData, uint64 dataSize, uint64 offset, uint32 headerBytes, uint64 maxFrameBytes)
+		{
+			uint64 number = 0;
+			bool isVariable = false;
+			uint16 crc = 0;
+
+			const uint64 end = maxFrameBytes && offset + maxFrameBytes < dataSize ? offset + maxFrameBytes : dataSize;
+			for (uint64 position = offset; position < end; position++)
+			{
+				crc = UpdateCRC16(crc, pData[position]);
+
+				// The stored CRC follows the header and at least one byte of subframes.
+				const uint64 next = position + 1;
+				if (crc || next < offset + headerBytes + 3)
+					continue;
+
+				if (next == dataSize || ParseFLACFrameHeader(pData + next, dataSize - next, number, isVariable))
+					return next;
+			}
+
+			return 0;
+		}
+
+		/**
+		 * Scan the frames of a FLAC file.
+		 */
+		bool ScanFLAC(const uint8* pData, uint64 dataSize, Vector<SeekPoint>& points, uint64& frameCount)
+		{
+			if (dataSize < 42 || std::memcmp(pData, "fLaC", 4) != 0)
+				return false;
+
+			// Walk the metadata blocks. The first one is always STREAMINFO.
+			uint64 offset = 4;
+			uint32 fixedBlockSize = 0;
+			uint64 maxFrameBytes = 0;
+			uint64 totalSamples = 0;
+			bool isLastBlock = false;
+
+			while (!isLastBlock && offset + 4 <= dataSize)
+			{
+				const uint8* pBlock = pData + offset;
+				const uint32 blockBytes = (pBlock[1] << 16) | (pBlock[2] << 8) | pBlock[3];
+				isLastBlock = pBlock[0] & 0x80;
+
+				if ((pBlock[0] & 0x7F) == 0 && blockBytes >= 34 && offset + 4 + blockBytes <= dataSize)
+				{
+					const uint8* pInfo = pBlock + 4;
+					const uint32 minBlockSize = (pInfo[0] << 8) | pInfo[1];
+					const uint32 maxBlockSize = (pInfo[2] << 8) | pInfo[3];
+					if (minBlockSize == maxBlockSize)
+						fixedBlockSize = maxBlockSize;
+
+					// 0 if the encoder did not know the largest frame, in which case frames are checked up to the end.
+					maxFrameBytes = (static_cast<uint64>(pInfo[7]) << 16) | (pInfo[8] << 8) | pInfo[9];
+
+					totalSamples = (static_cast<uint64>(pInfo[13] & 0x0F) << 32) | (static_cast<uint64>(pInfo[14]) << 24) | (pInfo[15] << 16) | (pInfo[16] << 8) | pInfo[17];
+				}
+
+				offset += 4 + static_cast<uint64>(blockBytes);
+			}
+
+			uint64 number = 0;
+			bool isVariable = false;
+			while (offset + 2 <= dataSize)
+			{
+				const uint32 headerBytes = ParseFLACFrameHeader(pData + offset, dataSize - offset, number, isVariable);
+				if (!headerBytes || (!isVariable && !fixedBlockSize))
+				{
+					offset++;
+					continue;
+				}
+
+				const uint64 frameEnd = FindFLACFrameEnd(pData, dataSize, offset, headerBytes, maxFrameBytes);
+				if (!frameEnd)
+				{
+					offset++;
+					continue;
+				}
+
+				// Frame headers carry the frame number on fixed block size streams and the sample number otherwise.
+				const uint64 frame = isVariable ? number : number * fixedBlockSize;
+				if (points.empty() || frame > points.back().mFrame)
+					points.insert(points.end(), { frame, offset });
+
+				offset = frameEnd;
+			}
+
+			frameCount = totalSamples ? totalSamples : (points.empty() ? 0 : points.back().mFrame + fixedBlockSize);
+			return !points.empty();
+		}
+	}
+
+	bool SeekTable::Build(AudioFileType type, const uint8* pData, uint64 dataSize, uint32 frameInterval)
+	{
+		Clear();
+
+		if (!pData || !frameInterval)
+			return false;
+
+		Vector<SeekPoint> packets;
+		uint64 frameCount = 0;
+		bool result = false;
+
+		switch (type)
+		{
+		case AudioFileType::AUDIO_FILE_TYPE_MP3:
+			result = ScanMP3(pData, dataSize, packets, frameCount);
+			break;
+
+		case AudioFileType::AUDIO_FILE_TYPE_OGG:
+			result = ScanOGG(pData, dataSize, packets, frameCount);
+			break;
+
+		case AudioFileType::AUDIO_FILE_TYPE_FLAC:
+			result = ScanFLAC(pData, dataSize, packets, frameCount);
+			break;
+
+		default:
+			Logger::LogError(STRING("Seek tables can only be built for MP3, OGG and FLAC files!"));
+			return false;
+		}
+
+		if (!result)
+		{
+			Logger::LogError(STRING("Failed to find any packets to build the seek table from!"));
+			return false;
+		}
+
+		// Resample the packets to a fixed interval so that a lookup is a single index.
+		const uint64 entryCount = frameCount / frameInterval + 1;
+		mSeekPoints.resize(entryCount);
+
+		uint64 packet = 0;
+		for (uint64 entry = 0; entry < entryCount; entry++)
+		{
+			const uint64 frame = entry * frameInterval;
+			while (packet + 1 < packets.size() && packets[packet + 1].mFrame <= frame)
+				packet++;
+
+			mSeekPoints[entry] = packets[packet];
+		}
+
+		mFrameCount = frameCount;
+		mFrameInterval = frameInterval;
+		mFileType = type;
+		return true;
+	}
+
+	void SeekTable::Clear()
+	{
+		mSeekPoints.clear();
+		mFrameCount = 0;
+		mFrameInterval = 0;
+		mFileType = AudioFileType::AUDIO_FILE_TYPE_UNKNOWN;
+	}
+
+	SeekPoint SeekTable::Find(uint64 frame) const
+	{
+		if (mSeekPoints.empty())
+			return {};
+
+		const uint64 entry = frame / mFrameInterval;
+		SeekPoint point = mSeekPoints[entry < mSeekPoints.size() ? entry : mSeekPoints.size() - 1];
+
+		// The first packet can start after frame 0, such as after an encoder delay or in a stream cut mid-file. Frames
+		// before it are decoded from the first packet with nothing to discard.
+		if (point.mFrame > frame)
+			point.mFrame = frame;
+
+		return point;
+	}
+
+	void SeekTable::Serialize(Vector<uint8>& output) const
+	{
+		SeekTableHeader header = {};
+		header.mFileType = static_cast<uint32>(mFileType);
+		header.mFrameInterval = mFrameInterval;
+		header.mFrameCount = mFrameCount;
+		header.mPointCount = mSeekPoints.size();
+
+		const uint64 pointBytes = mSeekPoints.size() * sizeof(SeekPoint);
+		output.resize(sizeof(SeekTableHeader) + pointBytes);
+
+		std::memcpy(output.data(), &header, sizeof(SeekTableHeader));
+		if (pointBytes)
+			std::memcpy(output.data() + sizeof(SeekTableHeader), mSeekPoints.data(), pointBytes);
+	}
+
+	bool SeekTable::Deserialize(const uint8* pData, uint64 dataSize)
+	{
+		Clear();
+
+		if (!pData || dataSize < sizeof(SeekTableHeader))
+			return false;
+
+		SeekTableHeader header = {};
+		std::memcpy(&header, pData, sizeof(SeekTableHeader));
+
+		// The point count is checked by dividing, since a corrupt count can overflow the multiplication.
+		const uint64 pointBytes = dataSize - sizeof(SeekTableHeader);
+		if (header.mTag != SeekTableTag || header.mVersion != SeekTableVersion || !header.mFrameInterval ||
+			pointBytes % sizeof(SeekPoint) || header.mPointCount != pointBytes / sizeof(SeekPoint))
+			return false;
+
+		mSeekPoints.resize(header.mPointCount);
+		if (header.mPointCount)
+			std::memcpy(mSeekPoints.data(), pData + sizeof(SeekTableHeader), header.mPointCount * sizeof(SeekPoint));
+
+		mFrameCount = header.mFrameCount;
+		mFrameInterval = header.mFrameInterval;
+		mFileType = static_cast<AudioFileType>(header.mFileType);
+		return true;
+	}
+
+	bool SeekTable::SaveToFile(const wchar* pFileName) const
+	{
+		if (!pFileName)
+			return false;
+
+		Vector<uint8> bytes;
+		Serialize(bytes);
+
+		std::ofstream file(std::filesystem::path(pFileName), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Logger::LogError(STRING("Failed to open the seek table file for writing!"));
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return file.good();
+	}
+
+	bool SeekTable::LoadFromFile(const wchar* pFileName)
+	{
+		Clear();
+
+		if (!pFileName)
+			return false;
+
+		std::ifstream file(std::filesystem::path(pFileName), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		Vector<uint8> bytes(static_cast<uint64>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+
+		return file.good() && Deserialize(bytes.data(), bytes.size());
+	}
+}
\ No newline at end of file
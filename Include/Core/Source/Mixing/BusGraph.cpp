@@ -0,0 +1,762 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/BusGraph.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	// The bus constants are passed by reference (std::fill, Vector), so they need a definition.
+	const uint32 BusGraph::MasterBus;
+	const uint32 BusGraph::InvalidBus;
+	const uint32 BusGraph::MaxRateDivisor;
+
+	bool BusGraph::Initialize(const BusGraphDescription& description)
+	{
+		Terminate();
+
+		if (!description.mChannelCount || !description.mBlockFrames || !description.mMaxBusCount)
+		{
+			Logger::LogError(STRING("Invalid bus graph description!"));
+			return false;
+		}
+
+		mDescription = description;
+		mGainRampStarts.assign(description.mMaxBusCount, 1.0f);
+		mGainRampEnds.assign(description.mMaxBusCount, 1.0f);
+		mUpsamplerHistory.assign(static_cast<uint64>(description.mMaxBusCount) * StreamCount * UpsamplerStageCount * UpsamplerHistoryFrames * description.mChannelCount, 0.0f);
+		mUpsamplerFactors.assign(static_cast<uint64>(description.mMaxBusCount) * StreamCount, 1);
+
+		pBusGains = std::make_unique<std::atomic<float>[]>(description.mMaxBusCount);
+		for (uint32 i = 0; i < description.mMaxBusCount; i++)
+			pBusGains[i].store(1.0f, std::memory_order_relaxed);
+
+		Bus master = {};
+		master.mCreatedVersion = mCompiledVersion + 1;
+		master.mIsActive = true;
+		std::fill(master.mSends, master.mSends + BusInput::MaxSendCount, InvalidBus);
+		mBuses.insert(mBuses.end(), master);
+
+		Compile();
+		return true;
+	}
+
+	void BusGraph::Terminate()
+	{
+		mBuses.clear();
+		mFreeBuses.clear();
+
+		pBusGains.reset();
+		mGainRampStarts.clear();
+		mGainRampEnds.clear();
+		mUpsamplerHistory.clear();
+		mUpsamplerFactors.clear();
+
+		for (auto& schedule : mSchedules)
+			schedule = {};
+
+		mCompileSchedule = 0;
+		mRenderSchedule = 1;
+		mPublishedSchedule = 2;
+		mCompiledVersion = 0;
+		mRenderedVersion = 0;
+	}
+
+	uint32 BusGraph::CreateBus(uint32 outputBus)
+	{
+		if (!IsValidBus(outputBus))
+		{
+			Logger::LogError(STRING("The output bus does not exist!"));
+			return InvalidBus;
+		}
+
+		uint32 bus = static_cast<uint32>(mBuses.size());
+		if (!mFreeBuses.empty())
+		{
+			bus = mFreeBuses.back();
+			mFreeBuses.pop_back();
+		}
+		else if (bus < mDescription.mMaxBusCount)
+			mBuses.insert(mBuses.end(), Bus());
+		else
+		{
+			Logger::LogError(STRING("The maximum number of buses is reached!"));
+			return InvalidBus;
+		}
+
+		Bus& newBus = mBuses[bus];
+		newBus.mCreatedVersion = mCompiledVersion + 1;
+		newBus.mOutputBus = outputBus;
+		newBus.mSidechain = InvalidBus;
+		newBus.mRateDivisor = mBuses[outputBus].mRateDivisor;
+		newBus.mIsActive = true;
+		std::fill(newBus.mSends, newBus.mSends + BusInput::MaxSendCount, InvalidBus);
+
+		pBusGains[bus].store(1.0f, std::memory_order_relaxed);
+
+		mBuses[outputBus].mChildren.insert(mBuses[outputBus].mChildren.end(), bus);
+		return bus;
+	}
+
+	void BusGraph::DestroyBus(uint32 bus)
+	{
+		if (bus == MasterBus || !IsValidBus(bus))
+			return;
+
+		Bus& oldBus = mBuses[bus];
+		Bus& output = mBuses[oldBus.mOutputBus];
+		output.mChildren.erase(std::find(output.mChildren.begin(), output.mChildren.end(), bus));
+
+		for (auto child : oldBus.mChildren)
+		{
+			mBuses[child].mOutputBus = oldBus.mOutputBus;
+			output.mChildren.insert(output.mChildren.end(), child);
+		}
+
+		// Nothing sends to, or is keyed by, a destroyed bus.
+		for (auto& other : mBuses)
+		{
+			std::replace(other.mSends, other.mSends + BusInput::MaxSendCount, bus, InvalidBus);
+			if (other.mSidechain == bus)
+				other.mSidechain = InvalidBus;
+		}
+
+		oldBus.mInputs.clear();
+		oldBus.mEffects.clear();
+		oldBus.mChildren.clear();
+		std::fill(oldBus.mSends, oldBus.mSends + BusInput::MaxSendCount, InvalidBus);
+		oldBus.mSidechain = InvalidBus;
+		oldBus.mIsActive = false;
+
+		mFreeBuses.insert(mFreeBuses.end(), bus);
+	}
+
+	bool BusGraph::SetBusOutput(uint32 bus, uint32 outputBus)
+	{
+		if (bus == MasterBus || !IsValidBus(bus) || !IsValidBus(outputBus))
+			return false;
+
+		// The new output must not be the bus itself or anything the bus is rendered after.
+		if (outputBus == bus || DependsOn(bus, outputBus))
+		{
+			Logger::LogError(STRING("Setting the bus output would create a cycle!"));
+			return false;
+		}
+
+		if (mBuses[bus].mRateDivisor < mBuses[outputBus].mRateDivisor)
+		{
+			Logger::LogError(STRING("A bus cannot mix into a bus with a lower rate!"));
+			return false;
+		}
+
+		Bus& oldOutput = mBuses[mBuses[bus].mOutputBus];
+		oldOutput.mChildren.erase(std::find(oldOutput.mChildren.begin(), oldOutput.mChildren.end(), bus));
+
+		mBuses[outputBus].mChildren.insert(mBuses[outputBus].mChildren.end(), bus);
+		mBuses[bus].mOutputBus = outputBus;
+		return true;
+	}
+
+	bool BusGraph::SetSend(uint32 bus, uint32 slot, uint32 sendBus)
+	{
+		if (!IsValidBus(bus) || slot >= BusInput::MaxSendCount)
+			return false;
+
+		if (sendBus == InvalidBus)
+		{
+			mBuses[bus].mSends[slot] = InvalidBus;
+			return true;
+		}
+
+		if (!IsValidBus(sendBus))
+		{
+			Logger::LogError(STRING("The send bus does not exist!"));
+			return false;
+		}
+
+		// The send bus is rendered after the bus, so the bus must not be rendered after the send bus.
+		if (sendBus == bus || DependsOn(bus, sendBus))
+		{
+			Logger::LogError(STRING("Setting the send would create a cycle!"));
+			return false;
+		}
+
+		if (mBuses[bus].mRateDivisor < mBuses[sendBus].mRateDivisor)
+		{
+			Logger::LogError(STRING("A bus cannot send to a bus with a lower rate!"));
+			return false;
+		}
+
+		mBuses[bus].mSends[slot] = sendBus;
+		return true;
+	}
+
+	bool BusGraph::SetSidechain(uint32 bus, uint32 sidechainBus)
+	{
+		if (!IsValidBus(bus))
+			return false;
+
+		if (sidechainBus == InvalidBus)
+		{
+			mBuses[bus].mSidechain = InvalidBus;
+			return true;
+		}
+
+		if (!IsValidBus(sidechainBus))
+		{
+			Logger::LogError(STRING("The sidechain bus does not exist!"));
+			return false;
+		}
+
+		// The bus is rendered after its sidechain bus, so the sidechain bus must not be rendered after the bus.
+		if (sidechainBus == bus || DependsOn(sidechainBus, bus))
+		{
+			Logger::LogError(STRING("Setting the sidechain would create a cycle!"));
+			return false;
+		}
+
+		if (mBuses[bus].mRateDivisor != mBuses[sidechainBus].mRateDivisor)
+		{
+			Logger::LogError(STRING("A bus and its sidechain bus must run at the same rate!"));
+			return false;
+		}
+
+		mBuses[bus].mSidechain = sidechainBus;
+		return true;
+	}
+
+	bool BusGraph::SetBusRateDivisor(uint32 bus, uint32 divisor)
+	{
+		if (!IsValidBus(bus))
+			return false;
+
+		// The upsampler stages work in a single block, which must hold the input of the last stage and its history.
+		if ((divisor != 1 && divisor != 2 && divisor != MaxRateDivisor) || mDescription.mBlockFrames % divisor || (divisor > 1 && mDescription.mBlockFrames < UpsamplerHistoryFrames * 2))
+		{
+			Logger::LogError(STRING("Invalid bus rate divisor!"));
+			return false;
+		}
+
+		if (bus == MasterBus && divisor != 1)
+		{
+			Logger::LogError(STRING("The master bus must run at the block rate!"));
+			return false;
+		}
+
+		// Rates only fall away from the master bus, so a bus is only ever upsampled into the buses it feeds.
+		const Bus& current = mBuses[bus];
+		bool isValid = bus == MasterBus || divisor >= mBuses[current.mOutputBus].mRateDivisor;
+		isValid &= current.mSidechain == InvalidBus || mBuses[current.mSidechain].mRateDivisor == divisor;
+		for (auto child : current.mChildren)
+			isValid &= mBuses[child].mRateDivisor >= divisor;
+
+		for (auto sendBus : current.mSends)
+			isValid &= sendBus == InvalidBus || divisor >= mBuses[sendBus].mRateDivisor;
+
+		for (const auto& other : mBuses)
+		{
+			if (!other.mIsActive)
+				continue;
+
+			if (std::find(other.mSends, other.mSends + BusInput::MaxSendCount, bus) != other.mSends + BusInput::MaxSendCount)
+				isValid &= other.mRateDivisor >= divisor;
+
+			if (other.mSidechain == bus)
+				isValid &= other.mRateDivisor == divisor;
+		}
+
+		if (!isValid)
+		{
+			Logger::LogError(STRING("The bus rate divisor does not fit the buses the bus feeds or is fed by!"));
+			return false;
+		}
+
+		mBuses[bus].mRateDivisor = divisor;
+		return true;
+	}
+
+	void BusGraph::SetBusGain(uint32 bus, float gain)
+	{
+		if (bus < mDescription.mMaxBusCount && pBusGains)
+			pBusGains[bus].store(gain, std::memory_order_relaxed);
+	}
+
+	void BusGraph::AddInput(uint32 bus, BusInput* pInput)
+	{
+		if (IsValidBus(bus) && pInput)
+			mBuses[bus].mInputs.insert(mBuses[bus].mInputs.end(), pInput);
+	}
+
+	void BusGraph::RemoveInput(uint32 bus, BusInput* pInput)
+	{
+		if (!IsValidBus(bus))
+			return;
+
+		auto& inputs = mBuses[bus].mInputs;
+		inputs.erase(std::remove(inputs.begin(), inputs.end(), pInput), inputs.end());
+	}
+
+	void BusGraph::AddEffect(uint32 bus, BusEffect* pEffect)
+	{
+		if (IsValidBus(bus) && pEffect)
+			mBuses[bus].mEffects.insert(mBuses[bus].mEffects.end(), pEffect);
+	}
+
+	void BusGraph::RemoveEffect(uint32 bus, BusEffect* pEffect)
+	{
+		if (!IsValidBus(bus))
+			return;
+
+		auto& effects = mBuses[bus].mEffects;
+		effects.erase(std::remove(effects.begin(), effects.end(), pEffect), effects.end());
+	}
+
+	uint64 BusGraph::Compile()
+	{
+		if (mBuses.empty())
+			return mCompiledVersion;
+
+		RenderSchedule& schedule = mSchedules[mCompileSchedule];
+		schedule.mOps.clear();
+		schedule.mChildOps.clear();
+		schedule.mLeafOps.clear();
+		schedule.mInputs.clear();
+		schedule.mEffects.clear();
+		schedule.mReturns.clear();
+		schedule.mDependentOps.clear();
+
+		uint32 bufferCount = 0;
+		Vector<uint32> busOps(mBuses.size(), InvalidBus);
+		CompileBus(schedule, MasterBus, busOps, bufferCount);
+
+		// The send and keyed ops are only known once every bus is compiled.
+		for (auto& op : schedule.mOps)
+		{
+			op.mDependentBegin = static_cast<uint32>(schedule.mDependentOps.size());
+			for (auto sendBus : mBuses[op.mBus].mSends)
+				if (sendBus != InvalidBus)
+					schedule.mDependentOps.insert(schedule.mDependentOps.end(), busOps[sendBus]);
+
+			for (uint32 keyed = 0; keyed < mBuses.size(); keyed++)
+				if (mBuses[keyed].mIsActive && mBuses[keyed].mSidechain == op.mBus)
+					schedule.mDependentOps.insert(schedule.mDependentOps.end(), busOps[keyed]);
+
+			op.mDependentEnd = static_cast<uint32>(schedule.mDependentOps.size());
+		}
+
+		schedule.mScratch.assign(static_cast<uint64>(bufferCount) * mDescription.mBlockFrames * mDescription.mChannelCount, 0.0f);
+		schedule.mSilentBuffers.assign(bufferCount, 1);
+		if (schedule.mPendingCapacity < schedule.mOps.size())
+		{
+			schedule.mPendingCapacity = schedule.mOps.size();
+			schedule.pPendingChildren = std::make_unique<std::atomic<uint32>[]>(schedule.mPendingCapacity);
+		}
+
+		schedule.mVersion = ++mCompiledVersion;
+
+		// Publish the schedule and take back whichever slot was published before, the mixer no longer needs it.
+		mCompileSchedule = mPublishedSchedule.exchange(mCompileSchedule | NewScheduleBit, std::memory_order_acq_rel) & ~NewScheduleBit;
+		return schedule.mVersion;
+	}
+
+	void BusGraph::Render(float* pOutput)
+	{
+		if (mPublishedSchedule.load(std::memory_order_relaxed) & NewScheduleBit)
+			mRenderSchedule = mPublishedSchedule.exchange(mRenderSchedule, std::memory_order_acq_rel) & ~NewScheduleBit;
+
+		RenderSchedule& schedule = mSchedules[mRenderSchedule];
+		const uint64 sampleCount = static_cast<uint64>(mDescription.mBlockFrames) * mDescription.mChannelCount;
+		if (schedule.mOps.empty())
+		{
+			std::fill(pOutput, pOutput + sampleCount, 0.0f);
+			return;
+		}
+
+		// Every bus ramps from the gain it ended the last block with, except the ones which were just created.
+		const uint64 previousVersion = mRenderedVersion.load(std::memory_order_relaxed);
+		for (const auto& op : schedule.mOps)
+		{
+			const float gain = pBusGains[op.mBus].load(std::memory_order_relaxed);
+			mGainRampStarts[op.mBus] = op.mCreatedVersion > previousVersion ? gain : mGainRampEnds[op.mBus];
+			mGainRampEnds[op.mBus] = gain;
+
+			// An upsampler starts from silence on a new bus or at a new rate, not from the frames of another stream.
+			if (op.mStagingBuffer == InvalidBus)
+				continue;
+
+			for (uint32 stream = 0; stream < StreamCount; stream++)
+			{
+				const uint32 factor = stream ? op.mSendFactors[stream - 1] : op.mOutputFactor;
+				const uint64 index = static_cast<uint64>(op.mBus) * StreamCount + stream;
+				if (factor > 1 && (op.mCreatedVersion > previousVersion || mUpsamplerFactors[index] != factor))
+				{
+					const uint64 historySamples = static_cast<uint64>(UpsamplerStageCount) * UpsamplerHistoryFrames * mDescription.mChannelCount;
+					std::fill(mUpsamplerHistory.begin() + index * historySamples, mUpsamplerHistory.begin() + (index + 1) * historySamples, 0.0f);
+				}
+
+				mUpsamplerFactors[index] = factor;
+			}
+		}
+
+		mSilentOps.store(0, std::memory_order_relaxed);
+		if (!mDescription.pJobSystem)
+		{
+			for (uint32 op = 0; op < schedule.mOps.size(); op++)
+				ProcessOp(op);
+		}
+		else
+		{
+			// The counters are reset before any job is submitted, and submitting publishes them to the workers.
+			for (uint32 op = 0; op < schedule.mOps.size(); op++)
+				schedule.pPendingChildren[op].store(schedule.mOps[op].mDependencyCount, std::memory_order_relaxed);
+
+			for (auto op : schedule.mLeafOps)
+				Dispatch(op);
+
+			mDescription.pJobSystem->Wait(mBlockJobs, JobPriority::JOB_PRIORITY_REAL_TIME_MIX);
+		}
+
+		const RenderOp& master = schedule.mOps.back();
+		if (schedule.mSilentBuffers[master.mBuffer])
+			std::fill(pOutput, pOutput + sampleCount, 0.0f);
+		else
+		{
+			const float* pMaster = schedule.mScratch.data() + master.mBuffer * sampleCount;
+			std::copy(pMaster, pMaster + sampleCount, pOutput);
+			if (mGainRampStarts[MasterBus] != 1.0f || mGainRampEnds[MasterBus] != 1.0f)
+				ScaleBufferRamped(pOutput, mGainRampStarts[MasterBus], mGainRampEnds[MasterBus], mDescription.mBlockFrames, mDescription.mChannelCount, mDescription.mGainCurve);
+		}
+
+		mSilentBusCount.store(mSilentOps.load(std::memory_order_relaxed), std::memory_order_relaxed);
+		mRenderedVersion.store(schedule.mVersion, std::memory_order_release);
+	}
+
+	bool BusGraph::DependsOn(uint32 bus, uint32 dependency) const
+	{
+		Vector<uint32> pending = { bus };
+		Vector<bool> isVisited(mBuses.size(), false);
+		while (!pending.empty())
+		{
+			const uint32 current = pending.back();
+			pending.pop_back();
+
+			if (current == dependency)
+				return true;
+
+			if (isVisited[current])
+				continue;
+
+			isVisited[current] = true;
+			pending.insert(pending.end(), mBuses[current].mChildren.begin(), mBuses[current].mChildren.end());
+			if (mBuses[current].mSidechain != InvalidBus)
+				pending.insert(pending.end(), mBuses[current].mSidechain);
+
+			for (uint32 source = 0; source < mBuses.size(); source++)
+			{
+				const uint32* pSends = mBuses[source].mSends;
+				if (mBuses[source].mIsActive && std::find(pSends, pSends + BusInput::MaxSendCount, current) != pSends + BusInput::MaxSendCount)
+					pending.insert(pending.end(), source);
+			}
+		}
+
+		return false;
+	}
+
+	uint32 BusGraph::CompileBus(RenderSchedule& schedule, uint32 bus, Vector<uint32>& busOps, uint32& bufferCount) const
+	{
+		// A bus which sends to another one may already be compiled.
+		if (busOps[bus] != InvalidBus)
+			return busOps[bus];
+
+		const Bus& current = mBuses[bus];
+
+		Vector<uint32> childOps;
+		childOps.reserve(current.mChildren.size());
+		for (auto child : current.mChildren)
+			childOps.insert(childOps.end(), CompileBus(schedule, child, busOps, bufferCount));
+
+		// The buses which send to this one are rendered before it, and it sums their send buffers in bus order.
+		Vector<uint32> returns;
+		for (uint32 source = 0; source < mBuses.size(); source++)
+		{
+			if (source == bus || !mBuses[source].mIsActive)
+				continue;
+
+			for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+			{
+				if (mBuses[source].mSends[slot] != bus)
+					continue;
+
+				const uint32 sourceOp = CompileBus(schedule, source, busOps, bufferCount);
+				returns.insert(returns.end(), schedule.mOps[sourceOp].mSendBuffers[slot]);
+			}
+		}
+
+		// The sidechain bus is rendered before it too.
+		uint32 sidechainBuffer = InvalidBus;
+		if (current.mSidechain != InvalidBus)
+			sidechainBuffer = schedule.mOps[CompileBus(schedule, current.mSidechain, busOps, bufferCount)].mKeyBuffer;
+
+		RenderOp op = {};
+		op.mCreatedVersion = current.mCreatedVersion;
+		op.mBus = bus;
+		op.mSidechainBuffer = sidechainBuffer;
+		op.mRateDivisor = current.mRateDivisor;
+		op.mOutputFactor = bus == MasterBus ? 1 : current.mRateDivisor / mBuses[current.mOutputBus].mRateDivisor;
+
+		op.mChildBegin = static_cast<uint32>(schedule.mChildOps.size());
+		schedule.mChildOps.insert(schedule.mChildOps.end(), childOps.begin(), childOps.end());
+		op.mChildEnd = static_cast<uint32>(schedule.mChildOps.size());
+
+		op.mInputBegin = static_cast<uint32>(schedule.mInputs.size());
+		schedule.mInputs.insert(schedule.mInputs.end(), current.mInputs.begin(), current.mInputs.end());
+		op.mInputEnd = static_cast<uint32>(schedule.mInputs.size());
+
+		op.mEffectBegin = static_cast<uint32>(schedule.mEffects.size());
+		schedule.mEffects.insert(schedule.mEffects.end(), current.mEffects.begin(), current.mEffects.end());
+		op.mEffectEnd = static_cast<uint32>(schedule.mEffects.size());
+
+		op.mReturnBegin = static_cast<uint32>(schedule.mReturns.size());
+		schedule.mReturns.insert(schedule.mReturns.end(), returns.begin(), returns.end());
+		op.mReturnEnd = static_cast<uint32>(schedule.mReturns.size());
+		op.mDependencyCount = static_cast<uint32>(childOps.size() + returns.size()) + (sidechainBuffer != InvalidBus ? 1 : 0);
+
+		// A bus with children accumulates in the buffer of its first child, which is done by then.
+		op.mBuffer = childOps.empty() ? bufferCount++ : schedule.mOps[childOps.front()].mBuffer;
+
+		// Every routed send slot gets a buffer of its own, so buses sending to the same bus can render in parallel.
+		for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+		{
+			op.mSendBuffers[slot] = current.mSends[slot] != InvalidBus ? bufferCount++ : InvalidBus;
+			op.mSendFactors[slot] = current.mSends[slot] != InvalidBus ? current.mRateDivisor / mBuses[current.mSends[slot]].mRateDivisor : 1;
+			op.mHasSends |= current.mSends[slot] != InvalidBus;
+		}
+
+		// A bus slower than any bus it feeds gets a buffer for the upsampler.
+		if (*std::max_element(op.mSendFactors, op.mSendFactors + BusInput::MaxSendCount) > 1 || op.mOutputFactor > 1)
+			op.mStagingBuffer = bufferCount++;
+
+		// The buffer of the bus is mixed into its output bus, so the buses keyed by it read a copy.
+		for (uint32 keyed = 0; keyed < mBuses.size(); keyed++)
+		{
+			if (mBuses[keyed].mIsActive && mBuses[keyed].mSidechain == bus)
+			{
+				op.mKeyBuffer = bufferCount++;
+				break;
+			}
+		}
+
+		const uint32 index = static_cast<uint32>(schedule.mOps.size());
+		schedule.mOps.insert(schedule.mOps.end(), op);
+		busOps[bus] = index;
+
+		for (auto child : childOps)
+			schedule.mOps[child].mOutputOp = index;
+
+		if (!op.mDependencyCount)
+			schedule.mLeafOps.insert(schedule.mLeafOps.end(), index);
+
+		return index;
+	}
+
+	void BusGraph::Dispatch(uint32 op)
+	{
+		Job job = {};
+		job.pFunction = &BusGraph::RenderJob;
+		job.pData = this;
+		job.mArgument = op;
+		job.pCounter = &mBlockJobs;
+
+		mDescription.pJobSystem->Submit(job, JobPriority::JOB_PRIORITY_REAL_TIME_MIX);
+	}
+
+	void BusGraph::ProcessOp(uint32 op)
+	{
+		RenderSchedule& schedule = mSchedules[mRenderSchedule];
+		const RenderOp& current = schedule.mOps[op];
+
+		// The scratch buffers are a block apart, but a reduced rate bus only uses the start of its buffers.
+		const uint64 sampleCount = static_cast<uint64>(mDescription.mBlockFrames) * mDescription.mChannelCount;
+		const uint32 frameCount = mDescription.mBlockFrames / current.mRateDivisor;
+		const uint64 blockSamples = static_cast<uint64>(frameCount) * mDescription.mChannelCount;
+		float* pBuffer = schedule.mScratch.data() + current.mBuffer * sampleCount;
+
+		// The buffer is only cleared once something has to be added to it, so a silent bus never touches it.
+		bool isSilent = true;
+		bool isCleared = false;
+		const auto clear = [&]()
+		{
+			if (!isCleared)
+				std::fill(pBuffer, pBuffer + blockSamples, 0.0f);
+
+			isCleared = true;
+		};
+
+		if (current.mChildBegin != current.mChildEnd)
+		{
+			// The first child is already in the buffer, unless it is silent.
+			const RenderOp& firstChild = schedule.mOps[schedule.mChildOps[current.mChildBegin]];
+			if (!schedule.mSilentBuffers[firstChild.mBuffer])
+			{
+				isSilent = false;
+				isCleared = true;
+				if (mGainRampStarts[firstChild.mBus] != 1.0f || mGainRampEnds[firstChild.mBus] != 1.0f)
+					ScaleBufferRamped(pBuffer, mGainRampStarts[firstChild.mBus], mGainRampEnds[firstChild.mBus], frameCount, mDescription.mChannelCount, mDescription.mGainCurve);
+			}
+
+			for (uint32 i = current.mChildBegin + 1; i < current.mChildEnd; i++)
+			{
+				const RenderOp& child = schedule.mOps[schedule.mChildOps[i]];
+				if (schedule.mSilentBuffers[child.mBuffer])
+					continue;
+
+				clear();
+				isSilent = false;
+				MixBufferRamped(pBuffer, schedule.mScratch.data() + child.mBuffer * sampleCount, mGainRampStarts[child.mBus], mGainRampEnds[child.mBus], frameCount, mDescription.mChannelCount, mDescription.mGainCurve);
+			}
+		}
+
+		for (uint32 i = current.mReturnBegin; i < current.mReturnEnd; i++)
+		{
+			if (schedule.mSilentBuffers[schedule.mReturns[i]])
+				continue;
+
+			clear();
+			isSilent = false;
+			MixBuffer(pBuffer, schedule.mScratch.data() + schedule.mReturns[i] * sampleCount, 1.0f, blockSamples);
+		}
+
+		if (current.mHasSends)
+		{
+			float* pSends[BusInput::MaxSendCount] = {};
+			for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+			{
+				if (current.mSendBuffers[slot] == InvalidBus)
+					continue;
+
+				pSends[slot] = schedule.mScratch.data() + current.mSendBuffers[slot] * sampleCount;
+				if (current.mInputBegin != current.mInputEnd)
+					std::fill(pSends[slot], pSends[slot] + blockSamples, 0.0f);
+			}
+
+			uint32 mask = 0;
+			if (current.mInputBegin != current.mInputEnd)
+				clear();
+
+			for (uint32 i = current.mInputBegin; i < current.mInputEnd; i++)
+				mask |= schedule.mInputs[i]->MixWithSends(pBuffer, pSends, BusInput::MaxSendCount, frameCount, mDescription.mChannelCount);
+
+			isSilent &= !(mask & 1);
+			for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+				if (current.mSendBuffers[slot] != InvalidBus)
+					schedule.mSilentBuffers[current.mSendBuffers[slot]] = !(mask & (2U << slot));
+		}
+		else
+		{
+			if (current.mInputBegin != current.mInputEnd)
+				clear();
+
+			for (uint32 i = current.mInputBegin; i < current.mInputEnd; i++)
+				isSilent &= !schedule.mInputs[i]->Mix(pBuffer, frameCount, mDescription.mChannelCount);
+		}
+
+		const float* pSidechain = nullptr;
+		if (current.mSidechainBuffer != InvalidBus && !schedule.mSilentBuffers[current.mSidechainBuffer])
+			pSidechain = schedule.mScratch.data() + current.mSidechainBuffer * sampleCount;
+
+		// Effects whose tails have decayed are skipped while the bus is silent. Any other effect wakes the bus up.
+		for (uint32 i = current.mEffectBegin; i < current.mEffectEnd; i++)
+		{
+			BusEffect* pEffect = schedule.mEffects[i];
+			if (isSilent && pEffect->IsTailSilent())
+				continue;
+
+			clear();
+			isSilent = false;
+			if (current.mSidechainBuffer != InvalidBus)
+				pEffect->ProcessWithSidechain(pBuffer, pSidechain, frameCount, mDescription.mChannelCount);
+			else
+				pEffect->Process(pBuffer, frameCount, mDescription.mChannelCount);
+		}
+
+		schedule.mSilentBuffers[current.mBuffer] = isSilent;
+		if (current.mKeyBuffer != InvalidBus)
+		{
+			schedule.mSilentBuffers[current.mKeyBuffer] = isSilent;
+			if (!isSilent)
+				std::copy(pBuffer, pBuffer + blockSamples, schedule.mScratch.data() + current.mKeyBuffer * sampleCount);
+		}
+
+		// A bus slower than the buses it feeds is brought up to their rates once, after its effects. A silent buffer
+		// adds nothing, so its upsampler history is silent for the next block.
+		if (current.mStagingBuffer != InvalidBus)
+		{
+			float* pStaging = schedule.mScratch.data() + current.mStagingBuffer * sampleCount;
+			for (uint32 stream = 0; stream < StreamCount; stream++)
+			{
+				const uint32 buffer = stream ? current.mSendBuffers[stream - 1] : current.mBuffer;
+				const uint32 factor = stream ? current.mSendFactors[stream - 1] : current.mOutputFactor;
+				if (buffer == InvalidBus || factor == 1)
+					continue;
+
+				if (schedule.mSilentBuffers[buffer])
+				{
+					const uint64 historySamples = static_cast<uint64>(UpsamplerStageCount) * UpsamplerHistoryFrames * mDescription.mChannelCount;
+					const uint64 index = static_cast<uint64>(current.mBus) * StreamCount + stream;
+					std::fill(mUpsamplerHistory.begin() + index * historySamples, mUpsamplerHistory.begin() + (index + 1) * historySamples, 0.0f);
+				}
+				else
+					UpsampleBuffer(schedule.mScratch.data() + buffer * sampleCount, pStaging, current.mBus, stream, frameCount, factor);
+			}
+		}
+
+		if (isSilent)
+			mSilentOps.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void BusGraph::UpsampleBuffer(float* pBuffer, float* pStaging, uint32 bus, uint32 stream, uint32 frameCount, uint32 factor)
+	{
+		// Every stage copies its input behind the history of the stage and doubles it back into the buffer.
+		const uint32 channelCount = mDescription.mChannelCount;
+		const uint64 historySamples = static_cast<uint64>(UpsamplerHistoryFrames) * channelCount;
+		float* pHistory = mUpsamplerHistory.data() + (static_cast<uint64>(bus) * StreamCount + stream) * UpsamplerStageCount * historySamples;
+		for (uint32 stage = 1; stage < factor; stage *= 2)
+		{
+			const uint64 inputSamples = static_cast<uint64>(frameCount) * channelCount;
+			std::copy(pHistory, pHistory + historySamples, pStaging);
+			std::copy(pBuffer, pBuffer + inputSamples, pStaging + historySamples);
+			std::copy(pStaging + inputSamples, pStaging + inputSamples + historySamples, pHistory);
+
+			Upsample(pBuffer, pStaging + historySamples, frameCount, channelCount);
+			frameCount *= 2;
+			pHistory += historySamples;
+		}
+	}
+
+	void BusGraph::RenderJob(void* pData, uint64 argument)
+	{
+		BusGraph* pGraph = static_cast<BusGraph*>(pData);
+		const uint32 op = static_cast<uint32>(argument);
+		pGraph->ProcessOp(op);
+
+		// The last dependency to finish hands its output or dependent op over to the job system.
+		RenderSchedule& schedule = pGraph->mSchedules[pGraph->mRenderSchedule];
+		const RenderOp& current = schedule.mOps[op];
+		for (uint32 i = current.mDependentBegin; i < current.mDependentEnd; i++)
+		{
+			const uint32 dependentOp = schedule.mDependentOps[i];
+			if (schedule.pPendingChildren[dependentOp].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				pGraph->Dispatch(dependentOp);
+		}
+
+		if (op + 1 < schedule.mOps.size())
+		{
+			const uint32 outputOp = current.mOutputOp;
+			if (schedule.pPendingChildren[outputOp].fetch_sub(1, std::memory_order_acq_rel) == 1)
+				pGraph->Dispatch(outputOp);
+		}
+	}
+}
\ No newline at end of file
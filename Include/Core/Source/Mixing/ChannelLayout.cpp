@@ -0,0 +1,236 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/ChannelLayout.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float HalfPower = 0.70710678f;	// The gain of a speaker folded into another, -3 dB.
+		const uint32 LayoutCount = static_cast<uint32>(ChannelLayout::CHANNEL_LAYOUT_MAX);
+
+		const Speaker MonoSpeakers[] = { Speaker::SPEAKER_FRONT_CENTER };
+		const Speaker StereoSpeakers[] = { Speaker::SPEAKER_FRONT_LEFT, Speaker::SPEAKER_FRONT_RIGHT };
+		const Speaker QuadSpeakers[] = { Speaker::SPEAKER_FRONT_LEFT, Speaker::SPEAKER_FRONT_RIGHT, Speaker::SPEAKER_BACK_LEFT, Speaker::SPEAKER_BACK_RIGHT };
+		const Speaker Surround51Speakers[] = {
+			Speaker::SPEAKER_FRONT_LEFT, Speaker::SPEAKER_FRONT_RIGHT, Speaker::SPEAKER_FRONT_CENTER, Speaker::SPEAKER_LOW_FREQUENCY,
+			Speaker::SPEAKER_SIDE_LEFT, Speaker::SPEAKER_SIDE_RIGHT };
+		const Speaker Surround71Speakers[] = {
+			Speaker::SPEAKER_FRONT_LEFT, Speaker::SPEAKER_FRONT_RIGHT, Speaker::SPEAKER_FRONT_CENTER, Speaker::SPEAKER_LOW_FREQUENCY,
+			Speaker::SPEAKER_BACK_LEFT, Speaker::SPEAKER_BACK_RIGHT, Speaker::SPEAKER_SIDE_LEFT, Speaker::SPEAKER_SIDE_RIGHT };
+		const Speaker Surround714Speakers[] = {
+			Speaker::SPEAKER_FRONT_LEFT, Speaker::SPEAKER_FRONT_RIGHT, Speaker::SPEAKER_FRONT_CENTER, Speaker::SPEAKER_LOW_FREQUENCY,
+			Speaker::SPEAKER_BACK_LEFT, Speaker::SPEAKER_BACK_RIGHT, Speaker::SPEAKER_SIDE_LEFT, Speaker::SPEAKER_SIDE_RIGHT,
+			Speaker::SPEAKER_TOP_FRONT_LEFT, Speaker::SPEAKER_TOP_FRONT_RIGHT, Speaker::SPEAKER_TOP_BACK_LEFT, Speaker::SPEAKER_TOP_BACK_RIGHT };
+
+		// The positions of the channels, from ITU-R BS.775 and BS.2051.
+		const float MonoAzimuths[] = { 0.0f };
+		const float StereoAzimuths[] = { -30.0f, 30.0f };
+		const float QuadAzimuths[] = { -45.0f, 45.0f, -135.0f, 135.0f };
+		const float Surround51Azimuths[] = { -30.0f, 30.0f, 0.0f, 0.0f, -110.0f, 110.0f };
+		const float Surround71Azimuths[] = { -30.0f, 30.0f, 0.0f, 0.0f, -145.0f, 145.0f, -100.0f, 100.0f };
+		const float Surround714Azimuths[] = { -30.0f, 30.0f, 0.0f, 0.0f, -145.0f, 145.0f, -100.0f, 100.0f, -45.0f, 45.0f, -135.0f, 135.0f };
+		const float FlatElevations[MaxLayoutChannels] = {};
+		const float Surround714Elevations[] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 45.0f, 45.0f, 45.0f, 45.0f };
+
+		const ChannelLayoutDescription LayoutDescriptions[] = {
+			{},
+			{ MonoSpeakers, MonoAzimuths, FlatElevations, 1 },
+			{ StereoSpeakers, StereoAzimuths, FlatElevations, 2 },
+			{ QuadSpeakers, QuadAzimuths, FlatElevations, 4 },
+			{ Surround51Speakers, Surround51Azimuths, FlatElevations, 6 },
+			{ Surround71Speakers, Surround71Azimuths, FlatElevations, 8 },
+			{ Surround714Speakers, Surround714Azimuths, Surround714Elevations, 12 },
+		};
+
+		static_assert(sizeof(LayoutDescriptions) / sizeof(LayoutDescriptions[0]) == LayoutCount, "Channel layout description count mismatch!");
+
+		/**
+		 * Find the channel of a speaker in a layout.
+		 */
+		uint32 FindChannel(const ChannelLayoutDescription& layout, Speaker speaker)
+		{
+			return static_cast<uint32>(std::find(layout.pSpeakers, layout.pSpeakers + layout.mChannelCount, speaker) - layout.pSpeakers);
+		}
+
+		inline bool HasSpeaker(const ChannelLayoutDescription& layout, Speaker speaker) { return FindChannel(layout, speaker) < layout.mChannelCount; }
+
+		/**
+		 * Add an input channel playing on a speaker to the matrix, folding the speaker into its neighbours when the
+		 * output does not have it.
+		 */
+		void Fold(const ChannelLayoutDescription& input, const ChannelLayoutDescription& output, uint32 inputChannel, Speaker speaker, float gain, float* pMatrix)
+		{
+			const uint32 outputChannel = FindChannel(output, speaker);
+			if (outputChannel < output.mChannelCount)
+			{
+				pMatrix[outputChannel * input.mChannelCount + inputChannel] += gain;
+				return;
+			}
+
+			switch (speaker)
+			{
+			case Speaker::SPEAKER_FRONT_LEFT:
+			case Speaker::SPEAKER_FRONT_RIGHT:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_FRONT_CENTER, gain * HalfPower, pMatrix);
+				break;
+
+			case Speaker::SPEAKER_FRONT_CENTER:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_FRONT_LEFT, gain * HalfPower, pMatrix);
+				Fold(input, output, inputChannel, Speaker::SPEAKER_FRONT_RIGHT, gain * HalfPower, pMatrix);
+				break;
+
+			case Speaker::SPEAKER_BACK_LEFT:
+			case Speaker::SPEAKER_BACK_RIGHT:
+			case Speaker::SPEAKER_SIDE_LEFT:
+			case Speaker::SPEAKER_SIDE_RIGHT:
+			{
+				const bool isLeft = speaker == Speaker::SPEAKER_BACK_LEFT || speaker == Speaker::SPEAKER_SIDE_LEFT;
+				const bool isBack = speaker == Speaker::SPEAKER_BACK_LEFT || speaker == Speaker::SPEAKER_BACK_RIGHT;
+				const Speaker other = isBack ? (isLeft ? Speaker::SPEAKER_SIDE_LEFT : Speaker::SPEAKER_SIDE_RIGHT) : (isLeft ? Speaker::SPEAKER_BACK_LEFT : Speaker::SPEAKER_BACK_RIGHT);
+				// Two inputs which fold into the same surround share it at -3 dB each, a lone one takes it as it is.
+				if (HasSpeaker(output, other))
+					Fold(input, output, inputChannel, other, HasSpeaker(input, other) ? gain * HalfPower : gain, pMatrix);
+				else
+					Fold(input, output, inputChannel, isLeft ? Speaker::SPEAKER_FRONT_LEFT : Speaker::SPEAKER_FRONT_RIGHT, gain * HalfPower, pMatrix);
+
+				break;
+			}
+
+			case Speaker::SPEAKER_TOP_FRONT_LEFT:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_FRONT_LEFT, gain * HalfPower, pMatrix);
+				break;
+
+			case Speaker::SPEAKER_TOP_FRONT_RIGHT:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_FRONT_RIGHT, gain * HalfPower, pMatrix);
+				break;
+
+			case Speaker::SPEAKER_TOP_BACK_LEFT:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_BACK_LEFT, gain * HalfPower, pMatrix);
+				break;
+
+			case Speaker::SPEAKER_TOP_BACK_RIGHT:
+				Fold(input, output, inputChannel, Speaker::SPEAKER_BACK_RIGHT, gain * HalfPower, pMatrix);
+				break;
+
+			default:
+				break;
+			}
+		}
+	}
+
+	const ChannelLayoutDescription& GetChannelLayoutDescription(ChannelLayout layout)
+	{
+		return LayoutDescriptions[static_cast<uint32>(layout) < LayoutCount ? static_cast<uint32>(layout) : 0];
+	}
+
+	ChannelLayout GetDefaultChannelLayout(uint32 channelCount)
+	{
+		switch (channelCount)
+		{
+		case 1:
+			return ChannelLayout::CHANNEL_LAYOUT_MONO;
+
+		case 2:
+			return ChannelLayout::CHANNEL_LAYOUT_STEREO;
+
+		case 4:
+			return ChannelLayout::CHANNEL_LAYOUT_QUAD;
+
+		case 6:
+			return ChannelLayout::CHANNEL_LAYOUT_5_1;
+
+		case 8:
+			return ChannelLayout::CHANNEL_LAYOUT_7_1;
+
+		case 12:
+			return ChannelLayout::CHANNEL_LAYOUT_7_1_4;
+
+		default:
+			return ChannelLayout::CHANNEL_LAYOUT_UNKNOWN;
+		}
+	}
+
+	const float* GetChannelMatrix(ChannelLayout input, ChannelLayout output)
+	{
+		// Every conversion between the standard layouts is computed once, the first time any matrix is asked for.
+		static const Vector<float> matrices = []() {
+			const uint64 matrixSize = static_cast<uint64>(MaxLayoutChannels) * MaxLayoutChannels;
+			Vector<float> result(static_cast<uint64>(LayoutCount) * LayoutCount * matrixSize, 0.0f);
+			for (uint32 from = 1; from < LayoutCount; from++)
+			{
+				for (uint32 to = 1; to < LayoutCount; to++)
+				{
+					const ChannelLayoutDescription& inputLayout = GetChannelLayoutDescription(static_cast<ChannelLayout>(from));
+					const ChannelLayoutDescription& outputLayout = GetChannelLayoutDescription(static_cast<ChannelLayout>(to));
+					float* pMatrix = result.data() + (static_cast<uint64>(from) * LayoutCount + to) * matrixSize;
+					for (uint32 channel = 0; channel < inputLayout.mChannelCount; channel++)
+						Fold(inputLayout, outputLayout, channel, inputLayout.pSpeakers[channel], 1.0f, pMatrix);
+				}
+			}
+
+			return result;
+		}();
+
+		const uint32 from = static_cast<uint32>(input);
+		const uint32 to = static_cast<uint32>(output);
+		if (!from || !to || from >= LayoutCount || to >= LayoutCount)
+			return nullptr;
+
+		return matrices.data() + (static_cast<uint64>(from) * LayoutCount + to) * MaxLayoutChannels * MaxLayoutChannels;
+	}
+
+	bool ChannelMixer::Initialize(ChannelLayout input, ChannelLayout output)
+	{
+		const float* pMatrix = GetChannelMatrix(input, output);
+		if (!pMatrix)
+		{
+			Terminate();
+			Logger::LogError(STRING("Unknown channel layout!"));
+			return false;
+		}
+
+		return Initialize(pMatrix, GetChannelLayoutDescription(input).mChannelCount, GetChannelLayoutDescription(output).mChannelCount);
+	}
+
+	bool ChannelMixer::Initialize(const float* pMatrix, uint32 inputChannelCount, uint32 outputChannelCount)
+	{
+		Terminate();
+
+		if (!pMatrix || !inputChannelCount || !outputChannelCount || outputChannelCount > MaxMatrixOutputs)
+		{
+			Logger::LogError(STRING("Invalid channel matrix!"));
+			return false;
+		}
+
+		// The matrix is transposed to one padded column of output weights per input channel.
+		mStride = (outputChannelCount + 3) & ~3U;
+		mInputChannelCount = inputChannelCount;
+		mOutputChannelCount = outputChannelCount;
+		mColumns.assign(static_cast<uint64>(mStride) * inputChannelCount, 0.0f);
+		for (uint32 output = 0; output < outputChannelCount; output++)
+			for (uint32 input = 0; input < inputChannelCount; input++)
+				mColumns[static_cast<uint64>(input) * mStride + output] = pMatrix[static_cast<uint64>(output) * inputChannelCount + input];
+
+		return true;
+	}
+
+	void ChannelMixer::Terminate()
+	{
+		mColumns.clear();
+		mStride = 0;
+		mInputChannelCount = 0;
+		mOutputChannelCount = 0;
+	}
+
+	void ChannelMixer::Mix(float* pOutput, const float* pInput, uint32 frameCount) const
+	{
+		if (!mColumns.empty())
+			MixMatrix(pOutput, pInput, mColumns.data(), frameCount, mInputChannelCount, mOutputChannelCount);
+	}
+}
\ No newline at end of file
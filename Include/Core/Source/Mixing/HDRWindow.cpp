@@ -0,0 +1,37 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/HDRWindow.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float NoLoudness = -1e30f;	// The loudness submitted when nothing is heard.
+	}
+
+	void HDRWindow::Initialize(const HDRWindowDescription& description)
+	{
+		mDescription = description;
+		mDescription.mSampleRate = std::max(description.mSampleRate, 1U);
+		mLoudest.store(NoLoudness, std::memory_order_relaxed);
+		mTop = description.mMinimumTop;
+	}
+
+	void HDRWindow::Submit(float loudness)
+	{
+		// The maximum does not depend on the order the tables submit in, so the mix stays deterministic.
+		float loudest = mLoudest.load(std::memory_order_relaxed);
+		while (loudness > loudest && !mLoudest.compare_exchange_weak(loudest, loudness, std::memory_order_relaxed))
+			;
+	}
+
+	void HDRWindow::Update(uint32 frameCount)
+	{
+		const float released = mTop - mDescription.mReleaseRate * frameCount / mDescription.mSampleRate;
+		const float loudest = mLoudest.exchange(NoLoudness, std::memory_order_relaxed);
+		mTop = std::max(std::max(loudest, released), mDescription.mMinimumTop);
+	}
+}
\ No newline at end of file
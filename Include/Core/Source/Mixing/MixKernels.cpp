@@ -0,0 +1,377 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		const uint32 RampChunkFrames = 64;	// The number of per frame gains computed at once on the stack.
+		const uint32 UpsamplerTapCount = 8;	// The number of tap pairs of the odd output frames.
+		const uint32 MatrixChunkFrames = 64;	// The number of matrix mixed frames summed at once on the stack.
+
+		// The taps of the odd output frames, a Kaiser windowed halfband sinc. Tap j weighs the input frames j and j + 1
+		// away from the odd frame on either side. The even output frames are the input frames themselves.
+		const float UpsamplerTaps[UpsamplerTapCount] = {
+			0.631843258f, -0.196297392f, 0.102000478f, -0.058233782f, 0.032998974f, -0.017529418f, 0.008201506f, -0.002983626f
+		};
+
+		/**
+		 * Multiply every frame of an interleaved chunk by its gain, and add it to the destination if there is a source.
+		 */
+		void ApplyGains(float* pDestination, const float* pSource, const float* pGains, uint32 frameCount, uint32 channelCount)
+		{
+			uint32 frame = 0;
+
+#ifdef ENSD_SIMD_SSE2
+			if (channelCount == 1)
+			{
+				for (; frame + 4 <= frameCount; frame += 4)
+				{
+					const __m128 gains = _mm_loadu_ps(pGains + frame);
+					if (pSource)
+						_mm_storeu_ps(pDestination + frame, _mm_add_ps(_mm_loadu_ps(pDestination + frame), _mm_mul_ps(_mm_loadu_ps(pSource + frame), gains)));
+					else
+						_mm_storeu_ps(pDestination + frame, _mm_mul_ps(_mm_loadu_ps(pDestination + frame), gains));
+				}
+			}
+			else if (channelCount == 2)
+			{
+				for (; frame + 4 <= frameCount; frame += 4)
+				{
+					const __m128 gains = _mm_loadu_ps(pGains + frame);
+					const __m128 low = _mm_unpacklo_ps(gains, gains);
+					const __m128 high = _mm_unpackhi_ps(gains, gains);
+
+					float* pOutput = pDestination + frame * 2;
+					if (pSource)
+					{
+						_mm_storeu_ps(pOutput, _mm_add_ps(_mm_loadu_ps(pOutput), _mm_mul_ps(_mm_loadu_ps(pSource + frame * 2), low)));
+						_mm_storeu_ps(pOutput + 4, _mm_add_ps(_mm_loadu_ps(pOutput + 4), _mm_mul_ps(_mm_loadu_ps(pSource + frame * 2 + 4), high)));
+					}
+					else
+					{
+						_mm_storeu_ps(pOutput, _mm_mul_ps(_mm_loadu_ps(pOutput), low));
+						_mm_storeu_ps(pOutput + 4, _mm_mul_ps(_mm_loadu_ps(pOutput + 4), high));
+					}
+				}
+			}
+#endif // ENSD_SIMD_SSE2
+
+			for (; frame < frameCount; frame++)
+			{
+				for (uint32 channel = 0; channel < channelCount; channel++)
+				{
+					const uint64 index = static_cast<uint64>(frame) * channelCount + channel;
+					if (pSource)
+						pDestination[index] += pSource[index] * pGains[frame];
+					else
+						pDestination[index] *= pGains[frame];
+				}
+			}
+		}
+
+		/**
+		 * Apply a ramping gain in chunks.
+		 */
+		void ApplyRamp(float* pDestination, const float* pSource, float startGain, float endGain, uint32 frameCount, uint32 channelCount, RampCurve curve)
+		{
+			float gains[RampChunkFrames];
+			for (uint32 frame = 0; frame < frameCount; frame += RampChunkFrames)
+			{
+				const uint32 chunkFrames = std::min(RampChunkFrames, frameCount - frame);
+				const uint64 offset = static_cast<uint64>(frame) * channelCount;
+
+				ComputeRamp(gains, startGain, endGain, frame, chunkFrames, frameCount, curve);
+				ApplyGains(pDestination + offset, pSource ? pSource + offset : nullptr, gains, chunkFrames, channelCount);
+			}
+		}
+
+#ifdef ENSD_SIMD_SSE2
+		/**
+		 * Sum the matrix outputs of a chunk of frames back to back, with the group count known so the sums stay in
+		 * registers. The padded lanes of a frame are overwritten by the next one, the last ones spill into the 4 floats
+		 * past the chunk.
+		 */
+		template<uint32 GroupCount>
+		void SumMatrixChunk(float* pSums, const float* pInput, const float* pColumns, uint32 frameCount, uint32 inputChannels, uint32 outputChannels)
+		{
+			for (uint32 frame = 0; frame < frameCount; frame++)
+			{
+				const float* pSamples = pInput + static_cast<uint64>(frame) * inputChannels;
+
+				__m128 sums[GroupCount];
+				for (uint32 group = 0; group < GroupCount; group++)
+					sums[group] = _mm_setzero_ps();
+
+				for (uint32 channel = 0; channel < inputChannels; channel++)
+				{
+					const __m128 sample = _mm_set1_ps(pSamples[channel]);
+					const float* pWeights = pColumns + static_cast<uint64>(channel) * GroupCount * 4;
+					for (uint32 group = 0; group < GroupCount; group++)
+						sums[group] = _mm_add_ps(sums[group], _mm_mul_ps(sample, _mm_loadu_ps(pWeights + group * 4)));
+				}
+
+				for (uint32 group = 0; group < GroupCount; group++)
+					_mm_storeu_ps(pSums + frame * outputChannels + group * 4, sums[group]);
+			}
+		}
+#endif // ENSD_SIMD_SSE2
+	}
+
+	void MixBuffer(float* pDestination, const float* pSource, float gain, uint64 sampleCount)
+	{
+		uint64 index = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		const __m128 gainVector = _mm_set1_ps(gain);
+		for (; index + 8 <= sampleCount; index += 8)
+		{
+			const __m128 low = _mm_add_ps(_mm_loadu_ps(pDestination + index), _mm_mul_ps(_mm_loadu_ps(pSource + index), gainVector));
+			const __m128 high = _mm_add_ps(_mm_loadu_ps(pDestination + index + 4), _mm_mul_ps(_mm_loadu_ps(pSource + index + 4), gainVector));
+
+			_mm_storeu_ps(pDestination + index, low);
+			_mm_storeu_ps(pDestination + index + 4, high);
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+			pDestination[index] += pSource[index] * gain;
+	}
+
+	void ScaleBuffer(float* pBuffer, float gain, uint64 sampleCount)
+	{
+		uint64 index = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		const __m128 gainVector = _mm_set1_ps(gain);
+		for (; index + 4 <= sampleCount; index += 4)
+			_mm_storeu_ps(pBuffer + index, _mm_mul_ps(_mm_loadu_ps(pBuffer + index), gainVector));
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+			pBuffer[index] *= gain;
+	}
+
+	void ComputeRamp(float* pOutput, float start, float end, uint32 offset, uint32 count, uint32 rampLength, RampCurve curve)
+	{
+		uint32 index = 0;
+
+		if (curve == RampCurve::RAMP_CURVE_EXPONENTIAL && start > 0.0f && end > 0.0f)
+		{
+			// Every sample is the previous one times a constant ratio, starting from the exact value at the offset.
+			const double ratio = std::pow(static_cast<double>(end) / start, 1.0 / rampLength);
+			const float stepRatio = static_cast<float>(ratio);
+			float value = static_cast<float>(start * std::pow(ratio, offset + 1.0));
+
+#ifdef ENSD_SIMD_SSE2
+			const float ratio2 = stepRatio * stepRatio;
+			const __m128 laneRatios = _mm_setr_ps(1.0f, stepRatio, ratio2, ratio2 * stepRatio);
+			const __m128 blockRatio = _mm_set1_ps(ratio2 * ratio2);
+
+			__m128 values = _mm_mul_ps(_mm_set1_ps(value), laneRatios);
+			for (; index + 4 <= count; index += 4)
+			{
+				_mm_storeu_ps(pOutput + index, values);
+				values = _mm_mul_ps(values, blockRatio);
+			}
+
+			value = _mm_cvtss_f32(values);
+#endif // ENSD_SIMD_SSE2
+
+			for (; index < count; index++)
+			{
+				pOutput[index] = value;
+				value *= stepRatio;
+			}
+		}
+		else
+		{
+			// Every sample is computed from its own index, so there is no drift.
+			const float step = (end - start) / rampLength;
+
+#ifdef ENSD_SIMD_SSE2
+			const __m128 startVector = _mm_set1_ps(start);
+			const __m128 stepVector = _mm_set1_ps(step);
+			const __m128 laneOffsets = _mm_setr_ps(1.0f, 2.0f, 3.0f, 4.0f);
+
+			for (; index + 4 <= count; index += 4)
+			{
+				const __m128 steps = _mm_add_ps(_mm_set1_ps(static_cast<float>(offset + index)), laneOffsets);
+				_mm_storeu_ps(pOutput + index, _mm_add_ps(startVector, _mm_mul_ps(steps, stepVector)));
+			}
+#endif // ENSD_SIMD_SSE2
+
+			for (; index < count; index++)
+				pOutput[index] = start + static_cast<float>(offset + index + 1) * step;
+		}
+
+		// The ramp always lands exactly on the end value.
+		if (count && offset + count == rampLength)
+			pOutput[count - 1] = end;
+	}
+
+	void MixBufferRamped(float* pDestination, const float* pSource, float startGain, float endGain, uint32 frameCount, uint32 channelCount, RampCurve curve)
+	{
+		if (startGain == endGain)
+			MixBuffer(pDestination, pSource, endGain, static_cast<uint64>(frameCount) * channelCount);
+		else
+			ApplyRamp(pDestination, pSource, startGain, endGain, frameCount, channelCount, curve);
+	}
+
+	void ScaleBufferRamped(float* pBuffer, float startGain, float endGain, uint32 frameCount, uint32 channelCount, RampCurve curve)
+	{
+		if (startGain == endGain)
+			ScaleBuffer(pBuffer, endGain, static_cast<uint64>(frameCount) * channelCount);
+		else
+			ApplyRamp(pBuffer, nullptr, startGain, endGain, frameCount, channelCount, curve);
+	}
+
+	void Upsample(float* pOutput, const float* pInput, uint32 frameCount, uint32 channelCount)
+	{
+		// Output frames 2m and 2m + 1 come from input frame m - latency and from the pairs around it, which reach back
+		// to the oldest history frame.
+		const int64 stride = channelCount;
+		const float* pCenter = pInput - static_cast<int64>(UpsamplerLatency) * stride;
+		const uint64 sampleCount = static_cast<uint64>(frameCount) * channelCount;
+		uint64 index = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		if (channelCount <= 2)
+		{
+			for (; index + 4 <= sampleCount; index += 4)
+			{
+				const float* pSample = pCenter + index;
+				__m128 odd = _mm_setzero_ps();
+				for (uint32 tap = 0; tap < UpsamplerTapCount; tap++)
+				{
+					const __m128 pair = _mm_add_ps(_mm_loadu_ps(pSample - tap * stride), _mm_loadu_ps(pSample + (tap + 1) * stride));
+					odd = _mm_add_ps(odd, _mm_mul_ps(pair, _mm_set1_ps(UpsamplerTaps[tap])));
+				}
+
+				const __m128 even = _mm_loadu_ps(pSample);
+				float* pFrames = pOutput + index * 2;
+				if (channelCount == 1)
+				{
+					_mm_storeu_ps(pFrames, _mm_unpacklo_ps(even, odd));
+					_mm_storeu_ps(pFrames + 4, _mm_unpackhi_ps(even, odd));
+				}
+				else
+				{
+					_mm_storeu_ps(pFrames, _mm_movelh_ps(even, odd));
+					_mm_storeu_ps(pFrames + 4, _mm_movehl_ps(odd, even));
+				}
+			}
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+		{
+			const float* pSample = pCenter + index;
+			float odd = 0.0f;
+			for (uint32 tap = 0; tap < UpsamplerTapCount; tap++)
+				odd += (pSample[-static_cast<int64>(tap) * stride] + pSample[(tap + 1) * stride]) * UpsamplerTaps[tap];
+
+			// Every input sample is followed by the odd sample of its channel one output frame later.
+			const uint64 frame = index / channelCount;
+			const uint64 outputIndex = index + frame * channelCount;
+			pOutput[outputIndex] = pSample[0];
+			pOutput[outputIndex + channelCount] = odd;
+		}
+	}
+
+	void Downsample(float* pOutput, const float* pInput, uint32 frameCount, uint32 channelCount)
+	{
+		// The same halfband as the upsampler at half the gain: the center frame weighs a half and the pairs around it
+		// weigh half of their taps.
+		const int64 stride = channelCount;
+		for (uint32 frame = 0; frame < frameCount; frame++)
+		{
+			for (uint32 channel = 0; channel < channelCount; channel++)
+			{
+				const float* pSample = pInput + static_cast<int64>(frame) * 2 * stride + channel;
+				float sum = 0.0f;
+				for (uint32 tap = 0; tap < UpsamplerTapCount; tap++)
+					sum += (pSample[-static_cast<int64>(tap * 2 + 1) * stride] + pSample[(tap * 2 + 1) * stride]) * UpsamplerTaps[tap];
+
+				pOutput[static_cast<uint64>(frame) * channelCount + channel] = (pSample[0] + sum) * 0.5f;
+			}
+		}
+	}
+
+	void MixMatrix(float* pOutput, const float* pInput, const float* pColumns, uint32 frameCount, uint32 inputChannels, uint32 outputChannels)
+	{
+		const uint32 stride = (outputChannels + 3) & ~3U;
+		uint32 frame = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		// The sums of a chunk of frames are stored back to back and mixed in with one pass. Reading the output per frame
+		// instead would load across the store of the last frame whenever the output count is not a multiple of 4, which
+		// stalls store forwarding.
+		alignas(16) float sums[MatrixChunkFrames * MaxMatrixOutputs + 4];
+		for (; frame < frameCount; frame += MatrixChunkFrames)
+		{
+			const uint32 chunkFrames = std::min(MatrixChunkFrames, frameCount - frame);
+			const float* pSamples = pInput + static_cast<uint64>(frame) * inputChannels;
+			switch (stride / 4)
+			{
+			case 1:
+				SumMatrixChunk<1>(sums, pSamples, pColumns, chunkFrames, inputChannels, outputChannels);
+				break;
+			case 2:
+				SumMatrixChunk<2>(sums, pSamples, pColumns, chunkFrames, inputChannels, outputChannels);
+				break;
+			case 3:
+				SumMatrixChunk<3>(sums, pSamples, pColumns, chunkFrames, inputChannels, outputChannels);
+				break;
+			default:
+				SumMatrixChunk<4>(sums, pSamples, pColumns, chunkFrames, inputChannels, outputChannels);
+				break;
+			}
+
+			MixBuffer(pOutput + static_cast<uint64>(frame) * outputChannels, sums, 1.0f, static_cast<uint64>(chunkFrames) * outputChannels);
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; frame < frameCount; frame++)
+		{
+			float* pFrame = pOutput + static_cast<uint64>(frame) * outputChannels;
+			const float* pSamples = pInput + static_cast<uint64>(frame) * inputChannels;
+			for (uint32 output = 0; output < outputChannels; output++)
+			{
+				float sum = 0.0f;
+				for (uint32 channel = 0; channel < inputChannels; channel++)
+					sum += pSamples[channel] * pColumns[static_cast<uint64>(channel) * stride + output];
+
+				pFrame[output] += sum;
+			}
+		}
+	}
+
+	float ComputePeak(const float* pBuffer, uint64 sampleCount)
+	{
+		uint64 index = 0;
+		float peak = 0.0f;
+
+#ifdef ENSD_SIMD_SSE2
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		__m128 peaks = _mm_setzero_ps();
+		for (; index + 4 <= sampleCount; index += 4)
+			peaks = _mm_max_ps(peaks, _mm_andnot_ps(signMask, _mm_loadu_ps(pBuffer + index)));
+
+		peaks = _mm_max_ps(peaks, _mm_movehl_ps(peaks, peaks));
+		peaks = _mm_max_ss(peaks, _mm_shuffle_ps(peaks, peaks, 1));
+		peak = _mm_cvtss_f32(peaks);
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+			peak = std::max(peak, std::fabs(pBuffer[index]));
+
+		return peak;
+	}
+}
\ No newline at end of file
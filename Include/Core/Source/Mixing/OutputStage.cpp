@@ -0,0 +1,256 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/OutputStage.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float RandomScale = 1.0f / 4294967296.0f;	// Maps a signed 32 bit random to [-0.5, 0.5).
+		const float ShaperTaps[3] = { 1.623f, -0.982f, 0.109f };	// The error feedback taps of the noise shaper, newest error first.
+		const float ShaperErrorLimit = 2.0f;	// The largest error fed back in LSBs, which only clipped samples go past.
+
+		/**
+		 * Step a xorshift generator and map it to a uniform value.
+		 */
+		inline float NextUniform(uint32& state)
+		{
+			state ^= state << 13;
+			state ^= state >> 17;
+			state ^= state << 5;
+			return static_cast<float>(static_cast<int32>(state)) * RandomScale;
+		}
+
+		/**
+		 * Get the triangular dither of a sample from the generator of its SIMD lane.
+		 */
+		inline float NextDither(uint32* pStates, uint64 index)
+		{
+			const float first = NextUniform(pStates[index & 3]);
+			const float second = NextUniform(pStates[index & 3]);
+			return first - second;
+		}
+
+		/**
+		 * Clamp a scaled sample to full scale and round it, the same way the SIMD path does.
+		 */
+		inline int32 QuantizeSample(float sample, float minimum, float maximum, uint64& clippedCount)
+		{
+			if (sample < minimum || sample > maximum)
+				clippedCount++;
+
+			sample = sample > minimum ? sample : minimum;
+			sample = sample < maximum ? sample : maximum;
+
+#ifdef ENSD_SIMD_SSE2
+			return _mm_cvtss_si32(_mm_set_ss(sample));
+
+#else
+			return static_cast<int32>(std::lrint(sample));
+
+#endif // ENSD_SIMD_SSE2
+		}
+
+		/**
+		 * Write a sample into the destination in little endian order.
+		 */
+		inline void WriteSample(uint8* pDestination, uint64 index, int32 sample, uint32 sampleBytes)
+		{
+			uint8* pSample = pDestination + index * sampleBytes;
+			for (uint32 byte = 0; byte < sampleBytes; byte++)
+				pSample[byte] = static_cast<uint8>(static_cast<uint32>(sample) >> (byte * 8));
+		}
+
+#ifdef ENSD_SIMD_SSE2
+		/**
+		 * Step the xorshift generators of the 4 lanes and map them to uniform values.
+		 */
+		inline __m128 NextUniform(__m128i& states)
+		{
+			states = _mm_xor_si128(states, _mm_slli_epi32(states, 13));
+			states = _mm_xor_si128(states, _mm_srli_epi32(states, 17));
+			states = _mm_xor_si128(states, _mm_slli_epi32(states, 5));
+			return _mm_mul_ps(_mm_cvtepi32_ps(states), _mm_set1_ps(RandomScale));
+		}
+
+		/**
+		 * Scale, dither, clamp and round 4 samples, counting the clamped lanes.
+		 */
+		inline __m128i QuantizeSamples(const float* pInput, __m128 scale, __m128 minimum, __m128 maximum, bool dither, __m128i& states, __m128i& clippedCounts)
+		{
+			__m128 samples = _mm_mul_ps(_mm_loadu_ps(pInput), scale);
+			if (dither)
+			{
+				const __m128 first = NextUniform(states);
+				const __m128 second = NextUniform(states);
+				samples = _mm_add_ps(samples, _mm_sub_ps(first, second));
+			}
+
+			// The comparison masks are -1 in the clipped lanes.
+			const __m128 clipped = _mm_or_ps(_mm_cmplt_ps(samples, minimum), _mm_cmpgt_ps(samples, maximum));
+			clippedCounts = _mm_sub_epi32(clippedCounts, _mm_castps_si128(clipped));
+
+			return _mm_cvtps_epi32(_mm_min_ps(_mm_max_ps(samples, minimum), maximum));
+		}
+
+		/**
+		 * Pack 4 samples into 12 bytes of 24 bit samples.
+		 */
+		inline void WriteSamples24(uint8* pDestination, __m128i samples)
+		{
+			// Every 64 bit half holds 2 samples, the second is shifted down next to the first, then the upper half is
+			// shifted down next to the lower one.
+			samples = _mm_and_si128(samples, _mm_set1_epi32(0x00FFFFFF));
+			const __m128i first = _mm_and_si128(samples, _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF));
+			const __m128i second = _mm_and_si128(_mm_srli_epi64(samples, 8), _mm_set_epi32(0x0000FFFF, static_cast<int32>(0xFF000000), 0x0000FFFF, static_cast<int32>(0xFF000000)));
+			const __m128i halves = _mm_or_si128(first, second);
+			const __m128i packed = _mm_or_si128(_mm_move_epi64(halves), _mm_slli_si128(_mm_srli_si128(halves, 8), 6));
+
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(pDestination), packed);
+			const int32 tail = _mm_cvtsi128_si32(_mm_srli_si128(packed, 8));
+			std::memcpy(pDestination + 8, &tail, sizeof(int32));
+		}
+#endif // ENSD_SIMD_SSE2
+	}
+
+	void OutputStage::Initialize(const OutputStageDescription& description)
+	{
+		Terminate();
+
+		mDescription = description;
+		mSampleBytes = description.mFormat == OutputFormat::OUTPUT_FORMAT_INT16 ? 2 : 3;
+		mScale = description.mFormat == OutputFormat::OUTPUT_FORMAT_INT16 ? 32768.0f : 8388608.0f;
+		mErrors.assign(static_cast<uint64>(description.mChannelCount) * 3, 0.0f);
+
+		// The seed is hashed per lane, so nearby seeds still start unrelated sequences. Xorshift must not start at 0.
+		for (uint32 lane = 0; lane < 4; lane++)
+		{
+			uint32 state = description.mSeed + lane * 0x9E3779B9U;
+			state = (state ^ (state >> 16)) * 0x85EBCA6BU;
+			state = (state ^ (state >> 13)) * 0xC2B2AE35U;
+			state ^= state >> 16;
+			mRandom[lane] = state ? state : 0x9E3779B9U;
+		}
+	}
+
+	void OutputStage::Terminate()
+	{
+		mErrors.clear();
+		for (uint32& state : mRandom)
+			state = 0;
+
+		mDescription = {};
+		mScale = 0.0f;
+		mSampleBytes = 0;
+		mClippedSampleCount = 0;
+	}
+
+	void OutputStage::Convert(void* pDestination, const float* pInput, uint32 frameCount)
+	{
+		const uint32 channelCount = mDescription.mChannelCount;
+		const uint64 sampleCount = static_cast<uint64>(frameCount) * channelCount;
+		uint8* pBytes = static_cast<uint8*>(pDestination);
+		const float minimum = -mScale;
+		const float maximum = mScale - 1.0f;
+		uint64 clippedCount = 0;
+
+		if (mDescription.mDither == DitherMode::DITHER_MODE_SHAPED)
+		{
+			// The recursion runs through the frames of a channel, so a channel is done at a time with its shaper state
+			// and its generator held in registers.
+			for (uint32 channel = 0; channel < channelCount; channel++)
+			{
+				float* pErrors = mErrors.data() + static_cast<uint64>(channel) * 3;
+				float errors[3] = { pErrors[0], pErrors[1], pErrors[2] };
+				uint32 state = mRandom[channel & 3];
+
+				for (uint32 frame = 0; frame < frameCount; frame++)
+				{
+					const uint64 index = static_cast<uint64>(frame) * channelCount + channel;
+					// Only the newest error is on the path from one frame to the next, the rest is summed ahead of it.
+					const float first = NextUniform(state);
+					const float second = NextUniform(state);
+					const float shaped = pInput[index] * mScale - (ShaperTaps[1] * errors[1] + ShaperTaps[2] * errors[2]);
+					const float target = shaped - ShaperTaps[0] * errors[0];
+					const int32 sample = QuantizeSample(target + (first - second), minimum, maximum, clippedCount);
+					const float error = static_cast<float>(sample) - target;
+
+					errors[2] = errors[1];
+					errors[1] = errors[0];
+					errors[0] = error < -ShaperErrorLimit ? -ShaperErrorLimit : (error > ShaperErrorLimit ? ShaperErrorLimit : error);
+					WriteSample(pBytes, index, sample, mSampleBytes);
+				}
+
+				std::copy(errors, errors + 3, pErrors);
+				mRandom[channel & 3] = state;
+			}
+
+			mClippedSampleCount += clippedCount;
+			return;
+		}
+
+		const bool dither = mDescription.mDither == DitherMode::DITHER_MODE_TPDF;
+		uint64 index = 0;
+
+#ifdef ENSD_SIMD_SSE2
+		const __m128 scale = _mm_set1_ps(mScale);
+		const __m128 minimumVector = _mm_set1_ps(minimum);
+		const __m128 maximumVector = _mm_set1_ps(maximum);
+		__m128i states = _mm_loadu_si128(reinterpret_cast<const __m128i*>(mRandom));
+		__m128i clippedCounts = _mm_setzero_si128();
+
+		if (mDescription.mFormat == OutputFormat::OUTPUT_FORMAT_INT16)
+		{
+			// The samples are already clamped, so the saturating pack only narrows them.
+			for (; index + 8 <= sampleCount; index += 8)
+			{
+				const __m128i low = QuantizeSamples(pInput + index, scale, minimumVector, maximumVector, dither, states, clippedCounts);
+				const __m128i high = QuantizeSamples(pInput + index + 4, scale, minimumVector, maximumVector, dither, states, clippedCounts);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(pBytes + index * 2), _mm_packs_epi32(low, high));
+			}
+		}
+		else
+		{
+			for (; index + 4 <= sampleCount; index += 4)
+				WriteSamples24(pBytes + index * 3, QuantizeSamples(pInput + index, scale, minimumVector, maximumVector, dither, states, clippedCounts));
+		}
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(mRandom), states);
+
+		uint32 laneCounts[4] = {};
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(laneCounts), clippedCounts);
+		clippedCount = static_cast<uint64>(laneCounts[0]) + laneCounts[1] + laneCounts[2] + laneCounts[3];
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < sampleCount; index++)
+		{
+			const float sample = pInput[index] * mScale + (dither ? NextDither(mRandom, index) : 0.0f);
+			WriteSample(pBytes, index, QuantizeSample(sample, minimum, maximum, clippedCount), mSampleBytes);
+		}
+
+		mClippedSampleCount += clippedCount;
+	}
+
+	void OutputStage::Reset()
+	{
+		std::fill(mErrors.begin(), mErrors.end(), 0.0f);
+	}
+
+	WAVFormat OutputStage::GetWAVFormat(uint64 sampleRate) const
+	{
+		WAVFormat format = {};
+		format.mFormatTag = static_cast<uint16>(WAVFormatTag::WAV_FORMAT_TAG_PCM);
+		format.mChannels = static_cast<uint16>(mDescription.mChannelCount);
+		format.mSampleRate = sampleRate;
+		format.mBlockAlignment = static_cast<uint16>(GetFrameBytes());
+		format.mAvgByteRate = sampleRate * format.mBlockAlignment;
+		format.mBitsPerSample = static_cast<uint16>(mSampleBytes * 8);
+		return format;
+	}
+}
\ No newline at end of file
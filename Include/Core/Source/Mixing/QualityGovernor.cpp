@@ -0,0 +1,201 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/QualityGovernor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float AverageTime = 1.0f;	// The time in seconds the average load is smoothed over.
+		const uint32 FullReverbLineCount = 16;	// The line count asked of the reverbs at full quality, clamped to their own.
+		const uint32 ReducedReverbLineCount = 8;	// The line count of the reverbs from the reduced reverb level.
+	}
+
+	void QualityGovernor::Initialize(const QualityGovernorDescription& description)
+	{
+		Terminate();
+
+		mDescription = description;
+		mDescription.mSampleRate = std::max(description.mSampleRate, 1U);
+		SetLevel(QualityLevel::QUALITY_LEVEL_FULL);
+	}
+
+	void QualityGovernor::Terminate()
+	{
+		mVoiceTables.clear();
+		mBinauralRenderers.clear();
+		mReverbs.clear();
+
+		mLevel = QualityLevel::QUALITY_LEVEL_FULL;
+		mOverBudgetBlocks = 0;
+		mUnderBudgetBlocks = 0;
+		mBlocksSinceStepUp = ~0U;
+		mBackoff = 1;
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats = {};
+	}
+
+	void QualityGovernor::AddVoiceTable(VoiceTable* pTable)
+	{
+		if (!pTable)
+			return;
+
+		mVoiceTables.insert(mVoiceTables.end(), pTable);
+		ApplyLevel(pTable);
+	}
+
+	void QualityGovernor::RemoveVoiceTable(VoiceTable* pTable)
+	{
+		mVoiceTables.erase(std::remove(mVoiceTables.begin(), mVoiceTables.end(), pTable), mVoiceTables.end());
+	}
+
+	void QualityGovernor::AddBinauralRenderer(BinauralRenderer* pRenderer)
+	{
+		if (!pRenderer)
+			return;
+
+		mBinauralRenderers.insert(mBinauralRenderers.end(), pRenderer);
+		ApplyLevel(pRenderer);
+	}
+
+	void QualityGovernor::RemoveBinauralRenderer(BinauralRenderer* pRenderer)
+	{
+		mBinauralRenderers.erase(std::remove(mBinauralRenderers.begin(), mBinauralRenderers.end(), pRenderer), mBinauralRenderers.end());
+	}
+
+	void QualityGovernor::AddReverb(FDNReverb* pReverb)
+	{
+		if (!pReverb)
+			return;
+
+		mReverbs.insert(mReverbs.end(), pReverb);
+		ApplyLevel(pReverb);
+	}
+
+	void QualityGovernor::RemoveReverb(FDNReverb* pReverb)
+	{
+		mReverbs.erase(std::remove(mReverbs.begin(), mReverbs.end(), pReverb), mReverbs.end());
+	}
+
+	void QualityGovernor::EndBlock(uint32 frameCount)
+	{
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - mBlockStart;
+		ReportBlock(elapsed.count(), frameCount);
+	}
+
+	void QualityGovernor::ReportBlock(double seconds, uint32 frameCount)
+	{
+		if (!frameCount)
+			return;
+
+		const double blockTime = static_cast<double>(frameCount) / mDescription.mSampleRate;
+		const float load = static_cast<float>(seconds / blockTime);
+		const float averageScale = std::min(static_cast<float>(blockTime) / AverageTime, 1.0f);
+
+		mStepDownBlocks = std::max(static_cast<uint32>(std::ceil(mDescription.mStepDownTime / blockTime)), 1U);
+		mStepUpBlocks = std::max(static_cast<uint32>(std::ceil(mDescription.mStepUpTime / blockTime)), 1U);
+		mBlocksSinceStepUp = std::min(mBlocksSinceStepUp, ~0U - 1) + 1;
+
+		// A step up which held for the whole step up time was not too early, so the next one waits the normal time.
+		// A step down since the last step up saturates the count, so it never gets here.
+		if (mBlocksSinceStepUp == mStepUpBlocks)
+			mBackoff = 1;
+
+		const uint8 level = static_cast<uint8>(mLevel);
+		const uint8 lowestLevel = static_cast<uint8>(QualityLevel::QUALITY_LEVEL_REDUCED_VOICES);
+		if (load > mDescription.mBudget)
+		{
+			mUnderBudgetBlocks = 0;
+			mOverBudgetBlocks++;
+
+			// A block which missed its deadline was already heard, so the next one must not wait.
+			if ((load >= 1.0f || mOverBudgetBlocks >= mStepDownBlocks) && level < lowestLevel)
+			{
+				if (mBlocksSinceStepUp < mStepUpBlocks)
+					mBackoff = std::min(mBackoff * 2, static_cast<uint32>(MaxBackoff));
+
+				mOverBudgetBlocks = 0;
+				mBlocksSinceStepUp = ~0U;
+				SetLevel(static_cast<QualityLevel>(level + 1));
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStats.mStepDownCount++;
+			}
+		}
+		else
+		{
+			mOverBudgetBlocks = 0;
+			mUnderBudgetBlocks = load < mDescription.mBudget * mDescription.mRecoveryRatio ? mUnderBudgetBlocks + 1 : 0;
+
+			if (level > 0 && mUnderBudgetBlocks >= mStepUpBlocks * mBackoff)
+			{
+				mUnderBudgetBlocks = 0;
+				mBlocksSinceStepUp = 0;
+				SetLevel(static_cast<QualityLevel>(level - 1));
+
+				std::lock_guard<std::mutex> lock(mMutex);
+				mStats.mStepUpCount++;
+			}
+		}
+
+		uint32 virtualVoiceCount = 0;
+		for (const VoiceTable* pTable : mVoiceTables)
+			virtualVoiceCount += pTable->GetVirtualVoiceCount();
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.mVirtualVoiceCount = virtualVoiceCount;
+		mStats.mLoad = load;
+		mStats.mAverageLoad = mStats.mBlockCount ? mStats.mAverageLoad + (load - mStats.mAverageLoad) * averageScale : load;
+		mStats.mPeakLoad = std::max(mStats.mPeakLoad, load);
+		mStats.mBlockCount++;
+		if (load >= 1.0f)
+			mStats.mOverrunCount++;
+	}
+
+	QualityGovernorStats QualityGovernor::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mStats;
+	}
+
+	void QualityGovernor::SetLevel(QualityLevel level)
+	{
+		mLevel = level;
+		for (VoiceTable* pTable : mVoiceTables)
+			ApplyLevel(pTable);
+
+		for (BinauralRenderer* pRenderer : mBinauralRenderers)
+			ApplyLevel(pRenderer);
+
+		for (FDNReverb* pReverb : mReverbs)
+			ApplyLevel(pReverb);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStats.mLevel = level;
+		mStats.mResamplerQuality = level >= QualityLevel::QUALITY_LEVEL_LINEAR_RESAMPLING ? ResamplerQuality::RESAMPLER_QUALITY_LINEAR : mDescription.mResamplerQuality;
+		mStats.mMaxHRTFVoices = level >= QualityLevel::QUALITY_LEVEL_REDUCED_HRTF ? mDescription.mReducedHRTFVoices : mDescription.mMaxHRTFVoices;
+		mStats.mReverbLineCount = level >= QualityLevel::QUALITY_LEVEL_REDUCED_REVERB ? ReducedReverbLineCount : FullReverbLineCount;
+		mStats.mMaxRealVoices = level >= QualityLevel::QUALITY_LEVEL_REDUCED_VOICES ? mDescription.mReducedRealVoices : mDescription.mMaxRealVoices;
+	}
+
+	void QualityGovernor::ApplyLevel(VoiceTable* pTable) const
+	{
+		pTable->SetResamplerQuality(mLevel >= QualityLevel::QUALITY_LEVEL_LINEAR_RESAMPLING ? ResamplerQuality::RESAMPLER_QUALITY_LINEAR : mDescription.mResamplerQuality);
+		pTable->SetMaxRealVoices(mLevel >= QualityLevel::QUALITY_LEVEL_REDUCED_VOICES ? mDescription.mReducedRealVoices : mDescription.mMaxRealVoices);
+	}
+
+	void QualityGovernor::ApplyLevel(BinauralRenderer* pRenderer) const
+	{
+		pRenderer->SetMaxHRTFVoices(mLevel >= QualityLevel::QUALITY_LEVEL_REDUCED_HRTF ? mDescription.mReducedHRTFVoices : mDescription.mMaxHRTFVoices);
+	}
+
+	void QualityGovernor::ApplyLevel(FDNReverb* pReverb) const
+	{
+		pReverb->SetLineCount(mLevel >= QualityLevel::QUALITY_LEVEL_REDUCED_REVERB ? ReducedReverbLineCount : FullReverbLineCount);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,154 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/SampleLODSet.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+
+namespace EnSound
+{
+	namespace
+	{
+		const uint32 DecimationChunkFrames = 1024;	// The number of output frames decimated at once.
+
+		/**
+		 * Halve the rate of interleaved samples, folding them to mono on the way if asked to.
+		 * The filter reads past the ends of the samples, where a looping sound wraps around and any other sound is silent.
+		 */
+		void Decimate(const float* pInput, uint64 inputFrames, uint32 inputChannels, bool isLooping, bool isFolded, Vector<float>& output)
+		{
+			const uint32 outputChannels = isFolded ? 1 : inputChannels;
+			const uint64 outputFrames = (inputFrames + 1) / 2;
+			output.assign(outputFrames * outputChannels, 0.0f);
+
+			Vector<float> padded((static_cast<uint64>(DecimationChunkFrames) * 2 + UpsamplerHistoryFrames * 2) * outputChannels);
+			for (uint64 chunk = 0; chunk < outputFrames; chunk += DecimationChunkFrames)
+			{
+				const uint32 chunkFrames = static_cast<uint32>(std::min<uint64>(DecimationChunkFrames, outputFrames - chunk));
+				const int64 first = static_cast<int64>(chunk * 2) - UpsamplerHistoryFrames;
+				const uint32 paddedFrames = chunkFrames * 2 + UpsamplerHistoryFrames * 2;
+				for (uint32 i = 0; i < paddedFrames; i++)
+				{
+					int64 frame = first + i;
+					if (isLooping)
+						frame = ((frame % static_cast<int64>(inputFrames)) + static_cast<int64>(inputFrames)) % static_cast<int64>(inputFrames);
+
+					const bool isInside = frame >= 0 && frame < static_cast<int64>(inputFrames);
+					const float* pFrame = pInput + (isInside ? frame : 0) * inputChannels;
+					if (isFolded)
+						padded[i] = isInside ? (pFrame[0] + pFrame[inputChannels - 1]) * 0.5f : 0.0f;
+					else
+						for (uint32 channel = 0; channel < inputChannels; channel++)
+							padded[static_cast<uint64>(i) * inputChannels + channel] = isInside ? pFrame[channel] : 0.0f;
+				}
+
+				Downsample(output.data() + chunk * outputChannels, padded.data() + static_cast<uint64>(UpsamplerHistoryFrames) * outputChannels, chunkFrames, outputChannels);
+			}
+		}
+	}
+
+	bool SampleLODSet::Initialize(const SampleLODSetDescription& description)
+	{
+		Terminate();
+
+		if (!description.pSamples || !description.mFrameCount || description.mChannelCount < 1 || description.mChannelCount > 2 || !description.mLODCount || description.mLODCount > MaxLODCount)
+		{
+			Logger::LogError(STRING("Invalid sample LOD set description!"));
+			return false;
+		}
+
+		mDescription = description;
+		mFrameCounts[0] = description.mFrameCount;
+		for (uint32 lod = 1; lod < MaxLODCount; lod++)
+			mFrameCounts[lod] = (mFrameCounts[lod - 1] + 1) / 2;
+
+		mIsResident[0].store(true, std::memory_order_release);
+		if (!description.mIsLazy)
+			for (uint32 lod = 1; lod < description.mLODCount; lod++)
+				Generate(lod);
+
+		return true;
+	}
+
+	void SampleLODSet::Terminate()
+	{
+		for (uint32 lod = 0; lod < MaxLODCount; lod++)
+		{
+			mIsResident[lod].store(false, std::memory_order_relaxed);
+			mIsRequested[lod].store(false, std::memory_order_relaxed);
+			mReaderCounts[lod].store(0, std::memory_order_relaxed);
+			mLODs[lod].clear();
+			mLODs[lod].shrink_to_fit();
+			mFrameCounts[lod] = 0;
+		}
+
+		mDescription = {};
+	}
+
+	bool SampleLODSet::Generate(uint32 lod)
+	{
+		if (!lod || lod >= mDescription.mLODCount)
+			return IsResident(lod);
+
+		// An evicted LOD which voices were still reading was never freed, and they may read it still.
+		mIsRequested[lod].store(false, std::memory_order_relaxed);
+		if (!mLODs[lod].empty())
+		{
+			mIsResident[lod].store(true, std::memory_order_release);
+			return true;
+		}
+
+		// Start from the closest resident LOD, so a quarter rate LOD reuses a resident half rate one.
+		uint32 source = lod - 1;
+		while (!IsResident(source))
+			source--;
+
+		// The samples are complete before the LOD is published to the voices.
+		Vector<float> samples;
+		Vector<float> temporary;
+		for (uint32 current = source; current < lod; current++)
+		{
+			const float* pInput = current == source ? GetSamples(source) : temporary.data();
+			const bool isFolded = mDescription.mIsMonoFolded && mDescription.mChannelCount == 2 && current == 0;
+			Decimate(pInput, mFrameCounts[current], GetChannelCount(current), mDescription.mIsLooping, isFolded, samples);
+			temporary.swap(samples);
+		}
+
+		mLODs[lod].swap(temporary);
+		mIsResident[lod].store(true, std::memory_order_release);
+		return true;
+	}
+
+	void SampleLODSet::GenerateRequested()
+	{
+		for (uint32 lod = 1; lod < mDescription.mLODCount; lod++)
+			if (mIsRequested[lod].load(std::memory_order_relaxed))
+				Generate(lod);
+	}
+
+	bool SampleLODSet::Evict(uint32 lod)
+	{
+		if (!lod || lod >= mDescription.mLODCount)
+			return false;
+
+		mIsResident[lod].store(false, std::memory_order_relaxed);
+		mIsRequested[lod].store(false, std::memory_order_relaxed);
+		if (mReaderCounts[lod].load(std::memory_order_relaxed))
+			return false;
+
+		mLODs[lod].clear();
+		mLODs[lod].shrink_to_fit();
+		return true;
+	}
+
+	uint64 SampleLODSet::GetMemorySize() const
+	{
+		uint64 size = 0;
+		for (const auto& samples : mLODs)
+			size += samples.capacity() * sizeof(float);
+
+		return size;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,1169 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Mixing/VoiceTable.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		inline uint64 MakeHandle(uint32 slot, uint32 generation) { return (static_cast<uint64>(generation) << 32) | slot; }
+		inline uint32 GetSlot(uint64 handle) { return static_cast<uint32>(handle & 0xFFFFFFFF); }
+		inline uint32 GetGeneration(uint64 handle) { return static_cast<uint32>(handle >> 32); }
+
+		const float RealVoicePriority = 2.0f;	// The priority boost of voices which are not culled by the real voice cap.
+		const float LODHysteresis = 1.41f;	// How far above the gain of its LOD a voice must get to switch to a finer one, 3 dB.
+
+		/**
+		 * 4 point Hermite interpolation between the second and third samples.
+		 */
+		inline float Hermite(float y0, float y1, float y2, float y3, float fraction)
+		{
+			const float c1 = 0.5f * (y2 - y0);
+			const float c2 = y0 - 2.5f * y1 + 2.0f * y2 - 0.5f * y3;
+			const float c3 = 0.5f * (y3 - y0) + 1.5f * (y1 - y2);
+			return ((c3 * fraction + c2) * fraction + c1) * fraction + y1;
+		}
+
+		/**
+		 * Read frames of samples as stereo pairs at a cursor moving by per frame pitch ratios, interpolating between
+		 * the two closest frames linearly or with a cubic through their neighbours too.
+		 *
+		 * @return The number of frames read, fewer than asked once samples which do not loop end.
+		 */
+		uint32 ReadSamples(const float* pSamples, uint64 sourceFrames, uint32 sourceChannels, bool isLooping, bool isCubic, const float* pPitchRatios, float pitchScale, uint32 frameCount, double& cursor, float* pFrames)
+		{
+			uint32 produced = 0;
+			for (; produced < frameCount; produced++)
+			{
+				if (cursor >= sourceFrames)
+				{
+					if (!isLooping)
+						break;
+
+					cursor = std::fmod(cursor, static_cast<double>(sourceFrames));
+				}
+
+				const uint64 position = static_cast<uint64>(cursor);
+				const uint64 next = (position + 1 < sourceFrames) ? position + 1 : (isLooping ? 0 : position);
+				const float fraction = static_cast<float>(cursor - static_cast<double>(position));
+
+				const float* pCurrent = pSamples + position * sourceChannels;
+				const float* pNext = pSamples + next * sourceChannels;
+
+				if (isCubic)
+				{
+					const uint64 previous = position > 0 ? position - 1 : (isLooping ? sourceFrames - 1 : 0);
+					const uint64 after = (next + 1 < sourceFrames) ? next + 1 : (isLooping ? 0 : next);
+					const float* pPrevious = pSamples + previous * sourceChannels;
+					const float* pAfter = pSamples + after * sourceChannels;
+					const uint32 last = sourceChannels - 1;
+
+					pFrames[produced * 2] = Hermite(pPrevious[0], pCurrent[0], pNext[0], pAfter[0], fraction);
+					pFrames[produced * 2 + 1] = Hermite(pPrevious[last], pCurrent[last], pNext[last], pAfter[last], fraction);
+				}
+				else
+				{
+					pFrames[produced * 2] = pCurrent[0] + (pNext[0] - pCurrent[0]) * fraction;
+					pFrames[produced * 2 + 1] = pCurrent[sourceChannels - 1] + (pNext[sourceChannels - 1] - pCurrent[sourceChannels - 1]) * fraction;
+				}
+
+				cursor += pPitchRatios[produced] * pitchScale;
+			}
+
+			return produced;
+		}
+
+		/**
+		 * Constant power panning: left = gain * sqrt((1 - pan) / 2), right = gain * sqrt((1 + pan) / 2).
+		 */
+		inline void ComputePanGains(float gain, float pan, float& left, float& right)
+		{
+			const float halfPan = pan * 0.5f;
+			left = gain * std::sqrt(std::max(0.5f - halfPan, 0.0f));
+			right = gain * std::sqrt(std::max(0.5f + halfPan, 0.0f));
+		}
+
+		/**
+		 * Add a run of source frames to an interleaved buffer with steady gains.
+		 * A mono bus gets both sides in its only channel, every other bus gets the voice in its first two channels.
+		 */
+		void MixRun(const float* pSource, uint32 sourceChannels, float* pOutput, uint32 channelCount, uint32 runFrames, float leftGain, float rightGain)
+		{
+			const uint32 rightChannel = channelCount == 1 ? 0 : 1;
+			uint32 i = 0;
+
+#ifdef ENSD_SIMD_SSE2
+			if (channelCount == 2)
+			{
+				const __m128 gains = _mm_setr_ps(leftGain, rightGain, leftGain, rightGain);
+				if (sourceChannels == 1)
+				{
+					for (; i + 4 <= runFrames; i += 4)
+					{
+						const __m128 samples = _mm_loadu_ps(pSource + i);
+						const __m128 low = _mm_unpacklo_ps(samples, samples);
+						const __m128 high = _mm_unpackhi_ps(samples, samples);
+
+						_mm_storeu_ps(pOutput + i * 2, _mm_add_ps(_mm_loadu_ps(pOutput + i * 2), _mm_mul_ps(low, gains)));
+						_mm_storeu_ps(pOutput + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(pOutput + i * 2 + 4), _mm_mul_ps(high, gains)));
+					}
+				}
+				else
+				{
+					for (; i + 2 <= runFrames; i += 2)
+						_mm_storeu_ps(pOutput + i * 2, _mm_add_ps(_mm_loadu_ps(pOutput + i * 2), _mm_mul_ps(_mm_loadu_ps(pSource + i * 2), gains)));
+				}
+			}
+#endif // ENSD_SIMD_SSE2
+
+			for (; i < runFrames; i++)
+			{
+				const float left = pSource[i * sourceChannels];
+				const float right = pSource[i * sourceChannels + sourceChannels - 1];
+
+				pOutput[i * channelCount] += left * leftGain;
+				pOutput[i * channelCount + rightChannel] += right * rightGain;
+			}
+		}
+
+		/**
+		 * Add stereo frames to an interleaved buffer with per frame gains.
+		 */
+		void MixFrames(const float* pFrames, const float* pLeftGains, const float* pRightGains, float* pOutput, uint32 channelCount, uint32 frameCount)
+		{
+			const uint32 rightChannel = channelCount == 1 ? 0 : 1;
+			uint32 i = 0;
+
+#ifdef ENSD_SIMD_SSE2
+			if (channelCount == 2)
+			{
+				for (; i + 4 <= frameCount; i += 4)
+				{
+					const __m128 left = _mm_loadu_ps(pLeftGains + i);
+					const __m128 right = _mm_loadu_ps(pRightGains + i);
+
+					_mm_storeu_ps(pOutput + i * 2, _mm_add_ps(_mm_loadu_ps(pOutput + i * 2), _mm_mul_ps(_mm_loadu_ps(pFrames + i * 2), _mm_unpacklo_ps(left, right))));
+					_mm_storeu_ps(pOutput + i * 2 + 4, _mm_add_ps(_mm_loadu_ps(pOutput + i * 2 + 4), _mm_mul_ps(_mm_loadu_ps(pFrames + i * 2 + 4), _mm_unpackhi_ps(left, right))));
+				}
+			}
+#endif // ENSD_SIMD_SSE2
+
+			for (; i < frameCount; i++)
+			{
+				pOutput[i * channelCount] += pFrames[i * 2] * pLeftGains[i];
+				pOutput[i * channelCount + rightChannel] += pFrames[i * 2 + 1] * pRightGains[i];
+			}
+		}
+	}
+
+	void VoiceTable::Initialize(uint32 capacity, uint32 sampleRate, uint32 rateDivisor)
+	{
+		Terminate();
+
+		mRateDivisor = std::max(rateDivisor, 1U);
+
+		mGains.resize(capacity);
+		mPans.resize(capacity);
+		mLeftGains.resize(capacity);
+		mRightGains.resize(capacity);
+		mPreviousLeftGains.resize(capacity);
+		mPreviousRightGains.resize(capacity);
+		mPitchRatios.resize(capacity);
+		mPreviousPitchRatios.resize(capacity);
+		mPositionsX.resize(capacity);
+		mPositionsY.resize(capacity);
+		mPositionsZ.resize(capacity);
+		mVelocitiesX.resize(capacity);
+		mVelocitiesY.resize(capacity);
+		mVelocitiesZ.resize(capacity);
+		mForwardsX.resize(capacity);
+		mForwardsY.resize(capacity);
+		mForwardsZ.resize(capacity);
+		mSpatialSettings.resize(capacity);
+		mSpatialLeftGains.resize(capacity);
+		mSpatialRightGains.resize(capacity);
+		mDopplerRatios.resize(capacity);
+		for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+		{
+			mSendLevels[slot].resize(capacity);
+			mPreviousSendLevels[slot].resize(capacity);
+		}
+
+		mLoudness.resize(capacity);
+		mPerceivedLoudness.resize(capacity);
+
+		mReadCursors.resize(capacity);
+		mSamples.resize(capacity);
+		mFrameCounts.resize(capacity);
+		mChannelCounts.resize(capacity);
+		mLODSets.resize(capacity);
+		mLODs.resize(capacity);
+		mPreviousLODs.resize(capacity);
+		mMinimumLODs.resize(capacity);
+		mSlots.resize(capacity);
+		mFlags.resize(capacity);
+		mOrder.resize(capacity);
+		mPriorities.resize(capacity);
+		mFilters.Initialize(capacity * 2, sampleRate / mRateDivisor);
+
+		// Generations start at 1 so that a handle is never 0.
+		mColdData.resize(capacity);
+		mFreeSlots.resize(capacity);
+		for (uint32 i = 0; i < capacity; i++)
+		{
+			mColdData[i].mGeneration = 1;
+			mFreeSlots[i] = capacity - i - 1;
+		}
+	}
+
+	void VoiceTable::Terminate()
+	{
+		// The LOD sets outlive the voices, so they hear about the LODs which are no longer read.
+		for (uint32 index = 0; index < mVoiceCount; index++)
+		{
+			if (!mLODSets[index])
+				continue;
+
+			mLODSets[index]->Release(mLODs[index]);
+			if (mPreviousLODs[index] != mLODs[index])
+				mLODSets[index]->Release(mPreviousLODs[index]);
+		}
+
+		mGains.clear();
+		mPans.clear();
+		mLeftGains.clear();
+		mRightGains.clear();
+		mPreviousLeftGains.clear();
+		mPreviousRightGains.clear();
+		mPitchRatios.clear();
+		mPreviousPitchRatios.clear();
+		mPositionsX.clear();
+		mPositionsY.clear();
+		mPositionsZ.clear();
+		mVelocitiesX.clear();
+		mVelocitiesY.clear();
+		mVelocitiesZ.clear();
+		mForwardsX.clear();
+		mForwardsY.clear();
+		mForwardsZ.clear();
+		mSpatialSettings.clear();
+		mSpatialLeftGains.clear();
+		mSpatialRightGains.clear();
+		mDopplerRatios.clear();
+		for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+		{
+			mSendLevels[slot].clear();
+			mPreviousSendLevels[slot].clear();
+		}
+
+		mLoudness.clear();
+		mPerceivedLoudness.clear();
+
+		mReadCursors.clear();
+		mSamples.clear();
+		mFrameCounts.clear();
+		mChannelCounts.clear();
+		mLODSets.clear();
+		mLODs.clear();
+		mPreviousLODs.clear();
+		mMinimumLODs.clear();
+		mSlots.clear();
+		mFlags.clear();
+		mOrder.clear();
+		mPriorities.clear();
+		mFilters.Terminate();
+
+		mColdData.clear();
+		mFreeSlots.clear();
+		mVoiceCount = 0;
+		mVirtualCount = 0;
+		mCulledCount = 0;
+	}
+
+	uint64 VoiceTable::Play(const VoiceDescription& description)
+	{
+		// A voice with a LOD set starts on its LOD 0, which is the sound itself.
+		SampleLODSet* pSet = description.pLODSet;
+		const float* pSamples = pSet ? pSet->GetSamples(0) : description.pSamples;
+		const uint64 frameCount = pSet ? pSet->GetFrameCount(0) : description.mFrameCount;
+		const uint32 channelCount = pSet ? pSet->GetChannelCount(0) : description.mChannelCount;
+		if (mFreeSlots.empty() || !pSamples || !frameCount || channelCount < 1 || channelCount > 2)
+			return 0;
+
+		const uint32 slot = mFreeSlots.back();
+		mFreeSlots.pop_back();
+
+		const uint32 index = mVoiceCount++;
+		mGains[index] = description.mGain;
+		mPans[index] = std::min(std::max(description.mPan, -1.0f), 1.0f);
+		mPitchRatios[index] = std::max(description.mPitchRatio, 0.0f);
+		mPreviousPitchRatios[index] = mPitchRatios[index];
+		mPositionsX[index] = 0.0f;
+		mPositionsY[index] = 0.0f;
+		mPositionsZ[index] = 0.0f;
+		mVelocitiesX[index] = 0.0f;
+		mVelocitiesY[index] = 0.0f;
+		mVelocitiesZ[index] = 0.0f;
+		mForwardsX[index] = 0.0f;
+		mForwardsY[index] = 0.0f;
+		mForwardsZ[index] = 1.0f;
+		mSpatialSettings[index] = description.mSpatialSettings;
+		mSpatialLeftGains[index] = 0.0f;
+		mSpatialRightGains[index] = 0.0f;
+		mDopplerRatios[index] = 1.0f;
+		for (uint32 send = 0; send < BusInput::MaxSendCount; send++)
+			mSendLevels[send][index] = mPreviousSendLevels[send][index] = description.mSendLevels[send];
+
+		mLoudness[index] = description.mLoudness;
+
+		mReadCursors[index] = 0.0;
+		mSamples[index] = pSamples;
+		mFrameCounts[index] = frameCount;
+		mChannelCounts[index] = channelCount;
+		mLODSets[index] = pSet;
+		mLODs[index] = 0;
+		mPreviousLODs[index] = 0;
+		mMinimumLODs[index] = static_cast<uint8>(std::min(description.mMinimumLOD, SampleLODSet::MaxLODCount - 1));
+		mSlots[index] = slot;
+
+		if (pSet)
+			pSet->Acquire(0);
+
+		for (uint32 channel = 0; channel < 2; channel++)
+		{
+			mFilters.SetFilter(index * 2 + channel, description.mFilter);
+			mFilters.Reset(index * 2 + channel);
+		}
+
+		// New voices start at their gains instead of ramping in from silence, see MixVoice().
+		mFlags[index] = static_cast<uint8>(VoiceFlags::Playing | VoiceFlags::Starting | (description.mIsLooping ? VoiceFlags::Looping : 0) | (description.mIsSpatial ? VoiceFlags::Spatial : 0) | (description.mFilter.mType != FilterType::FILTER_TYPE_NONE ? VoiceFlags::Filtered : 0));
+
+		VoiceColdData& coldData = mColdData[slot];
+		coldData.pName = description.pName;
+		coldData.mDenseIndex = index;
+
+		return MakeHandle(slot, coldData.mGeneration);
+	}
+
+	void VoiceTable::Stop(uint64 handle)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			RemoveVoice(index);
+	}
+
+	void VoiceTable::SetPaused(uint64 handle, bool isPaused)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index == InvalidIndex)
+			return;
+
+		if (isPaused)
+			mFlags[index] |= VoiceFlags::Paused;
+		else
+			mFlags[index] &= ~VoiceFlags::Paused;
+	}
+
+	void VoiceTable::SetGain(uint64 handle, float gain)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			mGains[index] = gain;
+	}
+
+	void VoiceTable::SetGains(const uint64* pHandles, const float* pGains, uint32 count)
+	{
+		for (uint32 i = 0; i < count; i++)
+			SetGain(pHandles[i], pGains[i]);
+	}
+
+	void VoiceTable::SetSendLevel(uint64 handle, uint32 slot, float level)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex && slot < BusInput::MaxSendCount)
+			mSendLevels[slot][index] = level;
+	}
+
+	void VoiceTable::SetSendLevels(const uint64* pHandles, uint32 slot, const float* pLevels, uint32 count)
+	{
+		for (uint32 i = 0; i < count; i++)
+			SetSendLevel(pHandles[i], slot, pLevels[i]);
+	}
+
+	void VoiceTable::SetFilter(uint64 handle, const FilterParameters& parameters)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index == InvalidIndex)
+			return;
+
+		mFilters.SetFilter(index * 2, parameters);
+		mFilters.SetFilter(index * 2 + 1, parameters);
+
+		// Removed filters stay on the filtered path for one more block, while they fade out, see MixFilteredVoices().
+		if (parameters.mType != FilterType::FILTER_TYPE_NONE)
+			mFlags[index] |= VoiceFlags::Filtered;
+	}
+
+	void VoiceTable::SetLoudness(uint64 handle, float loudness)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			mLoudness[index] = loudness;
+	}
+
+	void VoiceTable::SetMinimumLOD(uint64 handle, uint32 lod)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			mMinimumLODs[index] = static_cast<uint8>(std::min(lod, SampleLODSet::MaxLODCount - 1));
+	}
+
+	uint32 VoiceTable::GetLOD(uint64 handle) const
+	{
+		const uint32 index = GetDenseIndex(handle);
+		return index != InvalidIndex ? mLODs[index] : 0;
+	}
+
+	bool VoiceTable::IsVirtual(uint64 handle) const
+	{
+		const uint32 index = GetDenseIndex(handle);
+		return index != InvalidIndex && (mFlags[index] & (VoiceFlags::Virtual | VoiceFlags::Culled));
+	}
+
+	void VoiceTable::SetPan(uint64 handle, float pan)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			mPans[index] = std::min(std::max(pan, -1.0f), 1.0f);
+	}
+
+	void VoiceTable::SetPitchRatio(uint64 handle, float pitchRatio)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index != InvalidIndex)
+			mPitchRatios[index] = std::max(pitchRatio, 0.0f);
+	}
+
+	void VoiceTable::SetPosition(uint64 handle, float x, float y, float z)
+	{
+		const uint32 index = GetDenseIndex(handle);
+		if (index == InvalidIndex)
+			return;
+
+		mPositionsX[index] = x;
+		mPositionsY[index] = y;
+		mPositionsZ[index] = z;
+	}
+
+	void VoiceTable::SetEmitters(const uint64* pHandles, const EmitterArrays& emitters, uint32 count)
+	{
+		for (uint32 i = 0; i < count; i++)
+		{
+			const uint32 index = GetDenseIndex(pHandles[i]);
+			if (index == InvalidIndex)
+				continue;
+
+			if (emitters.pPositionsX && emitters.pPositionsY && emitters.pPositionsZ)
+			{
+				mPositionsX[index] = emitters.pPositionsX[i];
+				mPositionsY[index] = emitters.pPositionsY[i];
+				mPositionsZ[index] = emitters.pPositionsZ[i];
+			}
+
+			if (emitters.pVelocitiesX && emitters.pVelocitiesY && emitters.pVelocitiesZ)
+			{
+				mVelocitiesX[index] = emitters.pVelocitiesX[i];
+				mVelocitiesY[index] = emitters.pVelocitiesY[i];
+				mVelocitiesZ[index] = emitters.pVelocitiesZ[i];
+			}
+
+			if (emitters.pForwardsX && emitters.pForwardsY && emitters.pForwardsZ)
+			{
+				mForwardsX[index] = emitters.pForwardsX[i];
+				mForwardsY[index] = emitters.pForwardsY[i];
+				mForwardsZ[index] = emitters.pForwardsZ[i];
+			}
+
+			if (emitters.pSettingIndices)
+				mSpatialSettings[index] = emitters.pSettingIndices[i];
+		}
+	}
+
+	void VoiceTable::Spatialize(Spatializer& spatializer, const Listener& listener)
+	{
+		if (!mVoiceCount || !spatializer.GetSpeakerCount())
+			return;
+
+		// All the voices go through the pass, which is cheaper than compacting the spatial ones.
+		EmitterArrays emitters = {};
+		emitters.pPositionsX = mPositionsX.data();
+		emitters.pPositionsY = mPositionsY.data();
+		emitters.pPositionsZ = mPositionsZ.data();
+		emitters.pVelocitiesX = mVelocitiesX.data();
+		emitters.pVelocitiesY = mVelocitiesY.data();
+		emitters.pVelocitiesZ = mVelocitiesZ.data();
+		emitters.pForwardsX = mForwardsX.data();
+		emitters.pForwardsY = mForwardsY.data();
+		emitters.pForwardsZ = mForwardsZ.data();
+		emitters.pSettingIndices = mSpatialSettings.data();
+		spatializer.Process(listener, emitters, mVoiceCount);
+
+		const float* pLeftGains = spatializer.GetSpeakerGains(0);
+		const float* pRightGains = spatializer.GetSpeakerGains(spatializer.GetSpeakerCount() > 1 ? 1 : 0);
+		const float* pDopplerRatios = spatializer.GetDopplerRatios();
+
+		std::copy(pLeftGains, pLeftGains + mVoiceCount, mSpatialLeftGains.begin());
+		std::copy(pRightGains, pRightGains + mVoiceCount, mSpatialRightGains.begin());
+
+		for (uint32 i = 0; i < mVoiceCount; i++)
+			mDopplerRatios[i] = (mFlags[i] & VoiceFlags::Spatial) ? pDopplerRatios[i] : 1.0f;
+	}
+
+	const wchar* VoiceTable::GetName(uint64 handle) const
+	{
+		return GetDenseIndex(handle) != InvalidIndex ? mColdData[GetSlot(handle)].pName : nullptr;
+	}
+
+	bool VoiceTable::Mix(float* pBuffer, uint32 frameCount, uint32 channelCount)
+	{
+		return MixWithSends(pBuffer, nullptr, 0, frameCount, channelCount) != 0;
+	}
+
+	uint32 VoiceTable::MixWithSends(float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		mVirtualCount = 0;
+		UpdateChannelGains();
+		if (pHDRWindow)
+			ApplyHDRWindow();
+
+		if (mMaxRealVoices < mVoiceCount || mCulledCount)
+			ApplyVoiceCap();
+
+		UpdateLODs();
+
+		sendCount = std::min(sendCount, static_cast<uint32>(BusInput::MaxSendCount));
+
+		// Filtered voices are packed into groups which fill the lanes of the filter bank, one lane per channel.
+		uint32 group[FilterBank::LaneCount] = {};
+		uint32 groupVoices = 0;
+		uint32 groupLanes = 0;
+		uint32 mask = 0;
+		for (uint32 i = 0; i < mVoiceCount; i++)
+		{
+			if (mFlags[i] & VoiceFlags::Paused)
+				continue;
+
+			const uint32 voiceMask = GetOutputMask(i, ppSends, sendCount);
+			if (!voiceMask)
+			{
+				SkipVoice(i, frameCount);
+				continue;
+			}
+
+			mask |= voiceMask;
+			if (!(mFlags[i] & VoiceFlags::Filtered))
+			{
+				MixVoice(i, pBuffer, ppSends, sendCount, frameCount, channelCount);
+				continue;
+			}
+
+			const uint32 laneCount = GetLaneCount(i);
+			if (groupLanes + laneCount > FilterBank::LaneCount)
+			{
+				MixFilteredVoices(group, groupVoices, pBuffer, ppSends, sendCount, frameCount, channelCount);
+				groupVoices = 0;
+				groupLanes = 0;
+			}
+
+			group[groupVoices++] = i;
+			groupLanes += laneCount;
+		}
+
+		if (groupVoices)
+			MixFilteredVoices(group, groupVoices, pBuffer, ppSends, sendCount, frameCount, channelCount);
+
+		// Going backwards, a swapped in voice has always been visited already.
+		for (uint32 i = mVoiceCount; i > 0; i--)
+			if (!(mFlags[i - 1] & VoiceFlags::Playing))
+				RemoveVoice(i - 1);
+
+		return mask;
+	}
+
+	uint32 VoiceTable::GetDenseIndex(uint64 handle) const
+	{
+		const uint32 slot = GetSlot(handle);
+		if (slot >= mColdData.size() || mColdData[slot].mGeneration != GetGeneration(handle))
+			return InvalidIndex;
+
+		return mColdData[slot].mDenseIndex;
+	}
+
+	void VoiceTable::RemoveVoice(uint32 index)
+	{
+		const uint32 last = --mVoiceCount;
+		const uint32 slot = mSlots[index];
+
+		if (mLODSets[index])
+		{
+			mLODSets[index]->Release(mLODs[index]);
+			if (mPreviousLODs[index] != mLODs[index])
+				mLODSets[index]->Release(mPreviousLODs[index]);
+		}
+
+		if (index != last)
+		{
+			mGains[index] = mGains[last];
+			mPans[index] = mPans[last];
+			mPreviousLeftGains[index] = mPreviousLeftGains[last];
+			mPreviousRightGains[index] = mPreviousRightGains[last];
+			mPitchRatios[index] = mPitchRatios[last];
+			mPreviousPitchRatios[index] = mPreviousPitchRatios[last];
+			mPositionsX[index] = mPositionsX[last];
+			mPositionsY[index] = mPositionsY[last];
+			mPositionsZ[index] = mPositionsZ[last];
+			mVelocitiesX[index] = mVelocitiesX[last];
+			mVelocitiesY[index] = mVelocitiesY[last];
+			mVelocitiesZ[index] = mVelocitiesZ[last];
+			mForwardsX[index] = mForwardsX[last];
+			mForwardsY[index] = mForwardsY[last];
+			mForwardsZ[index] = mForwardsZ[last];
+			mSpatialSettings[index] = mSpatialSettings[last];
+			mSpatialLeftGains[index] = mSpatialLeftGains[last];
+			mSpatialRightGains[index] = mSpatialRightGains[last];
+			mDopplerRatios[index] = mDopplerRatios[last];
+			for (uint32 send = 0; send < BusInput::MaxSendCount; send++)
+			{
+				mSendLevels[send][index] = mSendLevels[send][last];
+				mPreviousSendLevels[send][index] = mPreviousSendLevels[send][last];
+			}
+
+			mLoudness[index] = mLoudness[last];
+
+			mReadCursors[index] = mReadCursors[last];
+			mSamples[index] = mSamples[last];
+			mFrameCounts[index] = mFrameCounts[last];
+			mChannelCounts[index] = mChannelCounts[last];
+			mLODSets[index] = mLODSets[last];
+			mLODs[index] = mLODs[last];
+			mPreviousLODs[index] = mPreviousLODs[last];
+			mMinimumLODs[index] = mMinimumLODs[last];
+			mSlots[index] = mSlots[last];
+			mFlags[index] = mFlags[last];
+			mFilters.Move(last * 2, index * 2);
+			mFilters.Move(last * 2 + 1, index * 2 + 1);
+
+			mColdData[mSlots[index]].mDenseIndex = index;
+		}
+
+		VoiceColdData& coldData = mColdData[slot];
+		coldData.pName = nullptr;
+		coldData.mDenseIndex = InvalidIndex;
+		coldData.mGeneration = std::max(coldData.mGeneration + 1, 1U);
+
+		mFreeSlots.insert(mFreeSlots.end(), slot);
+	}
+
+	void VoiceTable::UpdateChannelGains()
+	{
+		uint32 index = 0;
+
+		// The same constant power pan law as ComputePanGains(), four voices at a time. Spatial voices use their spatial
+		// gains instead of their pans.
+#ifdef ENSD_SIMD_SSE2
+		const __m128 half = _mm_set1_ps(0.5f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128i spatialFlag = _mm_set1_epi32(VoiceFlags::Spatial);
+		for (; index + 4 <= mVoiceCount; index += 4)
+		{
+			const __m128 gains = _mm_loadu_ps(mGains.data() + index);
+			const __m128 halfPans = _mm_mul_ps(_mm_loadu_ps(mPans.data() + index), half);
+
+			const __m128 flags = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(_mm_setr_epi32(mFlags[index], mFlags[index + 1], mFlags[index + 2], mFlags[index + 3]), spatialFlag), spatialFlag));
+			const __m128 panLeft = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(half, halfPans), zero));
+			const __m128 panRight = _mm_sqrt_ps(_mm_max_ps(_mm_add_ps(half, halfPans), zero));
+
+			const __m128 left = _mm_or_ps(_mm_and_ps(flags, _mm_loadu_ps(mSpatialLeftGains.data() + index)), _mm_andnot_ps(flags, panLeft));
+			const __m128 right = _mm_or_ps(_mm_and_ps(flags, _mm_loadu_ps(mSpatialRightGains.data() + index)), _mm_andnot_ps(flags, panRight));
+
+			_mm_storeu_ps(mLeftGains.data() + index, _mm_mul_ps(gains, left));
+			_mm_storeu_ps(mRightGains.data() + index, _mm_mul_ps(gains, right));
+		}
+#endif // ENSD_SIMD_SSE2
+
+		for (; index < mVoiceCount; index++)
+		{
+			if (mFlags[index] & VoiceFlags::Spatial)
+			{
+				mLeftGains[index] = mGains[index] * mSpatialLeftGains[index];
+				mRightGains[index] = mGains[index] * mSpatialRightGains[index];
+			}
+			else
+				ComputePanGains(mGains[index], mPans[index], mLeftGains[index], mRightGains[index]);
+		}
+	}
+
+	void VoiceTable::ApplyHDRWindow()
+	{
+		const HDRWindowDescription& description = pHDRWindow->GetDescription();
+
+		// The loudness of a voice as heard is its authored loudness plus the louder of its channel gains.
+		float loudest = -1e30f;
+		for (uint32 index = 0; index < mVoiceCount; index++)
+		{
+			if (mFlags[index] & VoiceFlags::Paused)
+				continue;
+
+			const float gain = std::max(std::max(mLeftGains[index], mRightGains[index]), 1e-12f);
+			mPerceivedLoudness[index] = mLoudness[index] + 20.0f * std::log10(gain);
+			loudest = std::max(loudest, mPerceivedLoudness[index]);
+		}
+
+		// The voices of the table are never louder than the top, even before the window catches up with them.
+		const float top = std::max(pHDRWindow->GetTop(), loudest);
+		const float floor = top - description.mRange;
+
+		for (uint32 index = 0; index < mVoiceCount; index++)
+		{
+			if (mFlags[index] & VoiceFlags::Paused)
+				continue;
+
+			const float perceived = mPerceivedLoudness[index];
+			const bool isVirtual = (mFlags[index] & VoiceFlags::Virtual) ? perceived < floor + description.mHysteresis : perceived < floor;
+			if (isVirtual)
+			{
+				mFlags[index] |= VoiceFlags::Virtual;
+				mLeftGains[index] = 0.0f;
+				mRightGains[index] = 0.0f;
+				mVirtualCount++;
+				continue;
+			}
+
+			const float scale = std::pow(10.0f, (mLoudness[index] - top) / 20.0f);
+			mFlags[index] &= ~VoiceFlags::Virtual;
+			mLeftGains[index] *= scale;
+			mRightGains[index] *= scale;
+		}
+
+		if (loudest > -1e30f)
+			pHDRWindow->Submit(loudest);
+	}
+
+	void VoiceTable::ApplyVoiceCap()
+	{
+		// Only the voices which would be heard compete for the cap.
+		uint32 audibleCount = 0;
+		for (uint32 index = 0; index < mVoiceCount; index++)
+		{
+			const float gain = std::max(std::fabs(mLeftGains[index]), std::fabs(mRightGains[index]));
+			if ((mFlags[index] & VoiceFlags::Paused) || gain == 0.0f)
+			{
+				mFlags[index] &= ~VoiceFlags::Culled;
+				continue;
+			}
+
+			mPriorities[index] = gain * ((mFlags[index] & VoiceFlags::Culled) ? 1.0f : RealVoicePriority);
+			mOrder[audibleCount++] = index;
+		}
+
+		const uint32 realCount = std::min(audibleCount, mMaxRealVoices);
+		std::nth_element(mOrder.begin(), mOrder.begin() + realCount, mOrder.begin() + audibleCount, [this](uint32 lhs, uint32 rhs) {
+			return mPriorities[lhs] > mPriorities[rhs]; });
+
+		// Culled voices fade out across this block like virtual ones, and fade back in when they are real again.
+		mCulledCount = audibleCount - realCount;
+		mVirtualCount += mCulledCount;
+		for (uint32 i = 0; i < audibleCount; i++)
+		{
+			const uint32 index = mOrder[i];
+			if (i < realCount)
+			{
+				mFlags[index] &= ~VoiceFlags::Culled;
+				continue;
+			}
+
+			mFlags[index] |= VoiceFlags::Culled;
+			mLeftGains[index] = 0.0f;
+			mRightGains[index] = 0.0f;
+		}
+	}
+
+	void VoiceTable::UpdateLODs()
+	{
+		for (uint32 index = 0; index < mVoiceCount; index++)
+		{
+			SampleLODSet* pSet = mLODSets[index];
+			if (!pSet)
+				continue;
+
+			// A voice already on a LOD only leaves it for a finer one once it is clearly louder than its gain.
+			const float gain = std::max(std::fabs(mLeftGains[index]), std::fabs(mRightGains[index]));
+			uint32 lod = mMinimumLODs[index];
+			for (uint32 level = 1; level < SampleLODSet::MaxLODCount; level++)
+				if (gain < mLODGains[level] * (level <= mLODs[index] ? LODHysteresis : 1.0f))
+					lod = std::max(lod, level);
+
+			// A lazy set generates a missing LOD for the next blocks, and the voice stays on a finer one meanwhile.
+			lod = std::min(lod, pSet->GetLODCount() - 1);
+			if (!pSet->IsResident(lod))
+				pSet->Request(lod);
+
+			while (!pSet->IsResident(lod))
+				lod--;
+
+			if (lod != mLODs[index])
+				SwitchLOD(index, lod);
+		}
+	}
+
+	void VoiceTable::SwitchLOD(uint32 index, uint32 lod)
+	{
+		SampleLODSet* pSet = mLODSets[index];
+		const uint32 previousLOD = mLODs[index];
+
+		// A paused voice may still hold the LOD of a crossfade it did not mix.
+		if (mPreviousLODs[index] != previousLOD)
+		{
+			pSet->Release(mPreviousLODs[index]);
+			mPreviousLODs[index] = static_cast<uint8>(previousLOD);
+		}
+
+		// The frames of the LODs line up, so the cursor and the pitch ramp only change scale.
+		const float scale = static_cast<float>(1U << previousLOD) / static_cast<float>(1U << lod);
+		mReadCursors[index] *= scale;
+		mPreviousPitchRatios[index] *= scale;
+
+		// A mono LOD only used the left filter, which the right one continues from.
+		if (pSet->GetChannelCount(previousLOD) < pSet->GetChannelCount(lod))
+			mFilters.Move(index * 2, index * 2 + 1);
+
+		// The previous LOD stays read until the crossfade is done, see EndVoice(). A starting voice has nothing to fade.
+		pSet->Acquire(lod);
+		if (mFlags[index] & VoiceFlags::Starting)
+		{
+			pSet->Release(previousLOD);
+			mPreviousLODs[index] = static_cast<uint8>(lod);
+		}
+		else
+		{
+			mPreviousLODs[index] = static_cast<uint8>(previousLOD);
+		}
+
+		mLODs[index] = static_cast<uint8>(lod);
+		mSamples[index] = pSet->GetSamples(lod);
+		mFrameCounts[index] = pSet->GetFrameCount(lod);
+		mChannelCounts[index] = pSet->GetChannelCount(lod);
+	}
+
+	uint32 VoiceTable::GetLaneCount(uint32 index) const
+	{
+		if (mPreviousLODs[index] == mLODs[index])
+			return mChannelCounts[index];
+
+		return std::max(mChannelCounts[index], mLODSets[index]->GetChannelCount(mPreviousLODs[index]));
+	}
+
+	float VoiceTable::BeginVoice(uint32 index)
+	{
+		// A frame mixed at a divided rate lasts as long as rate divisor frames of the voice at its pitch, and a frame of
+		// a reduced LOD as long as two or four frames of the sound.
+		const float pitchRatio = mPitchRatios[index] * mDopplerRatios[index] * mRateDivisor / static_cast<float>(1U << mLODs[index]);
+		if (mFlags[index] & VoiceFlags::Starting)
+		{
+			mPreviousLeftGains[index] = mLeftGains[index];
+			mPreviousRightGains[index] = mRightGains[index];
+			mPreviousPitchRatios[index] = pitchRatio;
+			for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+				mPreviousSendLevels[slot][index] = mSendLevels[slot][index];
+
+			mFlags[index] &= ~VoiceFlags::Starting;
+		}
+
+		return pitchRatio;
+	}
+
+	void VoiceTable::EndVoice(uint32 index, float pitchRatio)
+	{
+		mPreviousLeftGains[index] = mLeftGains[index];
+		mPreviousRightGains[index] = mRightGains[index];
+		mPreviousPitchRatios[index] = pitchRatio;
+		for (uint32 slot = 0; slot < BusInput::MaxSendCount; slot++)
+			mPreviousSendLevels[slot][index] = mSendLevels[slot][index];
+
+		// The crossfade from the previous LOD is done, so nothing reads it anymore.
+		if (mPreviousLODs[index] != mLODs[index])
+		{
+			mLODSets[index]->Release(mPreviousLODs[index]);
+			mPreviousLODs[index] = mLODs[index];
+		}
+
+		if (!(mFlags[index] & VoiceFlags::Looping) && mReadCursors[index] >= mFrameCounts[index])
+			mFlags[index] &= ~VoiceFlags::Playing;
+	}
+
+	uint32 VoiceTable::GetOutputMask(uint32 index, float* const* ppSends, uint32 sendCount) const
+	{
+		// A starting voice has no previous gains yet, it starts from its current ones.
+		const bool isStarting = mFlags[index] & VoiceFlags::Starting;
+		const bool isHeard = mLeftGains[index] != 0.0f || mRightGains[index] != 0.0f || (!isStarting && (mPreviousLeftGains[index] != 0.0f || mPreviousRightGains[index] != 0.0f));
+		if (!isHeard)
+			return 0;
+
+		uint32 mask = 1;
+		for (uint32 slot = 0; slot < sendCount; slot++)
+			if (ppSends[slot] && (mSendLevels[slot][index] != 0.0f || (!isStarting && mPreviousSendLevels[slot][index] != 0.0f)))
+				mask |= 2U << slot;
+
+		return mask;
+	}
+
+	void VoiceTable::SkipVoice(uint32 index, uint32 frameCount)
+	{
+		const float pitchRatio = BeginVoice(index);
+
+		// The cursor moves by the sum of the pitch ramp, the same as if the voice was read.
+		const double previousRatio = mPreviousPitchRatios[index];
+		double cursor = mReadCursors[index] + previousRatio * frameCount + (pitchRatio - previousRatio) * (frameCount + 1) * 0.5;
+		if (cursor >= mFrameCounts[index] && (mFlags[index] & VoiceFlags::Looping))
+			cursor = std::fmod(cursor, static_cast<double>(mFrameCounts[index]));
+
+		mReadCursors[index] = cursor;
+		EndVoice(index, pitchRatio);
+	}
+
+	void VoiceTable::MixVoice(uint32 index, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		const float pitchRatio = BeginVoice(index);
+
+		bool isRamping = mLeftGains[index] != mPreviousLeftGains[index] || mRightGains[index] != mPreviousRightGains[index] || pitchRatio != mPreviousPitchRatios[index] || mLODs[index] != mPreviousLODs[index];
+		for (uint32 slot = 0; slot < sendCount; slot++)
+			isRamping |= ppSends[slot] && mSendLevels[slot][index] != mPreviousSendLevels[slot][index];
+
+		const double cursor = mReadCursors[index];
+
+		// Only voices which play at the mix rate with steady gains take the direct path.
+		if (!isRamping && pitchRatio == 1.0f && cursor == std::floor(cursor))
+			MixDirect(index, pBuffer, ppSends, sendCount, frameCount, channelCount);
+		else
+			MixResampled(index, pitchRatio, pBuffer, ppSends, sendCount, frameCount, channelCount);
+
+		EndVoice(index, pitchRatio);
+	}
+
+	void VoiceTable::MixFilteredVoices(const uint32* pIndices, uint32 voiceCount, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		float frames[FilterBank::LaneCount][ChunkFrames * 2];
+		float lanes[ChunkFrames * FilterBank::LaneCount];
+
+		// Every voice takes one lane per channel. Mono voices filter their only channel once and play it on both sides.
+		uint32 filters[FilterBank::LaneCount] = {};
+		std::fill(filters, filters + FilterBank::LaneCount, static_cast<uint32>(FilterBank::InvalidFilter));
+		uint32 leftLanes[FilterBank::LaneCount] = {};
+		uint32 rightLanes[FilterBank::LaneCount] = {};
+		float pitchRatios[FilterBank::LaneCount] = {};
+		uint32 produced[FilterBank::LaneCount] = {};
+		bool isPlaying[FilterBank::LaneCount] = {};
+		uint32 laneCount = 0;
+		for (uint32 v = 0; v < voiceCount; v++)
+		{
+			const uint32 index = pIndices[v];
+			pitchRatios[v] = BeginVoice(index);
+			isPlaying[v] = true;
+
+			leftLanes[v] = laneCount;
+			filters[laneCount++] = index * 2;
+			rightLanes[v] = leftLanes[v];
+			if (GetLaneCount(index) == 2)
+			{
+				rightLanes[v] = laneCount;
+				filters[laneCount++] = index * 2 + 1;
+			}
+		}
+
+		for (uint32 chunk = 0; chunk < frameCount; chunk += ChunkFrames)
+		{
+			const uint32 chunkFrames = (frameCount - chunk < ChunkFrames) ? frameCount - chunk : ChunkFrames;
+
+			// Voices which ended in an earlier chunk feed silence to the rest of the ramp of their filters.
+			std::fill(lanes, lanes + ChunkFrames * FilterBank::LaneCount, 0.0f);
+			bool isAnyPlaying = false;
+			for (uint32 v = 0; v < voiceCount; v++)
+			{
+				produced[v] = 0;
+				if (!isPlaying[v])
+					continue;
+
+				produced[v] = ReadFrames(pIndices[v], pitchRatios[v], chunk, chunkFrames, frameCount, frames[v]);
+				for (uint32 i = 0; i < produced[v]; i++)
+				{
+					lanes[i * FilterBank::LaneCount + leftLanes[v]] = frames[v][i * 2];
+					lanes[i * FilterBank::LaneCount + rightLanes[v]] = frames[v][i * 2 + 1];
+				}
+
+				isAnyPlaying = true;
+			}
+
+			if (!isAnyPlaying)
+				break;
+
+			mFilters.Process(filters, lanes, chunk, chunkFrames, frameCount);
+
+			for (uint32 v = 0; v < voiceCount; v++)
+			{
+				for (uint32 i = 0; i < produced[v]; i++)
+				{
+					frames[v][i * 2] = lanes[i * FilterBank::LaneCount + leftLanes[v]];
+					frames[v][i * 2 + 1] = lanes[i * FilterBank::LaneCount + rightLanes[v]];
+				}
+
+				MixChunk(pIndices[v], frames[v], produced[v], chunk, pBuffer, ppSends, sendCount, frameCount, channelCount);
+				isPlaying[v] = produced[v] == chunkFrames;
+			}
+		}
+
+		for (uint32 v = 0; v < voiceCount; v++)
+		{
+			const uint32 index = pIndices[v];
+			EndVoice(index, pitchRatios[v]);
+
+			// A removed filter has faded to pass through by now, so the voice can leave the filtered path.
+			if (mFilters.GetFilter(index * 2).mType == FilterType::FILTER_TYPE_NONE)
+			{
+				mFilters.Reset(index * 2);
+				mFilters.Reset(index * 2 + 1);
+				mFlags[index] &= ~VoiceFlags::Filtered;
+			}
+		}
+	}
+
+	void VoiceTable::MixDirect(uint32 index, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		const float* pSamples = mSamples[index];
+		const uint64 sourceFrames = mFrameCounts[index];
+		const uint32 sourceChannels = mChannelCounts[index];
+		const bool isLooping = mFlags[index] & VoiceFlags::Looping;
+
+		const float leftGain = mLeftGains[index];
+		const float rightGain = mRightGains[index];
+
+		uint64 position = static_cast<uint64>(mReadCursors[index]);
+		uint32 frame = 0;
+
+		// Copy straight from the source, in runs up to the end of the samples.
+		while (frame < frameCount && position < sourceFrames)
+		{
+			const uint32 runFrames = static_cast<uint32>(std::min<uint64>(frameCount - frame, sourceFrames - position));
+			const float* pSource = pSamples + position * sourceChannels;
+			const uint64 offset = static_cast<uint64>(frame) * channelCount;
+
+			MixRun(pSource, sourceChannels, pBuffer + offset, channelCount, runFrames, leftGain, rightGain);
+			for (uint32 slot = 0; slot < sendCount; slot++)
+			{
+				const float level = mSendLevels[slot][index];
+				if (ppSends[slot] && level != 0.0f)
+					MixRun(pSource, sourceChannels, ppSends[slot] + offset, channelCount, runFrames, leftGain * level, rightGain * level);
+			}
+
+			frame += runFrames;
+			position += runFrames;
+
+			if (position >= sourceFrames && isLooping)
+				position = 0;
+		}
+
+		mReadCursors[index] = static_cast<double>(position);
+	}
+
+	void VoiceTable::MixResampled(uint32 index, float pitchRatio, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		float frames[ChunkFrames * 2];
+		for (uint32 chunk = 0; chunk < frameCount; chunk += ChunkFrames)
+		{
+			const uint32 chunkFrames = (frameCount - chunk < ChunkFrames) ? frameCount - chunk : ChunkFrames;
+			const uint32 produced = ReadFrames(index, pitchRatio, chunk, chunkFrames, frameCount, frames);
+			MixChunk(index, frames, produced, chunk, pBuffer, ppSends, sendCount, frameCount, channelCount);
+
+			if (produced < chunkFrames)
+				break;
+		}
+	}
+
+	uint32 VoiceTable::ReadFrames(uint32 index, float pitchRatio, uint32 chunk, uint32 chunkFrames, uint32 frameCount, float* pFrames)
+	{
+		const float* pSamples = mSamples[index];
+		const uint64 sourceFrames = mFrameCounts[index];
+		const uint32 sourceChannels = mChannelCounts[index];
+		const bool isLooping = mFlags[index] & VoiceFlags::Looping;
+
+		// The per frame pitch ratios of the chunk, a steady ratio comes out as a constant.
+		float pitchRatios[ChunkFrames];
+		ComputeRamp(pitchRatios, mPreviousPitchRatios[index], pitchRatio, chunk, chunkFrames, frameCount, RampCurve::RAMP_CURVE_LINEAR);
+
+		const bool isCubic = mResamplerQuality == ResamplerQuality::RESAMPLER_QUALITY_CUBIC;
+		double cursor = mReadCursors[index];
+		const double start = cursor;
+		const uint32 produced = ReadSamples(pSamples, sourceFrames, sourceChannels, isLooping, isCubic, pitchRatios, 1.0f, chunkFrames, cursor, pFrames);
+		mReadCursors[index] = cursor;
+
+		// A voice switching LOD also reads the same part of the sound from its previous LOD, and fades it out across
+		// the block. The frames of the LODs line up, so the cursor and the pitch ratios only change scale.
+		const uint32 previousLOD = mPreviousLODs[index];
+		if (previousLOD != mLODs[index])
+		{
+			const SampleLODSet* pSet = mLODSets[index];
+			const float scale = static_cast<float>(1U << mLODs[index]) / static_cast<float>(1U << previousLOD);
+			double previousCursor = start * scale;
+			float previousFrames[ChunkFrames * 2];
+			const uint32 previousProduced = ReadSamples(pSet->GetSamples(previousLOD), pSet->GetFrameCount(previousLOD), pSet->GetChannelCount(previousLOD), isLooping, isCubic, pitchRatios, scale, produced, previousCursor, previousFrames);
+			std::fill(previousFrames + previousProduced * 2, previousFrames + produced * 2, 0.0f);
+
+			for (uint32 i = 0; i < produced; i++)
+			{
+				const float fade = static_cast<float>(chunk + i + 1) / static_cast<float>(frameCount);
+				pFrames[i * 2] = previousFrames[i * 2] + (pFrames[i * 2] - previousFrames[i * 2]) * fade;
+				pFrames[i * 2 + 1] = previousFrames[i * 2 + 1] + (pFrames[i * 2 + 1] - previousFrames[i * 2 + 1]) * fade;
+			}
+		}
+
+		return produced;
+	}
+
+	void VoiceTable::MixChunk(uint32 index, const float* pFrames, uint32 produced, uint32 chunk, float* pBuffer, float* const* ppSends, uint32 sendCount, uint32 frameCount, uint32 channelCount)
+	{
+		float leftGains[ChunkFrames];
+		float rightGains[ChunkFrames];
+		float sendLevels[ChunkFrames];
+		float sendLeftGains[ChunkFrames];
+		float sendRightGains[ChunkFrames];
+
+		// The per frame gains of the chunk, steady gains come out as constants.
+		ComputeRamp(leftGains, mPreviousLeftGains[index], mLeftGains[index], chunk, produced, frameCount, mRampCurve);
+		ComputeRamp(rightGains, mPreviousRightGains[index], mRightGains[index], chunk, produced, frameCount, mRampCurve);
+
+		const uint64 offset = static_cast<uint64>(chunk) * channelCount;
+		MixFrames(pFrames, leftGains, rightGains, pBuffer + offset, channelCount, produced);
+
+		// The sends get the same frames, with their own level ramps on top of the gains.
+		for (uint32 slot = 0; slot < sendCount; slot++)
+		{
+			const float previousLevel = mPreviousSendLevels[slot][index];
+			const float level = mSendLevels[slot][index];
+			if (!ppSends[slot] || (previousLevel == 0.0f && level == 0.0f))
+				continue;
+
+			ComputeRamp(sendLevels, previousLevel, level, chunk, produced, frameCount, mRampCurve);
+			for (uint32 i = 0; i < produced; i++)
+			{
+				sendLeftGains[i] = leftGains[i] * sendLevels[i];
+				sendRightGains[i] = rightGains[i] * sendLevels[i];
+			}
+
+			MixFrames(pFrames, sendLeftGains, sendRightGains, ppSends[slot] + offset, channelCount, produced);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,634 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Spatial/AmbisonicBus.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Platform/SIMD.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float Pi = 3.14159265358979f;
+		const float HalfPi = Pi * 0.5f;
+		const float TwoPi = Pi * 2.0f;
+		const float Epsilon = 1e-6f;
+
+		const uint32 MaxChannelCount = 16;	// The number of ambisonic channels at third order.
+		const uint32 VirtualSpeakerCount = 256;	// The number of virtual speakers the decoders are made from.
+		const uint32 NormalizationDirections = 72;	// The number of horizontal directions the speaker decoder is normalized over.
+		const float MaxREAngle = 137.9f * Pi / 180.0f;	// The angle max rE weights are made from, divided by the order plus 1.51.
+
+		/**
+		 * Convert a direction from listener or world space (+X right, +Y up, +Z forward) to the ambisonic axes (+X
+		 * forward, +Y left, +Z up).
+		 */
+		inline void ToAmbisonic(const float* pDirection, float* pOutput)
+		{
+			pOutput[0] = pDirection[2];
+			pOutput[1] = -pDirection[0];
+			pOutput[2] = pDirection[1];
+		}
+
+		/**
+		 * Evaluate the real spherical harmonics of a normalized direction on the ambisonic axes, in ambisonic channel
+		 * order with SN3D normalization, up to third order.
+		 */
+		void EvaluateHarmonics(const float* pDirection, uint32 order, float* pHarmonics)
+		{
+			const float x = pDirection[0];
+			const float y = pDirection[1];
+			const float z = pDirection[2];
+
+			pHarmonics[0] = 1.0f;
+			if (order < 1)
+				return;
+
+			pHarmonics[1] = y;
+			pHarmonics[2] = z;
+			pHarmonics[3] = x;
+			if (order < 2)
+				return;
+
+			const float root3 = std::sqrt(3.0f);
+			pHarmonics[4] = root3 * x * y;
+			pHarmonics[5] = root3 * y * z;
+			pHarmonics[6] = 0.5f * (3.0f * z * z - 1.0f);
+			pHarmonics[7] = root3 * x * z;
+			pHarmonics[8] = root3 * 0.5f * (x * x - y * y);
+			if (order < 3)
+				return;
+
+			const float root5Over8 = std::sqrt(5.0f / 8.0f);
+			const float root3Over8 = std::sqrt(3.0f / 8.0f);
+			const float root15 = std::sqrt(15.0f);
+			pHarmonics[9] = root5Over8 * y * (3.0f * x * x - y * y);
+			pHarmonics[10] = root15 * x * y * z;
+			pHarmonics[11] = root3Over8 * y * (5.0f * z * z - 1.0f);
+			pHarmonics[12] = 0.5f * z * (5.0f * z * z - 3.0f);
+			pHarmonics[13] = root3Over8 * x * (5.0f * z * z - 1.0f);
+			pHarmonics[14] = root15 * 0.5f * z * (x * x - y * y);
+			pHarmonics[15] = root5Over8 * x * (x * x - 3.0f * y * y);
+		}
+
+		/**
+		 * The Legendre polynomial of a degree.
+		 */
+		float Legendre(uint32 degree, float x)
+		{
+			float previous = 1.0f;
+			float current = x;
+			if (degree == 0)
+				return previous;
+
+			for (uint32 n = 1; n < degree; n++)
+			{
+				const float next = ((2.0f * n + 1.0f) * x * current - n * previous) / (n + 1.0f);
+				previous = current;
+				current = next;
+			}
+
+			return current;
+		}
+
+		/**
+		 * Solve a linear system with several right hand sides in place, with Gauss-Jordan elimination.
+		 */
+		void Solve(double* pMatrix, double* pRight, uint32 size, uint32 columnCount)
+		{
+			for (uint32 column = 0; column < size; column++)
+			{
+				uint32 pivot = column;
+				for (uint32 row = column + 1; row < size; row++)
+					if (std::fabs(pMatrix[row * size + column]) > std::fabs(pMatrix[pivot * size + column]))
+						pivot = row;
+
+				std::swap_ranges(pMatrix + pivot * size, pMatrix + pivot * size + size, pMatrix + column * size);
+				std::swap_ranges(pRight + static_cast<uint64>(pivot) * columnCount, pRight + static_cast<uint64>(pivot + 1) * columnCount, pRight + static_cast<uint64>(column) * columnCount);
+
+				const double inverse = 1.0 / pMatrix[column * size + column];
+				for (uint32 row = 0; row < size; row++)
+				{
+					if (row == column)
+						continue;
+
+					const double factor = pMatrix[row * size + column] * inverse;
+					for (uint32 i = 0; i < size; i++)
+						pMatrix[row * size + i] -= factor * pMatrix[column * size + i];
+
+					for (uint32 i = 0; i < columnCount; i++)
+						pRight[static_cast<uint64>(row) * columnCount + i] -= factor * pRight[static_cast<uint64>(column) * columnCount + i];
+				}
+
+				for (uint32 i = 0; i < columnCount; i++)
+					pRight[static_cast<uint64>(column) * columnCount + i] *= inverse;
+
+				for (uint32 i = 0; i < size; i++)
+					pMatrix[column * size + i] *= inverse;
+			}
+		}
+
+		/**
+		 * Equal power panning between the two speakers around an azimuth, as done by the Spatializer.
+		 */
+		void Pan(float azimuth, const float* pSortedAzimuths, const uint32* pChannels, uint32 speakerCount, float* pGains)
+		{
+			std::fill(pGains, pGains + speakerCount, 0.0f);
+			if (speakerCount == 1)
+			{
+				pGains[0] = 1.0f;
+				return;
+			}
+
+			for (uint32 arc = 0; arc < speakerCount; arc++)
+			{
+				const uint32 next = (arc + 1) % speakerCount;
+				const float start = pSortedAzimuths[arc];
+				const float span = (next ? pSortedAzimuths[next] : pSortedAzimuths[0] + TwoPi) - start;
+
+				float relative = azimuth - start;
+				if (relative < -Epsilon)
+					relative += TwoPi;
+
+				relative = std::max(relative, 0.0f);
+				if (relative < span)
+				{
+					const float angle = relative / std::max(span, Epsilon) * HalfPi;
+					pGains[pChannels[arc]] += std::cos(angle);
+					pGains[pChannels[next]] += std::sin(angle);
+					return;
+				}
+			}
+		}
+
+		inline float WrapAngle(float radians)
+		{
+			radians = std::fmod(radians, TwoPi);
+			return radians < 0.0f ? radians + TwoPi : radians;
+		}
+
+		/**
+		 * Add a mono block to a channel of the field with a weight ramping across the block.
+		 * The result of every sample only depends on its own inputs, so the SIMD and scalar paths match bit for bit.
+		 */
+		void EncodeRamped(float* pField, const float* pSamples, const float* pRamp, float start, float end, uint32 frameCount)
+		{
+			const float delta = end - start;
+			uint32 frame = 0;
+
+#ifdef ENSD_SIMD_SSE2
+			const __m128 startVector = _mm_set1_ps(start);
+			const __m128 deltaVector = _mm_set1_ps(delta);
+			for (; frame + 4 <= frameCount; frame += 4)
+			{
+				const __m128 weight = _mm_add_ps(startVector, _mm_mul_ps(deltaVector, _mm_loadu_ps(pRamp + frame)));
+				_mm_storeu_ps(pField + frame, _mm_add_ps(_mm_loadu_ps(pField + frame), _mm_mul_ps(_mm_loadu_ps(pSamples + frame), weight)));
+			}
+#endif // ENSD_SIMD_SSE2
+
+			for (; frame < frameCount; frame++)
+				pField[frame] += pSamples[frame] * (start + delta * pRamp[frame]);
+		}
+	}
+
+	void AmbisonicBus::Initialize(const AmbisonicDescription& description)
+	{
+		Terminate();
+
+		const uint32 order = static_cast<uint32>(description.mOrder);
+		const uint32 blockFrames = description.mBlockFrames;
+		const HRIRSet* pHRIRSet = description.pHRIRSet;
+		if ((order != 1 && order != 3) || !blockFrames || !description.mMaxSources || (pHRIRSet && (!pHRIRSet->GetImpulseLength() || (blockFrames & (blockFrames - 1)))))
+		{
+			Logger::LogError(STRING("Invalid ambisonic bus description!"));
+			return;
+		}
+
+		if (pHRIRSet && pHRIRSet->GetSampleRate() != description.mSampleRate)
+			Logger::LogWarn(STRING("The sample rate of the HRIR set does not match the mix sample rate!"));
+
+		mDescription = description;
+		mOrder = order;
+		mChannelCount = (order + 1) * (order + 1);
+
+		const uint32 channelCount = mChannelCount;
+		mField.assign(static_cast<uint64>(channelCount) * blockFrames, 0.0f);
+		mRotated.resize(static_cast<uint64>(channelCount) * blockFrames);
+		mScratch.resize(static_cast<uint64>(std::max(channelCount, 3U)) * blockFrames);
+		mRamp.resize(blockFrames);
+		ComputeRamp(mRamp.data(), 0.0f, 1.0f, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+
+		mHandles.resize(description.mMaxSources);
+		mEncodedBlocks.resize(description.mMaxSources);
+		mPreviousCoefficients.resize(static_cast<uint64>(description.mMaxSources) * channelCount);
+
+		// Virtual speakers on a spherical Fibonacci lattice, which is close to uniform, mirrored from left to right so
+		// the decoders are symmetric.
+		const uint32 virtualCount = VirtualSpeakerCount;
+		const uint32 halfCount = virtualCount / 2;
+		const float goldenAngle = Pi * (3.0f - std::sqrt(5.0f));
+		mVirtualDirections.resize(static_cast<uint64>(virtualCount) * 3);
+		for (uint32 i = 0; i < halfCount; i++)
+		{
+			const float z = 1.0f - (2.0f * i + 1.0f) / halfCount;
+			const float radius = std::sqrt(std::max(1.0f - z * z, 0.0f));
+			const float x = radius * std::cos(goldenAngle * i);
+			const float y = radius * std::sin(goldenAngle * i);
+
+			const float mirrored[6] = { x, y, z, x, -y, z };
+			std::copy(mirrored, mirrored + 6, mVirtualDirections.begin() + i * 6);
+		}
+
+		// Sampling the field at the virtual speakers with max rE weights. With SN3D, the weights of a source sum to
+		// (2l + 1) P_l(cos angle) per order, so a source at the speaker peaks there and the pressure is kept.
+		const float weightCosine = std::cos(MaxREAngle / (order + 1.51f));
+		float orderWeights[4] = {};
+		for (uint32 l = 0; l <= order; l++)
+			orderWeights[l] = (2.0f * l + 1.0f) * Legendre(l, weightCosine) / virtualCount;
+
+		Vector<float> harmonics(static_cast<uint64>(virtualCount) * channelCount);
+		mVirtualDecoder.resize(static_cast<uint64>(virtualCount) * channelCount);
+		for (uint32 i = 0; i < virtualCount; i++)
+		{
+			float* pHarmonics = harmonics.data() + static_cast<uint64>(i) * channelCount;
+			EvaluateHarmonics(mVirtualDirections.data() + i * 3, order, pHarmonics);
+			for (uint32 l = 0; l <= order; l++)
+				for (uint32 channel = l * l; channel < (l + 1) * (l + 1); channel++)
+					mVirtualDecoder[static_cast<uint64>(i) * channelCount + channel] = pHarmonics[channel] * orderWeights[l];
+		}
+
+		// A rotation maps the harmonics of every order onto those of the same order, so the matrix of an order is the
+		// least squares fit of the harmonics of the rotated virtual speakers to the harmonics of the virtual speakers.
+		uint64 rotationSize = 0;
+		uint64 solverSize = 0;
+		for (uint32 l = 1; l <= order; l++)
+		{
+			rotationSize += (2 * l + 1) * (2 * l + 1);
+			solverSize += static_cast<uint64>(2 * l + 1) * virtualCount;
+		}
+
+		mRotationSolvers.resize(solverSize);
+		mRotations.resize(rotationSize);
+		mPreviousRotations.resize(rotationSize);
+
+		float* pSolver = mRotationSolvers.data();
+		for (uint32 l = 1; l <= order; l++)
+		{
+			const uint32 size = 2 * l + 1;
+			Vector<double> normal(size * size, 0.0);
+			Vector<double> right(static_cast<uint64>(size) * virtualCount);
+			for (uint32 row = 0; row < size; row++)
+			{
+				for (uint32 i = 0; i < virtualCount; i++)
+					right[static_cast<uint64>(row) * virtualCount + i] = harmonics[static_cast<uint64>(i) * channelCount + l * l + row];
+
+				for (uint32 column = 0; column < size; column++)
+					for (uint32 i = 0; i < virtualCount; i++)
+						normal[row * size + column] += static_cast<double>(harmonics[static_cast<uint64>(i) * channelCount + l * l + row]) * harmonics[static_cast<uint64>(i) * channelCount + l * l + column];
+			}
+
+			Solve(normal.data(), right.data(), size, virtualCount);
+			std::transform(right.begin(), right.end(), pSolver, [](double value) { return static_cast<float>(value); });
+			pSolver += static_cast<uint64>(size) * virtualCount;
+		}
+
+		SetListener(Listener());
+		mPreviousRotations = mRotations;
+
+		if (!pHRIRSet)
+		{
+			const float stereo[2] = { -30.0f, 30.0f };
+			SetSpeakerLayout(stereo, 2);
+			return;
+		}
+
+		// The HRIRs of the virtual speakers folded into every ambisonic channel, so the decode is one convolution per
+		// ambisonic channel and ear.
+		const uint32 impulseLength = pHRIRSet->GetImpulseLength();
+		const uint32 partitionCount = std::max(std::min(description.mMaxPartitions, (impulseLength + blockFrames - 1) / blockFrames), 1U);
+		Vector<float> impulses(static_cast<uint64>(virtualCount) * impulseLength * 2);
+		for (uint32 i = 0; i < virtualCount; i++)
+		{
+			const float* pDirection = mVirtualDirections.data() + i * 3;
+			const float direction[3] = { -pDirection[1], pDirection[2], pDirection[0] };
+			float* pLeft = impulses.data() + static_cast<uint64>(i) * impulseLength * 2;
+			pHRIRSet->Interpolate(direction, pLeft, pLeft + impulseLength);
+		}
+
+		Vector<float> folded(impulseLength);
+		mConvolvers.resize(channelCount);
+		mKernels.resize(static_cast<uint64>(channelCount) * 2);
+		for (uint32 channel = 0; channel < channelCount; channel++)
+		{
+			mConvolvers[channel].Initialize(blockFrames, partitionCount);
+			for (uint32 ear = 0; ear < 2; ear++)
+			{
+				std::fill(folded.begin(), folded.end(), 0.0f);
+				for (uint32 i = 0; i < virtualCount; i++)
+					MixBuffer(folded.data(), impulses.data() + (static_cast<uint64>(i) * 2 + ear) * impulseLength, mVirtualDecoder[static_cast<uint64>(i) * channelCount + channel], impulseLength);
+
+				mConvolvers[channel].CreateKernel(folded.data(), impulseLength, mKernels[channel * 2 + ear]);
+			}
+		}
+	}
+
+	void AmbisonicBus::Terminate()
+	{
+		mField.clear();
+		mRotated.clear();
+		mScratch.clear();
+		mRamp.clear();
+
+		mHandles.clear();
+		mEncodedBlocks.clear();
+		mPreviousCoefficients.clear();
+
+		mVirtualDirections.clear();
+		mVirtualDecoder.clear();
+		mRotationSolvers.clear();
+		mRotations.clear();
+		mPreviousRotations.clear();
+
+		mDecoder.clear();
+		mConvolvers.clear();
+		mKernels.clear();
+
+		mDescription = {};
+		mOrder = 0;
+		mChannelCount = 0;
+		mBlockIndex = 1;
+	}
+
+	void AmbisonicBus::SetSpeakerLayout(const float* pAzimuths, uint32 speakerCount)
+	{
+		const uint32 channelCount = mChannelCount;
+		if (!channelCount || !pAzimuths || !speakerCount)
+			return;
+
+		Vector<uint32> channels(speakerCount);
+		std::iota(channels.begin(), channels.end(), 0);
+		std::sort(channels.begin(), channels.end(), [pAzimuths](uint32 lhs, uint32 rhs) {
+			return WrapAngle(pAzimuths[lhs] * Pi / 180.0f) < WrapAngle(pAzimuths[rhs] * Pi / 180.0f); });
+
+		Vector<float> azimuths(speakerCount);
+		for (uint32 i = 0; i < speakerCount; i++)
+			azimuths[i] = WrapAngle(pAzimuths[channels[i]] * Pi / 180.0f);
+
+		// Every virtual speaker is panned to the real ones, which gives the decoder of the layout (AllRAD).
+		Vector<float> gains(speakerCount);
+		const uint32 virtualCount = static_cast<uint32>(mVirtualDirections.size() / 3);
+		mDecoder.assign(static_cast<uint64>(speakerCount) * channelCount, 0.0f);
+		for (uint32 i = 0; i < virtualCount; i++)
+		{
+			const float* pDirection = mVirtualDirections.data() + i * 3;
+			Pan(WrapAngle(std::atan2(-pDirection[1], pDirection[0])), azimuths.data(), channels.data(), speakerCount, gains.data());
+			for (uint32 speaker = 0; speaker < speakerCount; speaker++)
+				if (gains[speaker] != 0.0f)
+					MixBuffer(mDecoder.data() + static_cast<uint64>(speaker) * channelCount, mVirtualDecoder.data() + static_cast<uint64>(i) * channelCount, gains[speaker], channelCount);
+		}
+
+		// The panned virtual speakers add up coherently, so the decoder is scaled to unit power on the horizontal plane.
+		float harmonics[MaxChannelCount] = {};
+		float power = 0.0f;
+		for (uint32 i = 0; i < NormalizationDirections; i++)
+		{
+			const float angle = TwoPi * i / NormalizationDirections;
+			const float direction[3] = { std::cos(angle), std::sin(angle), 0.0f };
+			EvaluateHarmonics(direction, mOrder, harmonics);
+
+			for (uint32 speaker = 0; speaker < speakerCount; speaker++)
+			{
+				const float* pWeights = mDecoder.data() + static_cast<uint64>(speaker) * channelCount;
+				const float gain = std::inner_product(pWeights, pWeights + channelCount, harmonics, 0.0f);
+				power += gain * gain;
+			}
+		}
+
+		if (power > 0.0f)
+			ScaleBuffer(mDecoder.data(), 1.0f / std::sqrt(power / NormalizationDirections), mDecoder.size());
+	}
+
+	void AmbisonicBus::SetListener(const Listener& listener)
+	{
+		if (mRotations.empty())
+			return;
+
+		// The listener axes, made orthonormal, as the rows of the world to listener rotation on the ambisonic axes.
+		const float* pForward = listener.mForward;
+		const float* pUp = listener.mUp;
+		float right[3] = {
+			pUp[1] * pForward[2] - pUp[2] * pForward[1],
+			pUp[2] * pForward[0] - pUp[0] * pForward[2],
+			pUp[0] * pForward[1] - pUp[1] * pForward[0] };
+
+		const float forwardLength = std::sqrt(pForward[0] * pForward[0] + pForward[1] * pForward[1] + pForward[2] * pForward[2]);
+		const float rightLength = std::sqrt(right[0] * right[0] + right[1] * right[1] + right[2] * right[2]);
+		if (forwardLength < Epsilon || rightLength < Epsilon)
+			return;
+
+		const float forward[3] = { pForward[0] / forwardLength, pForward[1] / forwardLength, pForward[2] / forwardLength };
+		for (float& value : right)
+			value /= rightLength;
+
+		const float up[3] = {
+			forward[1] * right[2] - forward[2] * right[1],
+			forward[2] * right[0] - forward[0] * right[2],
+			forward[0] * right[1] - forward[1] * right[0] };
+
+		float rotation[9] = {};
+		ToAmbisonic(forward, rotation);
+		ToAmbisonic(right, rotation + 3);
+		ToAmbisonic(up, rotation + 6);
+		for (uint32 i = 3; i < 6; i++)
+			rotation[i] = -rotation[i];
+
+		// The matrix of every order maps the harmonics of the virtual speakers to those of the rotated ones.
+		std::fill(mRotations.begin(), mRotations.end(), 0.0f);
+		const uint32 virtualCount = static_cast<uint32>(mVirtualDirections.size() / 3);
+		float harmonics[MaxChannelCount] = {};
+		for (uint32 i = 0; i < virtualCount; i++)
+		{
+			const float* pDirection = mVirtualDirections.data() + i * 3;
+			float rotated[3] = {};
+			for (uint32 axis = 0; axis < 3; axis++)
+				rotated[axis] = rotation[axis * 3] * pDirection[0] + rotation[axis * 3 + 1] * pDirection[1] + rotation[axis * 3 + 2] * pDirection[2];
+
+			EvaluateHarmonics(rotated, mOrder, harmonics);
+
+			float* pRotation = mRotations.data();
+			const float* pSolver = mRotationSolvers.data();
+			for (uint32 l = 1; l <= mOrder; l++)
+			{
+				const uint32 size = 2 * l + 1;
+				for (uint32 row = 0; row < size; row++)
+					for (uint32 column = 0; column < size; column++)
+						pRotation[row * size + column] += harmonics[l * l + row] * pSolver[static_cast<uint64>(column) * virtualCount + i];
+
+				pRotation += size * size;
+				pSolver += static_cast<uint64>(size) * virtualCount;
+			}
+		}
+	}
+
+	void AmbisonicBus::Encode(const AmbisonicSource* pSources, uint32 sourceCount)
+	{
+		if (mHandles.empty())
+			return;
+
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		const uint32 channelCount = mChannelCount;
+		const uint32 slotCount = static_cast<uint32>(mHandles.size());
+		float coefficients[MaxChannelCount] = {};
+
+		for (uint32 i = 0; i < sourceCount; i++)
+		{
+			const AmbisonicSource& source = pSources[i];
+			const uint32 slot = static_cast<uint32>(source.mHandle & 0xFFFFFFFF);
+			if (slot >= slotCount || !source.pSamples)
+				continue;
+
+			// A new source, or one which skipped a block, starts at its direction and gain instead of ramping.
+			if (mHandles[slot] != source.mHandle)
+			{
+				mHandles[slot] = source.mHandle;
+				mEncodedBlocks[slot] = 0;
+			}
+
+			const bool isFresh = !mEncodedBlocks[slot] || mEncodedBlocks[slot] + 1 != mBlockIndex;
+			mEncodedBlocks[slot] = mBlockIndex;
+
+			const float* pSourceDirection = source.mDirection;
+			const float magnitude = std::sqrt(pSourceDirection[0] * pSourceDirection[0] + pSourceDirection[1] * pSourceDirection[1] + pSourceDirection[2] * pSourceDirection[2]);
+			const float direction[3] = {
+				magnitude > 0.0f ? pSourceDirection[0] / magnitude : 0.0f,
+				magnitude > 0.0f ? pSourceDirection[1] / magnitude : 0.0f,
+				magnitude > 0.0f ? pSourceDirection[2] / magnitude : 1.0f };
+
+			float ambisonicDirection[3] = {};
+			ToAmbisonic(direction, ambisonicDirection);
+			EvaluateHarmonics(ambisonicDirection, mOrder, coefficients);
+			ScaleBuffer(coefficients, source.mGain, channelCount);
+
+			float* pPrevious = mPreviousCoefficients.data() + static_cast<uint64>(slot) * channelCount;
+			if (isFresh)
+				std::copy(coefficients, coefficients + channelCount, pPrevious);
+
+			for (uint32 channel = 0; channel < channelCount; channel++)
+			{
+				float* pField = mField.data() + static_cast<uint64>(channel) * blockFrames;
+				if (pPrevious[channel] == coefficients[channel])
+				{
+					if (coefficients[channel] != 0.0f)
+						MixBuffer(pField, source.pSamples, coefficients[channel], blockFrames);
+				}
+				else
+					EncodeRamped(pField, source.pSamples, mRamp.data(), pPrevious[channel], coefficients[channel], blockFrames);
+
+				pPrevious[channel] = coefficients[channel];
+			}
+		}
+	}
+
+	void AmbisonicBus::Decode(float* pOutput, uint32 channelCount)
+	{
+		if (mField.empty() || !pOutput)
+			return;
+
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		const uint32 fieldChannels = mChannelCount;
+		RotateField();
+
+		if (mDescription.pHRIRSet)
+		{
+			float* pLeft = mScratch.data();
+			float* pRight = pLeft + blockFrames;
+			float* pConvolved = pRight + blockFrames;
+			std::fill(pLeft, pRight + blockFrames, 0.0f);
+
+			// The convolvers keep running on silence, so the tails of the HRIRs are not cut.
+			for (uint32 channel = 0; channel < fieldChannels; channel++)
+			{
+				UniformConvolver& convolver = mConvolvers[channel];
+				convolver.PushInput(mRotated.data() + static_cast<uint64>(channel) * blockFrames);
+				convolver.Convolve(mKernels[channel * 2], pConvolved);
+				MixBuffer(pLeft, pConvolved, 1.0f, blockFrames);
+				convolver.Convolve(mKernels[channel * 2 + 1], pConvolved);
+				MixBuffer(pRight, pConvolved, 1.0f, blockFrames);
+			}
+
+			if (channelCount >= 2)
+			{
+				for (uint32 frame = 0; frame < blockFrames; frame++)
+				{
+					pOutput[frame * channelCount] += pLeft[frame];
+					pOutput[frame * channelCount + 1] += pRight[frame];
+				}
+			}
+		}
+		else
+		{
+			const uint32 speakerCount = std::min(static_cast<uint32>(mDecoder.size() / fieldChannels), channelCount);
+			float* pSpeaker = mScratch.data();
+			for (uint32 speaker = 0; speaker < speakerCount; speaker++)
+			{
+				std::fill(pSpeaker, pSpeaker + blockFrames, 0.0f);
+				const float* pWeights = mDecoder.data() + static_cast<uint64>(speaker) * fieldChannels;
+				for (uint32 channel = 0; channel < fieldChannels; channel++)
+					if (pWeights[channel] != 0.0f)
+						MixBuffer(pSpeaker, mRotated.data() + static_cast<uint64>(channel) * blockFrames, pWeights[channel], blockFrames);
+
+				for (uint32 frame = 0; frame < blockFrames; frame++)
+					pOutput[frame * channelCount + speaker] += pSpeaker[frame];
+			}
+		}
+
+		std::fill(mField.begin(), mField.end(), 0.0f);
+		mBlockIndex++;
+	}
+
+	void AmbisonicBus::RotateField()
+	{
+		ApplyRotation(mRotations.data(), mRotated.data());
+		if (std::equal(mRotations.begin(), mRotations.end(), mPreviousRotations.begin()))
+			return;
+
+		// The field rotated by the last orientation fades into the one rotated by the new orientation.
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		ApplyRotation(mPreviousRotations.data(), mScratch.data());
+		for (uint32 channel = 1; channel < mChannelCount; channel++)
+		{
+			float* pRotated = mRotated.data() + static_cast<uint64>(channel) * blockFrames;
+			const float* pPrevious = mScratch.data() + static_cast<uint64>(channel) * blockFrames;
+			for (uint32 frame = 0; frame < blockFrames; frame++)
+				pRotated[frame] = pPrevious[frame] + (pRotated[frame] - pPrevious[frame]) * mRamp[frame];
+		}
+
+		mPreviousRotations = mRotations;
+	}
+
+	void AmbisonicBus::ApplyRotation(const float* pRotations, float* pOutput) const
+	{
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		std::copy(mField.begin(), mField.begin() + blockFrames, pOutput);
+
+		for (uint32 l = 1; l <= mOrder; l++)
+		{
+			const uint32 size = 2 * l + 1;
+			for (uint32 row = 0; row < size; row++)
+			{
+				float* pChannel = pOutput + static_cast<uint64>(l * l + row) * blockFrames;
+				std::fill(pChannel, pChannel + blockFrames, 0.0f);
+				for (uint32 column = 0; column < size; column++)
+					if (pRotations[row * size + column] != 0.0f)
+						MixBuffer(pChannel, mField.data() + static_cast<uint64>(l * l + column) * blockFrames, pRotations[row * size + column], blockFrames);
+			}
+
+			pRotations += size * size;
+		}
+	}
+}
\ No newline at end of file
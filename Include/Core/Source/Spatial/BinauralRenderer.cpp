@@ -0,0 +1,289 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Spatial/BinauralRenderer.h"
+#include "Core/Mixing/MixKernels.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float HeldVoicePriority = 2.0f;	// The priority boost of sources which already have a voice.
+	}
+
+	void BinauralRenderer::Initialize(const BinauralDescription& description)
+	{
+		Terminate();
+
+		const uint32 blockFrames = description.mBlockFrames;
+		if (!description.pHRIRSet || !description.pHRIRSet->GetImpulseLength() || !blockFrames || (blockFrames & (blockFrames - 1)) || !description.mMaxSources)
+		{
+			Logger::LogError(STRING("Invalid binaural renderer description!"));
+			return;
+		}
+
+		if (description.pHRIRSet->GetSampleRate() != description.mSampleRate)
+			Logger::LogWarn(STRING("The sample rate of the HRIR set does not match the mix sample rate!"));
+
+		mDescription = description;
+		mUpdateCosine = std::cos(description.mUpdateAngle * 3.14159265358979f / 180.0f);
+		mMaxHRTFVoices = description.mMaxHRTFVoices;
+
+		const uint32 impulseLength = description.pHRIRSet->GetImpulseLength();
+		const uint32 partitionCount = std::max(std::min(description.mMaxPartitions, (impulseLength + blockFrames - 1) / blockFrames), 1U);
+		mImpulses.resize(static_cast<uint64>(impulseLength) * 2);
+
+		// Kernels are created once here so that updating them never allocates.
+		mVoices.resize(description.mMaxHRTFVoices);
+		mFreeVoices.reserve(description.mMaxHRTFVoices);
+		for (uint32 i = 0; i < description.mMaxHRTFVoices; i++)
+		{
+			HRTFVoice& voice = mVoices[i];
+			voice.mConvolver.Initialize(blockFrames, partitionCount);
+			for (uint32 ear = 0; ear < 2; ear++)
+			{
+				voice.mConvolver.CreateKernel(mImpulses.data(), impulseLength, voice.mKernels[ear]);
+				voice.mConvolver.CreateKernel(mImpulses.data(), impulseLength, voice.mNextKernels[ear]);
+			}
+
+			mFreeVoices.insert(mFreeVoices.end(), description.mMaxHRTFVoices - i - 1);
+		}
+
+		const uint32 sourceCount = description.mMaxSources;
+		mHandles.resize(sourceCount);
+		mSlotVoices.resize(sourceCount, static_cast<uint32>(InvalidIndex));
+		mPreviousGains.resize(sourceCount);
+		mPreviousLeftGains.resize(sourceCount);
+		mPreviousRightGains.resize(sourceCount);
+		mPreviousMixes.resize(sourceCount);
+		mRenderedBlocks.resize(sourceCount);
+
+		mOrder.resize(sourceCount);
+		mPriorities.resize(sourceCount);
+		mConvolved.resize(static_cast<uint64>(blockFrames) * 4);
+		mRamps.resize(static_cast<uint64>(blockFrames) * 5);
+	}
+
+	void BinauralRenderer::Terminate()
+	{
+		mVoices.clear();
+		mFreeVoices.clear();
+
+		mHandles.clear();
+		mSlotVoices.clear();
+		mPreviousGains.clear();
+		mPreviousLeftGains.clear();
+		mPreviousRightGains.clear();
+		mPreviousMixes.clear();
+		mRenderedBlocks.clear();
+
+		mOrder.clear();
+		mPriorities.clear();
+		mImpulses.clear();
+		mConvolved.clear();
+		mRamps.clear();
+
+		mDescription = {};
+		mMaxHRTFVoices = 0;
+		mBlockIndex = 0;
+	}
+
+	void BinauralRenderer::SetMaxHRTFVoices(uint32 count)
+	{
+		mMaxHRTFVoices = std::min(count, static_cast<uint32>(mVoices.size()));
+	}
+
+	void BinauralRenderer::Render(const BinauralSource* pSources, uint32 sourceCount, float* pOutput)
+	{
+		if (mHandles.empty())
+			return;
+
+		const uint32 blockFrames = mDescription.mBlockFrames;
+		const uint32 slotCount = static_cast<uint32>(mHandles.size());
+		sourceCount = std::min(sourceCount, slotCount);
+		mBlockIndex++;
+
+		// Pick the sources which get full HRTF, favoring the ones which already have a voice.
+		for (uint32 i = 0; i < sourceCount; i++)
+		{
+			const uint32 slot = static_cast<uint32>(pSources[i].mHandle & 0xFFFFFFFF);
+			const bool isHeld = slot < slotCount && mHandles[slot] == pSources[i].mHandle && mSlotVoices[slot] != InvalidIndex;
+
+			mOrder[i] = i;
+			mPriorities[i] = std::fabs(pSources[i].mGain) * (isHeld ? HeldVoicePriority : 1.0f);
+		}
+
+		const uint32 selectedCount = std::min(sourceCount, mMaxHRTFVoices);
+		std::nth_element(mOrder.begin(), mOrder.begin() + selectedCount, mOrder.begin() + sourceCount, [this](uint32 lhs, uint32 rhs) {
+			return mPriorities[lhs] > mPriorities[rhs]; });
+
+		for (uint32 i = 0; i < sourceCount; i++)
+			mPriorities[mOrder[i]] = (i < selectedCount && mPriorities[mOrder[i]] > 0.0f) ? 1.0f : 0.0f;
+
+		float* pGainRamp = mRamps.data();
+		float* pMixRamp = pGainRamp + blockFrames;
+		float* pLeftRamp = pMixRamp + blockFrames;
+		float* pRightRamp = pLeftRamp + blockFrames;
+		float* pFadeRamp = pRightRamp + blockFrames;
+
+		float* pLeft = mConvolved.data();
+		float* pRight = pLeft + blockFrames;
+		float* pNextLeft = pRight + blockFrames;
+		float* pNextRight = pNextLeft + blockFrames;
+
+		for (uint32 i = 0; i < sourceCount; i++)
+		{
+			const BinauralSource& source = pSources[i];
+			const uint32 slot = static_cast<uint32>(source.mHandle & 0xFFFFFFFF);
+			if (slot >= slotCount || !source.pSamples)
+				continue;
+
+			// A new source, or one which skipped a block, starts at its gains instead of ramping.
+			if (mHandles[slot] != source.mHandle)
+			{
+				ReleaseVoice(slot);
+				mHandles[slot] = source.mHandle;
+			}
+
+			const bool isFresh = mRenderedBlocks[slot] + 1 != mBlockIndex;
+			mRenderedBlocks[slot] = mBlockIndex;
+
+			const float* pSourceDirection = source.mDirection;
+			const float magnitude = std::sqrt(pSourceDirection[0] * pSourceDirection[0] + pSourceDirection[1] * pSourceDirection[1] + pSourceDirection[2] * pSourceDirection[2]);
+			const float direction[3] = {
+				magnitude > 0.0f ? pSourceDirection[0] / magnitude : 0.0f,
+				magnitude > 0.0f ? pSourceDirection[1] / magnitude : 0.0f,
+				magnitude > 0.0f ? pSourceDirection[2] / magnitude : 1.0f };
+
+			// Constant power panning from the lateral position on the horizontal plane.
+			const float horizontal = std::sqrt(direction[0] * direction[0] + direction[2] * direction[2]);
+			const float halfPan = horizontal > 0.0f ? direction[0] / horizontal * 0.5f : 0.0f;
+			const float leftGain = source.mGain * std::sqrt(std::max(0.5f - halfPan, 0.0f));
+			const float rightGain = source.mGain * std::sqrt(std::max(0.5f + halfPan, 0.0f));
+
+			bool isNewVoice = false;
+			if (mPriorities[i] > 0.0f && mSlotVoices[slot] == InvalidIndex && !mFreeVoices.empty())
+			{
+				const uint32 voiceIndex = mFreeVoices.back();
+				mFreeVoices.pop_back();
+
+				HRTFVoice& voice = mVoices[voiceIndex];
+				voice.mSlot = slot;
+				voice.mConvolver.Reset();
+				UpdateKernels(voice, direction, true);
+
+				mSlotVoices[slot] = voiceIndex;
+				isNewVoice = true;
+			}
+
+			const uint32 voiceIndex = mSlotVoices[slot];
+			const float mix = (voiceIndex != InvalidIndex && mPriorities[i] > 0.0f) ? 1.0f : 0.0f;
+			if (isFresh)
+			{
+				mPreviousGains[slot] = source.mGain;
+				mPreviousLeftGains[slot] = leftGain;
+				mPreviousRightGains[slot] = rightGain;
+				mPreviousMixes[slot] = mix;
+			}
+
+			ComputeRamp(pMixRamp, mPreviousMixes[slot], mix, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+
+			// Panning, faded out as the source crossfades to HRTF.
+			if (mPreviousMixes[slot] < 1.0f || mix < 1.0f)
+			{
+				ComputeRamp(pLeftRamp, mPreviousLeftGains[slot], leftGain, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+				ComputeRamp(pRightRamp, mPreviousRightGains[slot], rightGain, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+
+				for (uint32 frame = 0; frame < blockFrames; frame++)
+				{
+					const float sample = source.pSamples[frame] * (1.0f - pMixRamp[frame]);
+					pOutput[frame * 2] += sample * pLeftRamp[frame];
+					pOutput[frame * 2 + 1] += sample * pRightRamp[frame];
+				}
+			}
+
+			// Full HRTF, with the old and new HRIRs crossfaded when the source moved.
+			if (voiceIndex != InvalidIndex)
+			{
+				HRTFVoice& voice = mVoices[voiceIndex];
+				const bool isCrossfading = !isNewVoice && UpdateKernels(voice, direction, false);
+
+				voice.mConvolver.PushInput(source.pSamples);
+				voice.mConvolver.Convolve(voice.mKernels[0], pLeft);
+				voice.mConvolver.Convolve(voice.mKernels[1], pRight);
+
+				if (isCrossfading)
+				{
+					voice.mConvolver.Convolve(voice.mNextKernels[0], pNextLeft);
+					voice.mConvolver.Convolve(voice.mNextKernels[1], pNextRight);
+
+					ComputeRamp(pFadeRamp, 0.0f, 1.0f, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+					for (uint32 frame = 0; frame < blockFrames; frame++)
+					{
+						pLeft[frame] += (pNextLeft[frame] - pLeft[frame]) * pFadeRamp[frame];
+						pRight[frame] += (pNextRight[frame] - pRight[frame]) * pFadeRamp[frame];
+					}
+
+					std::swap(voice.mKernels[0], voice.mNextKernels[0]);
+					std::swap(voice.mKernels[1], voice.mNextKernels[1]);
+				}
+
+				ComputeRamp(pGainRamp, mPreviousGains[slot], source.mGain, 0, blockFrames, blockFrames, RampCurve::RAMP_CURVE_LINEAR);
+				for (uint32 frame = 0; frame < blockFrames; frame++)
+				{
+					const float gain = pGainRamp[frame] * pMixRamp[frame];
+					pOutput[frame * 2] += pLeft[frame] * gain;
+					pOutput[frame * 2 + 1] += pRight[frame] * gain;
+				}
+
+				// The voice has faded out to panning and goes to another source.
+				if (mix == 0.0f)
+					ReleaseVoice(slot);
+			}
+
+			mPreviousGains[slot] = source.mGain;
+			mPreviousLeftGains[slot] = leftGain;
+			mPreviousRightGains[slot] = rightGain;
+			mPreviousMixes[slot] = mix;
+		}
+
+		// Voices of sources which were not rendered are freed.
+		for (const HRTFVoice& voice : mVoices)
+			if (voice.mSlot != InvalidIndex && mRenderedBlocks[voice.mSlot] != mBlockIndex)
+				ReleaseVoice(voice.mSlot);
+	}
+
+	bool BinauralRenderer::UpdateKernels(HRTFVoice& voice, const float* pDirection, bool isNew)
+	{
+		const float dot = voice.mDirection[0] * pDirection[0] + voice.mDirection[1] * pDirection[1] + voice.mDirection[2] * pDirection[2];
+		if (!isNew && dot >= mUpdateCosine)
+			return false;
+
+		const uint32 impulseLength = mDescription.pHRIRSet->GetImpulseLength();
+		float* pLeft = mImpulses.data();
+		float* pRight = pLeft + impulseLength;
+		mDescription.pHRIRSet->Interpolate(pDirection, pLeft, pRight);
+
+		ConvolutionKernel* pKernels = isNew ? voice.mKernels : voice.mNextKernels;
+		voice.mConvolver.CreateKernel(pLeft, impulseLength, pKernels[0]);
+		voice.mConvolver.CreateKernel(pRight, impulseLength, pKernels[1]);
+
+		std::copy(pDirection, pDirection + 3, voice.mDirection);
+		return !isNew;
+	}
+
+	void BinauralRenderer::ReleaseVoice(uint32 slot)
+	{
+		const uint32 voiceIndex = mSlotVoices[slot];
+		if (voiceIndex == InvalidIndex)
+			return;
+
+		mVoices[voiceIndex].mSlot = InvalidIndex;
+		mSlotVoices[slot] = InvalidIndex;
+		mFreeVoices.insert(mFreeVoices.end(), voiceIndex);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,267 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Spatial/HRIRSet.h"
+#include "Core/Formats/WAV/Format.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace EnSound
+{
+	namespace
+	{
+		const uint32 HRIRSetTag = MAKE_TAG('E', 'H', 'R', 'I');
+		const uint32 HRIRSetVersion = 1;
+
+		const float OnsetThreshold = 0.1f;	// The onset is where the response first reaches this fraction of its peak.
+		const uint32 OnsetMargin = 2;	// The number of samples kept before the onset.
+
+#pragma pack(push, 1)
+		/**
+		 * HRIR Set Header structure.
+		 * This is the header of a serialized set, which is followed by the directions, the delays and the responses.
+		 */
+		struct HRIRSetHeader {
+			uint32 mTag = HRIRSetTag;
+			uint32 mVersion = HRIRSetVersion;
+			uint32 mMeasurementCount = 0;
+			uint32 mImpulseLength = 0;
+			uint32 mSampleRate = 0;
+			uint32 mReserved = 0;
+		};
+#pragma pack(pop)
+
+		static_assert(sizeof(HRIRSetHeader) == 24, "HRIRSetHeader structure size mismatch!");
+
+		/**
+		 * Find the onset of a response.
+		 */
+		uint32 FindOnset(const float* pImpulse, uint32 length)
+		{
+			float peak = 0.0f;
+			for (uint32 i = 0; i < length; i++)
+				peak = std::max(peak, std::fabs(pImpulse[i]));
+
+			uint32 onset = 0;
+			while (onset < length && std::fabs(pImpulse[onset]) < peak * OnsetThreshold)
+				onset++;
+
+			return onset > OnsetMargin ? onset - OnsetMargin : 0;
+		}
+	}
+
+	bool HRIRSet::Initialize(const HRIRSetDescription& description)
+	{
+		Terminate();
+
+		if (!description.pPositions || !description.pImpulses || !description.mMeasurementCount || !description.mImpulseLength)
+		{
+			Logger::LogError(STRING("Invalid HRIR set description!"));
+			return false;
+		}
+
+		const uint32 measurementCount = description.mMeasurementCount;
+		const uint32 length = description.mImpulseLength;
+		mImpulseLength = length;
+		mSampleRate = description.mSampleRate;
+
+		mDirections.resize(static_cast<uint64>(measurementCount) * 3);
+		mDelays.resize(static_cast<uint64>(measurementCount) * 2);
+		mImpulses.resize(static_cast<uint64>(measurementCount) * 2 * length);
+
+		const float degrees = 3.14159265358979f / 180.0f;
+		for (uint32 i = 0; i < measurementCount; i++)
+		{
+			// SOFA azimuths are counterclockwise, so positive azimuths are on the left (-X).
+			const float azimuth = description.pPositions[i * 2] * degrees;
+			const float elevation = description.pPositions[i * 2 + 1] * degrees;
+			mDirections[i * 3] = -std::sin(azimuth) * std::cos(elevation);
+			mDirections[i * 3 + 1] = std::sin(elevation);
+			mDirections[i * 3 + 2] = std::cos(azimuth) * std::cos(elevation);
+
+			for (uint32 ear = 0; ear < 2; ear++)
+			{
+				const uint64 offset = (static_cast<uint64>(i) * 2 + ear) * length;
+				const float* pImpulse = description.pImpulses + offset;
+				const uint32 onset = FindOnset(pImpulse, length);
+
+				mDelays[i * 2 + ear] = static_cast<float>(onset);
+				std::copy(pImpulse + onset, pImpulse + length, mImpulses.begin() + offset);
+			}
+		}
+
+		return true;
+	}
+
+	void HRIRSet::Terminate()
+	{
+		mDirections.clear();
+		mDelays.clear();
+		mImpulses.clear();
+		mImpulseLength = 0;
+		mSampleRate = 0;
+	}
+
+	void HRIRSet::Interpolate(const float* pDirection, float* pLeft, float* pRight) const
+	{
+		const uint32 length = mImpulseLength;
+		std::fill(pLeft, pLeft + length, 0.0f);
+		std::fill(pRight, pRight + length, 0.0f);
+
+		const uint32 measurementCount = GetMeasurementCount();
+		if (!measurementCount)
+			return;
+
+		const float magnitude = std::sqrt(pDirection[0] * pDirection[0] + pDirection[1] * pDirection[1] + pDirection[2] * pDirection[2]);
+		const float direction[3] = {
+			magnitude > 0.0f ? pDirection[0] / magnitude : 0.0f,
+			magnitude > 0.0f ? pDirection[1] / magnitude : 0.0f,
+			magnitude > 0.0f ? pDirection[2] / magnitude : 1.0f };
+
+		// Find the three closest measurements, the closest being the one with the largest dot product.
+		uint32 closest[3] = { 0, 0, 0 };
+		float dots[3] = { -2.0f, -2.0f, -2.0f };
+		for (uint32 i = 0; i < measurementCount; i++)
+		{
+			const float* pMeasurement = mDirections.data() + static_cast<uint64>(i) * 3;
+			float dot = pMeasurement[0] * direction[0] + pMeasurement[1] * direction[1] + pMeasurement[2] * direction[2];
+			uint32 index = i;
+
+			for (uint32 j = 0; j < 3; j++)
+			{
+				if (dot > dots[j])
+				{
+					std::swap(dot, dots[j]);
+					std::swap(index, closest[j]);
+				}
+			}
+		}
+
+		// Inverse distance weights, where the distance is 1 - cos(angle).
+		float weights[3] = {};
+		float weightSum = 0.0f;
+		const uint32 count = std::min(measurementCount, 3U);
+		for (uint32 j = 0; j < count; j++)
+		{
+			weights[j] = 1.0f / std::max(1.0f - dots[j], 1e-6f);
+			weightSum += weights[j];
+		}
+
+		float* pOutputs[2] = { pLeft, pRight };
+		for (uint32 ear = 0; ear < 2; ear++)
+		{
+			float delay = 0.0f;
+			for (uint32 j = 0; j < count; j++)
+				delay += mDelays[closest[j] * 2 + ear] * weights[j] / weightSum;
+
+			// The aligned responses are mixed after the interpolated delay, the end of the responses is dropped.
+			const uint32 shift = std::min(static_cast<uint32>(delay + 0.5f), length);
+			for (uint32 j = 0; j < count; j++)
+			{
+				const float* pImpulse = mImpulses.data() + (static_cast<uint64>(closest[j]) * 2 + ear) * length;
+				const float weight = weights[j] / weightSum;
+
+				for (uint32 i = shift; i < length; i++)
+					pOutputs[ear][i] += pImpulse[i - shift] * weight;
+			}
+		}
+	}
+
+	void HRIRSet::Serialize(Vector<uint8>& output) const
+	{
+		HRIRSetHeader header = {};
+		header.mMeasurementCount = GetMeasurementCount();
+		header.mImpulseLength = mImpulseLength;
+		header.mSampleRate = mSampleRate;
+
+		const uint64 directionBytes = mDirections.size() * sizeof(float);
+		const uint64 delayBytes = mDelays.size() * sizeof(float);
+		const uint64 impulseBytes = mImpulses.size() * sizeof(float);
+		output.resize(sizeof(HRIRSetHeader) + directionBytes + delayBytes + impulseBytes);
+
+		uint8* pOutput = output.data();
+		std::memcpy(pOutput, &header, sizeof(HRIRSetHeader));
+		pOutput += sizeof(HRIRSetHeader);
+
+		if (header.mMeasurementCount)
+		{
+			std::memcpy(pOutput, mDirections.data(), directionBytes);
+			std::memcpy(pOutput + directionBytes, mDelays.data(), delayBytes);
+			std::memcpy(pOutput + directionBytes + delayBytes, mImpulses.data(), impulseBytes);
+		}
+	}
+
+	bool HRIRSet::Deserialize(const uint8* pData, uint64 dataSize)
+	{
+		Terminate();
+
+		if (!pData || dataSize < sizeof(HRIRSetHeader))
+			return false;
+
+		HRIRSetHeader header = {};
+		std::memcpy(&header, pData, sizeof(HRIRSetHeader));
+
+		const uint64 measurementCount = header.mMeasurementCount;
+		const uint64 floatCount = measurementCount * 3 + measurementCount * 2 + measurementCount * 2 * header.mImpulseLength;
+		if (header.mTag != HRIRSetTag || header.mVersion != HRIRSetVersion || !measurementCount || !header.mImpulseLength ||
+			dataSize - sizeof(HRIRSetHeader) != floatCount * sizeof(float))
+			return false;
+
+		mDirections.resize(measurementCount * 3);
+		mDelays.resize(measurementCount * 2);
+		mImpulses.resize(measurementCount * 2 * header.mImpulseLength);
+
+		const uint8* pInput = pData + sizeof(HRIRSetHeader);
+		std::memcpy(mDirections.data(), pInput, mDirections.size() * sizeof(float));
+		pInput += mDirections.size() * sizeof(float);
+		std::memcpy(mDelays.data(), pInput, mDelays.size() * sizeof(float));
+		pInput += mDelays.size() * sizeof(float);
+		std::memcpy(mImpulses.data(), pInput, mImpulses.size() * sizeof(float));
+
+		mImpulseLength = header.mImpulseLength;
+		mSampleRate = header.mSampleRate;
+		return true;
+	}
+
+	bool HRIRSet::SaveToFile(const wchar* pFileName) const
+	{
+		if (!pFileName)
+			return false;
+
+		Vector<uint8> bytes;
+		Serialize(bytes);
+
+		std::ofstream file(std::filesystem::path(pFileName), std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			Logger::LogError(STRING("Failed to open the HRIR set file for writing!"));
+			return false;
+		}
+
+		file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+		return file.good();
+	}
+
+	bool HRIRSet::LoadFromFile(const wchar* pFileName)
+	{
+		Terminate();
+
+		if (!pFileName)
+			return false;
+
+		std::ifstream file(std::filesystem::path(pFileName), std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+			return false;
+
+		Vector<uint8> bytes(static_cast<uint64>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+
+		return file.good() && Deserialize(bytes.data(), bytes.size());
+	}
+}
\ No newline at end of file
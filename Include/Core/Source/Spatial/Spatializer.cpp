@@ -0,0 +1,320 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Spatial/Spatializer.h"
+#include "Core/Platform/SIMD.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace EnSound
+{
+	namespace
+	{
+		const float Pi = 3.14159265358979f;
+		const float HalfPi = Pi * 0.5f;
+		const float TwoPi = Pi * 2.0f;
+		const float Epsilon = 1e-6f;
+
+		/**
+		 * Four emitters worth of values. Comparisons return masks which are only meant for Select() and the mask
+		 * functions.
+		 */
+#ifdef ENSD_SIMD_SSE2
+		struct Lanes { __m128 v; };
+
+		inline Lanes Set(float value) { return { _mm_set1_ps(value) }; }
+		inline Lanes Set(const float(&values)[4]) { return { _mm_loadu_ps(values) }; }
+		inline void Get(Lanes lanes, float(&values)[4]) { _mm_storeu_ps(values, lanes.v); }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return { _mm_add_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return { _mm_sub_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return { _mm_mul_ps(lhs.v, rhs.v) }; }
+		inline Lanes operator/(Lanes lhs, Lanes rhs) { return { _mm_div_ps(lhs.v, rhs.v) }; }
+
+		inline Lanes Min(Lanes lhs, Lanes rhs) { return { _mm_min_ps(lhs.v, rhs.v) }; }
+		inline Lanes Max(Lanes lhs, Lanes rhs) { return { _mm_max_ps(lhs.v, rhs.v) }; }
+		inline Lanes Sqrt(Lanes lanes) { return { _mm_sqrt_ps(lanes.v) }; }
+		inline Lanes Abs(Lanes lanes) { return { _mm_andnot_ps(_mm_set1_ps(-0.0f), lanes.v) }; }
+
+		inline Lanes Less(Lanes lhs, Lanes rhs) { return { _mm_cmplt_ps(lhs.v, rhs.v) }; }
+		inline Lanes Equal(Lanes lhs, Lanes rhs) { return { _mm_cmpeq_ps(lhs.v, rhs.v) }; }
+		inline Lanes MaskAnd(Lanes lhs, Lanes rhs) { return { _mm_and_ps(lhs.v, rhs.v) }; }
+		inline Lanes MaskAndNot(Lanes lhs, Lanes rhs) { return { _mm_andnot_ps(rhs.v, lhs.v) }; }
+		inline Lanes MaskOr(Lanes lhs, Lanes rhs) { return { _mm_or_ps(lhs.v, rhs.v) }; }
+		inline Lanes Select(Lanes mask, Lanes lhs, Lanes rhs) { return { _mm_or_ps(_mm_and_ps(mask.v, lhs.v), _mm_andnot_ps(mask.v, rhs.v)) }; }
+
+#else
+		struct Lanes { float v[4]; };
+
+		template<class Function>
+		inline Lanes Apply(Function function) { Lanes result = {}; for (uint32 i = 0; i < 4; i++) result.v[i] = function(i); return result; }
+
+		inline Lanes Set(float value) { return Apply([value](uint32) { return value; }); }
+		inline Lanes Set(const float(&values)[4]) { return Apply([&values](uint32 i) { return values[i]; }); }
+		inline void Get(Lanes lanes, float(&values)[4]) { for (uint32 i = 0; i < 4; i++) values[i] = lanes.v[i]; }
+
+		inline Lanes operator+(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] + rhs.v[i]; }); }
+		inline Lanes operator-(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] - rhs.v[i]; }); }
+		inline Lanes operator*(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] * rhs.v[i]; }); }
+		inline Lanes operator/(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] / rhs.v[i]; }); }
+
+		inline Lanes Min(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return std::min(lhs.v[i], rhs.v[i]); }); }
+		inline Lanes Max(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return std::max(lhs.v[i], rhs.v[i]); }); }
+		inline Lanes Sqrt(Lanes lanes) { return Apply([&](uint32 i) { return std::sqrt(lanes.v[i]); }); }
+		inline Lanes Abs(Lanes lanes) { return Apply([&](uint32 i) { return std::fabs(lanes.v[i]); }); }
+
+		inline Lanes Less(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] < rhs.v[i] ? 1.0f : 0.0f; }); }
+		inline Lanes Equal(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] == rhs.v[i] ? 1.0f : 0.0f; }); }
+		inline Lanes MaskAnd(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] * rhs.v[i]; }); }
+		inline Lanes MaskAndNot(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return lhs.v[i] * (1.0f - rhs.v[i]); }); }
+		inline Lanes MaskOr(Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return std::max(lhs.v[i], rhs.v[i]); }); }
+		inline Lanes Select(Lanes mask, Lanes lhs, Lanes rhs) { return Apply([&](uint32 i) { return mask.v[i] != 0.0f ? lhs.v[i] : rhs.v[i]; }); }
+
+#endif // ENSD_SIMD_SSE2
+
+		/**
+		 * Load up to four values, the missing ones are filled with a default.
+		 */
+		inline Lanes Load(const float* pValues, uint32 index, uint32 count, float defaultValue = 0.0f)
+		{
+			float values[4] = { defaultValue, defaultValue, defaultValue, defaultValue };
+			if (pValues)
+				std::copy(pValues + index, pValues + index + count, values);
+
+			return Set(values);
+		}
+
+		/**
+		 * Store up to four values.
+		 */
+		inline void Store(float* pValues, uint32 index, uint32 count, Lanes lanes)
+		{
+			float values[4] = {};
+			Get(lanes, values);
+			std::copy(values, values + count, pValues + index);
+		}
+
+		/**
+		 * sin(x) for x in [0, pi / 2], accurate to about 4e-6.
+		 */
+		inline Lanes SinQuarter(Lanes x)
+		{
+			const Lanes s = x * x;
+			return x * (Set(1.0f) + s * (Set(-1.0f / 6.0f) + s * (Set(1.0f / 120.0f) + s * (Set(-1.0f / 5040.0f) + s * Set(1.0f / 362880.0f)))));
+		}
+
+		/**
+		 * atan2(y, x) in (-pi, pi], accurate to about 1e-5 radians.
+		 */
+		inline Lanes Atan2(Lanes y, Lanes x)
+		{
+			const Lanes absX = Abs(x);
+			const Lanes absY = Abs(y);
+			const Lanes ratio = Min(absX, absY) / Max(Max(absX, absY), Set(Epsilon));
+			const Lanes s = ratio * ratio;
+
+			Lanes result = ((Set(-0.0464964749f) * s + Set(0.15931422f)) * s - Set(0.327622764f)) * s * ratio + ratio;
+			result = Select(Less(absX, absY), Set(HalfPi) - result, result);
+			result = Select(Less(x, Set(0.0f)), Set(Pi) - result, result);
+			return Select(Less(y, Set(0.0f)), Set(0.0f) - result, result);
+		}
+
+		inline float WrapAngle(float radians)
+		{
+			radians = std::fmod(radians, TwoPi);
+			return radians < 0.0f ? radians + TwoPi : radians;
+		}
+	}
+
+	void Spatializer::Initialize(const SpatializerDescription& description)
+	{
+		Terminate();
+		mDescription = description;
+
+		const float stereo[2] = { -30.0f, 30.0f };
+		SetSpeakerLayout(stereo, 2);
+		SetEmitterSettings(0, EmitterSettings());
+	}
+
+	void Spatializer::Terminate()
+	{
+		mGains.clear();
+		mDopplerRatios.clear();
+		mSpeakerAzimuths.clear();
+		mSpeakerChannels.clear();
+		mSettings.clear();
+		mCapacity = 0;
+	}
+
+	void Spatializer::SetSpeakerLayout(const float* pAzimuths, uint32 speakerCount)
+	{
+		mSpeakerChannels.resize(speakerCount);
+		std::iota(mSpeakerChannels.begin(), mSpeakerChannels.end(), 0);
+		std::sort(mSpeakerChannels.begin(), mSpeakerChannels.end(), [pAzimuths](uint32 lhs, uint32 rhs) {
+			return WrapAngle(pAzimuths[lhs] * Pi / 180.0f) < WrapAngle(pAzimuths[rhs] * Pi / 180.0f); });
+
+		mSpeakerAzimuths.resize(speakerCount);
+		for (uint32 i = 0; i < speakerCount; i++)
+			mSpeakerAzimuths[i] = WrapAngle(pAzimuths[mSpeakerChannels[i]] * Pi / 180.0f);
+
+		mGains.assign(static_cast<uint64>(mCapacity) * speakerCount, 0.0f);
+	}
+
+	void Spatializer::SetEmitterSettings(uint32 index, const EmitterSettings& settings)
+	{
+		if (index >= mSettings.size())
+			mSettings.resize(index + 1);
+
+		const float innerAngle = std::min(std::max(settings.mConeInnerAngle, 0.0f), 360.0f);
+		const float outerAngle = std::min(std::max(settings.mConeOuterAngle, innerAngle), 360.0f);
+
+		EmitterSettingsData& data = mSettings[index];
+		data.mCurve = static_cast<float>(settings.mCurve);
+		data.mMinDistance = std::max(settings.mMinDistance, Epsilon);
+		data.mMaxDistance = std::max(settings.mMaxDistance, data.mMinDistance);
+		data.mRolloff = std::max(settings.mRolloff, 0.0f);
+		data.mConeCosInner = std::cos(innerAngle * Pi / 360.0f);
+		data.mConeCosOuter = std::cos(outerAngle * Pi / 360.0f);
+		data.mConeOuterGain = settings.mConeOuterGain;
+	}
+
+	void Spatializer::Process(const Listener& listener, const EmitterArrays& emitters, uint32 emitterCount)
+	{
+		const uint32 speakerCount = GetSpeakerCount();
+		if (emitterCount > mCapacity)
+		{
+			mCapacity = (emitterCount + 3) & ~3U;
+			mGains.assign(static_cast<uint64>(mCapacity) * speakerCount, 0.0f);
+			mDopplerRatios.assign(mCapacity, 1.0f);
+		}
+
+		// The listener's right direction completes its left handed basis.
+		const float* pForward = listener.mForward;
+		const float* pUp = listener.mUp;
+		const float right[3] = { pUp[1] * pForward[2] - pUp[2] * pForward[1], pUp[2] * pForward[0] - pUp[0] * pForward[2], pUp[0] * pForward[1] - pUp[1] * pForward[0] };
+
+		const float speedOfSound = mDescription.mSpeedOfSound;
+		const float dopplerFactor = mDescription.mDopplerFactor;
+
+		for (uint32 i = 0; i < emitterCount; i += 4)
+		{
+			const uint32 count = std::min(emitterCount - i, 4U);
+
+			const Lanes x = Load(emitters.pPositionsX, i, count) - Set(listener.mPosition[0]);
+			const Lanes y = Load(emitters.pPositionsY, i, count) - Set(listener.mPosition[1]);
+			const Lanes z = Load(emitters.pPositionsZ, i, count) - Set(listener.mPosition[2]);
+
+			const Lanes distance = Sqrt(x * x + y * y + z * z);
+			const Lanes inverseDistance = Set(1.0f) / Max(distance, Set(Epsilon));
+
+			// Gather the settings of the four emitters.
+			float curves[4] = {}, minDistances[4] = {}, maxDistances[4] = {}, rolloffs[4] = {}, cosInners[4] = {}, cosOuters[4] = {}, outerGains[4] = {};
+			for (uint32 lane = 0; lane < 4; lane++)
+			{
+				const uint32 index = (emitters.pSettingIndices && lane < count) ? std::min<uint32>(emitters.pSettingIndices[i + lane], static_cast<uint32>(mSettings.size() - 1)) : 0;
+				const EmitterSettingsData& settings = mSettings[index];
+
+				curves[lane] = settings.mCurve;
+				minDistances[lane] = settings.mMinDistance;
+				maxDistances[lane] = settings.mMaxDistance;
+				rolloffs[lane] = settings.mRolloff;
+				cosInners[lane] = settings.mConeCosInner;
+				cosOuters[lane] = settings.mConeCosOuter;
+				outerGains[lane] = settings.mConeOuterGain;
+			}
+
+			// Distance attenuation. Every curve is computed and the emitter's own one is selected.
+			const Lanes curve = Set(curves);
+			const Lanes minDistance = Set(minDistances);
+			const Lanes maxDistance = Set(maxDistances);
+			const Lanes rolloff = Set(rolloffs);
+
+			const Lanes excess = Min(Max(distance, minDistance), maxDistance) - minDistance;
+			const Lanes inverse = minDistance / (minDistance + rolloff * excess);
+			const Lanes linear = Max(Set(1.0f) - rolloff * excess / Max(maxDistance - minDistance, Set(Epsilon)), Set(0.0f));
+
+			Lanes gain = Set(1.0f);
+			gain = Select(Equal(curve, Set(static_cast<float>(DistanceCurve::DISTANCE_CURVE_INVERSE))), inverse, gain);
+			gain = Select(Equal(curve, Set(static_cast<float>(DistanceCurve::DISTANCE_CURVE_LINEAR))), linear, gain);
+			gain = Select(Equal(curve, Set(static_cast<float>(DistanceCurve::DISTANCE_CURVE_INVERSE_SQUARE))), inverse * inverse, gain);
+
+			// Cone attenuation, from the angle between the emitter's direction and the direction to the listener.
+			if (emitters.pForwardsX && emitters.pForwardsY && emitters.pForwardsZ)
+			{
+				const Lanes forwardX = Load(emitters.pForwardsX, i, count);
+				const Lanes forwardY = Load(emitters.pForwardsY, i, count);
+				const Lanes forwardZ = Load(emitters.pForwardsZ, i, count);
+
+				const Lanes cosAngle = Set(0.0f) - (forwardX * x + forwardY * y + forwardZ * z) * inverseDistance;
+				const Lanes cosInner = Set(cosInners);
+				const Lanes cosOuter = Set(cosOuters);
+				const Lanes outerGain = Set(outerGains);
+
+				const Lanes blend = Min(Max((cosAngle - cosOuter) / Max(cosInner - cosOuter, Set(Epsilon)), Set(0.0f)), Set(1.0f));
+				gain = gain * (outerGain + (Set(1.0f) - outerGain) * blend);
+			}
+
+			// Doppler, from the velocities along the direction from the listener to the emitter.
+			if (dopplerFactor > 0.0f)
+			{
+				const Lanes directionX = x * inverseDistance;
+				const Lanes directionY = y * inverseDistance;
+				const Lanes directionZ = z * inverseDistance;
+				const Lanes limit = Set(speedOfSound * 0.5f);
+				const Lanes negativeLimit = Set(speedOfSound * -0.5f);
+
+				Lanes listenerSpeed = (Set(listener.mVelocity[0]) * directionX + Set(listener.mVelocity[1]) * directionY + Set(listener.mVelocity[2]) * directionZ) * Set(dopplerFactor);
+				Lanes emitterSpeed = (Load(emitters.pVelocitiesX, i, count) * directionX + Load(emitters.pVelocitiesY, i, count) * directionY + Load(emitters.pVelocitiesZ, i, count) * directionZ) * Set(dopplerFactor);
+
+				listenerSpeed = Min(Max(listenerSpeed, negativeLimit), limit);
+				emitterSpeed = Min(Max(emitterSpeed, negativeLimit), limit);
+
+				Store(mDopplerRatios.data(), i, count, (Set(speedOfSound) + listenerSpeed) / (Set(speedOfSound) + emitterSpeed));
+			}
+			else
+				std::fill(mDopplerRatios.begin() + i, mDopplerRatios.begin() + i + count, 1.0f);
+
+			for (uint32 speaker = 0; speaker < speakerCount; speaker++)
+				Store(mGains.data() + static_cast<uint64>(speaker) * mCapacity, i, count, Set(0.0f));
+
+			if (speakerCount == 1)
+			{
+				Store(mGains.data(), i, count, gain);
+				continue;
+			}
+
+			// Equal power panning between the two speakers around the emitter's azimuth.
+			const Lanes side = x * Set(right[0]) + y * Set(right[1]) + z * Set(right[2]);
+			const Lanes front = x * Set(pForward[0]) + y * Set(pForward[1]) + z * Set(pForward[2]);
+
+			Lanes azimuth = Atan2(side, front);
+			azimuth = Select(Less(azimuth, Set(0.0f)), azimuth + Set(TwoPi), azimuth);
+
+			Lanes assigned = Less(Set(1.0f), Set(0.0f));
+			for (uint32 arc = 0; arc < speakerCount; arc++)
+			{
+				const uint32 next = (arc + 1) % speakerCount;
+				const float start = mSpeakerAzimuths[arc];
+				const float span = (next ? mSpeakerAzimuths[next] : mSpeakerAzimuths[0] + TwoPi) - start;
+
+				// Azimuths just below the start of the arc are rounding errors, not a full turn.
+				Lanes relative = azimuth - Set(start);
+				relative = Select(Less(relative, Set(-Epsilon)), relative + Set(TwoPi), Max(relative, Set(0.0f)));
+
+				const Lanes inArc = MaskAndNot(Less(relative, Set(span)), assigned);
+				assigned = MaskOr(assigned, inArc);
+
+				const Lanes angle = Min(relative / Set(std::max(span, Epsilon)), Set(1.0f)) * Set(HalfPi);
+				const Lanes startGain = Select(inArc, SinQuarter(Set(HalfPi) - angle) * gain, Set(0.0f));
+				const Lanes endGain = Select(inArc, SinQuarter(angle) * gain, Set(0.0f));
+
+				float* pStartGains = mGains.data() + static_cast<uint64>(mSpeakerChannels[arc]) * mCapacity;
+				float* pEndGains = mGains.data() + static_cast<uint64>(mSpeakerChannels[next]) * mCapacity;
+				Store(pStartGains, i, count, Load(pStartGains, i, count) + startGain);
+				Store(pEndGains, i, count, Load(pEndGains, i, count) + endGain);
+			}
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,188 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Streaming/AudioStream.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace EnSound
+{
+	bool StreamAsset::Initialize(const wchar* pFilePath, const WAVFormat& format, uint64 dataOffset, uint64 dataBytes, uint32 preRollMilliseconds)
+	{
+		Terminate();
+
+		if (!pFilePath || !format.mAvgByteRate)
+		{
+			Logger::LogError(STRING("Invalid stream asset description!"));
+			return false;
+		}
+
+		pFileName = pFilePath;
+		mFormat = format;
+		mDataOffset = dataOffset;
+		mDataBytes = dataBytes;
+
+		uint64 preRollBytes = preRollMilliseconds * format.mAvgByteRate / 1000;
+		if (format.mBlockAlignment)
+			preRollBytes = (preRollBytes + format.mBlockAlignment - 1) / format.mBlockAlignment * format.mBlockAlignment;
+
+		mPreRoll.resize(std::min(preRollBytes, dataBytes));
+		if (mPreRoll.empty())
+			return true;
+
+		std::ifstream file(std::filesystem::path(pFilePath), std::ios::binary);
+		if (!file.is_open())
+		{
+			Logger::LogError(STRING("Failed to open the stream asset file!"));
+			Terminate();
+			return false;
+		}
+
+		file.seekg(dataOffset);
+		file.read(reinterpret_cast<char*>(mPreRoll.data()), mPreRoll.size());
+		if (!file.good())
+		{
+			Logger::LogError(STRING("Failed to load the pre-roll of the stream asset!"));
+			Terminate();
+			return false;
+		}
+
+		return true;
+	}
+
+	void StreamAsset::Terminate()
+	{
+		mPreRoll.clear();
+		mPreRoll.shrink_to_fit();
+		mFormat = {};
+		pFileName = nullptr;
+		mDataOffset = mDataBytes = 0;
+	}
+
+	void AudioStream::Initialize(const StreamAsset* pStreamAsset, uint32 bufferMilliseconds)
+	{
+		Terminate();
+
+		pAsset = pStreamAsset;
+		if (!pAsset)
+			return;
+
+		// Round the ring buffer up to a power of two so that wrapping is a mask.
+		const uint64 bufferBytes = std::max<uint64>(bufferMilliseconds * pAsset->GetFormat().mAvgByteRate / 1000, 4096);
+		uint64 ringBytes = 1;
+		while (ringBytes < bufferBytes)
+			ringBytes <<= 1;
+
+		mRingBuffer.resize(ringBytes);
+	}
+
+	void AudioStream::Terminate()
+	{
+		mRingBuffer.clear();
+		pAsset = nullptr;
+		mReadCursor.store(0, std::memory_order_relaxed);
+		mWriteCursor.store(0, std::memory_order_relaxed);
+		mUnderrunCount = 0;
+	}
+
+	uint64 AudioStream::Read(uint8* pOutput, uint64 byteCount)
+	{
+		if (!pAsset)
+			return 0;
+
+		const uint64 preRollBytes = GetPreRollBytes();
+		uint64 cursor = mReadCursor.load(std::memory_order_relaxed);
+		uint64 bytesRead = 0;
+
+		// Serve the pre-roll first.
+		if (cursor < preRollBytes)
+		{
+			const uint64 bytes = std::min(byteCount, preRollBytes - cursor);
+			std::memcpy(pOutput, pAsset->GetPreRoll() + cursor, bytes);
+
+			bytesRead += bytes;
+			cursor += bytes;
+		}
+
+		// Then continue from the ring buffer.
+		if (bytesRead < byteCount && !mRingBuffer.empty())
+		{
+			const uint64 streamedCursor = cursor - preRollBytes;
+			const uint64 available = mWriteCursor.load(std::memory_order_acquire) - streamedCursor;
+			const uint64 mask = mRingBuffer.size() - 1;
+
+			uint64 bytes = std::min(byteCount - bytesRead, available);
+			while (bytes)
+			{
+				const uint64 index = (cursor - preRollBytes) & mask;
+				const uint64 chunk = std::min(bytes, mRingBuffer.size() - index);
+				std::memcpy(pOutput + bytesRead, mRingBuffer.data() + index, chunk);
+
+				bytesRead += chunk;
+				cursor += chunk;
+				bytes -= chunk;
+			}
+		}
+
+		if (bytesRead < byteCount && cursor < pAsset->GetDataBytes())
+			mUnderrunCount++;
+
+		mReadCursor.store(cursor, std::memory_order_release);
+		return bytesRead;
+	}
+
+	void AudioStream::BeginWrite(uint64* pFileOffset, uint8** ppDestination, uint64* pByteCount)
+	{
+		*pFileOffset = 0;
+		*ppDestination = nullptr;
+		*pByteCount = 0;
+
+		if (!pAsset || mRingBuffer.empty())
+			return;
+
+		const uint64 preRollBytes = GetPreRollBytes();
+		const uint64 readCursor = mReadCursor.load(std::memory_order_acquire);
+		const uint64 writeCursor = mWriteCursor.load(std::memory_order_relaxed);
+
+		// Bytes still held by the ring buffer cannot be overwritten.
+		const uint64 streamedRead = readCursor > preRollBytes ? readCursor - preRollBytes : 0;
+		const uint64 freeBytes = mRingBuffer.size() - (writeCursor - streamedRead);
+		const uint64 index = writeCursor & (mRingBuffer.size() - 1);
+
+		*pByteCount = std::min({ freeBytes, mRingBuffer.size() - index, GetStreamedBytes() - writeCursor });
+		*pFileOffset = pAsset->GetDataOffset() + preRollBytes + writeCursor;
+		*ppDestination = mRingBuffer.data() + index;
+	}
+
+	void AudioStream::EndWrite(uint64 byteCount)
+	{
+		mWriteCursor.fetch_add(byteCount, std::memory_order_release);
+	}
+
+	uint64 AudioStream::GetBufferedBytes() const
+	{
+		if (!pAsset)
+			return 0;
+
+		const uint64 preRollBytes = GetPreRollBytes();
+		const uint64 readCursor = mReadCursor.load(std::memory_order_acquire);
+		const uint64 writeCursor = mWriteCursor.load(std::memory_order_acquire);
+
+		if (readCursor < preRollBytes)
+			return preRollBytes - readCursor + writeCursor;
+
+		return writeCursor - (readCursor - preRollBytes);
+	}
+
+	uint64 AudioStream::GetBufferedMilliseconds() const
+	{
+		if (!pAsset || !pAsset->GetFormat().mAvgByteRate)
+			return 0;
+
+		return GetBufferedBytes() * 1000 / pAsset->GetFormat().mAvgByteRate;
+	}
+}
\ No newline at end of file
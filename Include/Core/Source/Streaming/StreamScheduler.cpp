@@ -0,0 +1,636 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Streaming/StreamScheduler.h"
+#include "Core/Error/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#else
+#include <fcntl.h>
+#include <unistd.h>
+
+#endif // _WIN32
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#endif // __linux__
+
+namespace EnSound
+{
+	namespace
+	{
+		const intptr_t InvalidFile = -1;
+
+		intptr_t OpenNativeFile(const wchar* pFileName)
+		{
+#ifdef _WIN32
+			HANDLE hFile = CreateFileW(pFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			return hFile == INVALID_HANDLE_VALUE ? InvalidFile : reinterpret_cast<intptr_t>(hFile);
+
+#else
+			return open(std::filesystem::path(pFileName).c_str(), O_RDONLY | O_CLOEXEC);
+
+#endif // _WIN32
+		}
+
+		void CloseNativeFile(intptr_t file)
+		{
+			if (file == InvalidFile)
+				return;
+
+#ifdef _WIN32
+			CloseHandle(reinterpret_cast<HANDLE>(file));
+
+#else
+			close(static_cast<int>(file));
+
+#endif // _WIN32
+		}
+
+		int64 ReadNativeFile(intptr_t file, uint8* pDestination, uint64 byteCount, uint64 offset)
+		{
+#ifdef _WIN32
+			OVERLAPPED overlapped = {};
+			overlapped.Offset = static_cast<DWORD>(offset & 0xFFFFFFFF);
+			overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+
+			DWORD bytesRead = 0;
+			if (!ReadFile(reinterpret_cast<HANDLE>(file), pDestination, static_cast<DWORD>(byteCount), &bytesRead, &overlapped))
+				return -1;
+
+			return bytesRead;
+
+#else
+			return pread(static_cast<int>(file), pDestination, byteCount, static_cast<off_t>(offset));
+
+#endif // _WIN32
+		}
+	}
+
+#ifdef __linux__
+	/**
+	 * io_uring structure.
+	 * This is a minimal io_uring wrapper using the raw system calls, with a registered fixed buffer per slot.
+	 * Reference: https://kernel.dk/io_uring.pdf
+	 */
+	struct IOURing {
+		/**
+		 * Set up the ring and register the fixed buffers.
+		 *
+		 * @param depth: The number of slots (submission queue entries).
+		 * @param slotBytes: The byte size of each fixed buffer.
+		 * @return Boolean stating if io_uring is available.
+		 */
+		bool Initialize(uint32 depth, uint32 slotBytes)
+		{
+			io_uring_params params = {};
+			mFD = static_cast<int>(syscall(__NR_io_uring_setup, depth, &params));
+			if (mFD < 0)
+				return false;
+
+			mSQRingBytes = params.sq_off.array + params.sq_entries * sizeof(uint32);
+			mCQRingBytes = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+			if (params.features & IORING_FEAT_SINGLE_MMAP)
+				mSQRingBytes = mCQRingBytes = std::max(mSQRingBytes, mCQRingBytes);
+
+			pSQRing = mmap(nullptr, mSQRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQ_RING);
+			if (pSQRing == MAP_FAILED)
+			{
+				pSQRing = nullptr;
+				Terminate();
+				return false;
+			}
+
+			if (params.features & IORING_FEAT_SINGLE_MMAP)
+				pCQRing = pSQRing;
+			else
+			{
+				pCQRing = mmap(nullptr, mCQRingBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_CQ_RING);
+				if (pCQRing == MAP_FAILED)
+				{
+					pCQRing = nullptr;
+					Terminate();
+					return false;
+				}
+			}
+
+			mSQEBytes = params.sq_entries * sizeof(io_uring_sqe);
+			void* pSQEMemory = mmap(nullptr, mSQEBytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mFD, IORING_OFF_SQES);
+			if (pSQEMemory == MAP_FAILED)
+			{
+				Terminate();
+				return false;
+			}
+			pSQEs = static_cast<io_uring_sqe*>(pSQEMemory);
+
+			uint8* pSQ = static_cast<uint8*>(pSQRing);
+			pSQTail = reinterpret_cast<uint32*>(pSQ + params.sq_off.tail);
+			mSQMask = *reinterpret_cast<uint32*>(pSQ + params.sq_off.ring_mask);
+			pSQArray = reinterpret_cast<uint32*>(pSQ + params.sq_off.array);
+
+			uint8* pCQ = static_cast<uint8*>(pCQRing);
+			pCQHead = reinterpret_cast<uint32*>(pCQ + params.cq_off.head);
+			pCQTail = reinterpret_cast<uint32*>(pCQ + params.cq_off.tail);
+			mCQMask = *reinterpret_cast<uint32*>(pCQ + params.cq_off.ring_mask);
+			pCQEs = reinterpret_cast<io_uring_cqe*>(pCQ + params.cq_off.cqes);
+
+			// Register one fixed buffer per slot so that the kernel does not have to map the pages of every read.
+			mSlotBytes = slotBytes;
+			mBufferMemory.resize(static_cast<uint64>(depth) * slotBytes);
+
+			Vector<iovec> buffers(depth);
+			for (uint32 i = 0; i < depth; i++)
+			{
+				buffers[i].iov_base = mBufferMemory.data() + static_cast<uint64>(i) * slotBytes;
+				buffers[i].iov_len = slotBytes;
+				mFreeSlots.insert(mFreeSlots.end(), depth - 1 - i);
+			}
+
+			if (syscall(__NR_io_uring_register, mFD, IORING_REGISTER_BUFFERS, buffers.data(), depth) < 0)
+			{
+				Terminate();
+				return false;
+			}
+
+			mSlotOwners.resize(depth, nullptr);
+			return true;
+		}
+
+		/**
+		 * Destroy the ring.
+		 */
+		void Terminate()
+		{
+			if (pSQEs) munmap(pSQEs, mSQEBytes);
+			if (pCQRing && pCQRing != pSQRing) munmap(pCQRing, mCQRingBytes);
+			if (pSQRing) munmap(pSQRing, mSQRingBytes);
+			if (mFD >= 0) close(mFD);
+
+			pSQEs = nullptr;
+			pSQRing = pCQRing = nullptr;
+			mFD = -1;
+		}
+
+		/**
+		 * Queue a fixed buffer read. It is not submitted until Enter() is called.
+		 *
+		 * @return The slot used.
+		 */
+		uint32 QueueRead(int file, uint64 offset, uint32 byteCount, void* pOwner)
+		{
+			const uint32 slot = mFreeSlots.back();
+			mFreeSlots.pop_back();
+			mSlotOwners[slot] = pOwner;
+
+			const uint32 tail = *pSQTail + mQueued;
+			const uint32 index = tail & mSQMask;
+
+			io_uring_sqe& sqe = pSQEs[index];
+			std::memset(&sqe, 0, sizeof(io_uring_sqe));
+			sqe.opcode = IORING_OP_READ_FIXED;
+			sqe.fd = file;
+			sqe.addr = reinterpret_cast<uint64>(GetSlotBuffer(slot));
+			sqe.len = byteCount;
+			sqe.off = offset;
+			sqe.buf_index = static_cast<uint16>(slot);
+			sqe.user_data = slot;
+
+			pSQArray[index] = index;
+			mQueued++;
+			return slot;
+		}
+
+		/**
+		 * Submit all the queued reads in a single call, optionally waiting for a completion.
+		 *
+		 * @return The number of reads submitted.
+		 */
+		uint32 Enter(bool waitForCompletion)
+		{
+			const uint32 toSubmit = mQueued;
+			if (toSubmit)
+				__atomic_store_n(pSQTail, *pSQTail + toSubmit, __ATOMIC_RELEASE);
+
+			mQueued = 0;
+			if (!toSubmit && !waitForCompletion)
+				return 0;
+
+			const int result = static_cast<int>(syscall(__NR_io_uring_enter, mFD, toSubmit, waitForCompletion ? 1 : 0, waitForCompletion ? IORING_ENTER_GETEVENTS : 0, nullptr, 0));
+			return result < 0 ? 0 : static_cast<uint32>(result);
+		}
+
+		/**
+		 * Pop a completion, if any.
+		 *
+		 * @return Boolean stating if a completion was popped.
+		 */
+		bool PopCompletion(uint32& slot, int32& result)
+		{
+			const uint32 head = *pCQHead;
+			if (head == __atomic_load_n(pCQTail, __ATOMIC_ACQUIRE))
+				return false;
+
+			const io_uring_cqe& cqe = pCQEs[head & mCQMask];
+			slot = static_cast<uint32>(cqe.user_data);
+			result = cqe.res;
+
+			__atomic_store_n(pCQHead, head + 1, __ATOMIC_RELEASE);
+			return true;
+		}
+
+		/**
+		 * Release a slot after its completion was handled.
+		 */
+		void ReleaseSlot(uint32 slot)
+		{
+			mSlotOwners[slot] = nullptr;
+			mFreeSlots.insert(mFreeSlots.end(), slot);
+		}
+
+		uint8* GetSlotBuffer(uint32 slot) { return mBufferMemory.data() + static_cast<uint64>(slot) * mSlotBytes; }
+
+		Vector<uint8> mBufferMemory;
+		Vector<uint32> mFreeSlots;
+		Vector<void*> mSlotOwners;
+
+		void* pSQRing = nullptr;
+		void* pCQRing = nullptr;
+		io_uring_sqe* pSQEs = nullptr;
+		io_uring_cqe* pCQEs = nullptr;
+
+		uint32* pSQTail = nullptr;
+		uint32* pSQArray = nullptr;
+		uint32* pCQHead = nullptr;
+		uint32* pCQTail = nullptr;
+
+		uint64 mSQRingBytes = 0;
+		uint64 mCQRingBytes = 0;
+		uint64 mSQEBytes = 0;
+
+		uint32 mSQMask = 0;
+		uint32 mCQMask = 0;
+		uint32 mSlotBytes = 0;
+		uint32 mQueued = 0;
+		int mFD = -1;
+	};
+
+#else
+	struct IOURing {
+		void Terminate() {}
+	};
+
+#endif // __linux__
+
+	bool StreamScheduler::Initialize(const StreamSchedulerDescription& description)
+	{
+		Terminate();
+
+		if (!description.mQueueDepth || !description.mRequestBytes)
+		{
+			Logger::LogError(STRING("Invalid stream scheduler description!"));
+			return false;
+		}
+
+		mDescription = description;
+		mStats = {};
+		mIsRunning = true;
+		mBackend = StreamIOBackend::STREAM_IO_BACKEND_THREAD_POOL;
+
+#ifdef __linux__
+		if (description.mPreferIOURing)
+		{
+			pIOURing = new IOURing();
+			if (pIOURing->Initialize(description.mQueueDepth, description.mRequestBytes))
+			{
+				mBackend = StreamIOBackend::STREAM_IO_BACKEND_IO_URING;
+				if (!description.pJobSystem)
+					mThreads.insert(mThreads.end(), std::thread(&StreamScheduler::IOURingThread, this));
+
+				return true;
+			}
+
+			Logger::LogWarn(STRING("io_uring is not available, falling back to the thread pool stream I/O."));
+			pIOURing->Terminate();
+			delete pIOURing;
+			pIOURing = nullptr;
+		}
+
+#endif // __linux__
+
+		// The reads are submitted to the job system by Update().
+		if (description.pJobSystem)
+			return true;
+
+		for (uint32 i = 0; i < std::max(description.mWorkerCount, 1U); i++)
+			mThreads.insert(mThreads.end(), std::thread(&StreamScheduler::WorkerThread, this));
+
+		return true;
+	}
+
+	void StreamScheduler::Terminate()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mIsRunning = false;
+		}
+
+		mConditionVariable.notify_all();
+		for (auto& thread : mThreads)
+			thread.join();
+
+		mThreads.clear();
+
+		// Without threads of our own, the reads in flight are drained here.
+		if (mDescription.pJobSystem)
+		{
+			mDescription.pJobSystem->Wait(mReadJobs);
+
+			while (pIOURing && mIOURingInFlight)
+				ServiceIOURing(true);
+		}
+
+		for (auto& pEntry : mStreams)
+			CloseNativeFile(pEntry->mFile);
+
+		mStreams.clear();
+
+		if (pIOURing)
+		{
+			pIOURing->Terminate();
+			delete pIOURing;
+			pIOURing = nullptr;
+		}
+	}
+
+	bool StreamScheduler::Register(AudioStream* pStream)
+	{
+		if (!pStream || !pStream->GetAsset())
+			return false;
+
+		auto pEntry = std::make_unique<StreamEntry>();
+		pEntry->pStream = pStream;
+		pEntry->mFile = OpenNativeFile(pStream->GetAsset()->GetFileName());
+
+		if (pEntry->mFile == InvalidFile)
+		{
+			Logger::LogError(STRING("Failed to open the file of the stream!"));
+			return false;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStreams.insert(mStreams.end(), std::move(pEntry));
+		}
+
+		mConditionVariable.notify_all();
+		return true;
+	}
+
+	void StreamScheduler::Unregister(AudioStream* pStream)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		auto itr = std::find_if(mStreams.begin(), mStreams.end(), [pStream](const std::unique_ptr<StreamEntry>& pEntry) { return pEntry->pStream == pStream; });
+		if (itr == mStreams.end())
+			return;
+
+		// No new read is picked for the stream from here on, so only the one in flight has to be waited for.
+		StreamEntry* pEntry = itr->get();
+		pEntry->mRemoving = true;
+
+		// Nobody else reaps the io_uring completions when a job system is used.
+		while (mDescription.pJobSystem && pIOURing && pEntry->mInFlight)
+		{
+			lock.unlock();
+			ServiceIOURing(true);
+			lock.lock();
+		}
+
+		mConditionVariable.wait(lock, [pEntry]() { return !pEntry->mInFlight; });
+
+		// The iterator may have been invalidated while waiting.
+		itr = std::find_if(mStreams.begin(), mStreams.end(), [pEntry](const std::unique_ptr<StreamEntry>& pOther) { return pOther.get() == pEntry; });
+		CloseNativeFile(pEntry->mFile);
+		mStreams.erase(itr);
+	}
+
+	void StreamScheduler::Update()
+	{
+		if (!mDescription.pJobSystem)
+			return;
+
+		if (pIOURing)
+		{
+			ServiceIOURing(false);
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (!mIsRunning)
+				return;
+
+			const uint32 inFlight = mReadJobs.mCount.load(std::memory_order_acquire);
+			PickStreams(mDescription.mQueueDepth - std::min(inFlight, mDescription.mQueueDepth), mPickedStreams);
+		}
+
+		for (auto pEntry : mPickedStreams)
+		{
+			Job job = {};
+			job.pFunction = &StreamScheduler::ReadJob;
+			job.pData = this;
+			job.mArgument = reinterpret_cast<uint64>(pEntry);
+			job.pCounter = &mReadJobs;
+
+			mDescription.pJobSystem->Submit(job, JobPriority::JOB_PRIORITY_STREAMING);
+		}
+	}
+
+	StreamSchedulerStats StreamScheduler::GetStats() const
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		return mStats;
+	}
+
+	void StreamScheduler::PickStreams(uint64 maxCount, Vector<StreamEntry*>& entries)
+	{
+		entries.clear();
+
+		for (auto& pEntry : mStreams)
+		{
+			if (pEntry->mInFlight || pEntry->mRemoving)
+				continue;
+
+			pEntry->pStream->BeginWrite(&pEntry->mFileOffset, &pEntry->pDestination, &pEntry->mRequestBytes);
+			if (pEntry->mStalled)
+			{
+				// Reading the same offset again would only fail again.
+				if (pEntry->mFileOffset == pEntry->mStalledOffset)
+					continue;
+
+				pEntry->mStalled = false;
+			}
+
+			if (pEntry->mRequestBytes)
+				entries.insert(entries.end(), pEntry.get());
+		}
+
+		// The deadline of a stream is how long it can play from what it has buffered.
+		std::sort(entries.begin(), entries.end(), [](const StreamEntry* pLHS, const StreamEntry* pRHS) {
+			return pLHS->pStream->GetBufferedMilliseconds() < pRHS->pStream->GetBufferedMilliseconds(); });
+
+		if (entries.size() > maxCount)
+			entries.resize(maxCount);
+
+		for (auto pEntry : entries)
+		{
+			pEntry->mRequestBytes = std::min<uint64>(pEntry->mRequestBytes, mDescription.mRequestBytes);
+			pEntry->mInFlight = true;
+		}
+
+		mStats.mSubmittedReads += entries.size();
+	}
+
+	void StreamScheduler::CompleteRead(StreamEntry* pEntry, const uint8* pSource, int64 result)
+	{
+		if (result > 0)
+		{
+			if (pSource)
+				std::memcpy(pEntry->pDestination, pSource, static_cast<uint64>(result));
+
+			pEntry->pStream->EndWrite(static_cast<uint64>(result));
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			pEntry->mInFlight = false;
+
+			// A read of 0 bytes inside the audio data means the file is shorter than described.
+			if (result > 0)
+			{
+				mStats.mCompletedReads++;
+				mStats.mBytesRead += static_cast<uint64>(result);
+			}
+			else
+			{
+				mStats.mFailedReads++;
+				pEntry->mStalled = true;
+				pEntry->mStalledOffset = pEntry->mFileOffset;
+			}
+		}
+
+		if (result == 0)
+			Logger::LogError(STRING("The file of the stream ended before its audio data!"));
+		else if (result < 0)
+			Logger::LogError(STRING("Failed to read the file of the stream!"));
+
+		mConditionVariable.notify_all();
+	}
+
+	uint64 StreamScheduler::ServiceIOURing(bool waitForCompletion)
+	{
+#ifdef __linux__
+		// Handle everything that completed since the last submission.
+		uint32 slot = 0;
+		int32 result = 0;
+		while (pIOURing->PopCompletion(slot, result))
+		{
+			CompleteRead(static_cast<StreamEntry*>(pIOURing->mSlotOwners[slot]), pIOURing->GetSlotBuffer(slot), result);
+			pIOURing->ReleaseSlot(slot);
+			mIOURingInFlight--;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mIsRunning)
+				PickStreams(pIOURing->mFreeSlots.size(), mPickedStreams);
+			else
+				mPickedStreams.clear();
+		}
+
+		if (mPickedStreams.empty() && !(waitForCompletion && mIOURingInFlight))
+			return 0;
+
+		// Queue the picked reads and submit them as a single batch.
+		for (auto pEntry : mPickedStreams)
+			pIOURing->QueueRead(static_cast<int>(pEntry->mFile), pEntry->mFileOffset, static_cast<uint32>(pEntry->mRequestBytes), pEntry);
+
+		mIOURingInFlight += static_cast<uint32>(mPickedStreams.size());
+		if (pIOURing->Enter(waitForCompletion) && !mPickedStreams.empty())
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mStats.mSubmitBatches++;
+		}
+
+		return mPickedStreams.size();
+
+#else
+		(void)waitForCompletion;
+		return 0;
+
+#endif // __linux__
+	}
+
+	void StreamScheduler::ReadJob(void* pData, uint64 argument)
+	{
+		StreamScheduler* pScheduler = static_cast<StreamScheduler*>(pData);
+		StreamEntry* pEntry = reinterpret_cast<StreamEntry*>(argument);
+
+		const int64 result = ReadNativeFile(pEntry->mFile, pEntry->pDestination, pEntry->mRequestBytes, pEntry->mFileOffset);
+		pScheduler->CompleteRead(pEntry, nullptr, result);
+	}
+
+	void StreamScheduler::WorkerThread()
+	{
+		Vector<StreamEntry*> entries;
+		const auto idleWait = std::chrono::milliseconds(mDescription.mIdleWaitMilliseconds);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (mIsRunning)
+		{
+			PickStreams(1, entries);
+			if (entries.empty())
+			{
+				mConditionVariable.wait_for(lock, idleWait);
+				continue;
+			}
+
+			StreamEntry* pEntry = entries.front();
+			lock.unlock();
+
+			// The thread pool reads straight into the stream's ring buffer.
+			const int64 result = ReadNativeFile(pEntry->mFile, pEntry->pDestination, pEntry->mRequestBytes, pEntry->mFileOffset);
+			CompleteRead(pEntry, nullptr, result);
+
+			lock.lock();
+		}
+	}
+
+	void StreamScheduler::IOURingThread()
+	{
+		const auto idleWait = std::chrono::milliseconds(mDescription.mIdleWaitMilliseconds);
+
+		std::unique_lock<std::mutex> lock(mMutex);
+		while (mIsRunning || mIOURingInFlight)
+		{
+			lock.unlock();
+			const uint64 submitted = ServiceIOURing(true);
+			lock.lock();
+
+			if (!submitted && !mIOURingInFlight && mIsRunning)
+				mConditionVariable.wait_for(lock, idleWait);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,240 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#include "Core/Threading/JobSystem.h"
+
+#include <cassert>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+
+#endif // _WIN32
+
+namespace EnSound
+{
+	namespace
+	{
+		thread_local const JobSystem* tCurrentSystem = nullptr;	// The job system the current thread works for.
+		thread_local int32 tWorkerIndex = -1;	// The worker index of the current thread.
+
+		void SetThreadAffinity(std::thread& thread, uint64 mask)
+		{
+			if (!mask)
+				return;
+
+#ifdef _WIN32
+			SetThreadAffinityMask(thread.native_handle(), static_cast<DWORD_PTR>(mask));
+
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (uint32 cpu = 0; cpu < 64; cpu++)
+				if (mask & (1ULL << cpu))
+					CPU_SET(cpu, &set);
+
+			pthread_setaffinity_np(thread.native_handle(), sizeof(cpu_set_t), &set);
+
+#else
+			// Thread affinity is only a hint elsewhere, so it is left to the OS.
+			(void)thread;
+
+#endif // _WIN32
+		}
+	}
+
+	void JobSystem::Initialize(const JobSystemDescription& description)
+	{
+		Terminate();
+
+		uint32 workerCount = description.mWorkerCount;
+		if (!workerCount)
+		{
+			const uint32 hardwareThreads = std::thread::hardware_concurrency();
+			workerCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+		}
+
+		mIsRunning = true;
+		mWorkers.resize(workerCount);
+		for (auto& pWorker : mWorkers)
+			pWorker = std::make_unique<Worker>();
+
+		// The workers are created after all the deques exist since they steal from each other right away.
+		for (uint32 i = 0; i < workerCount; i++)
+		{
+			mWorkers[i]->mThread = std::thread(&JobSystem::WorkerThread, this, static_cast<int32>(i));
+
+			if (!description.mAffinityMasks.empty())
+				SetThreadAffinity(mWorkers[i]->mThread, description.mAffinityMasks[i % description.mAffinityMasks.size()]);
+		}
+	}
+
+	void JobSystem::Terminate()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+			mIsRunning = false;
+		}
+
+		mSleepConditionVariable.notify_all();
+		for (auto& pWorker : mWorkers)
+			if (pWorker->mThread.joinable())
+				pWorker->mThread.join();
+
+		// The jobs left in the deques still run, so every counter reaches 0 and nothing waits on them forever. Jobs
+		// they submit land in the same deques and are run by this loop too.
+		while (RunJob(-1, JobPriority::JOB_PRIORITY_BACKGROUND_LOAD));
+
+		mWorkers.clear();
+	}
+
+	void JobSystem::Submit(const Job& job, JobPriority priority)
+	{
+		if (job.pCounter)
+			job.pCounter->mCount.fetch_add(1, std::memory_order_relaxed);
+
+		if (mWorkers.empty())
+		{
+			// Without workers the job runs on the caller's thread.
+			Execute(job);
+			return;
+		}
+
+		// Workers keep their own jobs local, everyone else spreads them round robin.
+		const uint32 index = (tCurrentSystem == this) ? static_cast<uint32>(tWorkerIndex) : mNextWorker.fetch_add(1, std::memory_order_relaxed) % mWorkers.size();
+
+		Worker& worker = *mWorkers[index];
+		{
+			std::lock_guard<std::mutex> lock(worker.mMutex);
+			worker.mLanes[static_cast<uint8>(priority)].push_back(job);
+		}
+
+		mPendingJobs.fetch_add(1, std::memory_order_release);
+
+		// Taking the sleep mutex makes sure a worker checking for jobs cannot miss the notification.
+		{
+			std::lock_guard<std::mutex> lock(mSleepMutex);
+		}
+		mSleepConditionVariable.notify_one();
+	}
+
+	void JobSystem::ParallelFor(void (*pFunction)(void*, uint64), void* pData, uint64 count, JobPriority priority)
+	{
+		JobCounter counter;
+		for (uint64 i = 0; i < count; i++)
+		{
+			Job job = {};
+			job.pFunction = pFunction;
+			job.pData = pData;
+			job.mArgument = i;
+			job.pCounter = &counter;
+
+			Submit(job, priority);
+		}
+
+		Wait(counter, priority);
+	}
+
+	void JobSystem::Wait(const JobCounter& counter, JobPriority priority)
+	{
+		// The system must still be running, or terminating and draining its deques, for the jobs to ever complete. Jobs
+		// submitted after it was terminated run right away, so they are never waited on.
+		assert(mIsRunning.load(std::memory_order_acquire) || !mWorkers.empty() || !counter.mCount.load(std::memory_order_acquire));
+
+		const int32 workerIndex = (tCurrentSystem == this) ? tWorkerIndex : -1;
+		while (counter.mCount.load(std::memory_order_acquire))
+		{
+			// Once the workers are gone, the draining thread is the only one left to run the lower lanes.
+			const JobPriority lowest = mIsRunning.load(std::memory_order_acquire) ? priority : JobPriority::JOB_PRIORITY_BACKGROUND_LOAD;
+			if (!RunJob(workerIndex, lowest))
+				std::this_thread::yield();
+		}
+	}
+
+	bool JobSystem::RunJob(int32 workerIndex, JobPriority priority)
+	{
+		if (!mPendingJobs.load(std::memory_order_acquire))
+			return false;
+
+		const uint64 workerCount = mWorkers.size();
+		for (uint8 lane = 0; lane <= static_cast<uint8>(priority); lane++)
+		{
+			Job job = {};
+			bool found = false;
+
+			// The newest job of the worker's own deque is the one most likely to be in cache.
+			if (workerIndex >= 0)
+			{
+				Worker& worker = *mWorkers[workerIndex];
+				std::lock_guard<std::mutex> lock(worker.mMutex);
+
+				auto& deque = worker.mLanes[lane];
+				if (!deque.empty())
+				{
+					job = deque.back();
+					deque.pop_back();
+					found = true;
+				}
+			}
+
+			// Otherwise steal the oldest job of another worker.
+			for (uint64 i = 1; !found && i <= workerCount; i++)
+			{
+				const uint64 victimIndex = (static_cast<uint64>(workerIndex + workerCount) + i) % workerCount;
+				if (static_cast<int32>(victimIndex) == workerIndex)
+					continue;
+
+				Worker& victim = *mWorkers[victimIndex];
+				std::lock_guard<std::mutex> lock(victim.mMutex);
+
+				auto& deque = victim.mLanes[lane];
+				if (!deque.empty())
+				{
+					job = deque.front();
+					deque.pop_front();
+					found = true;
+				}
+			}
+
+			if (found)
+			{
+				mPendingJobs.fetch_sub(1, std::memory_order_acq_rel);
+				Execute(job);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	void JobSystem::Execute(const Job& job)
+	{
+		if (job.pFunction)
+			job.pFunction(job.pData, job.mArgument);
+
+		if (job.pCounter)
+			job.pCounter->mCount.fetch_sub(1, std::memory_order_release);
+	}
+
+	void JobSystem::WorkerThread(int32 workerIndex)
+	{
+		tCurrentSystem = this;
+		tWorkerIndex = workerIndex;
+
+		while (mIsRunning.load(std::memory_order_acquire))
+		{
+			if (RunJob(workerIndex, JobPriority::JOB_PRIORITY_BACKGROUND_LOAD))
+				continue;
+
+			std::unique_lock<std::mutex> lock(mSleepMutex);
+			mSleepConditionVariable.wait(lock, [this]() { return mPendingJobs.load(std::memory_order_acquire) || !mIsRunning.load(std::memory_order_acquire); });
+		}
+
+		tCurrentSystem = nullptr;
+		tWorkerIndex = -1;
+	}
+}
\ No newline at end of file
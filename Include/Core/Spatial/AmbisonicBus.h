@@ -0,0 +1,170 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DSP/Convolver.h"
+#include "Core/Spatial/HRIRSet.h"
+#include "Core/Spatial/Spatializer.h"
+
+namespace EnSound
+{
+	/**
+	 * Ambisonic Order enum.
+	 */
+	enum class AmbisonicOrder : uint8 {
+		AMBISONIC_ORDER_FIRST = 1,
+		AMBISONIC_ORDER_THIRD = 3,
+	};
+
+	/**
+	 * Ambisonic Source structure.
+	 * This is one block of a mono voice to encode, along with where it is.
+	 */
+	struct AmbisonicSource {
+		uint64 mHandle = 0;	// The voice handle. The low 32 bits are the slot, as in VoiceTable handles.
+		const float* pSamples = nullptr;	// The block frames mono samples.
+		float mDirection[3] = { 0.0f, 0.0f, 1.0f };	// The direction from the listener in world space (+X right, +Y up, +Z forward).
+		float mGain = 1.0f;	// The linear gain.
+	};
+
+	/**
+	 * Ambisonic Description structure.
+	 */
+	struct AmbisonicDescription {
+		AmbisonicOrder mOrder = AmbisonicOrder::AMBISONIC_ORDER_FIRST;	// The order of the sound field.
+		uint32 mBlockFrames = 256;	// The number of frames per block. This must be a power of two for binaural output.
+		uint32 mMaxSources = 256;	// The number of source slots, usually the capacity of the voice table.
+
+		const HRIRSet* pHRIRSet = nullptr;	// The HRIR set to decode to headphones with. Optional, the field is decoded to the speaker layout if nullptr.
+		uint32 mSampleRate = 48000;	// The mix sample rate, which the HRIR set is expected to match.
+		uint32 mMaxPartitions = 2;	// The binaural decoder length, in partitions of block frames of the HRIR.
+	};
+
+	/**
+	 * Ambisonic Bus object.
+	 * This is an intermediate bus holding a sound field instead of speaker channels, in ambisonic channel order with
+	 * SN3D normalization (AmbiX). Sources are encoded into the field in world space with one multiply and add per
+	 * ambisonic channel per frame, 4 channels at first order and 16 at third, no matter how they are rendered. Once per
+	 * block the field is rotated by the orientation of the listener and decoded, so the cost of the speaker layout or
+	 * the HRTF is paid once for all the sources instead of once per source.
+	 *
+	 * The decoders use max rE weights and are made from a set of virtual speakers spread evenly over the sphere. Speaker
+	 * layouts pan the virtual speakers to the real ones like the Spatializer does (AllRAD), so irregular layouts such as
+	 * 5.1 decode without holes. Binaural output convolves every ambisonic channel with the HRIRs of the virtual
+	 * speakers folded into that channel, two convolutions per ambisonic channel.
+	 *
+	 * Source directions and gains, and the listener orientation, ramp across the next block.
+	 */
+	class AmbisonicBus {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		AmbisonicBus() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~AmbisonicBus() {}
+
+		/**
+		 * Initialize the bus, with a stereo layout (-30 and 30 degrees) unless it decodes to headphones.
+		 *
+		 * @param description: The bus description.
+		 */
+		void Initialize(const AmbisonicDescription& description);
+
+		/**
+		 * Terminate the bus.
+		 */
+		void Terminate();
+
+		/**
+		 * Set the speaker layout the field is decoded to. This is not used by binaural output.
+		 *
+		 * @param pAzimuths: The azimuth of every output channel in degrees, clockwise from the front.
+		 * @param speakerCount: The number of speakers.
+		 */
+		void SetSpeakerLayout(const float* pAzimuths, uint32 speakerCount);
+
+		/**
+		 * Set the orientation of the listener the field is rotated by. Its position is not used, the source directions
+		 * are already relative to it.
+		 *
+		 * @param listener: The listener.
+		 */
+		void SetListener(const Listener& listener);
+
+		/**
+		 * Encode a block of sources into the field.
+		 * Sources which are not encoded for a block start from their new direction and gain when they come back.
+		 *
+		 * @param pSources: The sources.
+		 * @param sourceCount: The number of sources.
+		 */
+		void Encode(const AmbisonicSource* pSources, uint32 sourceCount);
+
+		/**
+		 * Decode the field of the block and start the next one.
+		 *
+		 * @param pOutput: The interleaved block to mix into, with a channel per speaker, or stereo for binaural output.
+		 * @param channelCount: The number of channels of the output. Speakers past it are dropped.
+		 */
+		void Decode(float* pOutput, uint32 channelCount);
+
+		/**
+		 * Get the number of ambisonic channels of the field.
+		 *
+		 * @return The channel count, 4 at first order and 16 at third.
+		 */
+		uint32 GetChannelCount() const { return mChannelCount; }
+
+		/**
+		 * Get the number of channels the field is decoded to.
+		 *
+		 * @return The speaker count, or 2 for binaural output.
+		 */
+		uint32 GetOutputChannelCount() const { return mDescription.pHRIRSet ? 2 : static_cast<uint32>(mDecoder.size() / (mChannelCount ? mChannelCount : 1)); }
+
+	private:
+		/**
+		 * Rotate the field by the listener orientation, crossfading from the last one if it changed.
+		 */
+		void RotateField();
+
+		/**
+		 * Apply the rotation of every band of the field.
+		 *
+		 * @param pRotations: The rotation matrices of the bands, back to back.
+		 * @param pOutput: The rotated field, which is overwritten.
+		 */
+		void ApplyRotation(const float* pRotations, float* pOutput) const;
+
+	private:
+		Vector<float> mField;	// The field of the block, one array of block frames per ambisonic channel.
+		Vector<float> mRotated;	// The rotated field.
+		Vector<float> mScratch;	// The field rotated by the new orientation while crossfading, then the decoded channels.
+		Vector<float> mRamp;	// The linear ramp across a block.
+
+		// Source state, indexed by the slot.
+		Vector<uint64> mHandles;	// The handle of the source in the slot, 0 if none.
+		Vector<uint64> mEncodedBlocks;	// The block the slot was last encoded in.
+		Vector<float> mPreviousCoefficients;	// The gain scaled harmonics at the end of the last block, one set per slot.
+
+		Vector<float> mVirtualDirections;	// The directions of the virtual speakers, three floats each.
+		Vector<float> mVirtualDecoder;	// The decoding weights of every virtual speaker, one set of channel weights each.
+		Vector<float> mRotationSolvers;	// The least squares solution of the harmonics of the virtual speakers, per band.
+		Vector<float> mRotations;	// The rotation matrix of every band of order 1 and above, back to back.
+		Vector<float> mPreviousRotations;	// The rotation matrices of the last block.
+
+		Vector<float> mDecoder;	// The speaker decoder, one set of channel weights per speaker.
+		Vector<UniformConvolver> mConvolvers;	// The binaural convolver of every ambisonic channel.
+		Vector<ConvolutionKernel> mKernels;	// The left and right binaural kernels of every ambisonic channel.
+
+		AmbisonicDescription mDescription = {};	// The bus description.
+		uint32 mOrder = 0;	// The order of the field.
+		uint32 mChannelCount = 0;	// The number of ambisonic channels.
+		uint64 mBlockIndex = 1;	// The index of the block being encoded.
+	};
+}
\ No newline at end of file
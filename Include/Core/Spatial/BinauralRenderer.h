@@ -0,0 +1,157 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DSP/Convolver.h"
+#include "Core/Spatial/HRIRSet.h"
+
+namespace EnSound
+{
+	/**
+	 * Binaural Source structure.
+	 * This is one block of a mono voice to render, along with where it is.
+	 */
+	struct BinauralSource {
+		uint64 mHandle = 0;	// The voice handle. The low 32 bits are the slot, as in VoiceTable handles.
+		const float* pSamples = nullptr;	// The block frames mono samples.
+		float mDirection[3] = { 0.0f, 0.0f, 1.0f };	// The direction from the listener in listener space (+X right, +Y up, +Z forward).
+		float mGain = 1.0f;	// The linear gain, which is also the priority of the source for full HRTF.
+	};
+
+	/**
+	 * Binaural Description structure.
+	 */
+	struct BinauralDescription {
+		const HRIRSet* pHRIRSet = nullptr;	// The HRIR set. It must outlive the renderer.
+		uint32 mBlockFrames = 256;	// The number of frames per block. This must be a power of two.
+		uint32 mSampleRate = 48000;	// The mix sample rate, which the HRIR set is expected to match.
+		uint32 mMaxSources = 256;	// The number of source slots, usually the capacity of the voice table.
+		uint32 mMaxHRTFVoices = 16;	// The maximum number of sources convolved with full HRTF. The others are panned.
+		uint32 mMaxPartitions = 2;	// The per voice cost budget, in partitions of block frames of the HRIR.
+		float mUpdateAngle = 2.0f;	// The direction change in degrees after which the HRIR is updated.
+	};
+
+	/**
+	 * Binaural Renderer object.
+	 * This renders mono sources to headphones. The loudest sources, up to the HRTF voice cap, are convolved with the
+	 * HRIRs of their directions using uniformly partitioned FFT convolution; the HRIRs are cut to the per voice
+	 * partition budget, so the cost of a voice is fixed. The remaining sources are panned with constant power panning.
+	 *
+	 * Sources which move further than the update angle get a new interpolated HRIR, which is crossfaded with the old one
+	 * across the block. Sources which gain or lose their HRTF voice crossfade between HRTF and panning the same way, and
+	 * sources which already have a voice are favored so that voices do not swap between sources of similar gains.
+	 */
+	class BinauralRenderer {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		BinauralRenderer() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~BinauralRenderer() {}
+
+		/**
+		 * Initialize the renderer.
+		 *
+		 * @param description: The renderer description.
+		 */
+		void Initialize(const BinauralDescription& description);
+
+		/**
+		 * Terminate the renderer.
+		 */
+		void Terminate();
+
+		/**
+		 * Render a block of sources.
+		 * Sources which are not rendered for a block are forgotten, along with their HRTF voices.
+		 *
+		 * @param pSources: The sources.
+		 * @param sourceCount: The number of sources.
+		 * @param pOutput: The interleaved stereo block to mix into.
+		 */
+		void Render(const BinauralSource* pSources, uint32 sourceCount, float* pOutput);
+
+		/**
+		 * Set the largest number of sources rendered with full HRTF. The sources which lose their voice crossfade to
+		 * panning across the next block.
+		 *
+		 * @param count: The HRTF voice cap. It is clamped to the HRTF voices of the description.
+		 */
+		void SetMaxHRTFVoices(uint32 count);
+
+		/**
+		 * Get the largest number of sources rendered with full HRTF.
+		 *
+		 * @return The HRTF voice cap.
+		 */
+		uint32 GetMaxHRTFVoices() const { return mMaxHRTFVoices; }
+
+		/**
+		 * Get the number of sources rendered with full HRTF in the last block.
+		 *
+		 * @return The HRTF voice count.
+		 */
+		uint32 GetHRTFVoiceCount() const { return static_cast<uint32>(mVoices.size() - mFreeVoices.size()); }
+
+	private:
+		static const uint32 InvalidIndex = ~0U;	// The index of a missing voice.
+
+		/**
+		 * HRTF Voice structure.
+		 */
+		struct HRTFVoice {
+			UniformConvolver mConvolver = {};	// The convolver of the source's input.
+			ConvolutionKernel mKernels[2] = {};	// The left and right kernels.
+			ConvolutionKernel mNextKernels[2] = {};	// The kernels being crossfaded in.
+			float mDirection[3] = {};	// The direction the kernels were made for.
+			uint32 mSlot = InvalidIndex;	// The source slot which holds the voice.
+		};
+
+		/**
+		 * Update the kernels of a voice if the direction moved past the update angle.
+		 *
+		 * @param voice: The voice.
+		 * @param pDirection: The normalized direction.
+		 * @param isNew: Whether the voice was just acquired, in which case there is nothing to crossfade from.
+		 * @return Boolean stating if the next kernels need to be crossfaded in.
+		 */
+		bool UpdateKernels(HRTFVoice& voice, const float* pDirection, bool isNew);
+
+		/**
+		 * Release the voice of a slot.
+		 *
+		 * @param slot: The source slot.
+		 */
+		void ReleaseVoice(uint32 slot);
+
+	private:
+		Vector<HRTFVoice> mVoices;	// The HRTF voices.
+		Vector<uint32> mFreeVoices;	// The voices which are not in use.
+
+		// Source state, indexed by the slot.
+		Vector<uint64> mHandles;	// The handle of the source in the slot, 0 if none.
+		Vector<uint32> mSlotVoices;	// The HRTF voice of the slot.
+		Vector<float> mPreviousGains;	// The gains at the end of the last block.
+		Vector<float> mPreviousLeftGains;	// The left pan gains at the end of the last block.
+		Vector<float> mPreviousRightGains;	// The right pan gains at the end of the last block.
+		Vector<float> mPreviousMixes;	// The HRTF to panning mixes at the end of the last block, 1 for full HRTF.
+		Vector<uint64> mRenderedBlocks;	// The block the slot was last rendered in.
+
+		// Scratch memory.
+		Vector<uint32> mOrder;	// The sources ordered by priority.
+		Vector<float> mPriorities;	// The priority of every source.
+		Vector<float> mImpulses;	// The interpolated left and right impulse responses.
+		Vector<float> mConvolved;	// The convolved left, right, next left and next right blocks.
+		Vector<float> mRamps;	// The gain, mix and crossfade ramps.
+
+		BinauralDescription mDescription = {};	// The renderer description.
+		float mUpdateCosine = 1.0f;	// The cosine of the update angle.
+		uint32 mMaxHRTFVoices = 0;	// The HRTF voice cap.
+		uint64 mBlockIndex = 0;	// The number of rendered blocks.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * HRIR Set Description structure.
+	 * This follows the layout of a SOFA SimpleFreeFieldHRIR file: one source position and one impulse response per ear
+	 * for every measurement.
+	 */
+	struct HRIRSetDescription {
+		const float* pPositions = nullptr;	// The azimuth and elevation of every measurement in degrees. The azimuth is counterclockwise from the front, as in SOFA.
+		const float* pImpulses = nullptr;	// The left and right impulse responses of every measurement, back to back.
+		uint32 mMeasurementCount = 0;	// The number of measurements.
+		uint32 mImpulseLength = 0;	// The number of samples of every impulse response.
+		uint32 mSampleRate = 48000;	// The sample rate of the impulse responses.
+	};
+
+	/**
+	 * HRIR Set object.
+	 * This holds a set of head related impulse responses in a preprocessed form: every measurement direction is a unit
+	 * vector in listener space (+X right, +Y up, +Z forward) and every response is split into its onset delay and the
+	 * response aligned to its onset. Interpolating aligned responses and their delays separately avoids the comb
+	 * filtering of mixing responses which arrive at different times.
+	 *
+	 * The preprocessed form can be saved to and loaded from a file, so the preprocessing is done once by the tools.
+	 */
+	class HRIRSet {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		HRIRSet() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~HRIRSet() {}
+
+		/**
+		 * Initialize the set from measurements.
+		 *
+		 * @param description: The set description.
+		 * @return Boolean stating if the description was valid.
+		 */
+		bool Initialize(const HRIRSetDescription& description);
+
+		/**
+		 * Terminate the set.
+		 */
+		void Terminate();
+
+		/**
+		 * Interpolate the impulse responses of a direction from the three closest measurements.
+		 *
+		 * @param pDirection: The direction in listener space. It does not need to be normalized.
+		 * @param pLeft: The impulse length left ear samples.
+		 * @param pRight: The impulse length right ear samples.
+		 */
+		void Interpolate(const float* pDirection, float* pLeft, float* pRight) const;
+
+		/**
+		 * Serialize the preprocessed set.
+		 *
+		 * @param output: The serialized bytes.
+		 */
+		void Serialize(Vector<uint8>& output) const;
+
+		/**
+		 * Deserialize a preprocessed set.
+		 *
+		 * @param pData: The serialized bytes.
+		 * @param dataSize: The number of serialized bytes.
+		 * @return Boolean stating if the data was a valid set.
+		 */
+		bool Deserialize(const uint8* pData, uint64 dataSize);
+
+		/**
+		 * Save the preprocessed set to a file.
+		 *
+		 * @param pFileName: The file path.
+		 * @return Boolean stating if the file was written.
+		 */
+		bool SaveToFile(const wchar* pFileName) const;
+
+		/**
+		 * Load a preprocessed set from a file.
+		 *
+		 * @param pFileName: The file path.
+		 * @return Boolean stating if the file contained a valid set.
+		 */
+		bool LoadFromFile(const wchar* pFileName);
+
+		/**
+		 * Get the number of samples of every impulse response.
+		 *
+		 * @return The impulse length.
+		 */
+		uint32 GetImpulseLength() const { return mImpulseLength; }
+
+		/**
+		 * Get the number of measurements.
+		 *
+		 * @return The measurement count.
+		 */
+		uint32 GetMeasurementCount() const { return static_cast<uint32>(mDirections.size() / 3); }
+
+		/**
+		 * Get the sample rate of the impulse responses.
+		 *
+		 * @return The sample rate.
+		 */
+		uint32 GetSampleRate() const { return mSampleRate; }
+
+	private:
+		Vector<float> mDirections;	// The unit direction of every measurement, three floats each.
+		Vector<float> mDelays;	// The left and right onset delays of every measurement in samples.
+		Vector<float> mImpulses;	// The left and right onset aligned responses of every measurement.
+
+		uint32 mImpulseLength = 0;	// The number of samples of every impulse response.
+		uint32 mSampleRate = 0;	// The sample rate of the impulse responses.
+	};
+}
\ No newline at end of file
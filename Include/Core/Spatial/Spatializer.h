@@ -0,0 +1,179 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+namespace EnSound
+{
+	/**
+	 * Distance Curve enum.
+	 */
+	enum class DistanceCurve : uint8 {
+		DISTANCE_CURVE_NONE,
+		DISTANCE_CURVE_INVERSE,
+		DISTANCE_CURVE_LINEAR,
+		DISTANCE_CURVE_INVERSE_SQUARE,
+	};
+
+	/**
+	 * Listener structure.
+	 * The coordinate system is left handed: +X is right, +Y is up and +Z is forward.
+	 */
+	struct Listener {
+		float mPosition[3] = { 0.0f, 0.0f, 0.0f };	// The position.
+		float mVelocity[3] = { 0.0f, 0.0f, 0.0f };	// The velocity in units per second.
+		float mForward[3] = { 0.0f, 0.0f, 1.0f };	// The normalized forward direction.
+		float mUp[3] = { 0.0f, 1.0f, 0.0f };	// The normalized up direction.
+	};
+
+	/**
+	 * Emitter Settings structure.
+	 * These are shared by all the emitters using the same settings index.
+	 */
+	struct EmitterSettings {
+		DistanceCurve mCurve = DistanceCurve::DISTANCE_CURVE_INVERSE;	// The distance attenuation curve.
+		float mMinDistance = 1.0f;	// The distance up to which there is no attenuation.
+		float mMaxDistance = 100.0f;	// The distance after which the attenuation does not change.
+		float mRolloff = 1.0f;	// The rolloff factor of the curve.
+
+		float mConeInnerAngle = 360.0f;	// The angle of the full gain cone in degrees.
+		float mConeOuterAngle = 360.0f;	// The angle outside of which the outer gain applies in degrees.
+		float mConeOuterGain = 1.0f;	// The gain outside of the outer cone.
+	};
+
+	/**
+	 * Emitter Arrays structure.
+	 * The emitters are uploaded as structure of arrays, all of the same length. The optional arrays may be nullptr.
+	 */
+	struct EmitterArrays {
+		const float* pPositionsX = nullptr;	// The X coordinates.
+		const float* pPositionsY = nullptr;	// The Y coordinates.
+		const float* pPositionsZ = nullptr;	// The Z coordinates.
+
+		const float* pVelocitiesX = nullptr;	// The X velocities. Optional, the emitters are static if nullptr.
+		const float* pVelocitiesY = nullptr;	// The Y velocities. Optional.
+		const float* pVelocitiesZ = nullptr;	// The Z velocities. Optional.
+
+		const float* pForwardsX = nullptr;	// The X of the normalized cone directions. Optional, the emitters are omnidirectional if nullptr.
+		const float* pForwardsY = nullptr;	// The Y of the normalized cone directions. Optional.
+		const float* pForwardsZ = nullptr;	// The Z of the normalized cone directions. Optional.
+
+		const uint32* pSettingIndices = nullptr;	// The emitter settings indexes. Optional, all the emitters use the first settings if nullptr.
+	};
+
+	/**
+	 * Spatializer Description structure.
+	 */
+	struct SpatializerDescription {
+		float mSpeedOfSound = 343.0f;	// The speed of sound in units per second.
+		float mDopplerFactor = 1.0f;	// The scale of the Doppler effect. 0 disables it.
+	};
+
+	/**
+	 * Spatializer object.
+	 * This computes the speaker gains and Doppler pitch ratios of any number of emitters in a single pass, four emitters
+	 * at a time. The gain of an emitter is its distance attenuation times its cone attenuation, spread over the two
+	 * speakers around it with equal power panning. The speakers can be laid out at any azimuth on the horizontal plane;
+	 * the elevation of an emitter is ignored for panning.
+	 */
+	class Spatializer {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		Spatializer() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~Spatializer() {}
+
+		/**
+		 * Initialize the spatializer with a stereo layout (-30 and 30 degrees) and default emitter settings.
+		 *
+		 * @param description: The spatializer description.
+		 */
+		void Initialize(const SpatializerDescription& description = {});
+
+		/**
+		 * Terminate the spatializer.
+		 */
+		void Terminate();
+
+		/**
+		 * Set the speaker layout.
+		 *
+		 * @param pAzimuths: The azimuth of every output channel in degrees, clockwise from the front.
+		 * @param speakerCount: The number of speakers.
+		 */
+		void SetSpeakerLayout(const float* pAzimuths, uint32 speakerCount);
+
+		/**
+		 * Set an entry of the emitter settings table.
+		 *
+		 * @param index: The settings index. The table grows as needed.
+		 * @param settings: The emitter settings.
+		 */
+		void SetEmitterSettings(uint32 index, const EmitterSettings& settings);
+
+		/**
+		 * Compute the speaker gains and Doppler ratios of all the emitters.
+		 *
+		 * @param listener: The listener.
+		 * @param emitters: The emitter arrays.
+		 * @param emitterCount: The number of emitters.
+		 */
+		void Process(const Listener& listener, const EmitterArrays& emitters, uint32 emitterCount);
+
+		/**
+		 * Get the gains of a speaker computed by the last Process() call.
+		 *
+		 * @param speaker: The speaker (output channel) index.
+		 * @return The gain of every emitter.
+		 */
+		const float* GetSpeakerGains(uint32 speaker) const { return mGains.data() + static_cast<uint64>(speaker) * mCapacity; }
+
+		/**
+		 * Get the Doppler pitch ratios computed by the last Process() call.
+		 *
+		 * @return The ratio of every emitter.
+		 */
+		const float* GetDopplerRatios() const { return mDopplerRatios.data(); }
+
+		/**
+		 * Get the number of speakers.
+		 *
+		 * @return The speaker count.
+		 */
+		uint32 GetSpeakerCount() const { return static_cast<uint32>(mSpeakerChannels.size()); }
+
+	private:
+		/**
+		 * Emitter Settings Data structure.
+		 * This is the emitter settings in the form the pass uses.
+		 */
+		struct EmitterSettingsData {
+			float mCurve = 0.0f;	// The distance curve as a float.
+			float mMinDistance = 1.0f;	// The minimum distance.
+			float mMaxDistance = 100.0f;	// The maximum distance.
+			float mRolloff = 1.0f;	// The rolloff factor.
+			float mConeCosInner = -1.0f;	// The cosine of half the inner cone angle.
+			float mConeCosOuter = -1.0f;	// The cosine of half the outer cone angle.
+			float mConeOuterGain = 1.0f;	// The gain outside of the outer cone.
+		};
+
+	private:
+		Vector<float> mGains;	// The gains, one array of capacity emitters per speaker.
+		Vector<float> mDopplerRatios;	// The Doppler pitch ratios.
+
+		Vector<float> mSpeakerAzimuths;	// The speaker azimuths in radians in [0, 2 pi), sorted.
+		Vector<uint32> mSpeakerChannels;	// The output channel of every sorted speaker.
+
+		Vector<EmitterSettingsData> mSettings;	// The emitter settings table.
+
+		SpatializerDescription mDescription = {};	// The spatializer description.
+		uint32 mCapacity = 0;	// The number of emitters the arrays can hold.
+	};
+}
\ No newline at end of file
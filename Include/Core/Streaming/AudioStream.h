@@ -0,0 +1,211 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Formats/WAV/Format.h"
+
+#include <atomic>
+
+namespace EnSound
+{
+	/**
+	 * Stream Asset object.
+	 * This is the resident part of a streamed asset. It holds where the audio data lives in the file and the first
+	 * few milliseconds of it (the pre-roll), so that a new playback can start in the next mix block while the rest of
+	 * the audio is still being read. A single stream asset is shared by all of its playbacks.
+	 */
+	class StreamAsset {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		StreamAsset() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~StreamAsset() {}
+
+		/**
+		 * Initialize the asset and load its pre-roll.
+		 * The pre-roll is rounded up to the block alignment of the format so that decoders never see a partial block.
+		 *
+		 * @param pFilePath: The file path. It must outlive the asset.
+		 * @param format: The format of the audio data.
+		 * @param dataOffset: The byte offset of the audio data in the file.
+		 * @param dataBytes: The number of audio bytes.
+		 * @param preRollMilliseconds: The length of the resident pre-roll. Default is 250 ms.
+		 * @return Boolean stating if the pre-roll was loaded.
+		 */
+		bool Initialize(const wchar* pFilePath, const WAVFormat& format, uint64 dataOffset, uint64 dataBytes, uint32 preRollMilliseconds = 250);
+
+		/**
+		 * Terminate the asset.
+		 */
+		void Terminate();
+
+		/**
+		 * Get the file name.
+		 *
+		 * @return The file path.
+		 */
+		const wchar* GetFileName() const { return pFileName; }
+
+		/**
+		 * Get the format of the audio data.
+		 *
+		 * @return The WAV format.
+		 */
+		const WAVFormat& GetFormat() const { return mFormat; }
+
+		/**
+		 * Get the byte offset of the audio data in the file.
+		 *
+		 * @return The byte offset.
+		 */
+		uint64 GetDataOffset() const { return mDataOffset; }
+
+		/**
+		 * Get the number of audio bytes.
+		 *
+		 * @return The byte count.
+		 */
+		uint64 GetDataBytes() const { return mDataBytes; }
+
+		/**
+		 * Get the resident pre-roll bytes.
+		 *
+		 * @return The pre-roll data pointer.
+		 */
+		const uint8* GetPreRoll() const { return mPreRoll.data(); }
+
+		/**
+		 * Get the number of pre-roll bytes.
+		 *
+		 * @return The byte count.
+		 */
+		uint64 GetPreRollBytes() const { return mPreRoll.size(); }
+
+	private:
+		Vector<uint8> mPreRoll;	// The first bytes of the audio data.
+		WAVFormat mFormat = {};	// The format of the audio data.
+		const wchar* pFileName = nullptr;	// The file path.
+		uint64 mDataOffset = 0;	// The byte offset of the audio data in the file.
+		uint64 mDataBytes = 0;	// The number of audio bytes.
+	};
+
+	/**
+	 * Audio Stream object.
+	 * This is a single playback of a stream asset. Reads are served from the asset's pre-roll first and then from a
+	 * ring buffer which the streaming I/O fills with the bytes following the pre-roll, so the handover is seamless as
+	 * long as the ring buffer is filled before the pre-roll runs out.
+	 *
+	 * The stream is single producer (the I/O side, using BeginWrite()/ EndWrite()) and single consumer (the mixer,
+	 * using Read()), and neither side takes a lock.
+	 */
+	class AudioStream {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		AudioStream() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~AudioStream() {}
+
+		/**
+		 * Initialize the stream.
+		 *
+		 * @param pStreamAsset: The stream asset. It must outlive the stream.
+		 * @param bufferMilliseconds: The length of the ring buffer. Default is 500 ms.
+		 */
+		void Initialize(const StreamAsset* pStreamAsset, uint32 bufferMilliseconds = 500);
+
+		/**
+		 * Terminate the stream.
+		 */
+		void Terminate();
+
+		/**
+		 * Read audio bytes.
+		 *
+		 * @param pOutput: The output buffer.
+		 * @param byteCount: The number of bytes to read.
+		 * @return The number of bytes read. Less than byteCount if the stream ended or the I/O has not caught up.
+		 */
+		uint64 Read(uint8* pOutput, uint64 byteCount);
+
+		/**
+		 * Get the next region the I/O side should fill.
+		 *
+		 * @param pFileOffset: The byte offset in the file to read from.
+		 * @param ppDestination: The destination pointer in the ring buffer.
+		 * @param pByteCount: The number of bytes to read. 0 if the ring buffer is full or the file is fully read.
+		 */
+		void BeginWrite(uint64* pFileOffset, uint8** ppDestination, uint64* pByteCount);
+
+		/**
+		 * Commit bytes read into the region returned by BeginWrite().
+		 *
+		 * @param byteCount: The number of bytes read.
+		 */
+		void EndWrite(uint64 byteCount);
+
+		/**
+		 * Get the number of bytes that can be read without waiting for the I/O.
+		 *
+		 * @return The byte count.
+		 */
+		uint64 GetBufferedBytes() const;
+
+		/**
+		 * Get the number of milliseconds that can be played without waiting for the I/O.
+		 *
+		 * @return The buffered duration in milliseconds.
+		 */
+		uint64 GetBufferedMilliseconds() const;
+
+		/**
+		 * Check if all the audio bytes were read.
+		 *
+		 * @return Boolean value.
+		 */
+		bool IsFinished() const { return mReadCursor.load(std::memory_order_acquire) >= GetStreamedBytes() + GetPreRollBytes(); }
+
+		/**
+		 * Get the number of reads which could not be fully served.
+		 *
+		 * @return The underrun count.
+		 */
+		uint64 GetUnderrunCount() const { return mUnderrunCount; }
+
+		/**
+		 * Get the stream asset.
+		 *
+		 * @return The stream asset pointer.
+		 */
+		const StreamAsset* GetAsset() const { return pAsset; }
+
+	private:
+		/**
+		 * Get the number of pre-roll bytes of the asset.
+		 */
+		uint64 GetPreRollBytes() const { return pAsset ? pAsset->GetPreRollBytes() : 0; }
+
+		/**
+		 * Get the number of bytes which have to be streamed after the pre-roll.
+		 */
+		uint64 GetStreamedBytes() const { return pAsset ? pAsset->GetDataBytes() - pAsset->GetPreRollBytes() : 0; }
+
+	private:
+		Vector<uint8> mRingBuffer;	// The streamed bytes. The size is a power of two.
+		const StreamAsset* pAsset = nullptr;	// The stream asset.
+
+		std::atomic<uint64> mReadCursor = 0;	// Bytes consumed from the start of the audio data, pre-roll included.
+		std::atomic<uint64> mWriteCursor = 0;	// Bytes streamed after the pre-roll.
+		uint64 mUnderrunCount = 0;	// The number of reads which could not be fully served.
+	};
+}
\ No newline at end of file
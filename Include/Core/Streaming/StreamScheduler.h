@@ -0,0 +1,203 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/Streaming/AudioStream.h"
+#include "Core/Threading/JobSystem.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace EnSound
+{
+	struct IOURing;
+
+	/**
+	 * Stream I/O Backend enum.
+	 */
+	enum class StreamIOBackend : uint8 {
+		STREAM_IO_BACKEND_THREAD_POOL,
+		STREAM_IO_BACKEND_IO_URING,
+	};
+
+	/**
+	 * Stream Scheduler Description structure.
+	 */
+	struct StreamSchedulerDescription {
+		uint32 mQueueDepth = 64;	// The maximum number of reads in flight.
+		uint32 mRequestBytes = 64 * 1024;	// The maximum byte size of a single read.
+		uint32 mWorkerCount = 2;	// The number of reader threads used by the thread pool backend. Ignored when a job system is given.
+		uint32 mIdleWaitMilliseconds = 2;	// How long the scheduler sleeps when no stream needs data.
+		JobSystem* pJobSystem = nullptr;	// The job system to submit the reads to. nullptr to let the scheduler run its own threads.
+		bool mPreferIOURing = true;	// Use io_uring when it is available (Linux only).
+	};
+
+	/**
+	 * Stream Scheduler Stats structure.
+	 */
+	struct StreamSchedulerStats {
+		uint64 mSubmittedReads = 0;	// The number of reads submitted.
+		uint64 mCompletedReads = 0;	// The number of reads completed.
+		uint64 mFailedReads = 0;	// The number of reads which failed.
+		uint64 mSubmitBatches = 0;	// The number of batched submissions (io_uring only).
+		uint64 mBytesRead = 0;	// The total number of bytes read.
+	};
+
+	/**
+	 * Stream Scheduler object.
+	 * This serves the block reads of all the registered audio streams. Streams are always served in the order of their
+	 * deadline, which is how long they can keep playing from what is already buffered, so the stream closest to an
+	 * underrun goes first.
+	 *
+	 * On Linux the reads are issued through io_uring in batches, into a set of registered fixed buffers. Everywhere
+	 * else (or when io_uring is not available) a small pool of threads issues positioned reads.
+	 *
+	 * When a job system is given, the scheduler does not start any threads. Instead Update() is called once per mix
+	 * block, which submits the positioned reads as streaming jobs, or services the io_uring queue without blocking.
+	 */
+	class StreamScheduler {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		StreamScheduler() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~StreamScheduler() {}
+
+		/**
+		 * Initialize the scheduler and start its threads (if no job system is given).
+		 *
+		 * @param description: The scheduler description.
+		 * @return Boolean stating if the scheduler was started.
+		 */
+		bool Initialize(const StreamSchedulerDescription& description = {});
+
+		/**
+		 * Stop the scheduler and close all the files.
+		 */
+		void Terminate();
+
+		/**
+		 * Register a stream to be served.
+		 *
+		 * @param pStream: The stream pointer. It must be initialized and must stay alive until it is unregistered.
+		 * @return Boolean stating if the stream's file could be opened.
+		 */
+		bool Register(AudioStream* pStream);
+
+		/**
+		 * Unregister a stream.
+		 * This waits for the stream's read in flight, if any, to complete. When a job system is used, this must be called
+		 * from the thread which calls Update() and never from within a job.
+		 *
+		 * @param pStream: The stream pointer.
+		 */
+		void Unregister(AudioStream* pStream);
+
+		/**
+		 * Pick the streams which need data and issue their reads.
+		 * This is only needed when a job system is used, and never blocks on the I/O.
+		 */
+		void Update();
+
+		/**
+		 * Get the backend in use.
+		 *
+		 * @return The stream I/O backend.
+		 */
+		StreamIOBackend GetBackend() const { return mBackend; }
+
+		/**
+		 * Get the scheduler stats.
+		 *
+		 * @return The stats structure.
+		 */
+		StreamSchedulerStats GetStats() const;
+
+	private:
+		/**
+		 * Stream Entry structure.
+		 */
+		struct StreamEntry {
+			AudioStream* pStream = nullptr;	// The stream.
+			intptr_t mFile = -1;	// The native file handle/ descriptor.
+			uint8* pDestination = nullptr;	// The destination of the read in flight.
+			uint64 mFileOffset = 0;	// The file offset of the read in flight.
+			uint64 mRequestBytes = 0;	// The byte size of the read in flight.
+			uint64 mStalledOffset = 0;	// The file offset at which a read hit the end of the file or failed.
+			bool mInFlight = false;	// Whether a read is in flight.
+			bool mRemoving = false;	// Whether the stream is being unregistered, so that no new read is issued.
+			bool mStalled = false;	// Whether reads are held until the stream asks for another file offset.
+		};
+
+		/**
+		 * Pick the streams which need data, most urgent first, and mark them as in flight.
+		 * Streams being unregistered, and stalled streams which still ask for the offset that stalled them, are skipped.
+		 * The scheduler mutex must be held.
+		 *
+		 * @param maxCount: The maximum number of streams to pick.
+		 * @param entries: The picked streams.
+		 */
+		void PickStreams(uint64 maxCount, Vector<StreamEntry*>& entries);
+
+		/**
+		 * Complete a read.
+		 * A read which returns no bytes stalls the stream until it asks for another offset, such as after a seek.
+		 *
+		 * @param pEntry: The stream entry.
+		 * @param pSource: The bytes read, nullptr if they were read in place.
+		 * @param result: The number of bytes read, or a negative value on failure.
+		 */
+		void CompleteRead(StreamEntry* pEntry, const uint8* pSource, int64 result);
+
+		/**
+		 * Reap the completed io_uring reads and submit the reads of the streams which need data as a single batch.
+		 *
+		 * @param waitForCompletion: Whether to block until at least one read completes, if any are in flight.
+		 * @return The number of reads submitted.
+		 */
+		uint64 ServiceIOURing(bool waitForCompletion);
+
+		/**
+		 * Streaming job function which reads a single block.
+		 *
+		 * @param pData: The scheduler pointer.
+		 * @param argument: The stream entry pointer.
+		 */
+		static void ReadJob(void* pData, uint64 argument);
+
+		/**
+		 * Thread pool worker function.
+		 */
+		void WorkerThread();
+
+		/**
+		 * io_uring submission and completion thread function.
+		 */
+		void IOURingThread();
+
+	private:
+		Vector<std::unique_ptr<StreamEntry>> mStreams;	// All the registered streams.
+		Vector<StreamEntry*> mPickedStreams;	// The streams picked by Update() or the io_uring thread.
+		Vector<std::thread> mThreads;	// The scheduler threads.
+
+		StreamSchedulerDescription mDescription = {};	// The scheduler description.
+		StreamSchedulerStats mStats = {};	// The scheduler stats.
+
+		mutable std::mutex mMutex;	// Guards the streams and the stats.
+		std::condition_variable mConditionVariable;	// Signalled when streams are registered or reads complete.
+
+		JobCounter mReadJobs = {};	// The read jobs which have not completed.
+
+		IOURing* pIOURing = nullptr;	// The io_uring instance.
+		uint32 mIOURingInFlight = 0;	// The number of io_uring reads in flight.
+		StreamIOBackend mBackend = StreamIOBackend::STREAM_IO_BACKEND_THREAD_POOL;	// The backend in use.
+		bool mIsRunning = false;	// Whether the threads should keep running.
+	};
+}
\ No newline at end of file
@@ -0,0 +1,165 @@
+// Copyright 2020 Dhiraj Wishal
+// SPDX-License-Identifier: Apache-2.0
+
+#pragma once
+
+#include "Core/DataTypes/Types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace EnSound
+{
+	/**
+	 * Job Priority enum.
+	 * Workers always run the highest priority job available anywhere in the pool before a lower priority one.
+	 */
+	enum class JobPriority : uint8 {
+		JOB_PRIORITY_REAL_TIME_MIX,
+		JOB_PRIORITY_STREAMING,
+		JOB_PRIORITY_BACKGROUND_LOAD,
+
+		JOB_PRIORITY_MAX
+	};
+
+	/**
+	 * Job Counter structure.
+	 * This counts the jobs of a group which have not completed yet.
+	 */
+	struct JobCounter {
+		std::atomic<uint32> mCount = 0;	// The number of jobs which have not completed.
+	};
+
+	/**
+	 * Job structure.
+	 * A job is a plain function pointer, its data and an argument, so that submitting it never allocates.
+	 */
+	struct Job {
+		void (*pFunction)(void* pData, uint64 argument) = nullptr;	// The job function.
+		void* pData = nullptr;	// The data passed to the function.
+		uint64 mArgument = 0;	// The argument passed to the function (the index, for parallel loops).
+		JobCounter* pCounter = nullptr;	// The counter decremented when the job completes.
+	};
+
+	/**
+	 * Job System Description structure.
+	 */
+	struct JobSystemDescription {
+		Vector<uint64> mAffinityMasks;	// Per worker CPU affinity masks, repeated if there are fewer masks than workers. Empty to leave it to the OS.
+		uint32 mWorkerCount = 0;	// The number of worker threads. 0 uses one less than the number of hardware threads.
+	};
+
+	/**
+	 * Job System object.
+	 * This is the thread pool shared by the loaders, decoders, streaming and the mixer. Every worker owns a deque per
+	 * priority; jobs submitted from a worker go to its own deques (and are taken back last-in-first-out), and idle
+	 * workers steal the oldest jobs from the other workers' deques. The worker count and affinity are configurable so
+	 * that the pool can be kept off the cores the game's own scheduler uses.
+	 */
+	class JobSystem {
+	public:
+		/**
+		 * Default constructor.
+		 */
+		JobSystem() {}
+
+		/**
+		 * Default destructor.
+		 */
+		~JobSystem() {}
+
+		/**
+		 * Initialize the job system and start the workers.
+		 *
+		 * @param description: The job system description.
+		 */
+		void Initialize(const JobSystemDescription& description = {});
+
+		/**
+		 * Stop the workers. Jobs which have not started are run on the calling thread before this returns.
+		 */
+		void Terminate();
+
+		/**
+		 * Submit a job.
+		 *
+		 * @param job: The job.
+		 * @param priority: The priority lane of the job.
+		 */
+		void Submit(const Job& job, JobPriority priority);
+
+		/**
+		 * Run a function for every index in [0, count) across the workers and wait for all of them.
+		 *
+		 * @param pFunction: The job function. It is called with the data and the index.
+		 * @param pData: The data passed to the function.
+		 * @param count: The number of indexes.
+		 * @param priority: The priority lane of the jobs.
+		 */
+		void ParallelFor(void (*pFunction)(void*, uint64), void* pData, uint64 count, JobPriority priority);
+
+		/**
+		 * Wait until all the jobs of a counter complete.
+		 * The calling thread runs jobs while it waits, so this can be called from within a job. Only jobs of the given
+		 * priority or above are taken, so a real time wait never ends up running a streaming read or a load.
+		 *
+		 * @param counter: The job counter.
+		 * @param priority: The lowest priority of the jobs run while waiting. Default is every lane.
+		 */
+		void Wait(const JobCounter& counter, JobPriority priority = JobPriority::JOB_PRIORITY_BACKGROUND_LOAD);
+
+		/**
+		 * Get the number of workers.
+		 *
+		 * @return The worker count.
+		 */
+		uint32 GetWorkerCount() const { return static_cast<uint32>(mWorkers.size()); }
+
+	private:
+		/**
+		 * Worker structure.
+		 */
+		struct Worker {
+			std::deque<Job> mLanes[static_cast<uint8>(JobPriority::JOB_PRIORITY_MAX)];	// The job deques, one per priority.
+			std::mutex mMutex;	// Guards the deques.
+			std::thread mThread;	// The worker thread.
+		};
+
+		/**
+		 * Pop a job and run it.
+		 *
+		 * @param workerIndex: The index of the calling worker. -1 if it is not a worker.
+		 * @param priority: The lowest priority of the job taken.
+		 * @return Boolean stating if a job was run.
+		 */
+		bool RunJob(int32 workerIndex, JobPriority priority);
+
+		/**
+		 * Run a job and signal its counter.
+		 *
+		 * @param job: The job.
+		 */
+		void Execute(const Job& job);
+
+		/**
+		 * Worker thread function.
+		 *
+		 * @param workerIndex: The index of the worker.
+		 */
+		void WorkerThread(int32 workerIndex);
+
+	private:
+		Vector<std::unique_ptr<Worker>> mWorkers;	// All the workers.
+
+		std::mutex mSleepMutex;	// Guards the workers going to sleep.
+		std::condition_variable mSleepConditionVariable;	// Signalled when jobs are submitted.
+
+		std::atomic<uint64> mPendingJobs = 0;	// The number of jobs waiting in the deques.
+		std::atomic<uint32> mNextWorker = 0;	// The worker the next external submission goes to.
+		std::atomic<bool> mIsRunning = false;	// Whether the workers should keep running.
+	};
+}
\ No newline at end of file
@@ -2,8 +2,214 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "Core/Error/Logger.h"
+#include "Core/Codecs/ADPCM.h"
+#include "Core/Effects/FDNReverb.h"
+#include "Core/Mixing/SampleLODSet.h"
+#include "Core/Mixing/VoiceTable.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+/**
+ * Benchmark the ADPCM decoders against plain 16 bit PCM conversion, and check that the round trip stays close to the
+ * input. Decoding is done in 256 frame mix blocks, the same way a voice would pull it.
+ *
+ * @return Boolean stating if every decoded signal was within the error bound.
+ */
+bool BenchmarkADPCM()
+{
+	const uint16 channels = 2;
+	const uint64 frameCount = 48000 * 10;
+
+	Vector<int16> pcm(frameCount * channels);
+	for (uint64 i = 0; i < frameCount; i++)
+		for (uint16 c = 0; c < channels; c++)
+			pcm[i * channels + c] = static_cast<int16>(16000.0 * std::sin(i * 0.031 * (c + 1)));
+
+	Vector<float> block(256 * channels);
+	auto timeIt = [](auto&& function) {
+		const auto start = std::chrono::high_resolution_clock::now();
+		function();
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	};
+
+	const double pcmTime = timeIt([&]() {
+		for (uint64 frame = 0; frame + 256 <= frameCount; frame += 256)
+			EnSound::ConvertPCM16ToFloat(pcm.data() + frame * channels, block.data(), 256 * channels);
+		});
+	EnSound::Logger::LogInfo((STRING("PCM16: ") + std::to_wstring(pcmTime) + STRING(" ms")).c_str());
+
+	bool isPassed = true;
+	const EnSound::ADPCMType types[] = { EnSound::ADPCMType::ADPCM_TYPE_MICROSOFT, EnSound::ADPCMType::ADPCM_TYPE_IMA };
+	const wchar* names[] = { STRING("MS-ADPCM: "), STRING("IMA-ADPCM: ") };
+	for (uint32 i = 0; i < 2; i++)
+	{
+		EnSound::WAVData data = {};
+		data.mWAVFormat = EnSound::CreateADPCMFormat(types[i], channels, 48000);
+
+		Vector<uint8> encoded;
+		EnSound::EncodeADPCM(data.mWAVFormat, pcm.data(), frameCount, encoded);
+		data.pStartAudio = encoded.data();
+		data.mAudioBytes = static_cast<uint32>(encoded.size());
+
+		EnSound::ADPCMDecoder decoder;
+		decoder.Initialize(data);
+
+		const double adpcmTime = timeIt([&]() { while (decoder.Decode(block.data(), 256)); });
+		EnSound::Logger::LogInfo((names[i] + std::to_wstring(adpcmTime) + STRING(" ms (") + std::to_wstring(static_cast<double>(pcm.size() * sizeof(int16)) / encoded.size()) + STRING(":1)")).c_str());
+
+		// Both codecs keep a clean sine 40 dB above the round trip error.
+		Vector<float> decoded(pcm.size());
+		decoder.Seek(0);
+		if (decoder.Decode(decoded.data(), frameCount) != frameCount)
+		{
+			EnSound::Logger::LogError((WString(names[i]) + STRING("The round trip lost frames!")).c_str());
+			isPassed = false;
+			continue;
+		}
+
+		double signal = 0.0, noise = 0.0;
+		for (uint64 sample = 0; sample < pcm.size(); sample++)
+		{
+			const double input = pcm[sample] / 32768.0;
+			signal += input * input;
+			noise += (decoded[sample] - input) * (decoded[sample] - input);
+		}
+
+		const double snr = 10.0 * std::log10(signal / std::max(noise, 1e-20));
+		if (snr < 40.0)
+		{
+			EnSound::Logger::LogError((WString(names[i]) + STRING("The round trip is only ") + std::to_wstring(snr) + STRING(" dB above its error!")).c_str());
+			isPassed = false;
+		}
+	}
+
+	return isPassed;
+}
+
+/**
+ * Benchmark the cost of a single FDN reverb instance.
+ * A stereo bus is processed in 256 frame blocks with the parameters changing every block, as a moving listener would.
+ */
+void BenchmarkFDNReverb()
+{
+	const uint32 channels = 2;
+	const uint64 frameCount = 48000 * 10;
+
+	Vector<float> input(frameCount * channels);
+	for (uint64 i = 0; i < frameCount; i++)
+		for (uint32 c = 0; c < channels; c++)
+			input[i * channels + c] = static_cast<float>(0.5 * std::sin(i * 0.031 * (c + 1)));
+
+	Vector<float> block(256 * channels);
+	const uint32 lineCounts[] = { 8, 16 };
+	const EnSound::FDNMatrix matrices[] = { EnSound::FDNMatrix::FDN_MATRIX_HOUSEHOLDER, EnSound::FDNMatrix::FDN_MATRIX_HADAMARD };
+	const wchar* names[] = { STRING(" lines, Householder: "), STRING(" lines, Hadamard: ") };
+
+	for (const uint32 lineCount : lineCounts)
+	{
+		for (uint32 i = 0; i < 2; i++)
+		{
+			EnSound::FDNReverbDescription description = {};
+			description.mLineCount = lineCount;
+			description.mMatrix = matrices[i];
+
+			EnSound::FDNReverb reverb;
+			reverb.Initialize(description);
+
+			const auto start = std::chrono::high_resolution_clock::now();
+			for (uint64 frame = 0; frame + 256 <= frameCount; frame += 256)
+			{
+				std::copy(input.begin() + frame * channels, input.begin() + (frame + 256) * channels, block.begin());
+
+				EnSound::FDNReverbParameters parameters = reverb.GetParameters();
+				parameters.mSize = 0.5f + 0.25f * static_cast<float>(std::sin(frame * 0.0001));
+				reverb.SetParameters(parameters);
+				reverb.Process(block.data(), 256, channels);
+			}
+			const double time = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+			reverb.Terminate();
+
+			EnSound::Logger::LogInfo((STRING("FDN reverb, ") + std::to_wstring(lineCount) + names[i] + std::to_wstring(time) + STRING(" ms per 10 s (") + std::to_wstring(time / 100.0) + STRING("% of a core)")).c_str());
+		}
+	}
+}
+
+/**
+ * Check that voices hand back every LOD they read once they stop.
+ * Voices start quiet, loud and paused, switch LODs as their gains change, and are stopped mid crossfade.
+ *
+ * @return Boolean stating if the check passed.
+ */
+bool CheckLODReaders()
+{
+	const uint64 frameCount = 48000;
+	Vector<float> samples(frameCount);
+	for (uint64 i = 0; i < frameCount; i++)
+		samples[i] = static_cast<float>(0.5 * std::sin(i * 0.031));
+
+	EnSound::SampleLODSetDescription setDescription = {};
+	setDescription.pSamples = samples.data();
+	setDescription.mFrameCount = frameCount;
+	setDescription.mIsLooping = true;
+
+	EnSound::SampleLODSet set;
+	set.Initialize(setDescription);
+
+	EnSound::VoiceTable table;
+	table.Initialize(8);
+	table.SetLODGain(1, 0.5f);
+	table.SetLODGain(2, 0.25f);
+
+	EnSound::VoiceDescription description = {};
+	description.mIsLooping = true;
+	description.pLODSet = &set;
+
+	const float gains[] = { 0.1f, 1.0f, 0.1f, 0.3f };
+	uint64 handles[4] = {};
+	for (uint32 i = 0; i < 4; i++)
+	{
+		description.mGain = gains[i];
+		handles[i] = table.Play(description);
+	}
+
+	table.SetPaused(handles[2], true);
+
+	Vector<float> block(256 * 2);
+	for (uint32 step = 0; step < 8; step++)
+	{
+		table.Mix(block.data(), 256, 2);
+		table.SetGain(handles[step % 4], gains[(step + 1) % 4]);
+		if (step == 4)
+			table.SetPaused(handles[2], false);
+	}
+
+	for (const uint64 handle : handles)
+		table.Stop(handle);
+
+	bool isPassed = true;
+	for (uint32 lod = 0; lod < EnSound::SampleLODSet::MaxLODCount; lod++)
+		isPassed &= set.GetReaderCount(lod) == 0;
+
+	isPassed &= set.Evict(1) && set.Evict(2);
+	table.Terminate();
+	set.Terminate();
+
+	if (!isPassed)
+		EnSound::Logger::LogError(STRING("LOD reader counts did not return to 0!"));
+
+	return isPassed;
+}
 
 int main()
 {
 	EnSound::Logger::LogInfo(STRING("Welcome to EnSound!"));
+
+	bool isPassed = CheckLODReaders();
+
+	isPassed &= BenchmarkADPCM();
+	BenchmarkFDNReverb();
+
+	return isPassed ? 0 : 1;
 }
\ No newline at end of file
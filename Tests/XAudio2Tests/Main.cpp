@@ -2,9 +2,93 @@
 // SPDX-License-Identifier: Apache-2.0
 
 #include "XAudio2/XAudio2Backend.h"
+#include "XAudio2/Loaders/WAVLoader.h"
+#include "Core/Effects/ConvolutionReverb.h"
+#include "Core/Error/Logger.h"
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * Check that a WAVE_FORMAT_EXTENSIBLE float impulse response loads through the WAV loader and convolves as float.
+ * The file is built in memory: a 64 frame mono impulse with a single 0.5 tap.
+ *
+ * @return Boolean stating if the check passed.
+ */
+bool CheckExtensibleImpulse()
+{
+	Vector<uint8> bytes;
+	auto write = [&bytes](uint64 value, uint32 size) {
+		for (uint32 i = 0; i < size; i++)
+			bytes.push_back(static_cast<uint8>(value >> (i * 8)));
+	};
+
+	const uint32 frameCount = 64;
+	const uint8 floatGUID[16] = { 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00, 0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71 };
+
+	bytes.insert(bytes.end(), { 'R', 'I', 'F', 'F' });
+	write(4 + 8 + 40 + 8 + frameCount * 4, 4);
+	bytes.insert(bytes.end(), { 'W', 'A', 'V', 'E', 'f', 'm', 't', ' ' });
+	write(40, 4);
+	write(WAVE_FORMAT_EXTENSIBLE, 2);
+	write(1, 2);	// Channels.
+	write(48000, 4);	// Sample rate.
+	write(48000 * 4, 4);	// Average byte rate.
+	write(4, 2);	// Block alignment.
+	write(32, 2);	// Bits per sample.
+	write(22, 2);	// cbSize.
+	write(32, 2);	// Valid bits per sample.
+	write(SPEAKER_FRONT_CENTER, 4);
+	bytes.insert(bytes.end(), floatGUID, floatGUID + 16);
+	bytes.insert(bytes.end(), { 'd', 'a', 't', 'a' });
+	write(frameCount * 4, 4);
+
+	for (uint32 frame = 0; frame < frameCount; frame++)
+	{
+		const float sample = frame ? 0.0f : 0.5f;
+		uint32 bits = 0;
+		std::memcpy(&bits, &sample, sizeof(float));
+		write(bits, 4);
+	}
+
+	EnSound::WAVData data = {};
+	if (FAILED(EnSound::XAudio2::LoadWAVAudioInMemoryEx(bytes.data(), bytes.size(), data)) || std::memcmp(data.mWAVFormat.mSubFormat, floatGUID, 16))
+	{
+		EnSound::Logger::LogError(STRING("The extensible float impulse was not loaded!"));
+		return false;
+	}
+
+	EnSound::ConvolutionReverbDescription description = {};
+	description.mChannelCount = 1;
+	description.mDryGain = 0.0f;
+
+	EnSound::ConvolutionReverb reverb;
+	reverb.Initialize(description);
+	if (!reverb.LoadImpulse(data))
+	{
+		EnSound::Logger::LogError(STRING("The extensible float impulse was rejected!"));
+		return false;
+	}
+
+	// A unit impulse through the reverb gives back the impulse response.
+	Vector<float> block(description.mBlockFrames, 0.0f);
+	block[0] = 1.0f;
+	reverb.Process(block.data(), description.mBlockFrames, 1);
+	reverb.Terminate();
+
+	if (std::fabs(block[0] - 0.5f) > 1e-3f)
+	{
+		EnSound::Logger::LogError(STRING("The extensible float impulse was not decoded as float!"));
+		return false;
+	}
+
+	return true;
+}
 
 int main()
 {
+	const bool isPassed = CheckExtensibleImpulse();
+
 	EnSound::XAudio2::XAudio2Backend mBackend;
 	mBackend.Initialize();
 
@@ -14,4 +98,6 @@ int main()
 	mBackend.PlayAudioOnce(mHandle);
 
 	mBackend.Terminate();
+
+	return isPassed ? 0 : 1;
 }
\ No newline at end of file